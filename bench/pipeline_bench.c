@@ -0,0 +1,578 @@
+#define _GNU_SOURCE
+#include "h264_bitstream.h"
+#include "h264_synth.h"
+#include "h264_to_jpeg.h"
+#include "yuv_convert.h"
+#include "jpeg_sw_encoder.h"
+#include "jpeg_sw_internal.h"
+#include "pipeline_stats.h"
+#include "pipeline_cpu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+// Micro-benchmarks for the frame path plus end-to-end runs through the
+// software JPEG encoder, so results are comparable on any Linux host.
+// Where the VideoCore is available, generated H.264 also goes through
+// the hardware pipeline.
+// Results go to stdout as a table and optionally to a JSON file that a
+// later run can use as its baseline.
+
+#define MAX_RESULTS 32
+#define DEFAULT_THRESHOLD_PCT 10.0
+
+typedef struct {
+    char name[48];
+    int iterations;
+    double seconds;
+    double items_per_s;
+    double mb_per_s;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    double copies_per_frame;
+} bench_result_t;
+
+typedef struct {
+    const char* name;
+    void (*run)(void* context);
+    void* context;
+    uint64_t items;
+    uint64_t bytes;
+    uint64_t frame_bytes;
+} bench_case_t;
+
+typedef struct {
+    double min_seconds;
+    int min_iterations;
+    const char* filter;
+    bench_result_t results[MAX_RESULTS];
+    int result_count;
+} bench_runner_t;
+
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t next_random(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Smooth gradient with mild noise, which compresses like a camera frame
+static void fill_plane(uint8_t* plane, int stride, int width, int height, int phase) {
+    for (int y = 0; y < height; y++) {
+        uint8_t* row = plane + (size_t)y * stride;
+        for (int x = 0; x < width; x++) {
+            int value = ((x + phase) * 3 + y * 2) / 5 % 200 + 28 + (int)(next_random() % 9) - 4;
+            row[x] = (uint8_t)value;
+        }
+    }
+}
+
+static void run_case(bench_runner_t* runner, const bench_case_t* bench) {
+    if (runner->filter && !strstr(bench->name, runner->filter)) return;
+    if (runner->result_count >= MAX_RESULTS) return;
+
+    pipeline_histogram_t latency;
+    pipeline_histogram_reset(&latency);
+
+    bench->run(bench->context);
+
+    pipeline_stats_snapshot_t before;
+    pipeline_stats_snapshot_t after;
+    pipeline_stats_snapshot(&before);
+
+    uint64_t min_ns = (uint64_t)(runner->min_seconds * 1e9);
+    uint64_t start_ns = now_ns();
+    uint64_t elapsed_ns = 0;
+    int iterations = 0;
+
+    while (iterations < runner->min_iterations || elapsed_ns < min_ns) {
+        uint64_t iteration_start = now_ns();
+        bench->run(bench->context);
+        uint64_t iteration_end = now_ns();
+
+        pipeline_histogram_add(&latency, iteration_end - iteration_start);
+        elapsed_ns = iteration_end - start_ns;
+        iterations++;
+    }
+
+    pipeline_stats_snapshot(&after);
+
+    bench_result_t* result = &runner->results[runner->result_count++];
+    memset(result, 0, sizeof(bench_result_t));
+    snprintf(result->name, sizeof(result->name), "%s", bench->name);
+    result->iterations = iterations;
+    result->seconds = elapsed_ns / 1e9;
+    result->items_per_s = (double)bench->items * iterations / result->seconds;
+    result->mb_per_s = (double)bench->bytes * iterations / result->seconds / 1e6;
+    result->p50_ns = pipeline_histogram_percentile(&latency, 50.0);
+    result->p99_ns = pipeline_histogram_percentile(&latency, 99.0);
+    if (bench->frame_bytes > 0) {
+        uint64_t copied = after.counters[PIPELINE_COUNTER_BYTES_COPIED] -
+                          before.counters[PIPELINE_COUNTER_BYTES_COPIED];
+        result->copies_per_frame = (double)copied / ((double)bench->frame_bytes * iterations);
+    }
+
+    printf("%-24s %8d %14.1f %10.1f %12llu %12llu %8.2f\n",
+           result->name, result->iterations, result->items_per_s, result->mb_per_s,
+           (unsigned long long)result->p50_ns, (unsigned long long)result->p99_ns,
+           result->copies_per_frame);
+    fflush(stdout);
+}
+
+// NAL scanning over one generated GOP
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    int nal_count;
+} nal_context_t;
+
+static void nal_scan_run(void* context) {
+    nal_context_t* ctx = (nal_context_t*)context;
+    size_t offset = 0;
+    h264_nal_unit_t nal;
+    int count = 0;
+
+    while (h264_bitstream_next_nal(ctx->data, ctx->size, H264_FORMAT_ANNEXB, 4, &offset, &nal)) {
+        count++;
+    }
+    if (count != ctx->nal_count) {
+        fprintf(stderr, "nal_scan: found %d NAL units, expected %d\n", count, ctx->nal_count);
+        exit(2);
+    }
+}
+
+static bool nal_context_init(nal_context_t* ctx, int width, int height, int frames) {
+    memset(ctx, 0, sizeof(nal_context_t));
+
+    h264_synth_config_t config;
+    h264_synth_default_config(&config);
+    config.width = width;
+    config.height = height;
+    config.gop_length = frames;
+
+    h264_synth_t synth;
+    if (!h264_synth_init(&synth, &config)) return false;
+
+    bool ok = true;
+    for (int i = 0; i < frames && ok; i++) {
+        const uint8_t* data;
+        size_t size;
+        uint8_t* grown = NULL;
+        ok = h264_synth_next_frame(&synth, &data, &size, NULL) &&
+             (grown = realloc(ctx->data, ctx->size + size)) != NULL;
+        if (ok) {
+            ctx->data = grown;
+            memcpy(ctx->data + ctx->size, data, size);
+            ctx->size += size;
+            ctx->nal_count += i == 0 ? 3 : 1;
+        }
+    }
+
+    h264_synth_cleanup(&synth);
+    return ok;
+}
+
+// Plane copy from a decoder-style padded stride into a packed I420 frame
+
+typedef struct {
+    int width;
+    int height;
+    int src_stride;
+    int slice_height;
+    uint8_t* src;
+    uint8_t* dst;
+} copy_context_t;
+
+static void yuv_copy_run(void* context) {
+    copy_context_t* ctx = (copy_context_t*)context;
+    int chroma_width = ctx->width / 2;
+    int chroma_height = ctx->height / 2;
+    size_t src_y = (size_t)ctx->src_stride * ctx->slice_height;
+    size_t src_uv = (size_t)(ctx->src_stride / 2) * (ctx->slice_height / 2);
+    size_t dst_y = (size_t)ctx->width * ctx->height;
+    size_t dst_uv = (size_t)chroma_width * chroma_height;
+
+    yuv_copy_plane(ctx->dst, ctx->width, ctx->src, ctx->src_stride, ctx->width, ctx->height);
+    yuv_copy_plane(ctx->dst + dst_y, chroma_width, ctx->src + src_y, ctx->src_stride / 2,
+                   chroma_width, chroma_height);
+    yuv_copy_plane(ctx->dst + dst_y + dst_uv, chroma_width, ctx->src + src_y + src_uv, ctx->src_stride / 2,
+                   chroma_width, chroma_height);
+}
+
+static void chroma_interleave_run(void* context) {
+    copy_context_t* ctx = (copy_context_t*)context;
+    int chroma_width = ctx->width / 2;
+    int chroma_height = ctx->height / 2;
+    const uint8_t* u = ctx->src;
+    const uint8_t* v = ctx->src + (size_t)chroma_width * chroma_height;
+
+    yuv_interleave_chroma(ctx->dst, ctx->width, u, chroma_width, v, chroma_width, chroma_width, chroma_height);
+}
+
+// Huffman coding of pre-quantized blocks, isolated from the DCT
+
+typedef struct {
+    int16_t* blocks;
+    int block_count;
+    jpeg_sw_encoder_t encoder;
+    jpeg_sw_writer_t writer;
+} entropy_context_t;
+
+static void jpeg_entropy_run(void* context) {
+    entropy_context_t* ctx = (entropy_context_t*)context;
+    int last_dc = 0;
+
+    ctx->writer.length = 0;
+    ctx->writer.bits = 0;
+    ctx->writer.bit_count = 0;
+    for (int i = 0; i < ctx->block_count; i++) {
+        jpeg_sw_encode_block(&ctx->writer, &ctx->blocks[(size_t)i * 64], &last_dc,
+                             &ctx->encoder.dc_luma, &ctx->encoder.ac_luma);
+    }
+    jpeg_sw_writer_flush(&ctx->writer);
+}
+
+static void entropy_context_free(entropy_context_t* ctx) {
+    jpeg_sw_encoder_cleanup(&ctx->encoder);
+    free(ctx->blocks);
+    free(ctx->writer.data);
+    ctx->blocks = NULL;
+    ctx->writer.data = NULL;
+}
+
+static bool entropy_context_init(entropy_context_t* ctx, int width, int height, int quality) {
+    memset(ctx, 0, sizeof(entropy_context_t));
+    if (!jpeg_sw_encoder_init(&ctx->encoder, quality)) return false;
+
+    uint8_t* plane = malloc((size_t)width * height);
+    ctx->block_count = (width / 8) * (height / 8);
+    ctx->blocks = malloc((size_t)ctx->block_count * 64 * sizeof(int16_t));
+    if (!plane || !ctx->blocks ||
+        !jpeg_sw_writer_reserve(&ctx->writer, (size_t)ctx->block_count * JPEG_SW_BLOCK_BYTES)) {
+        free(plane);
+        entropy_context_free(ctx);
+        return false;
+    }
+
+    fill_plane(plane, width, width, height, 0);
+    int index = 0;
+    for (int y = 0; y + 8 <= height; y += 8) {
+        for (int x = 0; x + 8 <= width; x += 8) {
+            jpeg_sw_forward_dct(plane + (size_t)y * width + x, width, ctx->encoder.luma_scale,
+                                &ctx->blocks[(size_t)index++ * 64]);
+        }
+    }
+
+    free(plane);
+    return true;
+}
+
+// End to end: decoder-style copy out of a padded buffer, then JPEG encode
+
+typedef struct {
+    copy_context_t copy;
+    yuv420_frame_t frame;
+    jpeg_sw_encoder_t encoder;
+    size_t jpeg_size;
+} e2e_context_t;
+
+static void e2e_run(void* context) {
+    e2e_context_t* ctx = (e2e_context_t*)context;
+    uint8_t* jpeg = NULL;
+
+    yuv_copy_run(&ctx->copy);
+    if (!jpeg_sw_encoder_encode(&ctx->encoder, &ctx->frame, &jpeg, &ctx->jpeg_size)) {
+        fprintf(stderr, "encode failed: %s\n", jpeg_sw_encoder_get_error(&ctx->encoder));
+        exit(2);
+    }
+    jpeg_sw_encoder_free(jpeg);
+}
+
+static bool copy_context_init(copy_context_t* ctx, int width, int height) {
+    ctx->width = width;
+    ctx->height = height;
+    ctx->src_stride = (width + 31) & ~31;
+    ctx->slice_height = (height + 15) & ~15;
+
+    size_t y_size = (size_t)ctx->src_stride * ctx->slice_height;
+    ctx->src = malloc(y_size * 3 / 2);
+    ctx->dst = malloc((size_t)width * height * 3 / 2);
+    if (!ctx->src || !ctx->dst) return false;
+
+    fill_plane(ctx->src, ctx->src_stride, ctx->src_stride, ctx->slice_height, 0);
+    fill_plane(ctx->src + y_size, ctx->src_stride / 2, ctx->src_stride / 2, ctx->slice_height, 17);
+    return true;
+}
+
+static void copy_context_free(copy_context_t* ctx) {
+    free(ctx->src);
+    free(ctx->dst);
+}
+
+static void run_e2e(bench_runner_t* runner, int width, int height, int quality) {
+    char name[48];
+    snprintf(name, sizeof(name), "e2e_%dx%d_q%d", width, height, quality);
+    if (runner->filter && !strstr(name, runner->filter)) return;
+
+    e2e_context_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    if (!copy_context_init(&ctx.copy, width, height) || !jpeg_sw_encoder_init(&ctx.encoder, quality)) {
+        fprintf(stderr, "%s: setup failed\n", name);
+        copy_context_free(&ctx.copy);
+        return;
+    }
+
+    size_t y_size = (size_t)width * height;
+    ctx.frame.width = width;
+    ctx.frame.height = height;
+    ctx.frame.y_plane = ctx.copy.dst;
+    ctx.frame.u_plane = ctx.copy.dst + y_size;
+    ctx.frame.v_plane = ctx.copy.dst + y_size + y_size / 4;
+    ctx.frame.y_size = (int)y_size;
+    ctx.frame.uv_size = (int)(y_size / 4);
+
+    bench_case_t bench = {name, e2e_run, &ctx, 1, y_size * 3 / 2, y_size * 3 / 2};
+    run_case(runner, &bench);
+
+    jpeg_sw_encoder_cleanup(&ctx.encoder);
+    copy_context_free(&ctx.copy);
+}
+
+// Hardware decode and encode of a generated IDR access unit
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    int quality;
+} hw_context_t;
+
+static void hw_e2e_run(void* context) {
+    hw_context_t* ctx = (hw_context_t*)context;
+    uint8_t* jpeg = NULL;
+    size_t jpeg_size = 0;
+
+    if (!h264_to_jpeg(ctx->data, ctx->size, &jpeg, &jpeg_size, ctx->quality)) {
+        fprintf(stderr, "conversion failed: %s\n", h264_to_jpeg_get_error());
+        exit(2);
+    }
+    h264_to_jpeg_free(jpeg);
+}
+
+static void run_hw_e2e(bench_runner_t* runner, int width, int height, int quality) {
+    char name[48];
+    snprintf(name, sizeof(name), "hw_e2e_%dx%d_q%d", width, height, quality);
+    if (runner->filter && !strstr(name, runner->filter)) return;
+
+    // A quarter of the macroblocks as I_PCM keeps 1080p IDRs under the
+    // default 1 MB access unit limit
+    h264_synth_config_t config;
+    h264_synth_default_config(&config);
+    config.width = width;
+    config.height = height;
+    config.pcm_percent = 25;
+
+    h264_synth_t synth;
+    hw_context_t ctx;
+    if (!h264_synth_init(&synth, &config) || !h264_synth_next_frame(&synth, &ctx.data, &ctx.size, NULL)) {
+        fprintf(stderr, "%s: %s\n", name, h264_synth_get_error(&synth));
+        h264_synth_cleanup(&synth);
+        return;
+    }
+    ctx.quality = quality;
+
+    bench_case_t bench = {name, hw_e2e_run, &ctx, 1, ctx.size, 0};
+    run_case(runner, &bench);
+    h264_synth_cleanup(&synth);
+}
+
+static long peak_rss_kb(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_maxrss;
+}
+
+static bool write_json(const bench_runner_t* runner, const char* path, bool quick) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return false;
+    }
+
+    // One benchmark per line keeps the file diffable and easy to read back
+    fprintf(file, "{\n  \"schema\": 1,\n  \"quick\": %s,\n  \"cpu\": \"%s\",\n  \"peak_rss_kb\": %ld,\n"
+            "  \"benchmarks\": [\n",
+            quick ? "true" : "false", pipeline_cpu_level_name(pipeline_cpu_get_level()), peak_rss_kb());
+    for (int i = 0; i < runner->result_count; i++) {
+        const bench_result_t* r = &runner->results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"iterations\": %d, \"seconds\": %.3f, "
+                "\"items_per_s\": %.1f, \"mb_per_s\": %.1f, \"p50_ns\": %llu, \"p99_ns\": %llu, "
+                "\"copies_per_frame\": %.2f}%s\n",
+                r->name, r->iterations, r->seconds, r->items_per_s, r->mb_per_s,
+                (unsigned long long)r->p50_ns, (unsigned long long)r->p99_ns,
+                r->copies_per_frame, i + 1 < runner->result_count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    return fclose(file) == 0;
+}
+
+static bool find_baseline(const char* path, const char* name, double* items_per_s) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"name\": \"%s\"", name);
+
+    char line[512];
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), file)) {
+        const char* rate = strstr(line, "\"items_per_s\": ");
+        if (strstr(line, pattern) && rate) {
+            found = sscanf(rate, "\"items_per_s\": %lf", items_per_s) == 1;
+        }
+    }
+
+    fclose(file);
+    return found;
+}
+
+static int compare_baseline(const bench_runner_t* runner, const char* path, double threshold_pct) {
+    FILE* probe = fopen(path, "r");
+    if (!probe) {
+        fprintf(stderr, "Failed to open baseline %s\n", path);
+        return -1;
+    }
+    fclose(probe);
+
+    int regressions = 0;
+    printf("\nBaseline %s (threshold %.1f%%)\n", path, threshold_pct);
+    for (int i = 0; i < runner->result_count; i++) {
+        const bench_result_t* r = &runner->results[i];
+        double baseline;
+        if (!find_baseline(path, r->name, &baseline) || baseline <= 0.0) {
+            printf("%-24s %10s\n", r->name, "new");
+            continue;
+        }
+
+        double change = (r->items_per_s - baseline) / baseline * 100.0;
+        bool regressed = change < -threshold_pct;
+        printf("%-24s %+9.1f%%%s\n", r->name, change, regressed ? "  REGRESSION" : "");
+        if (regressed) {
+            regressions++;
+        }
+    }
+    return regressions;
+}
+
+static void usage(const char* program) {
+    printf("Usage: %s [--json file] [--baseline file] [--threshold pct] [--filter name] [--quick]\n",
+           program);
+}
+
+int main(int argc, char* argv[]) {
+    const char* json_path = NULL;
+    const char* baseline_path = NULL;
+    double threshold_pct = DEFAULT_THRESHOLD_PCT;
+    bool quick = false;
+
+    bench_runner_t runner;
+    memset(&runner, 0, sizeof(runner));
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold_pct = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            runner.filter = argv[++i];
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else {
+            usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    runner.min_seconds = quick ? 0.05 : 0.5;
+    runner.min_iterations = quick ? 3 : 10;
+
+    // H264JPEG_CPU=scalar (or sse2, neon, ...) compares kernel levels on one machine
+    printf("CPU kernels: %s (detected %s)\n\n", pipeline_cpu_level_name(pipeline_cpu_get_level()),
+           pipeline_cpu_level_name(pipeline_cpu_detect()));
+    printf("%-24s %8s %14s %10s %12s %12s %8s\n",
+           "benchmark", "iters", "items/s", "MB/s", "p50 ns", "p99 ns", "copies");
+
+    nal_context_t nal;
+    if (nal_context_init(&nal, 1280, 720, 30)) {
+        bench_case_t bench = {"nal_scan", nal_scan_run, &nal, (uint64_t)nal.nal_count, nal.size, 0};
+        run_case(&runner, &bench);
+    }
+    free(nal.data);
+
+    copy_context_t copy;
+    memset(&copy, 0, sizeof(copy));
+    if (copy_context_init(&copy, 1920, 1080)) {
+        uint64_t frame_bytes = 1920 * 1080 * 3 / 2;
+        bench_case_t bench = {"yuv_copy_1080p", yuv_copy_run, &copy, 1, frame_bytes, frame_bytes};
+        run_case(&runner, &bench);
+
+        uint64_t chroma_bytes = 960 * 540 * 2;
+        bench_case_t interleave = {"chroma_interleave_1080p", chroma_interleave_run, &copy, 1,
+                                   chroma_bytes, chroma_bytes};
+        run_case(&runner, &interleave);
+    }
+    copy_context_free(&copy);
+
+    entropy_context_t entropy;
+    if (entropy_context_init(&entropy, 1280, 720, JPEG_SW_ENCODER_DEFAULT_QUALITY)) {
+        bench_case_t bench = {"jpeg_entropy", jpeg_entropy_run, &entropy, (uint64_t)entropy.block_count,
+                              (uint64_t)entropy.block_count * 64, 0};
+        run_case(&runner, &bench);
+        entropy_context_free(&entropy);
+    }
+
+    static const int sizes[][2] = {{640, 480}, {1280, 720}, {1920, 1080}};
+    static const int qualities[] = {50, 85, 95};
+    for (int s = 0; s < 3; s++) {
+        for (int q = 0; q < 3; q++) {
+            if (quick && q != 1) continue;
+            run_e2e(&runner, sizes[s][0], sizes[s][1], qualities[q]);
+        }
+    }
+
+    if (h264_hw_decoder_available()) {
+        for (int s = 0; s < 3; s++) {
+            run_hw_e2e(&runner, sizes[s][0], sizes[s][1], 85);
+        }
+    }
+
+    printf("\nPeak RSS: %ld KB\n", peak_rss_kb());
+
+    if (json_path) {
+        if (!write_json(&runner, json_path, quick)) {
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+
+    if (baseline_path) {
+        int regressions = compare_baseline(&runner, baseline_path, threshold_pct);
+        if (regressions != 0) {
+            printf("%s\n", regressions < 0 ? "Baseline comparison failed" : "Performance regression detected");
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,467 @@
+#define _GNU_SOURCE
+#include "h264_synth.h"
+#include "jpeg_sw_encoder.h"
+#include "jpeg_sw_decoder.h"
+#include "mjpeg_hw_encoder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+// Sweeps JPEG encoder settings over a corpus of decoded frames and reports
+// size, encode time, PSNR and SSIM for each, marking the settings that are
+// Pareto-optimal (no other setting is smaller, faster and at least as good).
+// Every JPEG is decoded again with the software decoder and compared with
+// the source YUV, so hardware and software output are measured the same way.
+// The corpus is a raw I420 file (e.g. dumped with ffmpeg -pix_fmt yuv420p)
+// or, without one, frames from the synthetic H.264 generator.
+
+#define MAX_FRAMES 64
+#define MAX_POINTS 256
+#define PSNR_MAX 100.0
+
+typedef enum {
+    ENCODER_SW,
+    ENCODER_SW_OPTIMIZED,
+    ENCODER_HW
+} encoder_kind_t;
+
+static const char* encoder_names[] = {"sw", "sw-opt", "hw"};
+
+typedef struct {
+    encoder_kind_t encoder;
+    int quality;
+    double bytes;
+    double bits_per_pixel;
+    double encode_ms;
+    double psnr_y;
+    double psnr;
+    double ssim;
+    double min_ssim;
+    bool frontier;
+} sweep_point_t;
+
+typedef struct {
+    yuv420_frame_t frames[MAX_FRAMES];
+    int frame_count;
+} corpus_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static bool alloc_frame(yuv420_frame_t* frame, int width, int height) {
+    frame->width = width;
+    frame->height = height;
+    frame->y_size = width * height;
+    frame->uv_size = (width / 2) * (height / 2);
+    frame->y_plane = malloc((size_t)frame->y_size + 2 * (size_t)frame->uv_size);
+    frame->u_plane = frame->y_plane + frame->y_size;
+    frame->v_plane = frame->u_plane + frame->uv_size;
+    return frame->y_plane != NULL;
+}
+
+static bool load_yuv(corpus_t* corpus, const char* path, int width, int height, int max_frames) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+
+    while (corpus->frame_count < max_frames) {
+        yuv420_frame_t* frame = &corpus->frames[corpus->frame_count];
+        if (!alloc_frame(frame, width, height)) break;
+
+        size_t size = (size_t)frame->y_size + 2 * (size_t)frame->uv_size;
+        if (fread(frame->y_plane, 1, size, file) != size) {
+            free(frame->y_plane);
+            break;
+        }
+        corpus->frame_count++;
+    }
+
+    fclose(file);
+    if (corpus->frame_count == 0) {
+        fprintf(stderr, "%s holds no complete %dx%d I420 frame\n", path, width, height);
+        return false;
+    }
+    return true;
+}
+
+static bool load_synthetic(corpus_t* corpus, int width, int height, int max_frames) {
+    h264_synth_config_t config;
+    h264_synth_default_config(&config);
+    config.width = width;
+    config.height = height;
+    config.gop_length = 1;
+    config.pcm_percent = 50;
+
+    h264_synth_t synth;
+    if (!h264_synth_init(&synth, &config)) {
+        fprintf(stderr, "%s\n", h264_synth_get_error(&synth));
+        return false;
+    }
+
+    while (corpus->frame_count < max_frames) {
+        const uint8_t* data;
+        size_t size;
+        yuv420_frame_t expected;
+        yuv420_frame_t* frame = &corpus->frames[corpus->frame_count];
+        if (!h264_synth_next_frame(&synth, &data, &size, &expected) || !alloc_frame(frame, width, height)) {
+            break;
+        }
+        memcpy(frame->y_plane, expected.y_plane, (size_t)expected.y_size + 2 * (size_t)expected.uv_size);
+        corpus->frame_count++;
+    }
+
+    h264_synth_cleanup(&synth);
+    return corpus->frame_count > 0;
+}
+
+static uint64_t squared_error(const uint8_t* a, const uint8_t* b, size_t count) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        int diff = (int)a[i] - (int)b[i];
+        sum += (uint64_t)(diff * diff);
+    }
+    return sum;
+}
+
+static double psnr(uint64_t error, size_t count) {
+    if (error == 0) return PSNR_MAX;
+    double mse = (double)error / (double)count;
+    return 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+// Mean SSIM over 8x8 windows on a 4-pixel grid, uniform weights
+static double ssim_plane(const uint8_t* a, const uint8_t* b, int width, int height) {
+    const double c1 = (0.01 * 255) * (0.01 * 255);
+    const double c2 = (0.03 * 255) * (0.03 * 255);
+    int window = width < 8 || height < 8 ? (width < height ? width : height) : 8;
+    double total = 0.0;
+    int windows = 0;
+
+    for (int y = 0; y + window <= height; y += 4) {
+        for (int x = 0; x + window <= width; x += 4) {
+            uint64_t sum_a = 0, sum_b = 0, sum_aa = 0, sum_bb = 0, sum_ab = 0;
+            for (int row = 0; row < window; row++) {
+                const uint8_t* pa = a + (size_t)(y + row) * width + x;
+                const uint8_t* pb = b + (size_t)(y + row) * width + x;
+                for (int col = 0; col < window; col++) {
+                    sum_a += pa[col];
+                    sum_b += pb[col];
+                    sum_aa += (uint64_t)pa[col] * pa[col];
+                    sum_bb += (uint64_t)pb[col] * pb[col];
+                    sum_ab += (uint64_t)pa[col] * pb[col];
+                }
+            }
+
+            double n = (double)(window * window);
+            double mean_a = sum_a / n;
+            double mean_b = sum_b / n;
+            double var_a = sum_aa / n - mean_a * mean_a;
+            double var_b = sum_bb / n - mean_b * mean_b;
+            double covariance = sum_ab / n - mean_a * mean_b;
+            total += ((2 * mean_a * mean_b + c1) * (2 * covariance + c2)) /
+                     ((mean_a * mean_a + mean_b * mean_b + c1) * (var_a + var_b + c2));
+            windows++;
+        }
+    }
+
+    return windows ? total / windows : 1.0;
+}
+
+static bool encode_frame(encoder_kind_t kind, jpeg_sw_encoder_t* sw, mjpeg_hw_encoder_t* hw,
+                         const yuv420_frame_t* frame, uint8_t** jpeg, size_t* size) {
+    if (kind == ENCODER_HW) {
+        return mjpeg_hw_encoder_encode(hw, frame, jpeg, size);
+    }
+    return jpeg_sw_encoder_encode(sw, frame, jpeg, size);
+}
+
+static void free_jpeg(encoder_kind_t kind, uint8_t* jpeg) {
+    if (kind == ENCODER_HW) {
+        mjpeg_hw_encoder_free(jpeg);
+    } else {
+        jpeg_sw_encoder_free(jpeg);
+    }
+}
+
+static bool measure(const corpus_t* corpus, encoder_kind_t kind, int quality, jpeg_sw_decoder_t* decoder,
+                    sweep_point_t* point) {
+    jpeg_sw_encoder_t sw;
+    mjpeg_hw_encoder_t hw;
+    memset(point, 0, sizeof(*point));
+    point->encoder = kind;
+    point->quality = quality;
+    point->min_ssim = 1.0;
+
+    if (kind == ENCODER_HW) {
+        if (!mjpeg_hw_encoder_init(&hw, quality) || !hw.hw_available) {
+            fprintf(stderr, "hw q%d: %s\n", quality, mjpeg_hw_encoder_get_error(&hw));
+            mjpeg_hw_encoder_cleanup(&hw);
+            return false;
+        }
+    } else {
+        jpeg_sw_encoder_init(&sw, quality);
+        jpeg_sw_encoder_set_optimize_huffman(&sw, kind == ENCODER_SW_OPTIMIZED);
+    }
+
+    bool ok = true;
+    uint64_t total_ns = 0;
+    for (int i = 0; i < corpus->frame_count && ok; i++) {
+        const yuv420_frame_t* source = &corpus->frames[i];
+        uint8_t* jpeg = NULL;
+        size_t size = 0;
+
+        uint64_t start_ns = now_ns();
+        if (!encode_frame(kind, &sw, &hw, source, &jpeg, &size)) {
+            fprintf(stderr, "%s q%d: %s\n", encoder_names[kind], quality,
+                    kind == ENCODER_HW ? mjpeg_hw_encoder_get_error(&hw) : jpeg_sw_encoder_get_error(&sw));
+            ok = false;
+            break;
+        }
+        total_ns += now_ns() - start_ns;
+
+        yuv420_frame_t decoded;
+        if (!jpeg_sw_decoder_decode(decoder, jpeg, size, &decoded) ||
+            decoded.width != source->width || decoded.height != source->height) {
+            fprintf(stderr, "%s q%d: %s\n", encoder_names[kind], quality, jpeg_sw_decoder_get_error(decoder));
+            free_jpeg(kind, jpeg);
+            ok = false;
+            break;
+        }
+
+        uint64_t error_y = squared_error(source->y_plane, decoded.y_plane, (size_t)source->y_size);
+        uint64_t error_uv = squared_error(source->u_plane, decoded.u_plane, (size_t)source->uv_size) +
+                            squared_error(source->v_plane, decoded.v_plane, (size_t)source->uv_size);
+        double ssim = ssim_plane(source->y_plane, decoded.y_plane, source->width, source->height);
+
+        point->bytes += (double)size;
+        point->psnr_y += psnr(error_y, (size_t)source->y_size);
+        point->psnr += psnr(error_y + error_uv, (size_t)source->y_size + 2 * (size_t)source->uv_size);
+        point->ssim += ssim;
+        if (ssim < point->min_ssim) {
+            point->min_ssim = ssim;
+        }
+        free_jpeg(kind, jpeg);
+    }
+
+    if (kind == ENCODER_HW) {
+        mjpeg_hw_encoder_cleanup(&hw);
+    } else {
+        jpeg_sw_encoder_cleanup(&sw);
+    }
+    if (!ok) return false;
+
+    double frames = corpus->frame_count;
+    const yuv420_frame_t* first = &corpus->frames[0];
+    point->bytes /= frames;
+    point->bits_per_pixel = point->bytes * 8.0 / ((double)first->width * first->height);
+    point->encode_ms = (double)total_ns / frames / 1e6;
+    point->psnr_y /= frames;
+    point->psnr /= frames;
+    point->ssim /= frames;
+    return true;
+}
+
+static double score(const sweep_point_t* point, bool use_psnr) {
+    return use_psnr ? point->psnr : point->ssim;
+}
+
+static bool dominates(const sweep_point_t* a, const sweep_point_t* b, bool use_psnr) {
+    bool no_worse = a->bytes <= b->bytes && a->encode_ms <= b->encode_ms &&
+                    score(a, use_psnr) >= score(b, use_psnr);
+    bool better = a->bytes < b->bytes || a->encode_ms < b->encode_ms ||
+                  score(a, use_psnr) > score(b, use_psnr);
+    return no_worse && better;
+}
+
+static void mark_frontier(sweep_point_t* points, int count, bool use_psnr) {
+    for (int i = 0; i < count; i++) {
+        points[i].frontier = true;
+        for (int j = 0; j < count && points[i].frontier; j++) {
+            if (j != i && dominates(&points[j], &points[i], use_psnr)) {
+                points[i].frontier = false;
+            }
+        }
+    }
+}
+
+static void print_point(const sweep_point_t* point) {
+    printf("%c %-7s %4d %10.0f %7.3f %9.3f %8.2f %8.2f %7.4f %7.4f\n",
+           point->frontier ? '*' : ' ', encoder_names[point->encoder], point->quality, point->bytes,
+           point->bits_per_pixel, point->encode_ms, point->psnr_y, point->psnr, point->ssim, point->min_ssim);
+}
+
+static int compare_bytes(const void* a, const void* b) {
+    double diff = ((const sweep_point_t*)a)->bytes - ((const sweep_point_t*)b)->bytes;
+    return diff < 0 ? -1 : diff > 0 ? 1 : 0;
+}
+
+static bool write_csv(const sweep_point_t* points, int count, const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "encoder,quality,bytes,bits_per_pixel,encode_ms,psnr_y,psnr,ssim,min_ssim,frontier\n");
+    for (int i = 0; i < count; i++) {
+        const sweep_point_t* p = &points[i];
+        fprintf(file, "%s,%d,%.0f,%.4f,%.4f,%.3f,%.3f,%.5f,%.5f,%d\n", encoder_names[p->encoder], p->quality,
+                p->bytes, p->bits_per_pixel, p->encode_ms, p->psnr_y, p->psnr, p->ssim, p->min_ssim,
+                p->frontier ? 1 : 0);
+    }
+    fclose(file);
+    return true;
+}
+
+static bool has_encoder(const char* list, encoder_kind_t kind) {
+    size_t length = strlen(encoder_names[kind]);
+    for (const char* item = list; item; item = strchr(item, ',') ? strchr(item, ',') + 1 : NULL) {
+        if (strncmp(item, encoder_names[kind], length) == 0 && (item[length] == ',' || item[length] == '\0')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void usage(const char* program) {
+    printf("Usage: %s [--yuv file --size WxH] [--frames n] [--qualities min:max:step]\n"
+           "          [--encoders sw,sw-opt,hw] [--metric ssim|psnr] [--target value] [--csv file]\n",
+           program);
+}
+
+int main(int argc, char* argv[]) {
+    const char* yuv_path = NULL;
+    const char* csv_path = NULL;
+    const char* encoders = "sw,sw-opt,hw";
+    int width = 640;
+    int height = 480;
+    int max_frames = 8;
+    int min_quality = 30;
+    int max_quality = 95;
+    int step = 5;
+    bool use_psnr = false;
+    double target = 0.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--yuv") == 0 && i + 1 < argc) {
+            yuv_path = argv[++i];
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc &&
+                   sscanf(argv[i + 1], "%dx%d", &width, &height) == 2) {
+            i++;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            max_frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--qualities") == 0 && i + 1 < argc &&
+                   sscanf(argv[i + 1], "%d:%d:%d", &min_quality, &max_quality, &step) == 3) {
+            i++;
+        } else if (strcmp(argv[i], "--encoders") == 0 && i + 1 < argc) {
+            encoders = argv[++i];
+        } else if (strcmp(argv[i], "--metric") == 0 && i + 1 < argc) {
+            use_psnr = strcmp(argv[++i], "psnr") == 0;
+        } else if (strcmp(argv[i], "--target") == 0 && i + 1 < argc) {
+            target = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    if (width < 16 || height < 16 || width % 2 || height % 2 || min_quality < 1 || max_quality > 100 ||
+        min_quality > max_quality || step < 1 || max_frames < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (max_frames > MAX_FRAMES) {
+        max_frames = MAX_FRAMES;
+    }
+
+    corpus_t corpus;
+    memset(&corpus, 0, sizeof(corpus));
+    bool loaded = yuv_path ? load_yuv(&corpus, yuv_path, width, height, max_frames)
+                           : load_synthetic(&corpus, width, height, max_frames);
+    if (!loaded) {
+        return 1;
+    }
+
+    printf("Corpus: %d frame%s, %dx%d (%s)\n\n", corpus.frame_count, corpus.frame_count == 1 ? "" : "s",
+           width, height, yuv_path ? yuv_path : "synthetic");
+
+    bool enabled[3] = {
+        has_encoder(encoders, ENCODER_SW),
+        has_encoder(encoders, ENCODER_SW_OPTIMIZED),
+        has_encoder(encoders, ENCODER_HW) && mjpeg_hw_encoder_available()
+    };
+
+    jpeg_sw_decoder_t decoder;
+    jpeg_sw_decoder_init(&decoder);
+
+    sweep_point_t points[MAX_POINTS];
+    int count = 0;
+    for (int kind = ENCODER_SW; kind <= ENCODER_HW; kind++) {
+        if (!enabled[kind]) continue;
+        for (int quality = min_quality; quality <= max_quality && count < MAX_POINTS; quality += step) {
+            if (measure(&corpus, (encoder_kind_t)kind, quality, &decoder, &points[count])) {
+                count++;
+            }
+        }
+    }
+    jpeg_sw_decoder_cleanup(&decoder);
+
+    mark_frontier(points, count, use_psnr);
+
+    printf("  %-7s %4s %10s %7s %9s %8s %8s %7s %7s\n",
+           "encoder", "q", "bytes", "bpp", "enc ms", "PSNR-Y", "PSNR", "SSIM", "minSSIM");
+    for (int i = 0; i < count; i++) {
+        print_point(&points[i]);
+    }
+
+    sweep_point_t frontier[MAX_POINTS];
+    int frontier_count = 0;
+    for (int i = 0; i < count; i++) {
+        if (points[i].frontier) {
+            frontier[frontier_count++] = points[i];
+        }
+    }
+    qsort(frontier, (size_t)frontier_count, sizeof(sweep_point_t), compare_bytes);
+
+    printf("\nPareto frontier (bytes, encode time, %s):\n", use_psnr ? "PSNR" : "SSIM");
+    for (int i = 0; i < frontier_count; i++) {
+        print_point(&frontier[i]);
+    }
+
+    if (target > 0.0) {
+        const sweep_point_t* best = NULL;
+        for (int i = 0; i < frontier_count; i++) {
+            if (score(&frontier[i], use_psnr) >= target && !best) {
+                best = &frontier[i];
+            }
+        }
+        if (best) {
+            printf("\nSmallest frontier setting reaching %s %.4g: %s quality %d (%.0f bytes, %.3f ms)\n",
+                   use_psnr ? "PSNR" : "SSIM", target, encoder_names[best->encoder], best->quality,
+                   best->bytes, best->encode_ms);
+        } else {
+            printf("\nNo setting reaches %s %.4g\n", use_psnr ? "PSNR" : "SSIM", target);
+        }
+    }
+
+    if (csv_path) {
+        if (!write_csv(points, count, csv_path)) {
+            return 1;
+        }
+        printf("Results written to %s\n", csv_path);
+    }
+
+    for (int i = 0; i < corpus.frame_count; i++) {
+        free(corpus.frames[i].y_plane);
+    }
+    return count > 0 ? 0 : 1;
+}
@@ -1,139 +1,65 @@
+#define _GNU_SOURCE
 #include "h264_to_jpeg.h"
 #include "h264_hw_decoder.h"
 #include "mjpeg_hw_encoder.h"
+#include "v4l2_capture.h"
+#include "h264_bitstream.h"
+#include "h264_snapshot.h"
+#include "frame_queue.h"
+#include "pipeline_latency.h"
+#include "pipeline_stats.h"
+#include "pipeline_metrics.h"
+#include "pipeline_trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
-#include <unistd.h>
-#include <fcntl.h>
-#include <sys/ioctl.h>
-#include <sys/mman.h>
-#include <errno.h>
 #include <signal.h>
-#include <time.h>
+#include <pthread.h>
 
-#include "videodev2.h"
-static int video_fd = -1;
-static void* buffers[4] = {NULL};
-static int buffer_count = 0;
-static bool running = true;
+static v4l2_capture_t capture;
+static h264_snapshot_t snapshot;
+static frame_queue_t queue;
+static pipeline_metrics_server_t metrics;
+static v4l2_capture_recorder_t recorder;
+static int metrics_running = 0;
 
-static void signal_handler(int sig) {
-    printf("\n🛑 Received signal %d, shutting down gracefully...\n", sig);
-    running = false;
-}
-
-static bool v4l2_set_format(int fd, int width, int height) {
-    struct v4l2_format fmt = {0};
-    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    fmt.fmt.pix.width = width;
-    fmt.fmt.pix.height = height;
-    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_H264;
-    fmt.fmt.pix.field = V4L2_FIELD_INTERLACED;
-    
-    if (ioctl(fd, VIDIOC_S_FMT, &fmt) == -1) {
-        printf("❌ Failed to set format: %s\n", strerror(errno));
-        return false;
-    }
-    
-    printf("✅ Format set: %dx%d H.264\n", fmt.fmt.pix.width, fmt.fmt.pix.height);
-    return true;
-}
-
-static bool v4l2_request_buffers(int fd, int count) {
-    struct v4l2_requestbuffers req = {0};
-    req.count = count;
-    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    req.memory = V4L2_MEMORY_MMAP;
-    
-    if (ioctl(fd, VIDIOC_REQBUFS, &req) == -1) {
-        printf("❌ Failed to request buffers: %s\n", strerror(errno));
-        return false;
-    }
-    
-    if (req.count < count) {
-        printf("⚠️  Warning: requested %d buffers, got %d\n", count, req.count);
-    }
-    
-    buffer_count = req.count;
-    printf("✅ Allocated %d buffers\n", buffer_count);
-    return true;
-}
+typedef struct {
+    int frame_count;
+    int converted_count;
+    int idr_count;
+    pipeline_latency_t latency;
+} capture_stats_t;
 
-static bool v4l2_map_buffers(int fd) {
-    struct v4l2_buffer buf = {0};
-    
-    for (int i = 0; i < buffer_count; i++) {
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
-        
-        if (ioctl(fd, VIDIOC_QUERYBUF, &buf) == -1) {
-            printf("❌ Failed to query buffer %d: %s\n", i, strerror(errno));
-            return false;
-        }
-        
-        buffers[i] = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
-        if (buffers[i] == MAP_FAILED) {
-            printf("❌ Failed to map buffer %d: %s\n", i, strerror(errno));
-            return false;
-        }
-        
-        printf("✅ Mapped buffer %d: %zu bytes\n", i, buf.length);
-    }
-    
-    return true;
-}
-
-static bool v4l2_start_capture(int fd) {
-    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    
-    if (ioctl(fd, VIDIOC_STREAMON, &type) == -1) {
-        printf("❌ Failed to start capture: %s\n", strerror(errno));
-        return false;
+static void signal_handler(int sig) {
+    if (sig == SIGUSR1) {
+        h264_snapshot_request(&snapshot);
+        return;
     }
-    
-    printf("✅ Capture started\n");
-    return true;
+    v4l2_capture_request_stop(&capture);
 }
 
-static bool v4l2_stop_capture(int fd) {
-    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+static void on_snapshot(const uint8_t* jpeg_data, size_t jpeg_size, uint64_t timestamp_us, void* userdata) {
+    (void)userdata;
     
-    if (ioctl(fd, VIDIOC_STREAMOFF, &type) == -1) {
-        printf("❌ Failed to stop capture: %s\n", strerror(errno));
-        return false;
-    }
+    char filename[256];
+    snprintf(filename, sizeof(filename), "tmp/snapshot_%llu.jpg", (unsigned long long)timestamp_us);
     
-    printf("✅ Capture stopped\n");
-    return true;
-}
-
-static bool is_idr_frame(const uint8_t* data, size_t size) {
-    if (size < 5) return false;
-    
-    for (size_t i = 0; i < size - 4; i++) {
-        if ((data[i] == 0x00 && data[i+1] == 0x00 && data[i+2] == 0x00 && data[i+3] == 0x01) ||
-            (data[i] == 0x00 && data[i+1] == 0x00 && data[i+2] == 0x01)) {
-            
-            size_t nal_offset = (data[i+2] == 0x01) ? 3 : 4;
-            if (i + nal_offset < size) {
-                uint8_t nal_type = data[i + nal_offset] & 0x1F;
-                if (nal_type == 5) {
-                    return true;
-                }
-            }
-        }
+    FILE* file = fopen(filename, "wb");
+    if (file) {
+        fwrite(jpeg_data, 1, jpeg_size, file);
+        fclose(file);
+        printf("📷 Snapshot saved: %s (%zu bytes)\n", filename, jpeg_size);
+    } else {
+        printf("❌ Failed to save %s\n", filename);
     }
-    
-    return false;
 }
 
-static bool process_h264_frame(const uint8_t* h264_data, size_t h264_size, int frame_number) {
-    printf("📸 Processing frame %d (%zu bytes)\n", frame_number, h264_size);
+static bool process_h264_frame(const v4l2_capture_frame_t* frame, int frame_number, bool is_idr,
+                               pipeline_latency_t* latency) {
+    printf("📸 Processing frame %d (%zu bytes)\n", frame_number, frame->size);
     
-    if (!is_idr_frame(h264_data, h264_size)) {
+    if (!is_idr) {
         printf("⏭️  Skipping non-IDR frame %d\n", frame_number);
         return true;
     }
@@ -142,22 +68,33 @@ static bool process_h264_frame(const uint8_t* h264_data, size_t h264_size, int f
     uint8_t* jpeg_data = NULL;
     size_t jpeg_size = 0;
     
-    if (h264_to_jpeg(h264_data, h264_size, &jpeg_data, &jpeg_size, 85)) {
+    // The record carries the capture timestamp through decode and
+    // encode; exported capture buffers go to the decoder as DMABUFs
+    pipeline_latency_record_t record;
+    pipeline_latency_begin(&record, frame);
+    bool converted = h264_to_jpeg_frame(frame, &jpeg_data, &jpeg_size, 85, &record);
+    
+    if (converted) {
         printf("✅ JPEG conversion successful: %zu bytes\n", jpeg_size);
         
         char filename[256];
         snprintf(filename, sizeof(filename), "tmp/frame_%d_idr.jpg", frame_number);
         
+        PIPELINE_TRACE_BEGIN("write", frame->sequence);
         FILE* file = fopen(filename, "wb");
         if (file) {
             fwrite(jpeg_data, 1, jpeg_size, file);
             fclose(file);
+            PIPELINE_TRACE_END("write", frame->sequence);
+            pipeline_latency_mark(&record, PIPELINE_STAGE_DELIVERED);
             printf("💾 Saved: %s\n", filename);
         } else {
+            PIPELINE_TRACE_END("write", frame->sequence);
             printf("❌ Failed to save %s\n", filename);
         }
         
         h264_to_jpeg_free(jpeg_data);
+        pipeline_latency_add(latency, &record);
         return true;
     } else {
         printf("❌ JPEG conversion failed: %s\n", h264_to_jpeg_get_error());
@@ -165,90 +102,186 @@ static bool process_h264_frame(const uint8_t* h264_data, size_t h264_size, int f
     }
 }
 
-static void capture_loop(int fd) {
-    struct v4l2_buffer buf = {0};
-    int frame_count = 0;
-    int idr_count = 0;
-    time_t start_time = time(NULL);
+static void print_capture_stats(const char* prefix) {
+    const v4l2_capture_stats_t* stats = &capture.stats;
+    frame_queue_stats_t queue_stats;
+    frame_queue_get_stats(&queue, &queue_stats);
+    
+    // Sensor: frame interval; driver: sequence gaps and starvation;
+    // pipeline: dequeue latency and queue drops
+    double fps = stats->expected_interval_us > 0 ? 1000000.0 / stats->expected_interval_us : 0.0;
+    printf("%s%u frames, %.1f fps, jitter p99 %llu us, %u lost in %u gaps, %u starved, "
+           "latency p50/p99 %llu/%llu us, %u dropped in queue\n",
+           prefix, stats->frames, fps,
+           (unsigned long long)pipeline_histogram_percentile(&stats->jitter, 99),
+           stats->frames_lost, stats->sequence_gaps, stats->starved,
+           (unsigned long long)pipeline_histogram_percentile(&stats->latency, 50),
+           (unsigned long long)pipeline_histogram_percentile(&stats->latency, 99),
+           queue_stats.dropped_oldest + queue_stats.dropped_newest + queue_stats.replaced);
+}
+
+static void print_latency(const pipeline_latency_t* latency) {
+    printf("   Glass-to-JPEG latency over %u frames: p50 %llu us, p99 %llu us\n", latency->frames,
+           (unsigned long long)pipeline_latency_total_percentile(latency, 50),
+           (unsigned long long)pipeline_latency_total_percentile(latency, 99));
+    for (int stage = PIPELINE_STAGE_DEQUEUED; stage < PIPELINE_STAGE_COUNT; stage++) {
+        printf("     -> %-16s p50 %8llu us, p99 %8llu us\n",
+               pipeline_latency_stage_name((pipeline_stage_t)stage),
+               (unsigned long long)pipeline_latency_stage_percentile(latency, (pipeline_stage_t)stage, 50),
+               (unsigned long long)pipeline_latency_stage_percentile(latency, (pipeline_stage_t)stage, 99));
+    }
+}
+
+static void print_pipeline_stats(void) {
+    // Summed across the capture and conversion threads without pausing them
+    pipeline_stats_snapshot_t snapshot;
+    pipeline_stats_snapshot(&snapshot);
+    
+    printf("   Pipeline counters:");
+    for (int counter = 0; counter < PIPELINE_COUNTER_COUNT; counter++) {
+        printf(" %s=%llu", pipeline_stats_counter_name((pipeline_counter_t)counter),
+               (unsigned long long)snapshot.counters[counter]);
+    }
+    printf("\n");
+    for (int metric = 0; metric < PIPELINE_METRIC_COUNT; metric++) {
+        const pipeline_histogram_t* histogram = &snapshot.histograms[metric];
+        printf("     %-8s n=%llu p50 %8llu us, p99 %8llu us, max %8llu us\n",
+               pipeline_stats_metric_name((pipeline_metric_t)metric),
+               (unsigned long long)histogram->count,
+               (unsigned long long)pipeline_histogram_percentile(histogram, 50),
+               (unsigned long long)pipeline_histogram_percentile(histogram, 99),
+               (unsigned long long)histogram->max_us);
+    }
+}
+
+static bool on_frame(const v4l2_capture_frame_t* frame, void* userdata) {
+    capture_stats_t* stats = (capture_stats_t*)userdata;
     
-    printf("\n🎬 Starting capture loop...\n");
-    printf("Press Ctrl+C to stop\n\n");
+    if (frame->size == 0) {
+        return true;
+    }
     
-    while (running) {
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        
-        if (ioctl(fd, VIDIOC_DQBUF, &buf) == -1) {
-            if (errno == EAGAIN) {
-                usleep(10000);
-                continue;
-            }
-            printf("❌ Failed to dequeue buffer: %s\n", strerror(errno));
-            break;
-        }
-        
-        if (buf.bytesused > 0) {
-            frame_count++;
-            const uint8_t* frame_data = (const uint8_t*)buffers[buf.index];
-            
-            if (process_h264_frame(frame_data, buf.bytesused, frame_count)) {
-                if (is_idr_frame(frame_data, buf.bytesused)) {
-                    idr_count++;
-                }
-            }
-        }
-        
-        if (ioctl(fd, VIDIOC_QBUF, &buf) == -1) {
-            printf("❌ Failed to requeue buffer: %s\n", strerror(errno));
-            break;
+    // Under block and drop-newest the queue keeps the capture buffer and
+    // its DMABUF until the converter is done with it; drop-oldest and
+    // keep-latest copy the frame so the buffer is requeued at once
+    stats->frame_count++;
+    frame_queue_push(&queue, frame);
+    
+    if (stats->frame_count % 30 == 0) {
+        print_capture_stats("📊 Stats: ");
+    }
+    
+    return true;
+}
+
+static void* conversion_thread(void* userdata) {
+    capture_stats_t* stats = (capture_stats_t*)userdata;
+    v4l2_capture_frame_t frame;
+    
+    pipeline_trace_set_thread_name("convert");
+    while (frame_queue_pop(&queue, &frame, -1)) {
+        // Snapshot requests are served from a recent IDR or by forcing one
+        int snapshots_taken = snapshot.snapshots_taken;
+        if (!h264_snapshot_feed(&snapshot, &frame)) {
+            printf("❌ %s\n", h264_snapshot_get_error(&snapshot));
         }
         
-        if (frame_count % 30 == 0) {
-            time_t current_time = time(NULL);
-            long elapsed = current_time - start_time;
-            if (elapsed > 0) {
-                long fps = frame_count / elapsed;
-                printf("📊 Stats: %d frames, %d IDR frames, %ld fps\n", 
-                       frame_count, idr_count, fps);
-            } else {
-                printf("📊 Stats: %d frames, %d IDR frames, calculating...\n", 
-                       frame_count, idr_count);
+        bool is_idr = h264_bitstream_contains_idr(frame.data, frame.size, H264_FORMAT_ANNEXB, 0);
+        stats->converted_count++;
+        if (is_idr && snapshot.snapshots_taken != snapshots_taken) {
+            // The snapshot just decoded and encoded this IDR, so it isn't converted twice
+            printf("⏭️  IDR frame %d already converted for the snapshot\n", stats->converted_count);
+            stats->idr_count++;
+        } else if (process_h264_frame(&frame, stats->converted_count, is_idr, &stats->latency)) {
+            if (is_idr) {
+                stats->idr_count++;
             }
         }
     }
     
-    printf("\n📊 Final statistics:\n");
-    printf("   Total frames: %d\n", frame_count);
-    printf("   IDR frames: %d\n", idr_count);
-    if (frame_count > 0) {
-        long idr_percent = (100 * idr_count) / frame_count;
-        printf("   IDR ratio: %ld%%\n", idr_percent);
-    } else {
-        printf("   IDR ratio: 0%%\n");
+    return NULL;
+}
+
+static void* metrics_thread(void* userdata) {
+    (void)userdata;
+    
+    while (__atomic_load_n(&metrics_running, __ATOMIC_ACQUIRE)) {
+        if (pipeline_metrics_server_serve(&metrics, 500) < 0) {
+            printf("❌ Metrics: %s\n", pipeline_metrics_server_get_error(&metrics));
+        }
     }
+    
+    return NULL;
 }
 
-static void cleanup(int fd) {
-    printf("\n🧹 Cleaning up...\n");
+static void capture_loop(void) {
+    capture_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    pthread_t converter;
+    pthread_t exporter;
+    bool exporting = false;
+    
+    printf("\n🎬 Starting capture loop...\n");
+    printf("Press Ctrl+C to stop, send SIGUSR1 for a snapshot\n\n");
     
-    if (fd >= 0) {
-        v4l2_stop_capture(fd);
-        close(fd);
+    pipeline_trace_set_thread_name("capture");
+    if (pthread_create(&converter, NULL, conversion_thread, &stats) != 0) {
+        printf("❌ Failed to start conversion thread\n");
+        return;
     }
     
-    for (int i = 0; i < buffer_count; i++) {
-        if (buffers[i] && buffers[i] != MAP_FAILED) {
-            munmap(buffers[i], 0);
-        }
+    if (pipeline_metrics_server_get_fd(&metrics) >= 0) {
+        __atomic_store_n(&metrics_running, 1, __ATOMIC_RELEASE);
+        exporting = pthread_create(&exporter, NULL, metrics_thread, NULL) == 0;
     }
     
-    printf("✅ Cleanup completed\n");
+    if (!v4l2_capture_run(&capture, on_frame, &stats)) {
+        printf("❌ Capture failed: %s\n", v4l2_capture_get_error(&capture));
+    }
+    
+    frame_queue_close(&queue);
+    pthread_join(converter, NULL);
+    if (exporting) {
+        __atomic_store_n(&metrics_running, 0, __ATOMIC_RELEASE);
+        pthread_join(exporter, NULL);
+    }
+    
+    frame_queue_stats_t queue_stats;
+    frame_queue_get_stats(&queue, &queue_stats);
+    
+    printf("\n📊 Final statistics:\n");
+    printf("   Total frames: %d\n", stats.frame_count);
+    print_capture_stats("   Capture: ");
+    printf("   Converted frames: %d\n", stats.converted_count);
+    printf("   Queue: %u blocked, %u dropped oldest, %u dropped newest, %u replaced\n",
+           queue_stats.blocked, queue_stats.dropped_oldest, queue_stats.dropped_newest,
+           queue_stats.replaced);
+    printf("   IDR frames: %d\n", stats.idr_count);
+    print_latency(&stats.latency);
+    print_pipeline_stats();
+    
+    if (__atomic_load_n(&pipeline_trace_enabled, __ATOMIC_ACQUIRE)) {
+        pipeline_trace_disable();
+        if (pipeline_trace_dump("tmp/trace.json")) {
+            printf("   Trace written to tmp/trace.json (open in ui.perfetto.dev)\n");
+        } else {
+            printf("❌ %s\n", pipeline_trace_get_error());
+        }
+    }
+    if (stats.frame_count > 0) {
+        long idr_percent = (100 * stats.idr_count) / stats.frame_count;
+        printf("   IDR ratio: %ld%%\n", idr_percent);
+    } else {
+        printf("   IDR ratio: 0%%\n");
+    }
 }
 
 int main(int argc, char* argv[]) {
     const char* device = "/dev/video0";
     int width = 1280;
     int height = 720;
+    frame_queue_policy_t policy = FRAME_QUEUE_DROP_OLDEST;
+    const char* metrics_address = NULL;
     
     if (argc > 1) {
         device = argv[1];
@@ -257,6 +290,28 @@ int main(int argc, char* argv[]) {
         width = atoi(argv[2]);
         height = atoi(argv[3]);
     }
+    if (argc > 4) {
+        if (strcmp(argv[4], "block") == 0) {
+            policy = FRAME_QUEUE_BLOCK;
+        } else if (strcmp(argv[4], "drop-newest") == 0) {
+            policy = FRAME_QUEUE_DROP_NEWEST;
+        } else if (strcmp(argv[4], "keep-latest") == 0) {
+            policy = FRAME_QUEUE_KEEP_LATEST;
+        } else if (strcmp(argv[4], "drop-oldest") != 0) {
+            printf("Usage: %s [device] [width height] [block|drop-oldest|drop-newest|keep-latest] "
+                   "[unix:<path>|tcp:<port>]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (argc > 5) {
+        metrics_address = argv[5];
+    }
+    
+    // Tracing is opt-in: H264JPEG_TRACE=<events per thread>, 0 for the default
+    const char* trace_events = getenv("H264JPEG_TRACE");
+    if (trace_events && !pipeline_trace_enable(atoi(trace_events))) {
+        printf("⚠️  Tracing disabled: %s\n", pipeline_trace_get_error());
+    }
     
     printf("🎥 V4L2 H.264 to JPEG Test\n");
     printf("==========================\n");
@@ -272,40 +327,86 @@ int main(int argc, char* argv[]) {
     
     printf("✅ Hardware components available\n");
     
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
-    video_fd = open(device, O_RDWR | O_NONBLOCK);
-    if (video_fd == -1) {
-        printf("❌ Failed to open %s: %s\n", device, strerror(errno));
-        return 1;
+    v4l2_capture_config_t config;
+    v4l2_capture_default_config(&config);
+    config.device = device;
+    config.width = width;
+    config.height = height;
+    config.export_dmabuf = true;
+    
+    // H264JPEG_REPLAY=<file> feeds a recording through the capture path instead
+    // of the device, at H264JPEG_REPLAY_SPEED times real time (0: as fast as possible)
+    const char* replay_path = getenv("H264JPEG_REPLAY");
+    const char* replay_speed = getenv("H264JPEG_REPLAY_SPEED");
+    if (replay_path) {
+        config.replay_path = replay_path;
+        device = replay_path;
+    }
+    if (replay_speed) {
+        config.replay_speed = atof(replay_speed);
     }
     
-    printf("✅ Opened %s\n", device);
-    
-    // Set up V4L2
-    if (!v4l2_set_format(video_fd, width, height)) {
-        cleanup(video_fd);
+    if (!v4l2_capture_init(&capture, &config)) {
+        printf("❌ %s\n", v4l2_capture_get_error(&capture));
         return 1;
     }
     
-    if (!v4l2_request_buffers(video_fd, 4)) {
-        cleanup(video_fd);
-        return 1;
+    printf("✅ Opened %s: %dx%d H.264, %d buffers\n", device, 
+           capture.width, capture.height, capture.buffer_count);
+    
+    // H264JPEG_RECORD=<file> saves every dequeued buffer for later replay
+    const char* record_path = getenv("H264JPEG_RECORD");
+    if (record_path) {
+        if (v4l2_capture_recorder_init(&recorder, record_path, &capture)) {
+            v4l2_capture_set_recorder(&capture, &recorder);
+            printf("✅ Recording to %s\n", record_path);
+        } else {
+            printf("⚠️  Recording disabled: %s\n", v4l2_capture_recorder_get_error(&recorder));
+        }
     }
     
-    if (!v4l2_map_buffers(video_fd)) {
-        cleanup(video_fd);
+    if (!frame_queue_init(&queue, policy, FRAME_QUEUE_DEFAULT_DEPTH)) {
+        printf("❌ %s\n", frame_queue_get_error(&queue));
+        v4l2_capture_cleanup(&capture);
+        v4l2_capture_recorder_cleanup(&recorder);
         return 1;
     }
+    frame_queue_set_capture(&queue, &capture);
     
-    if (!v4l2_start_capture(video_fd)) {
-        cleanup(video_fd);
-        return 1;
+    h264_snapshot_init(&snapshot, &capture, on_snapshot, NULL);
+    
+    // Scrapes are served from their own thread so a slow scraper never
+    // stalls capture or conversion
+    metrics.listen_fd = -1;
+    if (metrics_address) {
+        if (pipeline_metrics_server_init(&metrics, metrics_address)) {
+            printf("✅ Serving OpenMetrics on %s\n", metrics_address);
+        } else {
+            printf("⚠️  Metrics endpoint disabled: %s\n", pipeline_metrics_server_get_error(&metrics));
+        }
     }
     
-    capture_loop(video_fd);
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGUSR1, signal_handler);
     
-    cleanup(video_fd);
+    capture_loop();
+    
+    printf("\n🧹 Cleaning up...\n");
+    h264_snapshot_cleanup(&snapshot);
+    pipeline_metrics_server_cleanup(&metrics);
+    frame_queue_cleanup(&queue);
+    v4l2_capture_cleanup(&capture);
+    if (recorder.file) {
+        printf("   Recorded %u frames (%llu bytes)\n", recorder.frames,
+               (unsigned long long)recorder.bytes);
+        if (strlen(v4l2_capture_recorder_get_error(&recorder)) > 0) {
+            printf("❌ %s\n", v4l2_capture_recorder_get_error(&recorder));
+        }
+        v4l2_capture_recorder_cleanup(&recorder);
+    }
+    pipeline_trace_cleanup();
+    printf("✅ Cleanup completed\n");
     
     printf("\n🎉 Test completed successfully!\n");
     printf("Check the 'tmp/' directory for generated JPEG files\n");
@@ -0,0 +1,77 @@
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "v4l2_capture.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FRAME_QUEUE_DEFAULT_DEPTH 4
+#define FRAME_QUEUE_MAX_DEPTH 64
+#define FRAME_QUEUE_DEFAULT_SLOT_SIZE (256 * 1024)
+#define FRAME_QUEUE_CACHE_LINE 64
+
+typedef enum {
+    FRAME_QUEUE_BLOCK = 0,
+    FRAME_QUEUE_DROP_OLDEST,
+    FRAME_QUEUE_DROP_NEWEST,
+    FRAME_QUEUE_KEEP_LATEST
+} frame_queue_policy_t;
+
+typedef struct {
+    uint8_t* data;
+    size_t capacity;
+    bool held;
+    v4l2_capture_frame_t frame;
+} frame_queue_slot_t;
+
+typedef struct {
+    uint32_t pushed;
+    uint32_t popped;
+    uint32_t dropped_oldest;
+    uint32_t dropped_newest;
+    uint32_t replaced;
+    uint32_t blocked;
+} frame_queue_stats_t;
+
+typedef struct {
+    frame_queue_policy_t policy;
+    uint32_t depth;
+    v4l2_capture_t* capture;
+    int held_buffers;
+    frame_queue_slot_t slots[FRAME_QUEUE_MAX_DEPTH + 2];
+    int ring[FRAME_QUEUE_MAX_DEPTH];
+    int free_slots[FRAME_QUEUE_MAX_DEPTH * 2];
+    uint32_t head __attribute__((aligned(FRAME_QUEUE_CACHE_LINE)));
+    uint32_t free_tail;
+    int consumer_slot;
+    int consumer_waiting;
+    uint32_t tail __attribute__((aligned(FRAME_QUEUE_CACHE_LINE)));
+    uint32_t free_head;
+    int producer_slot;
+    int producer_waiting;
+    int closed __attribute__((aligned(FRAME_QUEUE_CACHE_LINE)));
+    int space_fd;
+    int data_fd;
+    frame_queue_stats_t stats;
+    char error_message[256];
+} frame_queue_t;
+
+bool frame_queue_init(frame_queue_t* queue, frame_queue_policy_t policy, int depth);
+void frame_queue_cleanup(frame_queue_t* queue);
+void frame_queue_set_capture(frame_queue_t* queue, v4l2_capture_t* capture);
+bool frame_queue_push(frame_queue_t* queue, const v4l2_capture_frame_t* frame);
+bool frame_queue_pop(frame_queue_t* queue, v4l2_capture_frame_t* frame, int timeout_ms);
+void frame_queue_close(frame_queue_t* queue);
+void frame_queue_get_stats(const frame_queue_t* queue, frame_queue_stats_t* stats);
+const char* frame_queue_get_error(const frame_queue_t* queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FRAME_QUEUE_H
@@ -0,0 +1,122 @@
+#ifndef H264_BITSTREAM_H
+#define H264_BITSTREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define H264_MAX_PARAMETER_SET_SIZE 256
+#define H264_DEFAULT_MAX_ACCESS_UNIT_SIZE (1024 * 1024)
+#define H264_DEFAULT_MAX_WIDTH 1920
+#define H264_DEFAULT_MAX_HEIGHT 1088
+
+typedef enum {
+    H264_FORMAT_UNKNOWN = 0,
+    H264_FORMAT_ANNEXB,
+    H264_FORMAT_AVCC
+} h264_stream_format_t;
+
+typedef enum {
+    H264_NAL_SLICE = 1,
+    H264_NAL_IDR = 5,
+    H264_NAL_SEI = 6,
+    H264_NAL_SPS = 7,
+    H264_NAL_PPS = 8,
+    H264_NAL_AUD = 9
+} h264_nal_type_t;
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    int type;
+    int ref_idc;
+} h264_nal_unit_t;
+
+typedef struct {
+    uint8_t sps[H264_MAX_PARAMETER_SET_SIZE];
+    size_t sps_size;
+    uint8_t pps[H264_MAX_PARAMETER_SET_SIZE];
+    size_t pps_size;
+    int nal_length_size;
+} h264_parameter_sets_t;
+
+typedef struct {
+    int profile_idc;
+    int level_idc;
+    int sps_id;
+    int chroma_format_idc;
+    int log2_max_frame_num;
+    int pic_order_cnt_type;
+    int log2_max_pic_order_cnt_lsb;
+    int max_num_ref_frames;
+    bool frame_mbs_only;
+    int width_in_mbs;
+    int height_in_mbs;
+    int width;
+    int height;
+} h264_sps_info_t;
+
+typedef struct {
+    size_t max_access_unit_size;
+    int max_width;
+    int max_height;
+    bool require_idr;
+    bool allow_parameter_sets_only;
+} h264_validation_limits_t;
+
+typedef struct {
+    bool has_sps;
+    bool has_pps;
+    bool has_idr;
+    int nal_count;
+    int slice_count;
+    int width;
+    int height;
+    char reason[128];
+} h264_validation_result_t;
+
+h264_stream_format_t h264_bitstream_detect_format(const uint8_t* data,
+                                                  size_t size,
+                                                  int nal_length_size);
+bool h264_bitstream_next_nal(const uint8_t* data,
+                             size_t size,
+                             h264_stream_format_t format,
+                             int nal_length_size,
+                             size_t* offset,
+                             h264_nal_unit_t* nal);
+bool h264_bitstream_parse_avcc(const uint8_t* avcc,
+                               size_t avcc_size,
+                               h264_parameter_sets_t* params);
+bool h264_bitstream_avcc_to_annexb_inplace(uint8_t* data, size_t size);
+bool h264_bitstream_contains_idr(const uint8_t* data,
+                                 size_t size,
+                                 h264_stream_format_t format,
+                                 int nal_length_size);
+size_t h264_bitstream_to_annexb(const uint8_t* src,
+                                size_t src_size,
+                                h264_stream_format_t format,
+                                h264_parameter_sets_t* params,
+                                uint8_t* dst,
+                                size_t dst_capacity);
+bool h264_bitstream_store_parameter_sets(const uint8_t* data,
+                                         size_t size,
+                                         h264_stream_format_t format,
+                                         h264_parameter_sets_t* params);
+bool h264_bitstream_parse_sps(const uint8_t* nal, size_t nal_size, h264_sps_info_t* sps);
+void h264_bitstream_default_limits(h264_validation_limits_t* limits);
+bool h264_bitstream_validate(const uint8_t* data,
+                             size_t size,
+                             h264_stream_format_t format,
+                             const h264_parameter_sets_t* params,
+                             const h264_validation_limits_t* limits,
+                             h264_validation_result_t* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // H264_BITSTREAM_H
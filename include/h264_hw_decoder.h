@@ -4,6 +4,12 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include "h264_bitstream.h"
+
+#define H264_HW_DECODER_INPUT_BUFFER_SIZE (1024 * 1024)
+#define H264_HW_DECODER_DEFAULT_TIMEOUT_MS 1000
+#define H264_HW_DECODER_MAX_DMABUFS 32
+#define H264_HW_DECODER_DMABUF_INSPECT_SIZE 4096
 
 typedef struct yuv420_frame {
     uint8_t* y_plane;
@@ -26,6 +32,7 @@ extern "C" {
 #include "interface/mmal/util/mmal_default_components.h"
 #include "interface/mmal/util/mmal_util_params.h"
 #include "interface/vcos/vcos.h"
+#include "interface/vcsm/user-vcsm.h"
 #endif
 #endif
 typedef struct {
@@ -34,7 +41,17 @@ typedef struct {
     int width;
     int height;
     bool frame_ready;
-    
+    bool hw_available;
+    int timeout_ms;
+    uint32_t frame_id;
+    bool needs_recovery;
+    int cancel_requested;
+    h264_parameter_sets_t parameter_sets;
+    h264_validation_limits_t limits;
+    const uint8_t* validated_data;
+    size_t validated_size;
+    h264_validation_result_t validation;
+
 #ifdef RASPBERRY_PI
 #ifndef NO_HARDWARE
     MMAL_COMPONENT_T* decoder;
@@ -42,22 +59,47 @@ typedef struct {
     MMAL_PORT_T* output_port;
     MMAL_POOL_T* input_pool;
     MMAL_POOL_T* output_pool;
+    MMAL_POOL_T* dmabuf_pool;
+    MMAL_QUEUE_T* output_queue;
     MMAL_BUFFER_HEADER_T* current_buffer;
     VCOS_SEMAPHORE_T output_semaphore;
+    int output_width;
+    int output_height;
+    int dmabuf_fds[H264_HW_DECODER_MAX_DMABUFS];
+    unsigned int dmabuf_handles[H264_HW_DECODER_MAX_DMABUFS];
+    int dmabuf_count;
+    bool zero_copy;
     bool component_ready;
-#else
-    bool hw_available;
 #endif
-#else
-    bool hw_available;
 #endif
 } h264_hw_decoder_t;
 
 bool h264_hw_decoder_init(h264_hw_decoder_t* decoder);
 void h264_hw_decoder_cleanup(h264_hw_decoder_t* decoder);
-bool h264_hw_decoder_process(h264_hw_decoder_t* decoder, 
-                            const uint8_t* h264_data, 
+bool h264_hw_decoder_set_avcc(h264_hw_decoder_t* decoder,
+                             const uint8_t* avcc_data,
+                             size_t avcc_size);
+void h264_hw_decoder_set_timeout(h264_hw_decoder_t* decoder, int timeout_ms);
+void h264_hw_decoder_set_frame_id(h264_hw_decoder_t* decoder, uint32_t frame_id);
+void h264_hw_decoder_set_validation(h264_hw_decoder_t* decoder,
+                                    const uint8_t* h264_data,
+                                    size_t h264_size,
+                                    const h264_validation_result_t* validation);
+bool h264_hw_decoder_process(h264_hw_decoder_t* decoder,
+                            const uint8_t* h264_data,
                             size_t h264_size);
+bool h264_hw_decoder_process_timeout(h264_hw_decoder_t* decoder,
+                                    const uint8_t* h264_data,
+                                    size_t h264_size,
+                                    int timeout_ms);
+bool h264_hw_decoder_process_dmabuf(h264_hw_decoder_t* decoder,
+                                    int dmabuf_fd,
+                                    const uint8_t* h264_data,
+                                    size_t h264_size,
+                                    int timeout_ms);
+void h264_hw_decoder_release_dmabufs(h264_hw_decoder_t* decoder);
+void h264_hw_decoder_cancel(h264_hw_decoder_t* decoder);
+bool h264_hw_decoder_recover(h264_hw_decoder_t* decoder);
 const yuv420_frame_t* h264_hw_decoder_get_frame(const h264_hw_decoder_t* decoder);
 const char* h264_hw_decoder_get_error(const h264_hw_decoder_t* decoder);
 bool h264_hw_decoder_available(void);
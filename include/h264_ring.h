@@ -0,0 +1,90 @@
+#ifndef H264_RING_H
+#define H264_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "h264_hw_decoder.h"
+#include "mjpeg_hw_encoder.h"
+#include "v4l2_capture.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define H264_RING_DEFAULT_CAPACITY (8 * 1024 * 1024)
+#define H264_RING_DEFAULT_DURATION_MS 10000
+#define H264_RING_DEFAULT_MAX_FRAMES 1024
+
+typedef struct {
+    size_t capacity;
+    int duration_ms;
+    int max_frames;
+} h264_ring_config_t;
+
+typedef struct {
+    size_t offset;
+    size_t size;
+    uint64_t timestamp_us;
+    bool is_idr;
+} h264_ring_entry_t;
+
+typedef void (*h264_ring_callback_t)(const uint8_t* jpeg_data,
+                                     size_t jpeg_size,
+                                     uint64_t timestamp_us,
+                                     void* userdata);
+
+typedef struct {
+    uint8_t* data;
+    size_t capacity;
+    size_t write_offset;
+    size_t bytes_used;
+    h264_ring_entry_t* entries;
+    uint64_t* idr_index;
+    int max_frames;
+    uint64_t duration_us;
+    uint64_t first;
+    uint64_t next;
+    uint64_t idr_first;
+    uint64_t idr_next;
+    uint64_t frames_evicted;
+    h264_parameter_sets_t parameter_sets;
+    char error_message[256];
+} h264_ring_t;
+
+void h264_ring_default_config(h264_ring_config_t* config);
+bool h264_ring_init(h264_ring_t* ring, const h264_ring_config_t* config);
+void h264_ring_cleanup(h264_ring_t* ring);
+void h264_ring_clear(h264_ring_t* ring);
+bool h264_ring_push(h264_ring_t* ring,
+                    const uint8_t* h264_data,
+                    size_t h264_size,
+                    uint64_t timestamp_us);
+bool h264_ring_push_frame(h264_ring_t* ring, const v4l2_capture_frame_t* frame);
+bool h264_ring_locate(h264_ring_t* ring,
+                      uint64_t timestamp_us,
+                      uint64_t* frame,
+                      uint64_t* idr_frame);
+const h264_ring_entry_t* h264_ring_get_entry(const h264_ring_t* ring, uint64_t frame);
+bool h264_ring_extract(h264_ring_t* ring,
+                       h264_hw_decoder_t* decoder,
+                       mjpeg_hw_encoder_t* encoder,
+                       uint64_t timestamp_us,
+                       uint8_t** jpeg_data,
+                       size_t* jpeg_size,
+                       uint64_t* frame_timestamp_us);
+int h264_ring_extract_range(h264_ring_t* ring,
+                            h264_hw_decoder_t* decoder,
+                            mjpeg_hw_encoder_t* encoder,
+                            uint64_t start_us,
+                            uint64_t end_us,
+                            int interval_ms,
+                            h264_ring_callback_t callback,
+                            void* userdata);
+const char* h264_ring_get_error(const h264_ring_t* ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // H264_RING_H
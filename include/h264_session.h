@@ -0,0 +1,71 @@
+#ifndef H264_SESSION_H
+#define H264_SESSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "h264_hw_decoder.h"
+#include "mjpeg_hw_encoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define H264_GOP_CACHE_DEFAULT_CAPACITY (4 * 1024 * 1024)
+#define H264_GOP_CACHE_MAX_FRAMES 300
+
+typedef enum {
+    H264_SESSION_STREAMING = 0,
+    H264_SESSION_ON_DEMAND
+} h264_session_mode_t;
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    size_t offsets[H264_GOP_CACHE_MAX_FRAMES];
+    size_t sizes[H264_GOP_CACHE_MAX_FRAMES];
+    uint64_t timestamps[H264_GOP_CACHE_MAX_FRAMES];
+    int count;
+    bool broken;
+} h264_gop_cache_t;
+
+typedef struct {
+    h264_session_mode_t mode;
+    h264_hw_decoder_t decoder;
+    mjpeg_hw_encoder_t encoder;
+    h264_gop_cache_t gop;
+    int decoded_index;
+    uint64_t frame_timestamp_us;
+    int quality;
+    int frames_decoded;
+    int frames_replayed;
+    char error_message[256];
+} h264_session_t;
+
+bool h264_gop_cache_init(h264_gop_cache_t* cache, size_t capacity);
+void h264_gop_cache_cleanup(h264_gop_cache_t* cache);
+void h264_gop_cache_reset(h264_gop_cache_t* cache);
+int h264_gop_cache_add(h264_gop_cache_t* cache,
+                       const uint8_t* data,
+                       size_t size,
+                       uint64_t timestamp_us,
+                       bool is_idr);
+
+bool h264_session_init(h264_session_t* session, h264_session_mode_t mode, int quality);
+void h264_session_cleanup(h264_session_t* session);
+bool h264_session_push(h264_session_t* session,
+                       const uint8_t* h264_data,
+                       size_t h264_size,
+                       uint64_t timestamp_us);
+bool h264_session_snapshot(h264_session_t* session,
+                           uint8_t** jpeg_data,
+                           size_t* jpeg_size,
+                           uint64_t* timestamp_us);
+const char* h264_session_get_error(const h264_session_t* session);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // H264_SESSION_H
@@ -0,0 +1,51 @@
+#ifndef H264_SNAPSHOT_H
+#define H264_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "v4l2_capture.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define H264_SNAPSHOT_DEFAULT_MAX_IDR_AGE_MS 100
+#define H264_SNAPSHOT_DEFAULT_QUALITY 85
+
+typedef void (*h264_snapshot_callback_t)(const uint8_t* jpeg_data,
+                                         size_t jpeg_size,
+                                         uint64_t timestamp_us,
+                                         void* userdata);
+
+typedef struct {
+    v4l2_capture_t* capture;
+    h264_snapshot_callback_t callback;
+    void* userdata;
+    int quality;
+    int max_idr_age_ms;
+    int pending;
+    bool keyframe_forced;
+    uint8_t* last_idr;
+    size_t last_idr_size;
+    size_t last_idr_capacity;
+    uint64_t last_idr_us;
+    int keyframes_forced;
+    int snapshots_taken;
+    char error_message[256];
+} h264_snapshot_t;
+
+bool h264_snapshot_init(h264_snapshot_t* snapshot,
+                        v4l2_capture_t* capture,
+                        h264_snapshot_callback_t callback,
+                        void* userdata);
+void h264_snapshot_cleanup(h264_snapshot_t* snapshot);
+void h264_snapshot_request(h264_snapshot_t* snapshot);
+bool h264_snapshot_feed(h264_snapshot_t* snapshot, const v4l2_capture_frame_t* frame);
+const char* h264_snapshot_get_error(const h264_snapshot_t* snapshot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // H264_SNAPSHOT_H
@@ -0,0 +1,55 @@
+#ifndef H264_SYNTH_H
+#define H264_SYNTH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "h264_hw_decoder.h"
+
+#define H264_SYNTH_DEFAULT_GOP_LENGTH 30
+#define H264_SYNTH_DEFAULT_PCM_PERCENT 100
+#define H264_SYNTH_MAX_DIMENSION 4096
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int width;
+    int height;
+    int gop_length;
+    int pcm_percent;
+    uint32_t seed;
+} h264_synth_config_t;
+
+typedef struct {
+    h264_synth_config_t config;
+    int width_in_mbs;
+    int height_in_mbs;
+    int level_idc;
+    uint32_t frame_count;
+    int idr_pic_id;
+    uint8_t* recon;
+    uint8_t* expected;
+    uint8_t* rbsp;
+    size_t rbsp_capacity;
+    uint8_t* output;
+    size_t output_capacity;
+    bool* pcm_map;
+    char error_message[256];
+} h264_synth_t;
+
+void h264_synth_default_config(h264_synth_config_t* config);
+bool h264_synth_init(h264_synth_t* synth, const h264_synth_config_t* config);
+void h264_synth_cleanup(h264_synth_t* synth);
+bool h264_synth_next_frame(h264_synth_t* synth,
+                           const uint8_t** h264_data,
+                           size_t* h264_size,
+                           yuv420_frame_t* expected);
+const char* h264_synth_get_error(const h264_synth_t* synth);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // H264_SYNTH_H
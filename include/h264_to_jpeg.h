@@ -8,12 +8,66 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include "v4l2_capture.h"
+#include "pipeline_latency.h"
+#include "yuv_convert.h"
+#include "yuv_scale.h"
+#include "yuv_rotate.h"
+
+#define H264_TO_JPEG_MAX_RENDITIONS 8
+#define H264_TO_JPEG_CROP_ALIGNMENT 16
+
+typedef struct {
+    int quality;
+    int width;
+    int height;
+    yuv_scale_aspect_t aspect;
+    yuv_rect_t crop;
+    yuv_rotation_t rotation;
+    yuv_flip_t flip;
+} h264_to_jpeg_options_t;
+
+typedef struct {
+    uint8_t* jpeg_data;
+    size_t jpeg_size;
+    int width;
+    int height;
+} h264_to_jpeg_rendition_t;
 
 bool h264_to_jpeg(const uint8_t* h264_data, 
                   size_t h264_size, 
                   uint8_t** jpeg_data, 
                   size_t* jpeg_size,
                   int quality);
+void h264_to_jpeg_default_options(h264_to_jpeg_options_t* options);
+bool h264_to_jpeg_with_options(const uint8_t* h264_data, 
+                               size_t h264_size, 
+                               const h264_to_jpeg_options_t* options,
+                               uint8_t** jpeg_data, 
+                               size_t* jpeg_size);
+bool h264_to_jpeg_renditions(const uint8_t* h264_data, 
+                             size_t h264_size, 
+                             const h264_to_jpeg_options_t* options,
+                             h264_to_jpeg_rendition_t* renditions,
+                             int count);
+void h264_to_jpeg_free_renditions(h264_to_jpeg_rendition_t* renditions, int count);
+bool h264_to_jpeg_dmabuf(int dmabuf_fd,
+                         const uint8_t* h264_data, 
+                         size_t h264_size, 
+                         uint8_t** jpeg_data, 
+                         size_t* jpeg_size,
+                         int quality);
+bool h264_to_jpeg_frame(const v4l2_capture_frame_t* frame,
+                        uint8_t** jpeg_data, 
+                        size_t* jpeg_size,
+                        int quality,
+                        pipeline_latency_record_t* record);
+bool yuv_to_jpeg(const yuv_image_t* image,
+                 uint8_t** jpeg_data,
+                 size_t* jpeg_size,
+                 int quality);
+bool h264_to_jpeg_set_avcc(const uint8_t* avcc_data, size_t avcc_size);
+void h264_to_jpeg_set_timeout(int timeout_ms);
 void h264_to_jpeg_free(uint8_t* jpeg_data);
 const char* h264_to_jpeg_get_error(void);
 void h264_to_jpeg_set_debug(bool enabled);
@@ -0,0 +1,31 @@
+#ifndef JPEG_SW_DECODER_H
+#define JPEG_SW_DECODER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "h264_hw_decoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint8_t* buffer;
+    size_t capacity;
+    char error_message[256];
+} jpeg_sw_decoder_t;
+
+bool jpeg_sw_decoder_init(jpeg_sw_decoder_t* decoder);
+void jpeg_sw_decoder_cleanup(jpeg_sw_decoder_t* decoder);
+bool jpeg_sw_decoder_decode(jpeg_sw_decoder_t* decoder,
+                            const uint8_t* jpeg_data,
+                            size_t jpeg_size,
+                            yuv420_frame_t* yuv_frame);
+const char* jpeg_sw_decoder_get_error(const jpeg_sw_decoder_t* decoder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JPEG_SW_DECODER_H
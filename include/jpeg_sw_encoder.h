@@ -0,0 +1,57 @@
+#ifndef JPEG_SW_ENCODER_H
+#define JPEG_SW_ENCODER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "h264_hw_decoder.h"
+#include "yuv_convert.h"
+
+#define JPEG_SW_ENCODER_DEFAULT_QUALITY 85
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint16_t code[256];
+    uint8_t size[256];
+} jpeg_sw_huffman_t;
+
+typedef struct {
+    uint8_t luma_quant[64];
+    uint8_t chroma_quant[64];
+    float luma_scale[64];
+    float chroma_scale[64];
+    jpeg_sw_huffman_t dc_luma;
+    jpeg_sw_huffman_t ac_luma;
+    jpeg_sw_huffman_t dc_chroma;
+    jpeg_sw_huffman_t ac_chroma;
+
+    char error_message[256];
+    int quality;
+    bool optimize_huffman;
+    uint8_t* strip;
+    size_t strip_capacity;
+} jpeg_sw_encoder_t;
+
+bool jpeg_sw_encoder_init(jpeg_sw_encoder_t* encoder, int quality);
+void jpeg_sw_encoder_cleanup(jpeg_sw_encoder_t* encoder);
+bool jpeg_sw_encoder_set_quality(jpeg_sw_encoder_t* encoder, int quality);
+void jpeg_sw_encoder_set_optimize_huffman(jpeg_sw_encoder_t* encoder, bool enabled);
+bool jpeg_sw_encoder_encode(jpeg_sw_encoder_t* encoder,
+                            const yuv420_frame_t* yuv_frame,
+                            uint8_t** jpeg_data,
+                            size_t* jpeg_size);
+bool jpeg_sw_encoder_encode_image(jpeg_sw_encoder_t* encoder,
+                                  const yuv_image_t* image,
+                                  uint8_t** jpeg_data,
+                                  size_t* jpeg_size);
+void jpeg_sw_encoder_free(uint8_t* jpeg_data);
+const char* jpeg_sw_encoder_get_error(const jpeg_sw_encoder_t* encoder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JPEG_SW_ENCODER_H
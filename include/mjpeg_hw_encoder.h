@@ -5,6 +5,11 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include "h264_hw_decoder.h"
+#include "yuv_convert.h"
+#include "yuv_rotate.h"
+
+#define MJPEG_HW_ENCODER_DEFAULT_TIMEOUT_MS 1000
+#define MJPEG_HW_ENCODER_OUTPUT_BUFFER_SIZE (256 * 1024)
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,19 +33,26 @@ typedef struct {
     MMAL_PORT_T* output_port;
     MMAL_POOL_T* input_pool;
     MMAL_POOL_T* output_pool;
+    MMAL_QUEUE_T* output_queue;
     MMAL_BUFFER_HEADER_T* current_buffer;
     VCOS_SEMAPHORE_T output_semaphore;
+    int input_width;
+    int input_height;
+    uint32_t input_encoding;
     bool frame_ready;
     bool component_ready;
-#else
-    bool hw_available;
 #endif
-#else
-    bool hw_available;
 #endif
+    bool hw_available;
+    int timeout_ms;
+    uint32_t frame_id;
+    bool needs_recovery;
+    int cancel_requested;
     
     char error_message[256];
     int quality;
+    yuv_rotation_t rotation;
+    yuv_flip_t flip;
 } mjpeg_hw_encoder_t;
 
 bool mjpeg_hw_encoder_init(mjpeg_hw_encoder_t* encoder, int quality);
@@ -49,6 +61,21 @@ bool mjpeg_hw_encoder_encode(mjpeg_hw_encoder_t* encoder,
                             const yuv420_frame_t* yuv_frame,
                             uint8_t** jpeg_data,
                             size_t* jpeg_size);
+bool mjpeg_hw_encoder_encode_timeout(mjpeg_hw_encoder_t* encoder,
+                                    const yuv420_frame_t* yuv_frame,
+                                    uint8_t** jpeg_data,
+                                    size_t* jpeg_size,
+                                    int timeout_ms);
+bool mjpeg_hw_encoder_encode_image(mjpeg_hw_encoder_t* encoder,
+                                   const yuv_image_t* image,
+                                   uint8_t** jpeg_data,
+                                   size_t* jpeg_size);
+bool mjpeg_hw_encoder_set_quality(mjpeg_hw_encoder_t* encoder, int quality);
+bool mjpeg_hw_encoder_set_orientation(mjpeg_hw_encoder_t* encoder, yuv_rotation_t rotation, yuv_flip_t flip);
+void mjpeg_hw_encoder_set_timeout(mjpeg_hw_encoder_t* encoder, int timeout_ms);
+void mjpeg_hw_encoder_set_frame_id(mjpeg_hw_encoder_t* encoder, uint32_t frame_id);
+void mjpeg_hw_encoder_cancel(mjpeg_hw_encoder_t* encoder);
+bool mjpeg_hw_encoder_recover(mjpeg_hw_encoder_t* encoder);
 void mjpeg_hw_encoder_free(uint8_t* jpeg_data);
 const char* mjpeg_hw_encoder_get_error(const mjpeg_hw_encoder_t* encoder);
 bool mjpeg_hw_encoder_available(void);
@@ -0,0 +1,34 @@
+#ifndef PIPELINE_CPU_H
+#define PIPELINE_CPU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PIPELINE_CPU_ENV "H264JPEG_CPU"
+
+typedef enum {
+    PIPELINE_CPU_SCALAR = 0,
+    PIPELINE_CPU_ARMV6,
+    PIPELINE_CPU_NEON,
+    PIPELINE_CPU_SSE2,
+    PIPELINE_CPU_AVX2,
+    PIPELINE_CPU_LEVEL_COUNT
+} pipeline_cpu_level_t;
+
+pipeline_cpu_level_t pipeline_cpu_detect(void);
+bool pipeline_cpu_supported(pipeline_cpu_level_t level);
+pipeline_cpu_level_t pipeline_cpu_get_level(void);
+bool pipeline_cpu_set_level(pipeline_cpu_level_t level);
+const char* pipeline_cpu_level_name(pipeline_cpu_level_t level);
+bool pipeline_cpu_parse_level(const char* name, pipeline_cpu_level_t* level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIPELINE_CPU_H
@@ -0,0 +1,50 @@
+#ifndef PIPELINE_LATENCY_H
+#define PIPELINE_LATENCY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "v4l2_capture.h"
+#include "pipeline_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    PIPELINE_STAGE_CAPTURED = 0,
+    PIPELINE_STAGE_DEQUEUED,
+    PIPELINE_STAGE_DECODE_SUBMITTED,
+    PIPELINE_STAGE_DECODED,
+    PIPELINE_STAGE_ENCODE_SUBMITTED,
+    PIPELINE_STAGE_ENCODED,
+    PIPELINE_STAGE_DELIVERED,
+    PIPELINE_STAGE_COUNT
+} pipeline_stage_t;
+
+typedef struct {
+    uint64_t timestamps_us[PIPELINE_STAGE_COUNT];
+} pipeline_latency_record_t;
+
+typedef struct {
+    pipeline_histogram_t stages[PIPELINE_STAGE_COUNT];
+    pipeline_histogram_t total;
+    uint32_t frames;
+    uint32_t incomplete;
+} pipeline_latency_t;
+
+void pipeline_latency_reset(pipeline_latency_t* latency);
+void pipeline_latency_begin(pipeline_latency_record_t* record, const v4l2_capture_frame_t* frame);
+void pipeline_latency_mark(pipeline_latency_record_t* record, pipeline_stage_t stage);
+void pipeline_latency_add(pipeline_latency_t* latency, const pipeline_latency_record_t* record);
+uint64_t pipeline_latency_stage_percentile(const pipeline_latency_t* latency,
+                                           pipeline_stage_t stage,
+                                           double percentile);
+uint64_t pipeline_latency_total_percentile(const pipeline_latency_t* latency, double percentile);
+const char* pipeline_latency_stage_name(pipeline_stage_t stage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIPELINE_LATENCY_H
@@ -0,0 +1,39 @@
+#ifndef PIPELINE_METRICS_H
+#define PIPELINE_METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "pipeline_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PIPELINE_METRICS_BUFFER_SIZE (32 * 1024)
+#define PIPELINE_METRICS_DEFAULT_PORT 9464
+#define PIPELINE_METRICS_CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+typedef struct {
+    int listen_fd;
+    bool is_unix;
+    char path[108];
+    int port;
+    uint32_t requests;
+    char body[PIPELINE_METRICS_BUFFER_SIZE];
+    char error_message[256];
+} pipeline_metrics_server_t;
+
+size_t pipeline_metrics_render(const pipeline_stats_snapshot_t* snapshot, char* buffer, size_t size);
+
+bool pipeline_metrics_server_init(pipeline_metrics_server_t* server, const char* address);
+void pipeline_metrics_server_cleanup(pipeline_metrics_server_t* server);
+int pipeline_metrics_server_get_fd(const pipeline_metrics_server_t* server);
+int pipeline_metrics_server_serve(pipeline_metrics_server_t* server, int timeout_ms);
+const char* pipeline_metrics_server_get_error(const pipeline_metrics_server_t* server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIPELINE_METRICS_H
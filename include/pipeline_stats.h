@@ -0,0 +1,74 @@
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PIPELINE_STATS_MAX_THREADS 16
+#define PIPELINE_HISTOGRAM_SUB_BITS 3
+#define PIPELINE_HISTOGRAM_BUCKETS 240
+
+typedef enum {
+    PIPELINE_METRIC_DECODE = 0,
+    PIPELINE_METRIC_ENCODE,
+    PIPELINE_METRIC_COPY,
+    PIPELINE_METRIC_SCALE,
+    PIPELINE_METRIC_ROTATE,
+    PIPELINE_METRIC_TOTAL,
+    PIPELINE_METRIC_COUNT
+} pipeline_metric_t;
+
+typedef enum {
+    PIPELINE_COUNTER_FRAMES_IN = 0,
+    PIPELINE_COUNTER_FRAMES_OUT,
+    PIPELINE_COUNTER_BYTES_IN,
+    PIPELINE_COUNTER_BYTES_OUT,
+    PIPELINE_COUNTER_TIMEOUTS,
+    PIPELINE_COUNTER_DROPS,
+    PIPELINE_COUNTER_ALLOCATIONS,
+    PIPELINE_COUNTER_ERRORS,
+    PIPELINE_COUNTER_BYTES_COPIED,
+    PIPELINE_COUNTER_COUNT
+} pipeline_counter_t;
+
+typedef struct {
+    uint32_t buckets[PIPELINE_HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t min_us;
+    uint64_t max_us;
+} pipeline_histogram_t;
+
+typedef struct {
+    pipeline_histogram_t histograms[PIPELINE_METRIC_COUNT];
+    uint64_t counters[PIPELINE_COUNTER_COUNT];
+    uint32_t threads;
+} pipeline_stats_snapshot_t;
+
+void pipeline_stats_record(pipeline_metric_t metric, uint64_t value_us);
+void pipeline_stats_add(pipeline_counter_t counter, uint64_t amount);
+void pipeline_stats_snapshot(pipeline_stats_snapshot_t* snapshot);
+void pipeline_stats_merge(pipeline_stats_snapshot_t* dst, const pipeline_stats_snapshot_t* src);
+void pipeline_stats_reset(void);
+uint64_t pipeline_stats_metric_percentile(const pipeline_stats_snapshot_t* snapshot,
+                                          pipeline_metric_t metric,
+                                          double percentile);
+const char* pipeline_stats_metric_name(pipeline_metric_t metric);
+const char* pipeline_stats_counter_name(pipeline_counter_t counter);
+
+void pipeline_histogram_reset(pipeline_histogram_t* histogram);
+void pipeline_histogram_add(pipeline_histogram_t* histogram, uint64_t value_us);
+void pipeline_histogram_merge(pipeline_histogram_t* dst, const pipeline_histogram_t* src);
+uint64_t pipeline_histogram_percentile(const pipeline_histogram_t* histogram, double percentile);
+uint64_t pipeline_histogram_bucket_upper(int bucket);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIPELINE_STATS_H
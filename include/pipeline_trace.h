@@ -0,0 +1,48 @@
+#ifndef PIPELINE_TRACE_H
+#define PIPELINE_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PIPELINE_TRACE_MAX_THREADS 16
+#define PIPELINE_TRACE_DEFAULT_EVENTS 4096
+#define PIPELINE_TRACE_MAX_EVENTS (1 << 20)
+
+typedef enum {
+    PIPELINE_TRACE_PHASE_BEGIN = 'B',
+    PIPELINE_TRACE_PHASE_END = 'E',
+    PIPELINE_TRACE_PHASE_INSTANT = 'i'
+} pipeline_trace_phase_t;
+
+extern int pipeline_trace_enabled;
+
+#define PIPELINE_TRACE(phase, name, frame_id) \
+    do { \
+        if (__builtin_expect(__atomic_load_n(&pipeline_trace_enabled, __ATOMIC_RELAXED), 0)) { \
+            pipeline_trace_record((phase), (name), (frame_id)); \
+        } \
+    } while (0)
+
+#define PIPELINE_TRACE_BEGIN(name, frame_id) PIPELINE_TRACE(PIPELINE_TRACE_PHASE_BEGIN, name, frame_id)
+#define PIPELINE_TRACE_END(name, frame_id) PIPELINE_TRACE(PIPELINE_TRACE_PHASE_END, name, frame_id)
+#define PIPELINE_TRACE_INSTANT(name, frame_id) PIPELINE_TRACE(PIPELINE_TRACE_PHASE_INSTANT, name, frame_id)
+
+bool pipeline_trace_enable(int events_per_thread);
+void pipeline_trace_disable(void);
+void pipeline_trace_cleanup(void);
+void pipeline_trace_record(pipeline_trace_phase_t phase, const char* name, uint32_t frame_id);
+void pipeline_trace_set_thread_name(const char* name);
+bool pipeline_trace_dump(const char* path);
+uint32_t pipeline_trace_get_dropped(void);
+const char* pipeline_trace_get_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIPELINE_TRACE_H
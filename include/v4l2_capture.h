@@ -0,0 +1,155 @@
+#ifndef V4L2_CAPTURE_H
+#define V4L2_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "pipeline_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define V4L2_CAPTURE_DEFAULT_BUFFER_COUNT 4
+#define V4L2_CAPTURE_MIN_BUFFERS 2
+#define V4L2_CAPTURE_MAX_BUFFERS 32
+#define V4L2_CAPTURE_RECORD_MAGIC "H264V4LR"
+#define V4L2_CAPTURE_RECORD_VERSION 1
+
+typedef struct {
+    const char* device;
+    int width;
+    int height;
+    uint32_t pixelformat;
+    int buffer_count;
+    bool export_dmabuf;
+    const char* replay_path;
+    double replay_speed;
+    bool replay_loop;
+} v4l2_capture_config_t;
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    int dmabuf_fd;
+    uint32_t index;
+    uint32_t sequence;
+    uint32_t flags;
+    uint64_t timestamp_us;
+    uint64_t dequeue_us;
+} v4l2_capture_frame_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t sequence_gaps;
+    uint32_t frames_lost;
+    uint32_t sequence_resets;
+    uint32_t error_frames;
+    uint32_t timestamp_regressions;
+    uint32_t starved;
+    bool have_last;
+    uint32_t last_sequence;
+    uint64_t last_timestamp_us;
+    uint64_t expected_interval_us;
+    pipeline_histogram_t interval;
+    pipeline_histogram_t jitter;
+    pipeline_histogram_t latency;
+} v4l2_capture_stats_t;
+
+typedef bool (*v4l2_capture_callback_t)(const v4l2_capture_frame_t* frame, void* userdata);
+
+typedef struct {
+    void* start;
+    size_t length;
+    int dmabuf_fd;
+    bool queued;
+    int holds;
+} v4l2_capture_buffer_t;
+
+typedef struct {
+    uint64_t timestamp_us;
+    uint32_t sequence;
+    uint32_t flags;
+    uint32_t size;
+} v4l2_capture_record_t;
+
+typedef struct {
+    FILE* file;
+    uint32_t frames;
+    uint64_t bytes;
+    char error_message[256];
+} v4l2_capture_recorder_t;
+
+typedef struct {
+    FILE* file;
+    int timer_fd;
+    double speed;
+    bool loop;
+    long data_offset;
+    v4l2_capture_record_t pending;
+    bool have_pending;
+    uint32_t pass_frames;
+    uint32_t first_sequence;
+    uint64_t first_timestamp_us;
+    uint32_t last_sequence;
+    uint64_t last_timestamp_us;
+    uint32_t sequence_offset;
+    uint64_t offset_us;
+    uint64_t start_us;
+    uint64_t starved_us;
+    uint64_t refilled_us;
+    uint32_t next_index;
+} v4l2_capture_replay_t;
+
+typedef struct {
+    int fd;
+    int epoll_fd;
+    int wake_fd;
+    int width;
+    int height;
+    uint32_t pixelformat;
+    int buffer_count;
+    v4l2_capture_buffer_t buffers[V4L2_CAPTURE_MAX_BUFFERS];
+    bool streaming;
+    int stop_requested;
+    v4l2_capture_stats_t stats;
+    v4l2_capture_recorder_t* recorder;
+    v4l2_capture_replay_t replay;
+    char error_message[256];
+} v4l2_capture_t;
+
+void v4l2_capture_default_config(v4l2_capture_config_t* config);
+bool v4l2_capture_init(v4l2_capture_t* capture, const v4l2_capture_config_t* config);
+void v4l2_capture_cleanup(v4l2_capture_t* capture);
+bool v4l2_capture_start(v4l2_capture_t* capture);
+bool v4l2_capture_stop(v4l2_capture_t* capture);
+bool v4l2_capture_dequeue(v4l2_capture_t* capture, v4l2_capture_frame_t* frame, int timeout_ms);
+bool v4l2_capture_requeue(v4l2_capture_t* capture, uint32_t index);
+bool v4l2_capture_hold(v4l2_capture_t* capture, uint32_t index);
+bool v4l2_capture_release(v4l2_capture_t* capture, uint32_t index);
+bool v4l2_capture_run(v4l2_capture_t* capture, v4l2_capture_callback_t callback, void* userdata);
+bool v4l2_capture_set_control(v4l2_capture_t* capture, uint32_t id, int32_t value);
+bool v4l2_capture_get_control(v4l2_capture_t* capture, uint32_t id, int32_t* value);
+bool v4l2_capture_force_keyframe(v4l2_capture_t* capture);
+bool v4l2_capture_set_repeat_sequence_header(v4l2_capture_t* capture, bool enabled);
+bool v4l2_capture_set_i_period(v4l2_capture_t* capture, int period);
+void v4l2_capture_request_stop(v4l2_capture_t* capture);
+void v4l2_capture_stats_reset(v4l2_capture_stats_t* stats);
+void v4l2_capture_stats_update(v4l2_capture_stats_t* stats,
+                               const v4l2_capture_frame_t* frame,
+                               uint64_t dequeue_us);
+const char* v4l2_capture_get_error(const v4l2_capture_t* capture);
+void v4l2_capture_set_recorder(v4l2_capture_t* capture, v4l2_capture_recorder_t* recorder);
+bool v4l2_capture_recorder_init(v4l2_capture_recorder_t* recorder,
+                                const char* path,
+                                const v4l2_capture_t* capture);
+void v4l2_capture_recorder_cleanup(v4l2_capture_recorder_t* recorder);
+bool v4l2_capture_recorder_write(v4l2_capture_recorder_t* recorder, const v4l2_capture_frame_t* frame);
+const char* v4l2_capture_recorder_get_error(const v4l2_capture_recorder_t* recorder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // V4L2_CAPTURE_H
@@ -2,10 +2,23 @@
 #define _VIDEODEV2_H
 
 // V4L2 header stub for cross-compilation
-// Real V4L2 headers will be available on Raspberry Pi
+// The system header is used whenever it is available so that struct
+// layouts and ioctl numbers match the running kernel
+
+#if defined(__has_include)
+#if __has_include(<linux/videodev2.h>)
+#define VIDEODEV2_SYSTEM_HEADER 1
+#endif
+#endif
+
+#ifdef VIDEODEV2_SYSTEM_HEADER
+#include <sys/time.h>
+#include <linux/videodev2.h>
+#else
 
 #include <stdint.h>
 #include <sys/ioctl.h>
+#include <sys/time.h>
 
 // V4L2 buffer types
 enum v4l2_buf_type {
@@ -52,6 +65,8 @@ enum v4l2_field {
 #define V4L2_PIX_FMT_H264     v4l2_fourcc('H', '2', '6', '4')
 #define V4L2_PIX_FMT_MJPEG    v4l2_fourcc('M', 'J', 'P', 'G')
 #define V4L2_PIX_FMT_YUV420   v4l2_fourcc('Y', 'U', '1', '2')
+#define V4L2_PIX_FMT_NV12     v4l2_fourcc('N', 'V', '1', '2')
+#define V4L2_PIX_FMT_YUYV     v4l2_fourcc('Y', 'U', 'Y', 'V')
 
 // V4L2 fourcc helper
 static inline uint32_t v4l2_fourcc(char a, char b, char c, char d) {
@@ -81,10 +96,22 @@ struct v4l2_format {
     uint32_t type;
     union {
         struct v4l2_pix_format pix;
+        void* align;
         uint8_t raw_data[200];
     } fmt;
 };
 
+// V4L2 timecode structure
+struct v4l2_timecode {
+    uint32_t type;
+    uint32_t flags;
+    uint8_t frames;
+    uint8_t seconds;
+    uint8_t minutes;
+    uint8_t hours;
+    uint8_t userbits[4];
+};
+
 // V4L2 buffer structure
 struct v4l2_buffer {
     uint32_t index;
@@ -93,15 +120,21 @@ struct v4l2_buffer {
     uint32_t flags;
     uint32_t field;
     struct timeval timestamp;
+    struct v4l2_timecode timecode;
     uint32_t sequence;
     uint32_t memory;
     union {
         uint32_t offset;
         unsigned long userptr;
+        void* planes;
         int32_t fd;
     } m;
     uint32_t length;
     uint32_t reserved2;
+    union {
+        int32_t request_fd;
+        uint32_t reserved;
+    };
 };
 
 // V4L2 request buffers structure
@@ -112,34 +145,39 @@ struct v4l2_requestbuffers {
     uint32_t reserved[2];
 };
 
-// V4L2 timeval structure (use system timeval if available)
-#ifndef _STRUCT_TIMEVAL
-#ifndef __timeval_defined
-struct timeval {
-    long tv_sec;
-    long tv_usec;
-};
-#endif
-#endif
-
-// V4L2 timecode structure
-struct v4l2_timecode {
+// V4L2 DMABUF export structure
+struct v4l2_exportbuffer {
     uint32_t type;
+    uint32_t index;
+    uint32_t plane;
     uint32_t flags;
-    uint8_t frames;
-    uint8_t seconds;
-    uint8_t minutes;
-    uint8_t hours;
-    uint8_t userbits[4];
+    int32_t fd;
+    uint32_t reserved[11];
+};
+
+// V4L2 control structure
+struct v4l2_control {
+    uint32_t id;
+    int32_t value;
 };
 
+// V4L2 codec controls
+#define V4L2_CTRL_CLASS_CODEC                   0x00990000
+#define V4L2_CID_CODEC_BASE                     (V4L2_CTRL_CLASS_CODEC | 0x900)
+#define V4L2_CID_MPEG_VIDEO_REPEAT_SEQ_HEADER   (V4L2_CID_CODEC_BASE + 226)
+#define V4L2_CID_MPEG_VIDEO_FORCE_KEY_FRAME     (V4L2_CID_CODEC_BASE + 229)
+#define V4L2_CID_MPEG_VIDEO_H264_I_PERIOD       (V4L2_CID_CODEC_BASE + 358)
+
 // V4L2 IOCTL commands
 #define VIDIOC_REQBUFS        _IOWR('V', 8, struct v4l2_requestbuffers)
 #define VIDIOC_QUERYBUF       _IOWR('V', 9, struct v4l2_buffer)
 #define VIDIOC_QBUF           _IOWR('V', 15, struct v4l2_buffer)
+#define VIDIOC_EXPBUF         _IOWR('V', 16, struct v4l2_exportbuffer)
 #define VIDIOC_DQBUF          _IOWR('V', 17, struct v4l2_buffer)
 #define VIDIOC_STREAMON        _IOW('V', 18, int)
 #define VIDIOC_STREAMOFF       _IOW('V', 19, int)
+#define VIDIOC_G_CTRL         _IOWR('V', 27, struct v4l2_control)
+#define VIDIOC_S_CTRL         _IOWR('V', 28, struct v4l2_control)
 #define VIDIOC_S_FMT           _IOWR('V', 5, struct v4l2_format)
 #define VIDIOC_G_FMT           _IOWR('V', 4, struct v4l2_format)
 
@@ -175,4 +213,6 @@ struct v4l2_timecode {
 #define V4L2_COLORSPACE_JPEG          7
 #define V4L2_COLORSPACE_SRGB          8
 
+#endif
+
 #endif // _VIDEODEV2_H
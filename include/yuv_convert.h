@@ -0,0 +1,55 @@
+#ifndef YUV_CONVERT_H
+#define YUV_CONVERT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "h264_hw_decoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    YUV_FORMAT_I420 = 0,
+    YUV_FORMAT_NV12,
+    YUV_FORMAT_YUYV
+} yuv_format_t;
+
+typedef struct {
+    yuv_format_t format;
+    int width;
+    int height;
+    const uint8_t* planes[3];
+    int strides[3];
+} yuv_image_t;
+
+void yuv_copy_plane(uint8_t* dst, int dst_stride,
+                    const uint8_t* src, int src_stride,
+                    int width, int height);
+void yuv_interleave_chroma(uint8_t* uv, int uv_stride,
+                           const uint8_t* u, int u_stride,
+                           const uint8_t* v, int v_stride,
+                           int width, int height);
+void yuv_deinterleave_chroma(uint8_t* u, int u_stride,
+                             uint8_t* v, int v_stride,
+                             const uint8_t* uv, int uv_stride,
+                             int width, int height);
+void yuv_yuyv_to_i420(uint8_t* y, int y_stride,
+                      uint8_t* u, int u_stride,
+                      uint8_t* v, int v_stride,
+                      const uint8_t* yuyv, int yuyv_stride,
+                      int width, int height);
+
+bool yuv_image_init(yuv_image_t* image, yuv_format_t format, int width, int height,
+                    const uint8_t* data, int stride);
+void yuv_image_from_frame(yuv_image_t* image, const yuv420_frame_t* frame);
+bool yuv_image_validate(const yuv_image_t* image);
+bool yuv_image_crop(yuv_image_t* image, int x, int y, int width, int height);
+bool yuv_format_from_fourcc(uint32_t fourcc, yuv_format_t* format);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YUV_CONVERT_H
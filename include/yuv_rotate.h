@@ -0,0 +1,58 @@
+#ifndef YUV_ROTATE_H
+#define YUV_ROTATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "h264_hw_decoder.h"
+#include "yuv_convert.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    YUV_ROTATE_0 = 0,
+    YUV_ROTATE_90 = 90,
+    YUV_ROTATE_180 = 180,
+    YUV_ROTATE_270 = 270
+} yuv_rotation_t;
+
+typedef enum {
+    YUV_FLIP_NONE = 0,
+    YUV_FLIP_HORIZONTAL,
+    YUV_FLIP_VERTICAL,
+    YUV_FLIP_BOTH
+} yuv_flip_t;
+
+typedef struct {
+    yuv420_frame_t frame;
+    uint8_t* buffer;
+    size_t buffer_capacity;
+
+    char error_message[256];
+} yuv_rotator_t;
+
+bool yuv_orientation_valid(yuv_rotation_t rotation, yuv_flip_t flip);
+bool yuv_orient_plane(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride,
+                      int width, int height, yuv_rotation_t rotation, yuv_flip_t flip);
+
+bool yuv_rotator_init(yuv_rotator_t* rotator);
+void yuv_rotator_cleanup(yuv_rotator_t* rotator);
+bool yuv_rotator_rotate(yuv_rotator_t* rotator,
+                        const yuv420_frame_t* src,
+                        yuv_rotation_t rotation,
+                        yuv_flip_t flip,
+                        const yuv420_frame_t** rotated);
+bool yuv_rotator_rotate_image(yuv_rotator_t* rotator,
+                              const yuv_image_t* src,
+                              yuv_rotation_t rotation,
+                              yuv_flip_t flip,
+                              const yuv420_frame_t** rotated);
+const char* yuv_rotator_get_error(const yuv_rotator_t* rotator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YUV_ROTATE_H
@@ -0,0 +1,83 @@
+#ifndef YUV_SCALE_H
+#define YUV_SCALE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "h264_hw_decoder.h"
+
+#define YUV_SCALER_DEFAULT_TIMEOUT_MS 1000
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    YUV_SCALE_STRETCH = 0,
+    YUV_SCALE_FIT,
+    YUV_SCALE_FILL
+} yuv_scale_aspect_t;
+
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+} yuv_rect_t;
+
+typedef struct {
+#ifdef RASPBERRY_PI
+#ifndef NO_HARDWARE
+    MMAL_COMPONENT_T* resizer;
+    MMAL_PORT_T* input_port;
+    MMAL_PORT_T* output_port;
+    MMAL_POOL_T* input_pool;
+    MMAL_POOL_T* output_pool;
+    MMAL_QUEUE_T* output_queue;
+    VCOS_SEMAPHORE_T output_semaphore;
+    yuv_rect_t input_rect;
+    int input_width;
+    int input_height;
+    int output_width;
+    int output_height;
+    bool component_ready;
+#endif
+#endif
+    bool hw_available;
+    int timeout_ms;
+    yuv420_frame_t frame;
+    uint8_t* buffer;
+    size_t buffer_capacity;
+
+    char error_message[256];
+} yuv_scaler_t;
+
+bool yuv_scale_plan(int src_width, int src_height, int target_width, int target_height,
+                    yuv_scale_aspect_t aspect, yuv_rect_t* source, int* width, int* height);
+bool yuv_rect_align(yuv_rect_t* rect, int width, int height, int alignment);
+bool yuv_scale_plane(uint8_t* dst, int dst_stride, int dst_width, int dst_height,
+                     const uint8_t* src, int src_stride, int src_width, int src_height);
+
+bool yuv_scaler_init(yuv_scaler_t* scaler, bool use_hardware);
+void yuv_scaler_cleanup(yuv_scaler_t* scaler);
+bool yuv_scaler_scale(yuv_scaler_t* scaler,
+                      const yuv420_frame_t* src,
+                      int target_width,
+                      int target_height,
+                      yuv_scale_aspect_t aspect,
+                      const yuv420_frame_t** scaled);
+bool yuv_scaler_scale_region(yuv_scaler_t* scaler,
+                             const yuv420_frame_t* src,
+                             const yuv_rect_t* region,
+                             int target_width,
+                             int target_height,
+                             yuv_scale_aspect_t aspect,
+                             const yuv420_frame_t** scaled);
+const char* yuv_scaler_get_error(const yuv_scaler_t* scaler);
+bool yuv_scaler_hw_available(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YUV_SCALE_H
@@ -0,0 +1,364 @@
+#define _GNU_SOURCE
+#include "frame_queue.h"
+#include "pipeline_stats.h"
+#include "pipeline_probes.h"
+#include "pipeline_time.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#define FREE_MASK (FRAME_QUEUE_MAX_DEPTH * 2 - 1)
+
+static void signal_fd(int fd) {
+    uint64_t value = 1;
+    ssize_t written = write(fd, &value, sizeof(value));
+    (void)written;
+}
+
+static bool wait_fd(int fd, int timeout_ms) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int result;
+    do {
+        result = poll(&pfd, 1, timeout_ms);
+    } while (result == -1 && errno == EINTR);
+
+    uint64_t value;
+    while (read(fd, &value, sizeof(value)) == (ssize_t)sizeof(value)) {
+    }
+
+    return result > 0;
+}
+
+static void count(uint32_t* counter) {
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+static bool is_closed(const frame_queue_t* queue) {
+    return __atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE) != 0;
+}
+
+bool frame_queue_init(frame_queue_t* queue, frame_queue_policy_t policy, int depth) {
+    if (!queue) return false;
+
+    memset(queue, 0, sizeof(frame_queue_t));
+    queue->space_fd = -1;
+    queue->data_fd = -1;
+    queue->consumer_slot = -1;
+
+    if (depth <= 0 || depth > FRAME_QUEUE_MAX_DEPTH) {
+        snprintf(queue->error_message, sizeof(queue->error_message),
+                "Queue depth must be between 1 and %d", FRAME_QUEUE_MAX_DEPTH);
+        return false;
+    }
+
+    queue->policy = policy;
+    queue->depth = 1;
+    while (queue->depth < (uint32_t)depth) {
+        queue->depth <<= 1;
+    }
+
+    for (uint32_t i = 0; i < queue->depth + 2; i++) {
+        queue->slots[i].data = malloc(FRAME_QUEUE_DEFAULT_SLOT_SIZE);
+        if (!queue->slots[i].data) {
+            frame_queue_cleanup(queue);
+            snprintf(queue->error_message, sizeof(queue->error_message),
+                    "Failed to allocate queue slots");
+            return false;
+        }
+        queue->slots[i].capacity = FRAME_QUEUE_DEFAULT_SLOT_SIZE;
+    }
+
+    queue->producer_slot = 0;
+    for (uint32_t i = 1; i < queue->depth + 2; i++) {
+        queue->free_slots[queue->free_tail++] = (int)i;
+    }
+
+    queue->space_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    queue->data_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (queue->space_fd == -1 || queue->data_fd == -1) {
+        snprintf(queue->error_message, sizeof(queue->error_message),
+                "Failed to create queue eventfd: %s", strerror(errno));
+        frame_queue_cleanup(queue);
+        return false;
+    }
+
+    return true;
+}
+
+static void release_slot(frame_queue_t* queue, frame_queue_slot_t* slot) {
+    if (!slot->held) {
+        return;
+    }
+
+    slot->held = false;
+    __atomic_fetch_sub(&queue->held_buffers, 1, __ATOMIC_RELEASE);
+    if (!v4l2_capture_release(queue->capture, slot->frame.index)) {
+        snprintf(queue->error_message, sizeof(queue->error_message),
+                "Failed to release capture buffer %u: %s", slot->frame.index,
+                v4l2_capture_get_error(queue->capture));
+    }
+}
+
+void frame_queue_cleanup(frame_queue_t* queue) {
+    if (!queue) return;
+
+    for (int i = 0; i < FRAME_QUEUE_MAX_DEPTH + 2; i++) {
+        release_slot(queue, &queue->slots[i]);
+    }
+
+    char message[sizeof(queue->error_message)];
+    memcpy(message, queue->error_message, sizeof(message));
+
+    for (int i = 0; i < FRAME_QUEUE_MAX_DEPTH + 2; i++) {
+        free(queue->slots[i].data);
+    }
+    if (queue->space_fd >= 0) {
+        close(queue->space_fd);
+    }
+    if (queue->data_fd >= 0) {
+        close(queue->data_fd);
+    }
+
+    memset(queue, 0, sizeof(frame_queue_t));
+    queue->space_fd = -1;
+    queue->data_fd = -1;
+    queue->consumer_slot = -1;
+    memcpy(queue->error_message, message, sizeof(message));
+}
+
+void frame_queue_set_capture(frame_queue_t* queue, v4l2_capture_t* capture) {
+    if (!queue) return;
+
+    queue->capture = capture;
+}
+
+static bool hold_frame(frame_queue_t* queue, frame_queue_slot_t* slot, const v4l2_capture_frame_t* frame) {
+    if (!queue->capture ||
+        (queue->policy != FRAME_QUEUE_BLOCK && queue->policy != FRAME_QUEUE_DROP_NEWEST) ||
+        __atomic_load_n(&queue->held_buffers, __ATOMIC_ACQUIRE) >= queue->capture->buffer_count - 1 ||
+        !v4l2_capture_hold(queue->capture, frame->index)) {
+        return false;
+    }
+
+    __atomic_fetch_add(&queue->held_buffers, 1, __ATOMIC_RELEASE);
+    slot->frame = *frame;
+    slot->held = true;
+    return true;
+}
+
+static int take_free_slot(frame_queue_t* queue) {
+    uint32_t free_head = queue->free_head;
+
+    while (__atomic_load_n(&queue->free_tail, __ATOMIC_ACQUIRE) == free_head) {
+        if (is_closed(queue)) {
+            return -1;
+        }
+
+        __atomic_store_n(&queue->producer_waiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&queue->free_tail, __ATOMIC_SEQ_CST) == free_head && !is_closed(queue)) {
+            wait_fd(queue->space_fd, -1);
+        }
+        __atomic_store_n(&queue->producer_waiting, 0, __ATOMIC_SEQ_CST);
+    }
+
+    int slot = queue->free_slots[free_head & FREE_MASK];
+    __atomic_store_n(&queue->free_head, free_head + 1, __ATOMIC_RELEASE);
+    return slot;
+}
+
+static bool copy_frame(frame_queue_slot_t* slot, const v4l2_capture_frame_t* frame) {
+    if (frame->size > slot->capacity) {
+        uint8_t* grown = realloc(slot->data, frame->size);
+        pipeline_stats_add(PIPELINE_COUNTER_ALLOCATIONS, 1);
+        PIPELINE_PROBE2(alloc, "queue_slot", frame->size);
+        if (!grown) {
+            return false;
+        }
+        slot->data = grown;
+        slot->capacity = frame->size;
+    }
+
+    memcpy(slot->data, frame->data, frame->size);
+    slot->frame = *frame;
+    slot->frame.data = slot->data;
+    slot->frame.dmabuf_fd = -1;
+    return true;
+}
+
+bool frame_queue_push(frame_queue_t* queue, const v4l2_capture_frame_t* frame) {
+    if (!queue || !frame || !frame->data || queue->depth == 0 || queue->producer_slot < 0 ||
+        is_closed(queue)) {
+        return false;
+    }
+
+    frame_queue_slot_t* slot = &queue->slots[queue->producer_slot];
+    if (!hold_frame(queue, slot, frame) && !copy_frame(slot, frame)) {
+        count(&queue->stats.dropped_newest);
+        pipeline_stats_add(PIPELINE_COUNTER_DROPS, 1);
+        PIPELINE_PROBE2(queue_drop, queue, frame->sequence);
+        return false;
+    }
+
+    uint32_t limit = queue->policy == FRAME_QUEUE_KEEP_LATEST ? 1 : queue->depth;
+    uint32_t mask = queue->depth - 1;
+    uint32_t tail = queue->tail;
+    int spare = -1;
+    bool blocked = false;
+
+    for (;;) {
+        uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+        if (tail - head < limit) {
+            break;
+        }
+
+        if (queue->policy == FRAME_QUEUE_DROP_NEWEST) {
+            release_slot(queue, slot);
+            count(&queue->stats.dropped_newest);
+            pipeline_stats_add(PIPELINE_COUNTER_DROPS, 1);
+            PIPELINE_PROBE2(queue_drop, queue, frame->sequence);
+            return false;
+        }
+
+        if (queue->policy == FRAME_QUEUE_BLOCK) {
+            if (!blocked) {
+                count(&queue->stats.blocked);
+                blocked = true;
+            }
+            __atomic_store_n(&queue->producer_waiting, 1, __ATOMIC_SEQ_CST);
+            if (tail - __atomic_load_n(&queue->head, __ATOMIC_SEQ_CST) >= limit && !is_closed(queue)) {
+                wait_fd(queue->space_fd, -1);
+            }
+            __atomic_store_n(&queue->producer_waiting, 0, __ATOMIC_SEQ_CST);
+            if (is_closed(queue)) {
+                release_slot(queue, slot);
+                return false;
+            }
+            continue;
+        }
+
+        int oldest = __atomic_load_n(&queue->ring[head & mask], __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&queue->head, &head, head + 1, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            spare = oldest;
+            count(queue->policy == FRAME_QUEUE_KEEP_LATEST ?
+                  &queue->stats.replaced : &queue->stats.dropped_oldest);
+            pipeline_stats_add(PIPELINE_COUNTER_DROPS, 1);
+            PIPELINE_PROBE2(queue_drop, queue, queue->slots[oldest].frame.sequence);
+        }
+    }
+
+    __atomic_store_n(&queue->ring[tail & mask], queue->producer_slot, __ATOMIC_RELAXED);
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_SEQ_CST);
+    count(&queue->stats.pushed);
+    PIPELINE_PROBE2(queue_depth, queue, tail + 1 - __atomic_load_n(&queue->head, __ATOMIC_RELAXED));
+
+    if (spare < 0) {
+        spare = take_free_slot(queue);
+    }
+    queue->producer_slot = spare;
+
+    if (__atomic_load_n(&queue->consumer_waiting, __ATOMIC_SEQ_CST)) {
+        signal_fd(queue->data_fd);
+    }
+
+    return true;
+}
+
+bool frame_queue_pop(frame_queue_t* queue, v4l2_capture_frame_t* frame, int timeout_ms) {
+    if (!queue || !frame || queue->depth == 0) {
+        return false;
+    }
+
+    if (queue->consumer_slot >= 0) {
+        release_slot(queue, &queue->slots[queue->consumer_slot]);
+        uint32_t free_tail = queue->free_tail;
+        queue->free_slots[free_tail & FREE_MASK] = queue->consumer_slot;
+        __atomic_store_n(&queue->free_tail, free_tail + 1, __ATOMIC_SEQ_CST);
+        queue->consumer_slot = -1;
+
+        if (__atomic_load_n(&queue->producer_waiting, __ATOMIC_SEQ_CST)) {
+            signal_fd(queue->space_fd);
+        }
+    }
+
+    uint32_t mask = queue->depth - 1;
+    uint64_t deadline_us = timeout_ms > 0 ? pipeline_time_now_us() + (uint64_t)timeout_ms * 1000 : 0;
+
+    for (;;) {
+        uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+        uint32_t tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+
+        if (head != tail) {
+            int slot = __atomic_load_n(&queue->ring[head & mask], __ATOMIC_RELAXED);
+            if (!__atomic_compare_exchange_n(&queue->head, &head, head + 1, false,
+                                             __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE)) {
+                continue;
+            }
+
+            queue->consumer_slot = slot;
+            *frame = queue->slots[slot].frame;
+            count(&queue->stats.popped);
+            PIPELINE_PROBE2(queue_depth, queue, tail - head - 1);
+
+            if (__atomic_load_n(&queue->producer_waiting, __ATOMIC_SEQ_CST)) {
+                signal_fd(queue->space_fd);
+            }
+            return true;
+        }
+
+        if (is_closed(queue) || timeout_ms == 0) {
+            return false;
+        }
+
+        int wait_ms = -1;
+        if (timeout_ms > 0) {
+            uint64_t now = pipeline_time_now_us();
+            if (now >= deadline_us) {
+                return false;
+            }
+            wait_ms = (int)((deadline_us - now + 999) / 1000);
+        }
+
+        __atomic_store_n(&queue->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&queue->tail, __ATOMIC_SEQ_CST) == head && !is_closed(queue)) {
+            wait_fd(queue->data_fd, wait_ms);
+        }
+        __atomic_store_n(&queue->consumer_waiting, 0, __ATOMIC_SEQ_CST);
+    }
+}
+
+void frame_queue_close(frame_queue_t* queue) {
+    if (!queue) return;
+
+    __atomic_store_n(&queue->closed, 1, __ATOMIC_RELEASE);
+    if (queue->space_fd >= 0) {
+        signal_fd(queue->space_fd);
+    }
+    if (queue->data_fd >= 0) {
+        signal_fd(queue->data_fd);
+    }
+}
+
+void frame_queue_get_stats(const frame_queue_t* queue, frame_queue_stats_t* stats) {
+    if (!queue || !stats) return;
+
+    stats->pushed = __atomic_load_n(&queue->stats.pushed, __ATOMIC_RELAXED);
+    stats->popped = __atomic_load_n(&queue->stats.popped, __ATOMIC_RELAXED);
+    stats->dropped_oldest = __atomic_load_n(&queue->stats.dropped_oldest, __ATOMIC_RELAXED);
+    stats->dropped_newest = __atomic_load_n(&queue->stats.dropped_newest, __ATOMIC_RELAXED);
+    stats->replaced = __atomic_load_n(&queue->stats.replaced, __ATOMIC_RELAXED);
+    stats->blocked = __atomic_load_n(&queue->stats.blocked, __ATOMIC_RELAXED);
+}
+
+const char* frame_queue_get_error(const frame_queue_t* queue) {
+    if (!queue) return "Invalid queue context";
+    return queue->error_message;
+}
@@ -0,0 +1,763 @@
+#include "h264_bitstream.h"
+#include "pipeline_kernels.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+
+static const uint8_t start_code[4] = {0x00, 0x00, 0x00, 0x01};
+
+static size_t find_start_code(const uint8_t* data, size_t size, size_t from) {
+    return pipeline_kernels()->find_start_code(data, size, from);
+}
+
+static size_t read_nal_length(const uint8_t* data, int nal_length_size) {
+    size_t length = 0;
+
+    for (int i = 0; i < nal_length_size; i++) {
+        length = (length << 8) | data[i];
+    }
+
+    return length;
+}
+
+static int effective_length_size(int nal_length_size) {
+    return nal_length_size > 0 ? nal_length_size : 4;
+}
+
+static bool avcc_layout_valid(const uint8_t* data, size_t size, int nal_length_size) {
+    size_t offset = 0;
+
+    while (offset < size) {
+        if (size - offset < (size_t)nal_length_size + 1) {
+            return false;
+        }
+
+        size_t length = read_nal_length(data + offset, nal_length_size);
+        offset += nal_length_size;
+
+        if (length == 0 || length > size - offset || (data[offset] & 0x80)) {
+            return false;
+        }
+
+        offset += length;
+    }
+
+    return size > 0;
+}
+
+h264_stream_format_t h264_bitstream_detect_format(const uint8_t* data,
+                                                  size_t size,
+                                                  int nal_length_size) {
+    if (!data || size < 4) {
+        return H264_FORMAT_UNKNOWN;
+    }
+
+    if (avcc_layout_valid(data, size, effective_length_size(nal_length_size))) {
+        return H264_FORMAT_AVCC;
+    }
+
+    if (data[0] == 0x00 && data[1] == 0x00 &&
+        (data[2] == 0x01 || (data[2] == 0x00 && data[3] == 0x01))) {
+        return H264_FORMAT_ANNEXB;
+    }
+
+    return H264_FORMAT_UNKNOWN;
+}
+
+bool h264_bitstream_next_nal(const uint8_t* data,
+                             size_t size,
+                             h264_stream_format_t format,
+                             int nal_length_size,
+                             size_t* offset,
+                             h264_nal_unit_t* nal) {
+    if (!data || !offset || !nal || *offset >= size) {
+        return false;
+    }
+
+    if (format == H264_FORMAT_AVCC) {
+        int length_size = effective_length_size(nal_length_size);
+
+        if (size - *offset < (size_t)length_size + 1) {
+            return false;
+        }
+
+        size_t length = read_nal_length(data + *offset, length_size);
+        size_t start = *offset + length_size;
+
+        if (length == 0 || length > size - start) {
+            return false;
+        }
+
+        nal->data = data + start;
+        nal->size = length;
+        *offset = start + length;
+    } else if (format == H264_FORMAT_ANNEXB) {
+        size_t start;
+        size_t end;
+
+        do {
+            size_t code = find_start_code(data, size, *offset);
+            if (code >= size) {
+                *offset = size;
+                return false;
+            }
+
+            start = code + 3;
+            end = find_start_code(data, size, start);
+            *offset = end;
+
+            while (end > start && data[end - 1] == 0x00) {
+                end--;
+            }
+        } while (end == start);
+
+        nal->data = data + start;
+        nal->size = end - start;
+    } else {
+        return false;
+    }
+
+    nal->type = nal->data[0] & 0x1F;
+    nal->ref_idc = (nal->data[0] >> 5) & 0x03;
+
+    return true;
+}
+
+bool h264_bitstream_parse_avcc(const uint8_t* avcc,
+                               size_t avcc_size,
+                               h264_parameter_sets_t* params) {
+    if (!avcc || !params || avcc_size < 7 || avcc[0] != 1) {
+        return false;
+    }
+
+    int nal_length_size = (avcc[4] & 0x03) + 1;
+    if (nal_length_size == 3) {
+        return false;
+    }
+
+    h264_parameter_sets_t parsed;
+    memset(&parsed, 0, sizeof(parsed));
+    parsed.nal_length_size = nal_length_size;
+
+    size_t offset = 5;
+    for (int set = 0; set < 2; set++) {
+        if (offset >= avcc_size) {
+            return false;
+        }
+
+        int count = (set == 0) ? (avcc[offset] & 0x1F) : avcc[offset];
+        offset++;
+
+        for (int i = 0; i < count; i++) {
+            if (avcc_size - offset < 2) {
+                return false;
+            }
+
+            size_t length = ((size_t)avcc[offset] << 8) | avcc[offset + 1];
+            offset += 2;
+
+            if (length == 0 || length > avcc_size - offset) {
+                return false;
+            }
+
+            uint8_t* target = (set == 0) ? parsed.sps : parsed.pps;
+            size_t* target_size = (set == 0) ? &parsed.sps_size : &parsed.pps_size;
+
+            if (*target_size == 0 && length <= H264_MAX_PARAMETER_SET_SIZE) {
+                memcpy(target, avcc + offset, length);
+                *target_size = length;
+            }
+
+            offset += length;
+        }
+    }
+
+    if (parsed.sps_size == 0 || parsed.pps_size == 0) {
+        return false;
+    }
+
+    *params = parsed;
+    return true;
+}
+
+bool h264_bitstream_avcc_to_annexb_inplace(uint8_t* data, size_t size) {
+    if (!data || !avcc_layout_valid(data, size, 4)) {
+        return false;
+    }
+
+    size_t offset = 0;
+    while (offset < size) {
+        size_t length = read_nal_length(data + offset, 4);
+        memcpy(data + offset, start_code, sizeof(start_code));
+        offset += 4 + length;
+    }
+
+    return true;
+}
+
+bool h264_bitstream_contains_idr(const uint8_t* data,
+                                 size_t size,
+                                 h264_stream_format_t format,
+                                 int nal_length_size) {
+    if (!data || size == 0) return false;
+
+    if (format == H264_FORMAT_UNKNOWN) {
+        format = h264_bitstream_detect_format(data, size, nal_length_size);
+    }
+
+    size_t offset = 0;
+    h264_nal_unit_t nal;
+    while (h264_bitstream_next_nal(data, size, format, nal_length_size, &offset, &nal)) {
+        if (nal.type == H264_NAL_IDR) {
+            return true;
+        }
+        if (nal.type == H264_NAL_SLICE) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+static void cache_parameter_set(h264_parameter_sets_t* params, const h264_nal_unit_t* nal) {
+    if (nal->size > H264_MAX_PARAMETER_SET_SIZE) {
+        return;
+    }
+
+    if (nal->type == H264_NAL_SPS) {
+        memcpy(params->sps, nal->data, nal->size);
+        params->sps_size = nal->size;
+    } else if (nal->type == H264_NAL_PPS) {
+        memcpy(params->pps, nal->data, nal->size);
+        params->pps_size = nal->size;
+    }
+}
+
+static uint8_t* write_nal(uint8_t* dst, const uint8_t* nal, size_t nal_size) {
+    memcpy(dst, start_code, sizeof(start_code));
+    memcpy(dst + sizeof(start_code), nal, nal_size);
+    return dst + sizeof(start_code) + nal_size;
+}
+
+size_t h264_bitstream_to_annexb(const uint8_t* src,
+                                size_t src_size,
+                                h264_stream_format_t format,
+                                h264_parameter_sets_t* params,
+                                uint8_t* dst,
+                                size_t dst_capacity) {
+    if (!src || src_size == 0) {
+        return 0;
+    }
+
+    int nal_length_size = params ? effective_length_size(params->nal_length_size) : 4;
+
+    if (format == H264_FORMAT_UNKNOWN) {
+        format = h264_bitstream_detect_format(src, src_size, nal_length_size);
+    } else if (format == H264_FORMAT_AVCC && !avcc_layout_valid(src, src_size, nal_length_size)) {
+        return 0;
+    }
+
+    if (format == H264_FORMAT_UNKNOWN) {
+        return 0;
+    }
+
+    bool has_idr = false;
+    bool has_sps = false;
+    bool has_pps = false;
+    size_t nal_count = 0;
+    size_t payload_size = 0;
+    size_t offset = 0;
+    h264_nal_unit_t nal;
+
+    while (h264_bitstream_next_nal(src, src_size, format, nal_length_size, &offset, &nal)) {
+        has_idr |= (nal.type == H264_NAL_IDR);
+        has_sps |= (nal.type == H264_NAL_SPS);
+        has_pps |= (nal.type == H264_NAL_PPS);
+        nal_count++;
+        payload_size += nal.size;
+
+        if (params) {
+            cache_parameter_set(params, &nal);
+        }
+    }
+
+    if (nal_count == 0) {
+        return 0;
+    }
+
+    bool prepend = has_idr && (!has_sps || !has_pps) &&
+                   params && params->sps_size > 0 && params->pps_size > 0;
+    bool verbatim = !prepend &&
+                    (format == H264_FORMAT_ANNEXB || nal_length_size == 4);
+
+    size_t total = verbatim ? src_size : nal_count * sizeof(start_code) + payload_size;
+    if (prepend) {
+        total += 2 * sizeof(start_code) + params->sps_size + params->pps_size;
+    }
+
+    if (!dst) {
+        return total;
+    }
+
+    if (dst_capacity < total) {
+        return 0;
+    }
+
+    if (verbatim) {
+        memcpy(dst, src, src_size);
+        if (format == H264_FORMAT_AVCC) {
+            h264_bitstream_avcc_to_annexb_inplace(dst, src_size);
+        }
+        return total;
+    }
+
+    uint8_t* out = dst;
+    if (prepend) {
+        out = write_nal(out, params->sps, params->sps_size);
+        out = write_nal(out, params->pps, params->pps_size);
+    }
+
+    offset = 0;
+    while (h264_bitstream_next_nal(src, src_size, format, nal_length_size, &offset, &nal)) {
+        out = write_nal(out, nal.data, nal.size);
+    }
+
+    return (size_t)(out - dst);
+}
+
+typedef struct {
+    uint8_t data[H264_MAX_PARAMETER_SET_SIZE];
+    size_t size;
+    size_t bit;
+    bool overrun;
+} bit_reader_t;
+
+static void bit_reader_init(bit_reader_t* reader, const uint8_t* nal, size_t nal_size) {
+    int zeros = 0;
+
+    reader->size = 0;
+    reader->bit = 0;
+    reader->overrun = false;
+
+    for (size_t i = 1; i < nal_size && reader->size < sizeof(reader->data); i++) {
+        if (zeros >= 2 && nal[i] == 0x03) {
+            zeros = 0;
+            continue;
+        }
+
+        zeros = (nal[i] == 0x00) ? zeros + 1 : 0;
+        reader->data[reader->size++] = nal[i];
+    }
+}
+
+static uint32_t read_bits(bit_reader_t* reader, int count) {
+    uint32_t value = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (reader->bit >= reader->size * 8) {
+            reader->overrun = true;
+            return 0;
+        }
+
+        value = (value << 1) | ((reader->data[reader->bit >> 3] >> (7 - (reader->bit & 7))) & 1);
+        reader->bit++;
+    }
+
+    return value;
+}
+
+static uint32_t read_ue(bit_reader_t* reader) {
+    int zeros = 0;
+
+    while (read_bits(reader, 1) == 0) {
+        if (reader->overrun || ++zeros > 31) {
+            reader->overrun = true;
+            return 0;
+        }
+    }
+
+    if (zeros == 0) {
+        return 0;
+    }
+
+    return ((1u << zeros) - 1) + read_bits(reader, zeros);
+}
+
+static int32_t read_se(bit_reader_t* reader) {
+    uint32_t code = read_ue(reader);
+    return (code & 1) ? (int32_t)((code + 1) / 2) : -(int32_t)(code / 2);
+}
+
+static void skip_scaling_list(bit_reader_t* reader, int size) {
+    int last_scale = 8;
+    int next_scale = 8;
+
+    for (int i = 0; i < size && !reader->overrun; i++) {
+        if (next_scale != 0) {
+            next_scale = (last_scale + read_se(reader) + 256) % 256;
+        }
+        last_scale = (next_scale == 0) ? last_scale : next_scale;
+    }
+}
+
+static bool is_high_profile(int profile_idc) {
+    switch (profile_idc) {
+    case 100: case 110: case 122: case 244: case 44:
+    case 83: case 86: case 118: case 128: case 138:
+    case 139: case 134: case 135:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool h264_bitstream_parse_sps(const uint8_t* nal, size_t nal_size, h264_sps_info_t* sps) {
+    if (!nal || !sps || nal_size < 4 || (nal[0] & 0x1F) != H264_NAL_SPS) {
+        return false;
+    }
+
+    bit_reader_t reader;
+    bit_reader_init(&reader, nal, nal_size);
+
+    memset(sps, 0, sizeof(*sps));
+    sps->profile_idc = read_bits(&reader, 8);
+    read_bits(&reader, 8);
+    sps->level_idc = read_bits(&reader, 8);
+    sps->sps_id = read_ue(&reader);
+    sps->chroma_format_idc = 1;
+
+    if (sps->sps_id > 31) {
+        return false;
+    }
+
+    if (is_high_profile(sps->profile_idc)) {
+        sps->chroma_format_idc = read_ue(&reader);
+        if (sps->chroma_format_idc > 3) {
+            return false;
+        }
+        if (sps->chroma_format_idc == 3) {
+            read_bits(&reader, 1);
+        }
+        if (read_ue(&reader) > 6 || read_ue(&reader) > 6) {
+            return false;
+        }
+        read_bits(&reader, 1);
+        if (read_bits(&reader, 1)) {
+            int lists = (sps->chroma_format_idc == 3) ? 12 : 8;
+            for (int i = 0; i < lists; i++) {
+                if (read_bits(&reader, 1)) {
+                    skip_scaling_list(&reader, i < 6 ? 16 : 64);
+                }
+            }
+        }
+    }
+
+    uint32_t log2_max_frame_num_minus4 = read_ue(&reader);
+    if (log2_max_frame_num_minus4 > 12) {
+        return false;
+    }
+    sps->log2_max_frame_num = log2_max_frame_num_minus4 + 4;
+
+    sps->pic_order_cnt_type = read_ue(&reader);
+    if (sps->pic_order_cnt_type == 0) {
+        uint32_t log2_max_poc_lsb_minus4 = read_ue(&reader);
+        if (log2_max_poc_lsb_minus4 > 12) {
+            return false;
+        }
+        sps->log2_max_pic_order_cnt_lsb = log2_max_poc_lsb_minus4 + 4;
+    } else if (sps->pic_order_cnt_type == 1) {
+        read_bits(&reader, 1);
+        read_se(&reader);
+        read_se(&reader);
+        uint32_t cycle = read_ue(&reader);
+        if (cycle > 255) {
+            return false;
+        }
+        for (uint32_t i = 0; i < cycle && !reader.overrun; i++) {
+            read_se(&reader);
+        }
+    } else if (sps->pic_order_cnt_type != 2) {
+        return false;
+    }
+
+    sps->max_num_ref_frames = read_ue(&reader);
+    if (sps->max_num_ref_frames > 16) {
+        return false;
+    }
+    read_bits(&reader, 1);
+
+    uint32_t width_in_mbs = read_ue(&reader) + 1;
+    uint32_t height_in_map_units = read_ue(&reader) + 1;
+    sps->frame_mbs_only = read_bits(&reader, 1);
+    if (!sps->frame_mbs_only) {
+        read_bits(&reader, 1);
+    }
+    read_bits(&reader, 1);
+
+    if (reader.overrun || width_in_mbs > 1024 || height_in_map_units > 1024) {
+        return false;
+    }
+
+    sps->width_in_mbs = width_in_mbs;
+    sps->height_in_mbs = height_in_map_units * (sps->frame_mbs_only ? 1 : 2);
+
+    int crop_unit_x = (sps->chroma_format_idc == 1 || sps->chroma_format_idc == 2) ? 2 : 1;
+    int crop_unit_y = (sps->chroma_format_idc == 1 ? 2 : 1) * (sps->frame_mbs_only ? 1 : 2);
+    uint32_t crop[4] = {0, 0, 0, 0};
+
+    if (read_bits(&reader, 1)) {
+        for (int i = 0; i < 4; i++) {
+            crop[i] = read_ue(&reader);
+        }
+    }
+
+    if (reader.overrun) {
+        return false;
+    }
+
+    sps->width = sps->width_in_mbs * 16 - crop_unit_x * (int)(crop[0] + crop[1]);
+    sps->height = sps->height_in_mbs * 16 - crop_unit_y * (int)(crop[2] + crop[3]);
+
+    return sps->width > 0 && sps->height > 0;
+}
+
+static bool parse_pps_id(const uint8_t* nal, size_t nal_size, int* pps_id) {
+    bit_reader_t reader;
+    bit_reader_init(&reader, nal, nal_size);
+
+    uint32_t id = read_ue(&reader);
+    uint32_t sps_id = read_ue(&reader);
+
+    if (reader.overrun || id > 255 || sps_id > 31) {
+        return false;
+    }
+
+    *pps_id = (int)id;
+    return true;
+}
+
+static bool validation_fail(h264_validation_result_t* result, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(result->reason, sizeof(result->reason), format, args);
+    va_end(args);
+    return false;
+}
+
+void h264_bitstream_default_limits(h264_validation_limits_t* limits) {
+    if (!limits) return;
+
+    limits->max_access_unit_size = H264_DEFAULT_MAX_ACCESS_UNIT_SIZE;
+    limits->max_width = H264_DEFAULT_MAX_WIDTH;
+    limits->max_height = H264_DEFAULT_MAX_HEIGHT;
+    limits->require_idr = false;
+    limits->allow_parameter_sets_only = false;
+}
+
+bool h264_bitstream_validate(const uint8_t* data,
+                             size_t size,
+                             h264_stream_format_t format,
+                             const h264_parameter_sets_t* params,
+                             const h264_validation_limits_t* limits,
+                             h264_validation_result_t* result) {
+    h264_validation_result_t local_result;
+    h264_validation_limits_t default_limits;
+
+    if (!result) {
+        result = &local_result;
+    }
+    memset(result, 0, sizeof(*result));
+
+    if (!limits) {
+        h264_bitstream_default_limits(&default_limits);
+        limits = &default_limits;
+    }
+
+    if (!data || size == 0) {
+        return validation_fail(result, "Empty access unit");
+    }
+
+    if (size > limits->max_access_unit_size) {
+        return validation_fail(result, "Access unit too large (%zu > %zu bytes)",
+                               size, limits->max_access_unit_size);
+    }
+
+    int nal_length_size = params ? effective_length_size(params->nal_length_size) : 4;
+
+    if (format == H264_FORMAT_UNKNOWN) {
+        format = h264_bitstream_detect_format(data, size, nal_length_size);
+        if (format == H264_FORMAT_UNKNOWN) {
+            return validation_fail(result, "Unrecognized framing (no start code or valid length prefixes)");
+        }
+    } else if (format == H264_FORMAT_AVCC && !avcc_layout_valid(data, size, nal_length_size)) {
+        return validation_fail(result, "Truncated or corrupt NAL length prefix");
+    }
+
+    h264_sps_info_t sps;
+    bool sps_known = false;
+    bool pps_known = false;
+    uint8_t pps_ids[32];
+    memset(pps_ids, 0, sizeof(pps_ids));
+
+    if (params && params->sps_size > 0 && h264_bitstream_parse_sps(params->sps, params->sps_size, &sps)) {
+        sps_known = true;
+        result->has_sps = true;
+    }
+
+    int cached_pps_id;
+    if (params && params->pps_size > 0 && parse_pps_id(params->pps, params->pps_size, &cached_pps_id)) {
+        pps_ids[cached_pps_id >> 3] |= 1 << (cached_pps_id & 7);
+        pps_known = true;
+        result->has_pps = true;
+    }
+
+    bool first_slice_seen = false;
+    bool parameter_set_seen = false;
+    size_t offset = 0;
+    h264_nal_unit_t nal;
+
+    while (h264_bitstream_next_nal(data, size, format, nal_length_size, &offset, &nal)) {
+        int index = result->nal_count++;
+
+        if (nal.data[0] & 0x80) {
+            return validation_fail(result, "NAL %d: forbidden_zero_bit set", index);
+        }
+
+        if (nal.type == 0 || nal.type >= 24) {
+            return validation_fail(result, "NAL %d: invalid nal_unit_type %d", index, nal.type);
+        }
+
+        if (nal.type == H264_NAL_SPS) {
+            if (nal.ref_idc == 0 || !h264_bitstream_parse_sps(nal.data, nal.size, &sps)) {
+                return validation_fail(result, "NAL %d: malformed SPS", index);
+            }
+            sps_known = true;
+            parameter_set_seen = true;
+            result->has_sps = true;
+        } else if (nal.type == H264_NAL_PPS) {
+            int pps_id;
+            if (nal.ref_idc == 0 || !parse_pps_id(nal.data, nal.size, &pps_id)) {
+                return validation_fail(result, "NAL %d: malformed PPS", index);
+            }
+            pps_ids[pps_id >> 3] |= 1 << (pps_id & 7);
+            pps_known = true;
+            parameter_set_seen = true;
+            result->has_pps = true;
+        } else if (nal.type == H264_NAL_SLICE || nal.type == H264_NAL_IDR) {
+            bool idr = (nal.type == H264_NAL_IDR);
+
+            if (idr && nal.ref_idc == 0) {
+                return validation_fail(result, "NAL %d: IDR slice with nal_ref_idc 0", index);
+            }
+
+            bit_reader_t reader;
+            bit_reader_init(&reader, nal.data, nal.size < 32 ? nal.size : 32);
+
+            uint32_t first_mb = read_ue(&reader);
+            uint32_t slice_type = read_ue(&reader);
+            uint32_t pps_id = read_ue(&reader);
+
+            if (reader.overrun) {
+                return validation_fail(result, "NAL %d: truncated slice header", index);
+            }
+
+            if (slice_type > 9 || pps_id > 255) {
+                return validation_fail(result, "NAL %d: invalid slice header (type %u, pps %u)",
+                                       index, slice_type, pps_id);
+            }
+
+            if (idr && slice_type % 5 != 2 && slice_type % 5 != 4) {
+                return validation_fail(result, "NAL %d: IDR slice is not intra (type %u)", index, slice_type);
+            }
+
+            if (pps_known && !(pps_ids[pps_id >> 3] & (1 << (pps_id & 7)))) {
+                return validation_fail(result, "NAL %d: slice references unknown PPS %u", index, pps_id);
+            }
+
+            if (sps_known && first_mb >= (uint32_t)(sps.width_in_mbs * sps.height_in_mbs)) {
+                return validation_fail(result, "NAL %d: first_mb_in_slice %u out of range", index, first_mb);
+            }
+
+            first_slice_seen |= (first_mb == 0);
+            result->has_idr |= idr;
+            result->slice_count++;
+        }
+    }
+
+    if (format == H264_FORMAT_AVCC && offset != size) {
+        return validation_fail(result, "Truncated or corrupt NAL length prefix");
+    }
+
+    if (result->nal_count == 0) {
+        return validation_fail(result, "No NAL units found");
+    }
+
+    if (sps_known) {
+        result->width = sps.width;
+        result->height = sps.height;
+
+        if (sps.width > limits->max_width || sps.height > limits->max_height) {
+            return validation_fail(result, "Resolution %dx%d exceeds limit %dx%d",
+                                   sps.width, sps.height, limits->max_width, limits->max_height);
+        }
+    }
+
+    if (result->slice_count == 0 && parameter_set_seen && limits->allow_parameter_sets_only) {
+        return true;
+    }
+
+    if (result->slice_count == 0) {
+        return validation_fail(result, "Access unit contains no slices");
+    }
+
+    if (!first_slice_seen) {
+        return validation_fail(result, "Missing first slice of picture (truncated access unit)");
+    }
+
+    if (limits->require_idr && !result->has_idr) {
+        return validation_fail(result, "Access unit contains no IDR slice");
+    }
+
+    if (result->has_idr && (!result->has_sps || !result->has_pps)) {
+        return validation_fail(result, "IDR access unit without %s", result->has_sps ? "PPS" : "SPS");
+    }
+
+    return true;
+}
+
+bool h264_bitstream_store_parameter_sets(const uint8_t* data,
+                                         size_t size,
+                                         h264_stream_format_t format,
+                                         h264_parameter_sets_t* params) {
+    if (!data || size == 0 || !params) {
+        return false;
+    }
+
+    int nal_length_size = effective_length_size(params->nal_length_size);
+
+    if (format == H264_FORMAT_UNKNOWN) {
+        format = h264_bitstream_detect_format(data, size, nal_length_size);
+    } else if (format == H264_FORMAT_AVCC && !avcc_layout_valid(data, size, nal_length_size)) {
+        return false;
+    }
+
+    if (format == H264_FORMAT_UNKNOWN) {
+        return false;
+    }
+
+    bool stored = false;
+    size_t offset = 0;
+    h264_nal_unit_t nal;
+    h264_sps_info_t sps;
+    int pps_id;
+
+    while (h264_bitstream_next_nal(data, size, format, nal_length_size, &offset, &nal)) {
+        if ((nal.type == H264_NAL_SPS && h264_bitstream_parse_sps(nal.data, nal.size, &sps)) ||
+            (nal.type == H264_NAL_PPS && parse_pps_id(nal.data, nal.size, &pps_id))) {
+            cache_parameter_set(params, &nal);
+            stored |= (nal.size <= H264_MAX_PARAMETER_SET_SIZE);
+        }
+    }
+
+    return stored;
+}
@@ -1,4 +1,7 @@
 #include "h264_hw_decoder.h"
+#include "pipeline_stats.h"
+#include "pipeline_probes.h"
+#include "yuv_convert.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -9,19 +12,168 @@
 static void output_callback(MMAL_PORT_T* port, MMAL_BUFFER_HEADER_T* buffer) {
     h264_hw_decoder_t* decoder = (h264_hw_decoder_t*)port->userdata;
     
-    if (decoder && buffer->length > 0) {
-        decoder->current_buffer = buffer;
-        decoder->frame_ready = true;
-        vcos_semaphore_post(&decoder->output_semaphore);
+    if (!decoder || buffer->cmd != 0) {
+        mmal_buffer_header_release(buffer);
+        return;
     }
     
-    mmal_buffer_header_release(buffer);
+    mmal_queue_put(decoder->output_queue, buffer);
+    vcos_semaphore_post(&decoder->output_semaphore);
 }
 
 static void input_callback(MMAL_PORT_T* port, MMAL_BUFFER_HEADER_T* buffer) {
     mmal_buffer_header_release(buffer);
 }
 
+static bool send_output_buffers(h264_hw_decoder_t* decoder) {
+    MMAL_BUFFER_HEADER_T* buffer;
+    
+    while ((buffer = mmal_queue_get(decoder->output_pool->queue)) != NULL) {
+        MMAL_STATUS_T status = mmal_port_send_buffer(decoder->output_port, buffer);
+        if (status != MMAL_SUCCESS) {
+            mmal_buffer_header_release(buffer);
+            snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                    "Failed to send output buffer: %s", mmal_status_to_string(status));
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+static void drain_output(h264_hw_decoder_t* decoder) {
+    MMAL_BUFFER_HEADER_T* buffer;
+    
+    while ((buffer = mmal_queue_get(decoder->output_queue)) != NULL) {
+        mmal_buffer_header_release(buffer);
+    }
+    
+    while (vcos_semaphore_trywait(&decoder->output_semaphore) == VCOS_SUCCESS) {
+    }
+    
+    decoder->current_buffer = NULL;
+}
+
+static bool configure_output(h264_hw_decoder_t* decoder, int width, int height) {
+    if (decoder->output_pool && decoder->output_width == width && decoder->output_height == height) {
+        return true;
+    }
+    
+    if (width <= 0 || height <= 0) {
+        snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                "Frame size unknown (no SPS received)");
+        return false;
+    }
+    
+    if (decoder->output_port->is_enabled) {
+        mmal_port_disable(decoder->output_port);
+    }
+    drain_output(decoder);
+    
+    if (decoder->output_pool) {
+        mmal_port_pool_destroy(decoder->output_port, decoder->output_pool);
+        decoder->output_pool = NULL;
+    }
+    
+    MMAL_ES_FORMAT_T* format = decoder->output_port->format;
+    format->encoding = MMAL_ENCODING_I420;
+    format->es->video.width = VCOS_ALIGN_UP(width, 32);
+    format->es->video.height = VCOS_ALIGN_UP(height, 16);
+    format->es->video.crop.x = 0;
+    format->es->video.crop.y = 0;
+    format->es->video.crop.width = width;
+    format->es->video.crop.height = height;
+    
+    MMAL_STATUS_T status = mmal_port_format_commit(decoder->output_port);
+    if (status != MMAL_SUCCESS) {
+        snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                "Failed to commit output format: %s", mmal_status_to_string(status));
+        return false;
+    }
+    
+    decoder->output_port->buffer_num = decoder->output_port->buffer_num_recommended;
+    decoder->output_port->buffer_size = decoder->output_port->buffer_size_recommended;
+    
+    decoder->output_pool = mmal_port_pool_create(decoder->output_port, 
+                                                 decoder->output_port->buffer_num,
+                                                 decoder->output_port->buffer_size);
+    if (!decoder->output_pool) {
+        snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                "Failed to create output pool");
+        return false;
+    }
+    
+    status = mmal_port_enable(decoder->output_port, output_callback);
+    if (status != MMAL_SUCCESS) {
+        snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                "Failed to enable output port: %s", mmal_status_to_string(status));
+        return false;
+    }
+    
+    decoder->output_width = width;
+    decoder->output_height = height;
+    
+    return send_output_buffers(decoder);
+}
+
+static MMAL_BUFFER_HEADER_T* wait_for_output(h264_hw_decoder_t* decoder, uint64_t deadline_us) {
+    for (;;) {
+        uint64_t now_us = vcos_getmicrosecs64();
+        if (now_us >= deadline_us) {
+            pipeline_stats_add(PIPELINE_COUNTER_TIMEOUTS, 1);
+            PIPELINE_PROBE2(decode_timeout, decoder->frame_id, deadline_us);
+            snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                    "Timeout waiting for decoded frame");
+            return NULL;
+        }
+        
+        VCOS_STATUS_T wait_status = vcos_semaphore_wait_timeout(&decoder->output_semaphore, 
+                                                                (VCOS_UNSIGNED)((deadline_us - now_us + 999) / 1000));
+        
+        if (__atomic_load_n(&decoder->cancel_requested, __ATOMIC_ACQUIRE)) {
+            snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                    "Decode cancelled");
+            return NULL;
+        }
+        
+        if (wait_status != VCOS_SUCCESS) {
+            continue;
+        }
+        
+        MMAL_BUFFER_HEADER_T* buffer = mmal_queue_get(decoder->output_queue);
+        if (!buffer) {
+            continue;
+        }
+        
+        if (buffer->length > 0) {
+            return buffer;
+        }
+        
+        mmal_buffer_header_release(buffer);
+        if (!send_output_buffers(decoder)) {
+            return NULL;
+        }
+    }
+}
+
+static MMAL_BUFFER_HEADER_T* wait_for_input(h264_hw_decoder_t* decoder, MMAL_POOL_T* pool,
+                                            const char* what, uint64_t deadline_us) {
+    uint64_t now_us = vcos_getmicrosecs64();
+    MMAL_BUFFER_HEADER_T* buffer = NULL;
+    
+    if (now_us < deadline_us) {
+        buffer = mmal_queue_timedwait(pool->queue, (VCOS_UNSIGNED)((deadline_us - now_us + 999) / 1000));
+    }
+    
+    if (!buffer) {
+        pipeline_stats_add(PIPELINE_COUNTER_TIMEOUTS, 1);
+        snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                "Timeout waiting for %s", what);
+    }
+    
+    return buffer;
+}
+
 static bool convert_mmal_to_yuv420(h264_hw_decoder_t* decoder, MMAL_BUFFER_HEADER_T* buffer) {
     if (!buffer || !buffer->data || buffer->length == 0) {
         return false;
@@ -31,37 +183,178 @@ static bool convert_mmal_to_yuv420(h264_hw_decoder_t* decoder, MMAL_BUFFER_HEADE
     int height = decoder->height;
     int y_size = width * height;
     int uv_size = y_size / 4;
+    int stride = decoder->output_port->format->es->video.width;
+    int slice_height = decoder->output_port->format->es->video.height;
     
-    if (decoder->current_frame.y_plane) {
+    if ((size_t)(stride * slice_height * 3 / 2) > buffer->length) {
+        snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                "Decoded buffer too small (%u bytes)", buffer->length);
+        return false;
+    }
+    
+    if (!decoder->current_frame.y_plane || 
+        decoder->current_frame.width != width || 
+        decoder->current_frame.height != height) {
         free(decoder->current_frame.y_plane);
+        
+        decoder->current_frame.y_plane = malloc(y_size + 2 * uv_size);
+        pipeline_stats_add(PIPELINE_COUNTER_ALLOCATIONS, 1);
+        PIPELINE_PROBE2(alloc, "decoded_frame", y_size + 2 * uv_size);
+        if (!decoder->current_frame.y_plane) {
+            snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                    "Failed to allocate memory for YUV frame");
+            return false;
+        }
+        
+        decoder->current_frame.u_plane = decoder->current_frame.y_plane + y_size;
+        decoder->current_frame.v_plane = decoder->current_frame.u_plane + uv_size;
+        decoder->current_frame.width = width;
+        decoder->current_frame.height = height;
+        decoder->current_frame.y_size = y_size;
+        decoder->current_frame.uv_size = uv_size;
     }
     
-    decoder->current_frame.y_plane = malloc(y_size + 2 * uv_size);
-    if (!decoder->current_frame.y_plane) {
+    uint64_t copy_start_us = vcos_getmicrosecs64();
+    const uint8_t* src = buffer->data + buffer->offset;
+    const uint8_t* u_src = src + stride * slice_height;
+    const uint8_t* v_src = u_src + (stride / 2) * (slice_height / 2);
+    
+    yuv_copy_plane(decoder->current_frame.y_plane, width, src, stride, width, height);
+    yuv_copy_plane(decoder->current_frame.u_plane, width / 2, u_src, stride / 2, width / 2, height / 2);
+    yuv_copy_plane(decoder->current_frame.v_plane, width / 2, v_src, stride / 2, width / 2, height / 2);
+    
+    pipeline_stats_record(PIPELINE_METRIC_COPY, vcos_getmicrosecs64() - copy_start_us);
+    return true;
+}
+
+static bool begin_decode(h264_hw_decoder_t* decoder,
+                         const uint8_t* h264_data,
+                         size_t h264_size,
+                         h264_validation_result_t* validation) {
+    bool validated = decoder->validated_data == h264_data && decoder->validated_size == h264_size;
+    decoder->validated_data = NULL;
+    
+    if (validated) {
+        *validation = decoder->validation;
+    } else if (!h264_bitstream_validate(h264_data, h264_size, H264_FORMAT_UNKNOWN,
+                                        &decoder->parameter_sets, &decoder->limits, validation)) {
         snprintf(decoder->error_message, sizeof(decoder->error_message), 
-                "Failed to allocate memory for YUV frame");
+                "Invalid H.264 access unit: %s", validation->reason);
+        return false;
+    }
+    
+    if (validation->width > 0 && validation->height > 0) {
+        decoder->width = validation->width;
+        decoder->height = validation->height;
+    }
+    
+    if (decoder->needs_recovery && !h264_hw_decoder_recover(decoder)) {
+        return false;
+    }
+    
+    __atomic_store_n(&decoder->cancel_requested, 0, __ATOMIC_RELEASE);
+    decoder->frame_ready = false;
+    
+    if (!configure_output(decoder, decoder->width, decoder->height)) {
+        decoder->needs_recovery = true;
         return false;
     }
     
-    decoder->current_frame.u_plane = decoder->current_frame.y_plane + y_size;
-    decoder->current_frame.v_plane = decoder->current_frame.u_plane + uv_size;
-    decoder->current_frame.width = width;
-    decoder->current_frame.height = height;
-    decoder->current_frame.y_size = y_size;
-    decoder->current_frame.uv_size = uv_size;
+    drain_output(decoder);
+    if (!send_output_buffers(decoder)) {
+        decoder->needs_recovery = true;
+        return false;
+    }
     
-    uint8_t* src = buffer->data;
-    uint8_t* y_dst = decoder->current_frame.y_plane;
-    uint8_t* u_dst = decoder->current_frame.u_plane;
-    uint8_t* v_dst = decoder->current_frame.v_plane;
+    return true;
+}
+
+static bool finish_decode(h264_hw_decoder_t* decoder, uint64_t start_us, uint64_t deadline_us) {
+    decoder->current_buffer = wait_for_output(decoder, deadline_us);
+    if (!decoder->current_buffer) {
+        decoder->needs_recovery = true;
+        return false;
+    }
     
-    memcpy(y_dst, src, y_size);
-    src += y_size;
+    bool converted = convert_mmal_to_yuv420(decoder, decoder->current_buffer);
     
-    memcpy(u_dst, src, uv_size);
-    src += uv_size;
+    mmal_buffer_header_release(decoder->current_buffer);
+    decoder->current_buffer = NULL;
+    send_output_buffers(decoder);
     
-    memcpy(v_dst, src, uv_size);
+    if (!converted) {
+        snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                "Failed to convert MMAL frame to YUV420");
+        return false;
+    }
+    
+    decoder->frame_ready = true;
+    pipeline_stats_record(PIPELINE_METRIC_DECODE, vcos_getmicrosecs64() - start_us);
+    PIPELINE_PROBE3(decode_done, decoder->frame_id, decoder->current_frame.y_size + 2 * decoder->current_frame.uv_size,
+                    vcos_getmicrosecs64());
+    return true;
+}
+
+static unsigned int import_dmabuf(h264_hw_decoder_t* decoder, int dmabuf_fd) {
+    for (int i = 0; i < decoder->dmabuf_count; i++) {
+        if (decoder->dmabuf_fds[i] == dmabuf_fd) {
+            return vcsm_vc_hdl_from_hdl(decoder->dmabuf_handles[i]);
+        }
+    }
+    
+    if (decoder->dmabuf_count == H264_HW_DECODER_MAX_DMABUFS) {
+        h264_hw_decoder_release_dmabufs(decoder);
+    }
+    
+    unsigned int handle = vcsm_import_dmabuf(dmabuf_fd, "h264_hw_decoder");
+    if (!handle) {
+        snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                "Failed to import DMABUF fd %d", dmabuf_fd);
+        return 0;
+    }
+    
+    decoder->dmabuf_fds[decoder->dmabuf_count] = dmabuf_fd;
+    decoder->dmabuf_handles[decoder->dmabuf_count] = handle;
+    decoder->dmabuf_count++;
+    
+    return vcsm_vc_hdl_from_hdl(handle);
+}
+
+static bool send_parameter_sets(h264_hw_decoder_t* decoder, uint64_t deadline_us) {
+    const h264_parameter_sets_t* params = &decoder->parameter_sets;
+    size_t size = 8 + params->sps_size + params->pps_size;
+    
+    MMAL_BUFFER_HEADER_T* buffer = wait_for_input(decoder, decoder->input_pool, "input buffer", deadline_us);
+    if (!buffer) {
+        return false;
+    }
+    
+    if (size > buffer->alloc_size) {
+        mmal_buffer_header_release(buffer);
+        snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                "Input buffer too small for parameter sets");
+        return false;
+    }
+    
+    static const uint8_t start_code[4] = {0x00, 0x00, 0x00, 0x01};
+    uint8_t* out = buffer->data;
+    memcpy(out, start_code, 4);
+    memcpy(out + 4, params->sps, params->sps_size);
+    out += 4 + params->sps_size;
+    memcpy(out, start_code, 4);
+    memcpy(out + 4, params->pps, params->pps_size);
+    
+    buffer->length = size;
+    buffer->offset = 0;
+    buffer->flags = 0;
+    
+    MMAL_STATUS_T status = mmal_port_send_buffer(decoder->input_port, buffer);
+    if (status != MMAL_SUCCESS) {
+        mmal_buffer_header_release(buffer);
+        snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                "Failed to send parameter sets: %s", mmal_status_to_string(status));
+        return false;
+    }
     
     return true;
 }
@@ -73,6 +366,8 @@ bool h264_hw_decoder_init(h264_hw_decoder_t* decoder) {
     
     memset(decoder, 0, sizeof(h264_hw_decoder_t));
     decoder->hw_available = false;
+    decoder->timeout_ms = H264_HW_DECODER_DEFAULT_TIMEOUT_MS;
+    h264_bitstream_default_limits(&decoder->limits);
     
 #ifdef RASPBERRY_PI
 #ifndef NO_HARDWARE
@@ -84,6 +379,13 @@ bool h264_hw_decoder_init(h264_hw_decoder_t* decoder) {
         return false;
     }
     
+    decoder->output_queue = mmal_queue_create();
+    if (!decoder->output_queue) {
+        snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                "Failed to create output queue");
+        return false;
+    }
+    
     MMAL_STATUS_T status = mmal_component_create(MMAL_COMPONENT_DEFAULT_VIDEO_DECODER, &decoder->decoder);
     if (status != MMAL_SUCCESS) {
         snprintf(decoder->error_message, sizeof(decoder->error_message), 
@@ -120,33 +422,45 @@ bool h264_hw_decoder_init(h264_hw_decoder_t* decoder) {
         return false;
     }
     
-    decoder->output_port->userdata = (struct MMAL_PORT_USERDATA_T*)decoder;
-    status = mmal_port_enable(decoder->output_port, output_callback);
-    if (status != MMAL_SUCCESS) {
-        snprintf(decoder->error_message, sizeof(decoder->error_message), 
-                "Failed to enable output port: %s", mmal_status_to_string(status));
-        return false;
+    decoder->input_port->buffer_num = decoder->input_port->buffer_num_recommended;
+    decoder->input_port->buffer_size = decoder->input_port->buffer_size_recommended;
+    if (decoder->input_port->buffer_size < H264_HW_DECODER_INPUT_BUFFER_SIZE) {
+        decoder->input_port->buffer_size = H264_HW_DECODER_INPUT_BUFFER_SIZE;
     }
     
-    decoder->input_port->userdata = (struct MMAL_PORT_USERDATA_T*)decoder;
-    status = mmal_port_enable(decoder->input_port, input_callback);
-    if (status != MMAL_SUCCESS) {
-        snprintf(decoder->error_message, sizeof(decoder->error_message), 
-                "Failed to enable input port: %s", mmal_status_to_string(status));
-        return false;
+    if (vcsm_init() == 0) {
+        decoder->zero_copy = mmal_port_parameter_set_boolean(decoder->input_port, 
+                                                             MMAL_PARAMETER_ZERO_COPY, 
+                                                             MMAL_TRUE) == MMAL_SUCCESS;
+        if (!decoder->zero_copy) {
+            vcsm_exit();
+        }
     }
     
-    decoder->input_pool = mmal_port_pool_create(decoder->input_port, 1, 0);
+    decoder->input_pool = mmal_port_pool_create(decoder->input_port, 
+                                                decoder->input_port->buffer_num,
+                                                decoder->input_port->buffer_size);
     if (!decoder->input_pool) {
         snprintf(decoder->error_message, sizeof(decoder->error_message), 
                 "Failed to create input pool");
         return false;
     }
     
-    decoder->output_pool = mmal_port_pool_create(decoder->output_port, 1, 0);
-    if (!decoder->output_pool) {
+    if (decoder->zero_copy) {
+        decoder->dmabuf_pool = mmal_pool_create(decoder->input_port->buffer_num, 0);
+        if (!decoder->dmabuf_pool) {
+            snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                    "Failed to create DMABUF header pool");
+            return false;
+        }
+    }
+    
+    decoder->output_port->userdata = (struct MMAL_PORT_USERDATA_T*)decoder;
+    decoder->input_port->userdata = (struct MMAL_PORT_USERDATA_T*)decoder;
+    status = mmal_port_enable(decoder->input_port, input_callback);
+    if (status != MMAL_SUCCESS) {
         snprintf(decoder->error_message, sizeof(decoder->error_message), 
-                "Failed to create output pool");
+                "Failed to enable input port: %s", mmal_status_to_string(status));
         return false;
     }
     
@@ -178,17 +492,20 @@ void h264_hw_decoder_cleanup(h264_hw_decoder_t* decoder) {
     
 #ifdef RASPBERRY_PI
 #ifndef NO_HARDWARE
-    if (decoder->hw_available && decoder->component_ready) {
-        if (decoder->input_port) {
-            mmal_port_disable(decoder->input_port);
-        }
-        if (decoder->output_port) {
-            mmal_port_disable(decoder->output_port);
-        }
-        
-        if (decoder->decoder) {
-            mmal_component_disable(decoder->decoder);
-        }
+    if (decoder->input_port && decoder->input_port->is_enabled) {
+        mmal_port_disable(decoder->input_port);
+    }
+    if (decoder->output_port && decoder->output_port->is_enabled) {
+        mmal_port_disable(decoder->output_port);
+    }
+    
+    if (decoder->decoder && decoder->component_ready) {
+        mmal_component_disable(decoder->decoder);
+    }
+    
+    if (decoder->output_queue) {
+        drain_output(decoder);
+        mmal_queue_destroy(decoder->output_queue);
     }
     
     if (decoder->input_pool) {
@@ -197,11 +514,19 @@ void h264_hw_decoder_cleanup(h264_hw_decoder_t* decoder) {
     if (decoder->output_pool) {
         mmal_port_pool_destroy(decoder->output_port, decoder->output_pool);
     }
+    if (decoder->dmabuf_pool) {
+        mmal_pool_destroy(decoder->dmabuf_pool);
+    }
     
     if (decoder->decoder) {
         mmal_component_destroy(decoder->decoder);
     }
     
+    if (decoder->zero_copy) {
+        h264_hw_decoder_release_dmabufs(decoder);
+        vcsm_exit();
+    }
+    
     vcos_semaphore_delete(&decoder->output_semaphore);
 #endif
 #endif
@@ -213,9 +538,41 @@ void h264_hw_decoder_cleanup(h264_hw_decoder_t* decoder) {
     memset(decoder, 0, sizeof(h264_hw_decoder_t));
 }
 
+void h264_hw_decoder_set_timeout(h264_hw_decoder_t* decoder, int timeout_ms) {
+    if (!decoder) return;
+    
+    decoder->timeout_ms = timeout_ms > 0 ? timeout_ms : H264_HW_DECODER_DEFAULT_TIMEOUT_MS;
+}
+
+void h264_hw_decoder_set_frame_id(h264_hw_decoder_t* decoder, uint32_t frame_id) {
+    if (!decoder) return;
+    
+    decoder->frame_id = frame_id;
+}
+
+void h264_hw_decoder_set_validation(h264_hw_decoder_t* decoder,
+                                    const uint8_t* h264_data,
+                                    size_t h264_size,
+                                    const h264_validation_result_t* validation) {
+    if (!decoder) return;
+    
+    decoder->validated_data = validation ? h264_data : NULL;
+    decoder->validated_size = h264_size;
+    if (validation) {
+        decoder->validation = *validation;
+    }
+}
+
 bool h264_hw_decoder_process(h264_hw_decoder_t* decoder, 
                             const uint8_t* h264_data, 
                             size_t h264_size) {
+    return h264_hw_decoder_process_timeout(decoder, h264_data, h264_size, 0);
+}
+
+bool h264_hw_decoder_process_timeout(h264_hw_decoder_t* decoder, 
+                                    const uint8_t* h264_data, 
+                                    size_t h264_size,
+                                    int timeout_ms) {
     if (!decoder || !h264_data || h264_size == 0) {
         if (decoder) {
             snprintf(decoder->error_message, sizeof(decoder->error_message), 
@@ -224,6 +581,10 @@ bool h264_hw_decoder_process(h264_hw_decoder_t* decoder,
         return false;
     }
     
+    if (timeout_ms <= 0) {
+        timeout_ms = decoder->timeout_ms;
+    }
+    
 #ifdef RASPBERRY_PI
 #ifndef NO_HARDWARE
     if (!decoder->component_ready) {
@@ -232,17 +593,31 @@ bool h264_hw_decoder_process(h264_hw_decoder_t* decoder,
         return false;
     }
     
-    decoder->frame_ready = false;
+    uint64_t start_us = vcos_getmicrosecs64();
+    uint64_t deadline_us = start_us + (uint64_t)timeout_ms * 1000;
     
-    MMAL_BUFFER_HEADER_T* buffer = mmal_queue_get(decoder->input_pool->queue);
+    h264_validation_result_t validation;
+    if (!begin_decode(decoder, h264_data, h264_size, &validation)) {
+        return false;
+    }
+    
+    MMAL_BUFFER_HEADER_T* buffer = wait_for_input(decoder, decoder->input_pool, "input buffer", deadline_us);
     if (!buffer) {
+        decoder->needs_recovery = true;
+        return false;
+    }
+    
+    size_t annexb_size = h264_bitstream_to_annexb(h264_data, h264_size, H264_FORMAT_UNKNOWN,
+                                                  &decoder->parameter_sets,
+                                                  buffer->data, buffer->alloc_size);
+    if (annexb_size == 0) {
+        mmal_buffer_header_release(buffer);
         snprintf(decoder->error_message, sizeof(decoder->error_message), 
-                "No input buffer available");
+                "Unrecognized H.264 framing or input buffer too small (%zu bytes)", h264_size);
         return false;
     }
     
-    memcpy(buffer->data, h264_data, h264_size);
-    buffer->length = h264_size;
+    buffer->length = annexb_size;
     buffer->offset = 0;
     buffer->flags = MMAL_BUFFER_HEADER_FLAG_FRAME_END;
     
@@ -254,36 +629,213 @@ bool h264_hw_decoder_process(h264_hw_decoder_t* decoder,
         return false;
     }
     
-    if (vcos_semaphore_wait_timeout(&decoder->output_semaphore, 1000) != VCOS_SUCCESS) {
+    PIPELINE_PROBE3(decode_submit, decoder->frame_id, annexb_size, vcos_getmicrosecs64());
+    return finish_decode(decoder, start_us, deadline_us);
+#else
+    snprintf(decoder->error_message, sizeof(decoder->error_message), 
+            "Hardware decoder not available on this system");
+    return false;
+#endif
+#else
+    snprintf(decoder->error_message, sizeof(decoder->error_message), 
+            "Hardware decoder not available on this system");
+    return false;
+#endif
+}
+
+bool h264_hw_decoder_process_dmabuf(h264_hw_decoder_t* decoder,
+                                    int dmabuf_fd,
+                                    const uint8_t* h264_data,
+                                    size_t h264_size,
+                                    int timeout_ms) {
+    if (!decoder || dmabuf_fd < 0 || !h264_data || h264_size == 0) {
+        if (decoder) {
+            snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                    "Invalid parameters");
+        }
+        return false;
+    }
+    
+    if (timeout_ms <= 0) {
+        timeout_ms = decoder->timeout_ms;
+    }
+    
+#ifdef RASPBERRY_PI
+#ifndef NO_HARDWARE
+    if (!decoder->component_ready) {
+        snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                "Hardware decoder not ready");
+        return false;
+    }
+    
+    size_t inspect_size = h264_size < H264_HW_DECODER_DMABUF_INSPECT_SIZE ? 
+                          h264_size : H264_HW_DECODER_DMABUF_INSPECT_SIZE;
+    
+    if (!decoder->zero_copy || 
+        h264_bitstream_detect_format(h264_data, h264_size, decoder->parameter_sets.nal_length_size) !=
+        H264_FORMAT_ANNEXB) {
+        return h264_hw_decoder_process_timeout(decoder, h264_data, h264_size, timeout_ms);
+    }
+    
+    if (h264_size > decoder->limits.max_access_unit_size) {
         snprintf(decoder->error_message, sizeof(decoder->error_message), 
-                "Timeout waiting for decoded frame");
+                "Invalid H.264 access unit: access unit too large (%zu bytes)", h264_size);
+        return false;
+    }
+    
+    uint64_t start_us = vcos_getmicrosecs64();
+    uint64_t deadline_us = start_us + (uint64_t)timeout_ms * 1000;
+    
+    h264_validation_result_t validation;
+    if (!begin_decode(decoder, h264_data, inspect_size, &validation)) {
         return false;
     }
     
-    if (!decoder->frame_ready || !decoder->current_buffer) {
+    h264_bitstream_to_annexb(h264_data, inspect_size, H264_FORMAT_ANNEXB, 
+                             &decoder->parameter_sets, NULL, 0);
+    
+    unsigned int vc_handle = import_dmabuf(decoder, dmabuf_fd);
+    if (!vc_handle) {
+        return false;
+    }
+    
+    if (validation.has_idr && (!validation.has_sps || !validation.has_pps) &&
+        decoder->parameter_sets.sps_size > 0 && decoder->parameter_sets.pps_size > 0) {
+        if (!send_parameter_sets(decoder, deadline_us)) {
+            decoder->needs_recovery = true;
+            return false;
+        }
+    }
+    
+    MMAL_BUFFER_HEADER_T* buffer = wait_for_input(decoder, decoder->dmabuf_pool, "DMABUF buffer header",
+                                                  deadline_us);
+    if (!buffer) {
+        decoder->needs_recovery = true;
+        return false;
+    }
+    
+    buffer->data = (uint8_t*)(uintptr_t)vc_handle;
+    buffer->alloc_size = h264_size;
+    buffer->length = h264_size;
+    buffer->offset = 0;
+    buffer->flags = MMAL_BUFFER_HEADER_FLAG_FRAME_END;
+    
+    MMAL_STATUS_T status = mmal_port_send_buffer(decoder->input_port, buffer);
+    if (status != MMAL_SUCCESS) {
+        mmal_buffer_header_release(buffer);
+        decoder->needs_recovery = true;
         snprintf(decoder->error_message, sizeof(decoder->error_message), 
-                "No frame decoded");
+                "Failed to send DMABUF buffer: %s", mmal_status_to_string(status));
         return false;
     }
     
-    if (!convert_mmal_to_yuv420(decoder, decoder->current_buffer)) {
+    PIPELINE_PROBE3(decode_submit, decoder->frame_id, h264_size, vcos_getmicrosecs64());
+    return finish_decode(decoder, start_us, deadline_us);
+#else
+    (void)dmabuf_fd;
+    return h264_hw_decoder_process_timeout(decoder, h264_data, h264_size, timeout_ms);
+#endif
+#else
+    (void)dmabuf_fd;
+    return h264_hw_decoder_process_timeout(decoder, h264_data, h264_size, timeout_ms);
+#endif
+}
+
+void h264_hw_decoder_release_dmabufs(h264_hw_decoder_t* decoder) {
+    if (!decoder) return;
+    
+#ifdef RASPBERRY_PI
+#ifndef NO_HARDWARE
+    for (int i = 0; i < decoder->dmabuf_count; i++) {
+        vcsm_free(decoder->dmabuf_handles[i]);
+    }
+    decoder->dmabuf_count = 0;
+#endif
+#endif
+}
+
+void h264_hw_decoder_cancel(h264_hw_decoder_t* decoder) {
+    if (!decoder) return;
+    
+    __atomic_store_n(&decoder->cancel_requested, 1, __ATOMIC_RELEASE);
+    
+#ifdef RASPBERRY_PI
+#ifndef NO_HARDWARE
+    if (decoder->component_ready) {
+        vcos_semaphore_post(&decoder->output_semaphore);
+    }
+#endif
+#endif
+}
+
+bool h264_hw_decoder_recover(h264_hw_decoder_t* decoder) {
+    if (!decoder) return false;
+    
+#ifdef RASPBERRY_PI
+#ifndef NO_HARDWARE
+    if (!decoder->component_ready) {
         snprintf(decoder->error_message, sizeof(decoder->error_message), 
-                "Failed to convert MMAL frame to YUV420");
+                "Hardware decoder not ready");
         return false;
     }
     
-    decoder->width = 640;
-    decoder->height = 480;
+    MMAL_STATUS_T status = mmal_port_flush(decoder->input_port);
+    if (status == MMAL_SUCCESS && decoder->output_port->is_enabled) {
+        status = mmal_port_flush(decoder->output_port);
+    }
+    
+    if (status != MMAL_SUCCESS) {
+        mmal_component_disable(decoder->decoder);
+        status = mmal_component_enable(decoder->decoder);
+        if (status != MMAL_SUCCESS) {
+            snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                    "Failed to reset decoder: %s", mmal_status_to_string(status));
+            return false;
+        }
+    }
+    
+    drain_output(decoder);
+    __atomic_store_n(&decoder->cancel_requested, 0, __ATOMIC_RELEASE);
+    decoder->frame_ready = false;
     
+    if (decoder->output_port->is_enabled && !send_output_buffers(decoder)) {
+        return false;
+    }
+    
+    decoder->needs_recovery = false;
     return true;
 #else
     snprintf(decoder->error_message, sizeof(decoder->error_message), 
             "Hardware decoder not available on this system");
     return false;
 #endif
+#else
+    snprintf(decoder->error_message, sizeof(decoder->error_message), 
+            "Hardware decoder not available on this system");
+    return false;
 #endif
 }
 
+bool h264_hw_decoder_set_avcc(h264_hw_decoder_t* decoder,
+                             const uint8_t* avcc_data,
+                             size_t avcc_size) {
+    if (!decoder || !avcc_data || avcc_size == 0) {
+        if (decoder) {
+            snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                    "Invalid parameters");
+        }
+        return false;
+    }
+    
+    if (!h264_bitstream_parse_avcc(avcc_data, avcc_size, &decoder->parameter_sets)) {
+        snprintf(decoder->error_message, sizeof(decoder->error_message), 
+                "Invalid avcC decoder configuration record");
+        return false;
+    }
+    
+    return true;
+}
+
 const yuv420_frame_t* h264_hw_decoder_get_frame(const h264_hw_decoder_t* decoder) {
     if (!decoder) return NULL;
     
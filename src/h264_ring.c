@@ -0,0 +1,390 @@
+#include "h264_ring.h"
+#include "h264_bitstream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static h264_ring_entry_t* entry_at(const h264_ring_t* ring, uint64_t frame) {
+    return &ring->entries[frame % (uint64_t)ring->max_frames];
+}
+
+static void evict_oldest(h264_ring_t* ring) {
+    h264_ring_entry_t* oldest = entry_at(ring, ring->first);
+
+    if (ring->idr_first < ring->idr_next &&
+        ring->idr_index[ring->idr_first % (uint64_t)ring->max_frames] == ring->first) {
+        ring->idr_first++;
+    }
+
+    ring->bytes_used -= oldest->size;
+    ring->first++;
+    ring->frames_evicted++;
+}
+
+static bool overlaps_oldest(const h264_ring_t* ring, size_t offset, size_t size) {
+    const h264_ring_entry_t* oldest = entry_at(ring, ring->first);
+    return oldest->offset < offset + size && oldest->offset + oldest->size > offset;
+}
+
+void h264_ring_default_config(h264_ring_config_t* config) {
+    if (!config) return;
+
+    config->capacity = H264_RING_DEFAULT_CAPACITY;
+    config->duration_ms = H264_RING_DEFAULT_DURATION_MS;
+    config->max_frames = H264_RING_DEFAULT_MAX_FRAMES;
+}
+
+bool h264_ring_init(h264_ring_t* ring, const h264_ring_config_t* config) {
+    if (!ring) return false;
+
+    memset(ring, 0, sizeof(h264_ring_t));
+
+    h264_ring_config_t defaults;
+    h264_ring_default_config(&defaults);
+    if (!config) {
+        config = &defaults;
+    }
+
+    if (config->capacity == 0 || config->max_frames <= 0 || config->duration_ms < 0) {
+        snprintf(ring->error_message, sizeof(ring->error_message),
+                "Invalid ring configuration");
+        return false;
+    }
+
+    ring->data = malloc(config->capacity);
+    ring->entries = calloc((size_t)config->max_frames, sizeof(h264_ring_entry_t));
+    ring->idr_index = calloc((size_t)config->max_frames, sizeof(uint64_t));
+    if (!ring->data || !ring->entries || !ring->idr_index) {
+        h264_ring_cleanup(ring);
+        snprintf(ring->error_message, sizeof(ring->error_message),
+                "Failed to allocate %zu byte ring", config->capacity);
+        return false;
+    }
+
+    ring->capacity = config->capacity;
+    ring->max_frames = config->max_frames;
+    ring->duration_us = (uint64_t)config->duration_ms * 1000;
+    return true;
+}
+
+void h264_ring_cleanup(h264_ring_t* ring) {
+    if (!ring) return;
+
+    free(ring->data);
+    free(ring->entries);
+    free(ring->idr_index);
+    memset(ring, 0, sizeof(h264_ring_t));
+}
+
+void h264_ring_clear(h264_ring_t* ring) {
+    if (!ring) return;
+
+    ring->write_offset = 0;
+    ring->bytes_used = 0;
+    ring->first = ring->next;
+    ring->idr_first = ring->idr_next;
+}
+
+bool h264_ring_push(h264_ring_t* ring,
+                    const uint8_t* h264_data,
+                    size_t h264_size,
+                    uint64_t timestamp_us) {
+    if (!ring || !ring->data || !h264_data || h264_size == 0) {
+        if (ring) {
+            snprintf(ring->error_message, sizeof(ring->error_message),
+                    "Invalid parameters");
+        }
+        return false;
+    }
+
+    if (h264_size > ring->capacity) {
+        snprintf(ring->error_message, sizeof(ring->error_message),
+                "Access unit of %zu bytes exceeds ring capacity", h264_size);
+        return false;
+    }
+
+    if (ring->next > ring->first && timestamp_us < entry_at(ring, ring->next - 1)->timestamp_us) {
+        snprintf(ring->error_message, sizeof(ring->error_message),
+                "Timestamp earlier than previous frame");
+        return false;
+    }
+
+    if (ring->next - ring->first == (uint64_t)ring->max_frames) {
+        evict_oldest(ring);
+    }
+
+    size_t offset = ring->write_offset;
+    if (offset + h264_size > ring->capacity) {
+        while (ring->first < ring->next && entry_at(ring, ring->first)->offset >= offset) {
+            evict_oldest(ring);
+        }
+        offset = 0;
+    }
+
+    while (ring->first < ring->next && overlaps_oldest(ring, offset, h264_size)) {
+        evict_oldest(ring);
+    }
+
+    while (ring->duration_us > 0 && ring->first < ring->next &&
+           timestamp_us - entry_at(ring, ring->first)->timestamp_us > ring->duration_us) {
+        evict_oldest(ring);
+    }
+
+    if (ring->first == ring->next) {
+        offset = 0;
+    }
+
+    h264_ring_entry_t* entry = entry_at(ring, ring->next);
+    entry->offset = offset;
+    entry->size = h264_size;
+    entry->timestamp_us = timestamp_us;
+    entry->is_idr = h264_bitstream_contains_idr(h264_data, h264_size, H264_FORMAT_UNKNOWN, 4);
+    h264_bitstream_store_parameter_sets(h264_data, h264_size, H264_FORMAT_UNKNOWN, &ring->parameter_sets);
+    memcpy(ring->data + offset, h264_data, h264_size);
+
+    if (entry->is_idr) {
+        ring->idr_index[ring->idr_next % (uint64_t)ring->max_frames] = ring->next;
+        ring->idr_next++;
+    }
+
+    ring->next++;
+    ring->write_offset = offset + h264_size;
+    ring->bytes_used += h264_size;
+    return true;
+}
+
+bool h264_ring_push_frame(h264_ring_t* ring, const v4l2_capture_frame_t* frame) {
+    if (!frame) {
+        if (ring) {
+            snprintf(ring->error_message, sizeof(ring->error_message),
+                    "Invalid parameters");
+        }
+        return false;
+    }
+
+    return h264_ring_push(ring, frame->data, frame->size, frame->timestamp_us);
+}
+
+bool h264_ring_locate(h264_ring_t* ring,
+                      uint64_t timestamp_us,
+                      uint64_t* frame,
+                      uint64_t* idr_frame) {
+    if (!ring || !ring->data) return false;
+
+    if (ring->first == ring->next || timestamp_us < entry_at(ring, ring->first)->timestamp_us) {
+        snprintf(ring->error_message, sizeof(ring->error_message),
+                "Timestamp %llu is not in the buffered range",
+                (unsigned long long)timestamp_us);
+        return false;
+    }
+
+    uint64_t low = ring->first;
+    uint64_t high = ring->next - 1;
+    while (low < high) {
+        uint64_t mid = low + (high - low + 1) / 2;
+        if (entry_at(ring, mid)->timestamp_us <= timestamp_us) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    if (ring->idr_first == ring->idr_next ||
+        ring->idr_index[ring->idr_first % (uint64_t)ring->max_frames] > low) {
+        snprintf(ring->error_message, sizeof(ring->error_message),
+                "No buffered IDR precedes timestamp %llu",
+                (unsigned long long)timestamp_us);
+        return false;
+    }
+
+    uint64_t idr_low = ring->idr_first;
+    uint64_t idr_high = ring->idr_next - 1;
+    while (idr_low < idr_high) {
+        uint64_t mid = idr_low + (idr_high - idr_low + 1) / 2;
+        if (ring->idr_index[mid % (uint64_t)ring->max_frames] <= low) {
+            idr_low = mid;
+        } else {
+            idr_high = mid - 1;
+        }
+    }
+
+    if (frame) {
+        *frame = low;
+    }
+    if (idr_frame) {
+        *idr_frame = ring->idr_index[idr_low % (uint64_t)ring->max_frames];
+    }
+    return true;
+}
+
+const h264_ring_entry_t* h264_ring_get_entry(const h264_ring_t* ring, uint64_t frame) {
+    if (!ring || !ring->entries || frame < ring->first || frame >= ring->next) {
+        return NULL;
+    }
+
+    return entry_at(ring, frame);
+}
+
+static void seed_parameter_sets(const h264_ring_t* ring, h264_hw_decoder_t* decoder) {
+    const h264_parameter_sets_t* params = &ring->parameter_sets;
+
+    if (params->sps_size > 0) {
+        memcpy(decoder->parameter_sets.sps, params->sps, params->sps_size);
+        decoder->parameter_sets.sps_size = params->sps_size;
+    }
+    if (params->pps_size > 0) {
+        memcpy(decoder->parameter_sets.pps, params->pps, params->pps_size);
+        decoder->parameter_sets.pps_size = params->pps_size;
+    }
+}
+
+static bool decode_through(h264_ring_t* ring,
+                           h264_hw_decoder_t* decoder,
+                           uint64_t frame,
+                           uint64_t idr_frame,
+                           bool* have_decoded,
+                           uint64_t* decoded) {
+    uint64_t start = idr_frame;
+    if (*have_decoded && *decoded >= idr_frame && *decoded <= frame) {
+        start = *decoded + 1;
+    }
+
+    if (start == idr_frame) {
+        seed_parameter_sets(ring, decoder);
+    }
+
+    bool require_idr = decoder->limits.require_idr;
+    decoder->limits.require_idr = false;
+
+    for (uint64_t n = start; n <= frame; n++) {
+        const h264_ring_entry_t* entry = entry_at(ring, n);
+        if (!h264_hw_decoder_process(decoder, ring->data + entry->offset, entry->size)) {
+            decoder->limits.require_idr = require_idr;
+            *have_decoded = false;
+            snprintf(ring->error_message, sizeof(ring->error_message),
+                    "Decoding buffered frame failed: %s", h264_hw_decoder_get_error(decoder));
+            return false;
+        }
+        *decoded = n;
+        *have_decoded = true;
+    }
+
+    decoder->limits.require_idr = require_idr;
+    return true;
+}
+
+static bool encode_decoded(h264_ring_t* ring,
+                           h264_hw_decoder_t* decoder,
+                           mjpeg_hw_encoder_t* encoder,
+                           uint8_t** jpeg_data,
+                           size_t* jpeg_size) {
+    const yuv420_frame_t* frame = h264_hw_decoder_get_frame(decoder);
+    if (!frame) {
+        snprintf(ring->error_message, sizeof(ring->error_message),
+                "No decoded frame available");
+        return false;
+    }
+
+    if (!mjpeg_hw_encoder_encode(encoder, frame, jpeg_data, jpeg_size)) {
+        snprintf(ring->error_message, sizeof(ring->error_message),
+                "Hardware MJPEG encoding failed: %s", mjpeg_hw_encoder_get_error(encoder));
+        return false;
+    }
+
+    return true;
+}
+
+bool h264_ring_extract(h264_ring_t* ring,
+                       h264_hw_decoder_t* decoder,
+                       mjpeg_hw_encoder_t* encoder,
+                       uint64_t timestamp_us,
+                       uint8_t** jpeg_data,
+                       size_t* jpeg_size,
+                       uint64_t* frame_timestamp_us) {
+    if (!ring || !decoder || !encoder || !jpeg_data || !jpeg_size) {
+        if (ring) {
+            snprintf(ring->error_message, sizeof(ring->error_message),
+                    "Invalid parameters");
+        }
+        return false;
+    }
+
+    uint64_t frame;
+    uint64_t idr_frame;
+    if (!h264_ring_locate(ring, timestamp_us, &frame, &idr_frame)) {
+        return false;
+    }
+
+    bool have_decoded = false;
+    uint64_t decoded = 0;
+    if (!decode_through(ring, decoder, frame, idr_frame, &have_decoded, &decoded) ||
+        !encode_decoded(ring, decoder, encoder, jpeg_data, jpeg_size)) {
+        return false;
+    }
+
+    if (frame_timestamp_us) {
+        *frame_timestamp_us = entry_at(ring, frame)->timestamp_us;
+    }
+    return true;
+}
+
+int h264_ring_extract_range(h264_ring_t* ring,
+                            h264_hw_decoder_t* decoder,
+                            mjpeg_hw_encoder_t* encoder,
+                            uint64_t start_us,
+                            uint64_t end_us,
+                            int interval_ms,
+                            h264_ring_callback_t callback,
+                            void* userdata) {
+    if (!ring || !decoder || !encoder || !callback || interval_ms <= 0 || end_us < start_us) {
+        if (ring) {
+            snprintf(ring->error_message, sizeof(ring->error_message),
+                    "Invalid parameters");
+        }
+        return -1;
+    }
+
+    bool have_decoded = false;
+    uint64_t decoded = 0;
+    bool have_emitted = false;
+    uint64_t emitted = 0;
+    int count = 0;
+
+    for (uint64_t t = start_us; t <= end_us; t += (uint64_t)interval_ms * 1000) {
+        uint64_t frame;
+        uint64_t idr_frame;
+        if (!h264_ring_locate(ring, t, &frame, &idr_frame)) {
+            continue;
+        }
+
+        if (have_emitted && frame == emitted) {
+            continue;
+        }
+
+        uint8_t* jpeg_data = NULL;
+        size_t jpeg_size = 0;
+        if (!decode_through(ring, decoder, frame, idr_frame, &have_decoded, &decoded) ||
+            !encode_decoded(ring, decoder, encoder, &jpeg_data, &jpeg_size)) {
+            return -1;
+        }
+
+        callback(jpeg_data, jpeg_size, entry_at(ring, frame)->timestamp_us, userdata);
+        free(jpeg_data);
+
+        emitted = frame;
+        have_emitted = true;
+        count++;
+    }
+
+    if (count == 0) {
+        snprintf(ring->error_message, sizeof(ring->error_message),
+                "No decodable frames in requested range");
+    }
+
+    return count;
+}
+
+const char* h264_ring_get_error(const h264_ring_t* ring) {
+    if (!ring) return "Invalid ring context";
+    return ring->error_message;
+}
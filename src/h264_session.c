@@ -0,0 +1,237 @@
+#include "h264_session.h"
+#include "h264_bitstream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool h264_gop_cache_init(h264_gop_cache_t* cache, size_t capacity) {
+    if (!cache) return false;
+
+    memset(cache, 0, sizeof(h264_gop_cache_t));
+
+    if (capacity == 0) {
+        capacity = H264_GOP_CACHE_DEFAULT_CAPACITY;
+    }
+
+    cache->data = malloc(capacity);
+    if (!cache->data) {
+        return false;
+    }
+
+    cache->capacity = capacity;
+    return true;
+}
+
+void h264_gop_cache_cleanup(h264_gop_cache_t* cache) {
+    if (!cache) return;
+
+    free(cache->data);
+    memset(cache, 0, sizeof(h264_gop_cache_t));
+}
+
+void h264_gop_cache_reset(h264_gop_cache_t* cache) {
+    if (!cache) return;
+
+    cache->size = 0;
+    cache->count = 0;
+    cache->broken = false;
+}
+
+int h264_gop_cache_add(h264_gop_cache_t* cache,
+                       const uint8_t* data,
+                       size_t size,
+                       uint64_t timestamp_us,
+                       bool is_idr) {
+    if (!cache || !cache->data || !data || size == 0) return -1;
+
+    if (is_idr) {
+        h264_gop_cache_reset(cache);
+    } else if (cache->count == 0 || cache->broken) {
+        return -1;
+    }
+
+    if (cache->count == H264_GOP_CACHE_MAX_FRAMES || size > cache->capacity - cache->size) {
+        cache->broken = true;
+        return -1;
+    }
+
+    int index = cache->count++;
+    cache->offsets[index] = cache->size;
+    cache->sizes[index] = size;
+    cache->timestamps[index] = timestamp_us;
+    memcpy(cache->data + cache->size, data, size);
+    cache->size += size;
+
+    return index;
+}
+
+static bool decode_to(h264_session_t* session, int target, bool replay) {
+    int next = session->decoded_index + 1;
+
+    for (int i = next; i <= target; i++) {
+        const uint8_t* data = session->gop.data + session->gop.offsets[i];
+        if (!h264_hw_decoder_process(&session->decoder, data, session->gop.sizes[i])) {
+            session->decoded_index = -1;
+            snprintf(session->error_message, sizeof(session->error_message),
+                    "Decoding frame %d of GOP failed: %s", i,
+                    h264_hw_decoder_get_error(&session->decoder));
+            return false;
+        }
+
+        session->decoded_index = i;
+        session->frame_timestamp_us = session->gop.timestamps[i];
+        session->frames_decoded++;
+        if (replay) {
+            session->frames_replayed++;
+        }
+    }
+
+    return true;
+}
+
+bool h264_session_init(h264_session_t* session, h264_session_mode_t mode, int quality) {
+    if (!session) return false;
+
+    memset(session, 0, sizeof(h264_session_t));
+    session->mode = mode;
+    session->quality = quality;
+    session->decoded_index = -1;
+
+    if (!h264_gop_cache_init(&session->gop, H264_GOP_CACHE_DEFAULT_CAPACITY)) {
+        snprintf(session->error_message, sizeof(session->error_message),
+                "Failed to allocate GOP cache");
+        return false;
+    }
+
+    if (!h264_hw_decoder_init(&session->decoder) || !session->decoder.hw_available) {
+        snprintf(session->error_message, sizeof(session->error_message),
+                "Hardware decoder not available: %s",
+                h264_hw_decoder_get_error(&session->decoder));
+        h264_session_cleanup(session);
+        return false;
+    }
+
+    if (!mjpeg_hw_encoder_init(&session->encoder, quality) || !session->encoder.hw_available) {
+        snprintf(session->error_message, sizeof(session->error_message),
+                "Hardware MJPEG encoder not available: %s",
+                mjpeg_hw_encoder_get_error(&session->encoder));
+        h264_session_cleanup(session);
+        return false;
+    }
+
+    return true;
+}
+
+void h264_session_cleanup(h264_session_t* session) {
+    if (!session) return;
+
+    char message[sizeof(session->error_message)];
+    memcpy(message, session->error_message, sizeof(message));
+
+    mjpeg_hw_encoder_cleanup(&session->encoder);
+    h264_hw_decoder_cleanup(&session->decoder);
+    h264_gop_cache_cleanup(&session->gop);
+
+    memset(session, 0, sizeof(h264_session_t));
+    session->decoded_index = -1;
+    memcpy(session->error_message, message, sizeof(message));
+}
+
+bool h264_session_push(h264_session_t* session,
+                       const uint8_t* h264_data,
+                       size_t h264_size,
+                       uint64_t timestamp_us) {
+    if (!session || !h264_data || h264_size == 0) {
+        if (session) {
+            snprintf(session->error_message, sizeof(session->error_message),
+                    "Invalid parameters");
+        }
+        return false;
+    }
+
+    h264_validation_limits_t limits = session->decoder.limits;
+    limits.allow_parameter_sets_only = true;
+
+    h264_validation_result_t validation;
+    if (!h264_bitstream_validate(h264_data, h264_size, H264_FORMAT_UNKNOWN,
+                                 &session->decoder.parameter_sets, &limits, &validation)) {
+        snprintf(session->error_message, sizeof(session->error_message),
+                "Invalid H.264 access unit: %s", validation.reason);
+        return false;
+    }
+
+    h264_bitstream_store_parameter_sets(h264_data, h264_size, H264_FORMAT_UNKNOWN,
+                                        &session->decoder.parameter_sets);
+    if (validation.slice_count == 0) {
+        return true;
+    }
+
+    int index = h264_gop_cache_add(&session->gop, h264_data, h264_size, timestamp_us,
+                                   validation.has_idr);
+    if (index < 0) {
+        if (session->gop.count == 0) {
+            return true;
+        }
+        snprintf(session->error_message, sizeof(session->error_message),
+                "GOP cache full, waiting for next IDR");
+        return false;
+    }
+
+    if (validation.has_idr) {
+        session->decoded_index = -1;
+    }
+
+    if (session->mode == H264_SESSION_STREAMING) {
+        return decode_to(session, index, false);
+    }
+
+    return true;
+}
+
+bool h264_session_snapshot(h264_session_t* session,
+                           uint8_t** jpeg_data,
+                           size_t* jpeg_size,
+                           uint64_t* timestamp_us) {
+    if (!session || !jpeg_data || !jpeg_size) {
+        if (session) {
+            snprintf(session->error_message, sizeof(session->error_message),
+                    "Invalid parameters");
+        }
+        return false;
+    }
+
+    if (session->gop.count == 0) {
+        snprintf(session->error_message, sizeof(session->error_message),
+                "No IDR received yet");
+        return false;
+    }
+
+    if (!decode_to(session, session->gop.count - 1, true)) {
+        return false;
+    }
+
+    const yuv420_frame_t* frame = h264_hw_decoder_get_frame(&session->decoder);
+    if (!frame) {
+        snprintf(session->error_message, sizeof(session->error_message),
+                "No decoded frame available");
+        return false;
+    }
+
+    if (!mjpeg_hw_encoder_encode(&session->encoder, frame, jpeg_data, jpeg_size)) {
+        snprintf(session->error_message, sizeof(session->error_message),
+                "Hardware MJPEG encoding failed: %s",
+                mjpeg_hw_encoder_get_error(&session->encoder));
+        return false;
+    }
+
+    if (timestamp_us) {
+        *timestamp_us = session->frame_timestamp_us;
+    }
+
+    return true;
+}
+
+const char* h264_session_get_error(const h264_session_t* session) {
+    if (!session) return "Invalid session context";
+    return session->error_message;
+}
@@ -0,0 +1,148 @@
+#define _GNU_SOURCE
+#include "h264_snapshot.h"
+#include "h264_to_jpeg.h"
+#include "h264_bitstream.h"
+#include "videodev2.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool frame_is_idr(const v4l2_capture_frame_t* frame) {
+    uint32_t type_flags = V4L2_BUF_FLAG_KEYFRAME | V4L2_BUF_FLAG_PFRAME | V4L2_BUF_FLAG_BFRAME;
+
+    if ((frame->flags & type_flags) && !(frame->flags & V4L2_BUF_FLAG_KEYFRAME)) {
+        return false;
+    }
+
+    return h264_bitstream_contains_idr(frame->data, frame->size, H264_FORMAT_ANNEXB, 4);
+}
+
+static bool cache_idr(h264_snapshot_t* snapshot, const v4l2_capture_frame_t* frame) {
+    if (frame->size > snapshot->last_idr_capacity) {
+        uint8_t* grown = realloc(snapshot->last_idr, frame->size);
+        if (!grown) {
+            snprintf(snapshot->error_message, sizeof(snapshot->error_message),
+                    "Failed to allocate memory for cached IDR");
+            snapshot->last_idr_size = 0;
+            return false;
+        }
+        snapshot->last_idr = grown;
+        snapshot->last_idr_capacity = frame->size;
+    }
+
+    memcpy(snapshot->last_idr, frame->data, frame->size);
+    snapshot->last_idr_size = frame->size;
+    snapshot->last_idr_us = frame->timestamp_us;
+    return true;
+}
+
+static bool deliver(h264_snapshot_t* snapshot,
+                    const uint8_t* data,
+                    size_t size,
+                    int dmabuf_fd,
+                    uint64_t timestamp_us) {
+    uint8_t* jpeg_data = NULL;
+    size_t jpeg_size = 0;
+
+    bool converted = dmabuf_fd >= 0 ?
+        h264_to_jpeg_dmabuf(dmabuf_fd, data, size, &jpeg_data, &jpeg_size, snapshot->quality) :
+        h264_to_jpeg(data, size, &jpeg_data, &jpeg_size, snapshot->quality);
+
+    __atomic_store_n(&snapshot->pending, 0, __ATOMIC_RELEASE);
+    snapshot->keyframe_forced = false;
+
+    if (!converted) {
+        snprintf(snapshot->error_message, sizeof(snapshot->error_message),
+                "Snapshot conversion failed: %s", h264_to_jpeg_get_error());
+        return false;
+    }
+
+    snapshot->snapshots_taken++;
+    if (snapshot->callback) {
+        snapshot->callback(jpeg_data, jpeg_size, timestamp_us, snapshot->userdata);
+    }
+
+    h264_to_jpeg_free(jpeg_data);
+    return true;
+}
+
+bool h264_snapshot_init(h264_snapshot_t* snapshot,
+                        v4l2_capture_t* capture,
+                        h264_snapshot_callback_t callback,
+                        void* userdata) {
+    if (!snapshot) return false;
+
+    memset(snapshot, 0, sizeof(h264_snapshot_t));
+    snapshot->capture = capture;
+    snapshot->callback = callback;
+    snapshot->userdata = userdata;
+    snapshot->quality = H264_SNAPSHOT_DEFAULT_QUALITY;
+    snapshot->max_idr_age_ms = H264_SNAPSHOT_DEFAULT_MAX_IDR_AGE_MS;
+
+    if (!callback) {
+        snprintf(snapshot->error_message, sizeof(snapshot->error_message),
+                "Invalid parameters");
+        return false;
+    }
+
+    if (capture && capture->fd >= 0) {
+        v4l2_capture_set_repeat_sequence_header(capture, true);
+    }
+
+    return true;
+}
+
+void h264_snapshot_cleanup(h264_snapshot_t* snapshot) {
+    if (!snapshot) return;
+
+    free(snapshot->last_idr);
+    memset(snapshot, 0, sizeof(h264_snapshot_t));
+}
+
+void h264_snapshot_request(h264_snapshot_t* snapshot) {
+    if (!snapshot) return;
+
+    __atomic_store_n(&snapshot->pending, 1, __ATOMIC_RELEASE);
+}
+
+bool h264_snapshot_feed(h264_snapshot_t* snapshot, const v4l2_capture_frame_t* frame) {
+    if (!snapshot || !frame) return false;
+
+    if (!frame->data || frame->size == 0) {
+        return true;
+    }
+
+    bool is_idr = frame_is_idr(frame);
+    bool pending = __atomic_load_n(&snapshot->pending, __ATOMIC_ACQUIRE) != 0;
+
+    if (is_idr && snapshot->max_idr_age_ms > 0) {
+        cache_idr(snapshot, frame);
+    }
+
+    if (!pending) {
+        return true;
+    }
+
+    if (is_idr) {
+        return deliver(snapshot, frame->data, frame->size, frame->dmabuf_fd, frame->timestamp_us);
+    }
+
+    if (snapshot->last_idr_size > 0 &&
+        frame->timestamp_us >= snapshot->last_idr_us &&
+        frame->timestamp_us - snapshot->last_idr_us <= (uint64_t)snapshot->max_idr_age_ms * 1000) {
+        return deliver(snapshot, snapshot->last_idr, snapshot->last_idr_size, -1, snapshot->last_idr_us);
+    }
+
+    if (!snapshot->keyframe_forced && snapshot->capture &&
+        v4l2_capture_force_keyframe(snapshot->capture)) {
+        snapshot->keyframe_forced = true;
+        snapshot->keyframes_forced++;
+    }
+
+    return true;
+}
+
+const char* h264_snapshot_get_error(const h264_snapshot_t* snapshot) {
+    if (!snapshot) return "Invalid snapshot context";
+    return snapshot->error_message;
+}
@@ -0,0 +1,467 @@
+#include "h264_synth.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG2_MAX_FRAME_NUM 16
+#define MB_TYPE_I_16X16_DC 3
+#define MB_TYPE_I_PCM 25
+#define SLICE_TYPE_P 5
+#define SLICE_TYPE_I 7
+#define PCM_MB_BYTES 384
+#define NAL_HEADER_BYTES 64
+
+typedef struct {
+    uint8_t* data;
+    size_t length;
+    int bit;
+} bit_writer_t;
+
+static const struct {
+    int max_frame_mbs;
+    int level_idc;
+} levels[] = {
+    {99, 10}, {396, 20}, {792, 21}, {1620, 30}, {3600, 31}, {5120, 32},
+    {8192, 40}, {8704, 42}, {22080, 50}, {36864, 51}, {139264, 60}
+};
+
+static void put_bit(bit_writer_t* writer, int value) {
+    if (writer->bit == 0) {
+        writer->data[writer->length] = 0;
+    }
+    if (value) {
+        writer->data[writer->length] |= (uint8_t)(0x80 >> writer->bit);
+    }
+    if (++writer->bit == 8) {
+        writer->bit = 0;
+        writer->length++;
+    }
+}
+
+static void put_bits(bit_writer_t* writer, uint32_t value, int count) {
+    for (int i = count - 1; i >= 0; i--) {
+        put_bit(writer, (value >> i) & 1);
+    }
+}
+
+static void put_ue(bit_writer_t* writer, uint32_t value) {
+    uint32_t code = value + 1;
+    int length = 32 - __builtin_clz(code);
+    put_bits(writer, 0, length - 1);
+    put_bits(writer, code, length);
+}
+
+static void put_se(bit_writer_t* writer, int value) {
+    put_ue(writer, value > 0 ? (uint32_t)(2 * value - 1) : (uint32_t)(-2 * value));
+}
+
+static void put_align_zero(bit_writer_t* writer) {
+    while (writer->bit != 0) {
+        put_bit(writer, 0);
+    }
+}
+
+static void put_trailing_bits(bit_writer_t* writer) {
+    put_bit(writer, 1);
+    put_align_zero(writer);
+}
+
+static size_t append_nal(uint8_t* out, int nal_header, const bit_writer_t* rbsp) {
+    size_t length = 0;
+    out[length++] = 0;
+    out[length++] = 0;
+    out[length++] = 0;
+    out[length++] = 1;
+    out[length++] = (uint8_t)nal_header;
+
+    int zeros = 0;
+    for (size_t i = 0; i < rbsp->length; i++) {
+        uint8_t byte = rbsp->data[i];
+        if (zeros >= 2 && byte <= 3) {
+            out[length++] = 3;
+            zeros = 0;
+        }
+        out[length++] = byte;
+        zeros = byte == 0 ? zeros + 1 : 0;
+    }
+    return length;
+}
+
+static uint8_t pattern_sample(const h264_synth_t* synth, int plane, int x, int y, int phase) {
+    uint32_t hash = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^
+                    (synth->config.seed + (uint32_t)plane) * 83492791u;
+    hash ^= hash >> 13;
+    hash *= 0x5bd1e995u;
+    hash ^= hash >> 15;
+    int noise = (int)(hash % 24);
+
+    switch (plane) {
+    case 0:
+        return (uint8_t)(16 + (x + y / 2 + phase) % 176 + noise);
+    case 1:
+        return (uint8_t)(64 + (x * 2 + phase) % 96 + noise);
+    default:
+        return (uint8_t)(64 + (y * 2 + phase) % 96 + noise);
+    }
+}
+
+static int dc_average(int sum_a, bool has_a, int sum_b, bool has_b, int count) {
+    int shift = count == 16 ? 4 : 2;
+    if (has_a && has_b) return (sum_a + sum_b + count) >> (shift + 1);
+    if (has_a) return (sum_a + count / 2) >> shift;
+    if (has_b) return (sum_b + count / 2) >> shift;
+    return 128;
+}
+
+static void predict_luma_dc(uint8_t* plane, int stride, int x, int y) {
+    int top = 0;
+    int left = 0;
+    for (int i = 0; i < 16; i++) {
+        if (y > 0) top += plane[(size_t)(y - 1) * stride + x + i];
+        if (x > 0) left += plane[(size_t)(y + i) * stride + x - 1];
+    }
+
+    uint8_t value = (uint8_t)dc_average(top, y > 0, left, x > 0, 16);
+    for (int row = 0; row < 16; row++) {
+        memset(plane + (size_t)(y + row) * stride + x, value, 16);
+    }
+}
+
+static void predict_chroma_dc(uint8_t* plane, int stride, int x, int y) {
+    for (int block = 0; block < 4; block++) {
+        int bx = (block & 1) * 4;
+        int by = (block >> 1) * 4;
+        int top = 0;
+        int left = 0;
+        for (int i = 0; i < 4; i++) {
+            if (y > 0) top += plane[(size_t)(y - 1) * stride + x + bx + i];
+            if (x > 0) left += plane[(size_t)(y + by + i) * stride + x - 1];
+        }
+
+        int value;
+        if (bx > 0 && by == 0 && y > 0) {
+            value = dc_average(top, true, 0, false, 4);
+        } else if (bx == 0 && by > 0 && x > 0) {
+            value = dc_average(left, true, 0, false, 4);
+        } else {
+            value = dc_average(top, y > 0, left, x > 0, 4);
+        }
+
+        for (int row = 0; row < 4; row++) {
+            memset(plane + (size_t)(y + by + row) * stride + x + bx, value, 4);
+        }
+    }
+}
+
+static void put_empty_coeff_token(bit_writer_t* writer, int nc) {
+    if (nc < 2) {
+        put_bits(writer, 0x1, 1);
+    } else if (nc < 4) {
+        put_bits(writer, 0x3, 2);
+    } else if (nc < 8) {
+        put_bits(writer, 0xF, 4);
+    } else {
+        put_bits(writer, 0x3, 6);
+    }
+}
+
+static void write_sps(h264_synth_t* synth, bit_writer_t* writer) {
+    int crop_right = (synth->width_in_mbs * 16 - synth->config.width) / 2;
+    int crop_bottom = (synth->height_in_mbs * 16 - synth->config.height) / 2;
+
+    put_bits(writer, 66, 8);
+    put_bits(writer, 0xC0, 8);
+    put_bits(writer, (uint32_t)synth->level_idc, 8);
+    put_ue(writer, 0);
+    put_ue(writer, LOG2_MAX_FRAME_NUM - 4);
+    put_ue(writer, 2);
+    put_ue(writer, 1);
+    put_bit(writer, 0);
+    put_ue(writer, (uint32_t)synth->width_in_mbs - 1);
+    put_ue(writer, (uint32_t)synth->height_in_mbs - 1);
+    put_bit(writer, 1);
+    put_bit(writer, 1);
+    if (crop_right || crop_bottom) {
+        put_bit(writer, 1);
+        put_ue(writer, 0);
+        put_ue(writer, (uint32_t)crop_right);
+        put_ue(writer, 0);
+        put_ue(writer, (uint32_t)crop_bottom);
+    } else {
+        put_bit(writer, 0);
+    }
+    put_bit(writer, 0);
+    put_trailing_bits(writer);
+}
+
+static void write_pps(bit_writer_t* writer) {
+    put_ue(writer, 0);
+    put_ue(writer, 0);
+    put_bit(writer, 0);
+    put_bit(writer, 0);
+    put_ue(writer, 0);
+    put_ue(writer, 0);
+    put_ue(writer, 0);
+    put_bit(writer, 0);
+    put_bits(writer, 0, 2);
+    put_se(writer, 0);
+    put_se(writer, 0);
+    put_se(writer, 0);
+    put_bit(writer, 1);
+    put_bit(writer, 0);
+    put_bit(writer, 0);
+    put_trailing_bits(writer);
+}
+
+static void write_idr_slice(h264_synth_t* synth, bit_writer_t* writer) {
+    int luma_stride = synth->width_in_mbs * 16;
+    int chroma_stride = synth->width_in_mbs * 8;
+    uint8_t* y_plane = synth->recon;
+    uint8_t* u_plane = y_plane + (size_t)luma_stride * synth->height_in_mbs * 16;
+    uint8_t* v_plane = u_plane + (size_t)chroma_stride * synth->height_in_mbs * 8;
+    int phase = (int)(synth->frame_count / (uint32_t)synth->config.gop_length) * 16;
+
+    put_ue(writer, 0);
+    put_ue(writer, SLICE_TYPE_I);
+    put_ue(writer, 0);
+    put_bits(writer, 0, LOG2_MAX_FRAME_NUM);
+    put_ue(writer, (uint32_t)synth->idr_pic_id);
+    put_bit(writer, 0);
+    put_bit(writer, 0);
+    put_se(writer, 0);
+    put_ue(writer, 1);
+
+    int credit = 0;
+    for (int my = 0; my < synth->height_in_mbs; my++) {
+        for (int mx = 0; mx < synth->width_in_mbs; mx++) {
+            int index = my * synth->width_in_mbs + mx;
+            credit += synth->config.pcm_percent;
+            bool pcm = credit >= 100;
+            if (pcm) {
+                credit -= 100;
+            }
+            synth->pcm_map[index] = pcm;
+
+            if (!pcm) {
+                int left = mx > 0 && synth->pcm_map[index - 1] ? 16 : 0;
+                int top = my > 0 && synth->pcm_map[index - synth->width_in_mbs] ? 16 : 0;
+                int nc = (mx > 0 && my > 0) ? (left + top + 1) >> 1 : left + top;
+
+                put_ue(writer, MB_TYPE_I_16X16_DC);
+                put_ue(writer, 0);
+                put_se(writer, 0);
+                put_empty_coeff_token(writer, nc);
+
+                predict_luma_dc(y_plane, luma_stride, mx * 16, my * 16);
+                predict_chroma_dc(u_plane, chroma_stride, mx * 8, my * 8);
+                predict_chroma_dc(v_plane, chroma_stride, mx * 8, my * 8);
+                continue;
+            }
+
+            put_ue(writer, MB_TYPE_I_PCM);
+            put_align_zero(writer);
+            for (int row = 0; row < 16; row++) {
+                uint8_t* dst = y_plane + (size_t)(my * 16 + row) * luma_stride + mx * 16;
+                for (int col = 0; col < 16; col++) {
+                    dst[col] = pattern_sample(synth, 0, mx * 16 + col, my * 16 + row, phase);
+                }
+                memcpy(writer->data + writer->length, dst, 16);
+                writer->length += 16;
+            }
+            for (int plane = 1; plane <= 2; plane++) {
+                uint8_t* chroma = plane == 1 ? u_plane : v_plane;
+                for (int row = 0; row < 8; row++) {
+                    uint8_t* dst = chroma + (size_t)(my * 8 + row) * chroma_stride + mx * 8;
+                    for (int col = 0; col < 8; col++) {
+                        dst[col] = pattern_sample(synth, plane, mx * 8 + col, my * 8 + row, phase);
+                    }
+                    memcpy(writer->data + writer->length, dst, 8);
+                    writer->length += 8;
+                }
+            }
+        }
+    }
+
+    put_trailing_bits(writer);
+}
+
+static void write_p_slice(h264_synth_t* synth, bit_writer_t* writer, int frame_num) {
+    put_ue(writer, 0);
+    put_ue(writer, SLICE_TYPE_P);
+    put_ue(writer, 0);
+    put_bits(writer, (uint32_t)frame_num, LOG2_MAX_FRAME_NUM);
+    put_bit(writer, 0);
+    put_bit(writer, 0);
+    put_bit(writer, 0);
+    put_se(writer, 0);
+    put_ue(writer, 1);
+    put_ue(writer, (uint32_t)(synth->width_in_mbs * synth->height_in_mbs));
+    put_trailing_bits(writer);
+}
+
+void h264_synth_default_config(h264_synth_config_t* config) {
+    if (!config) return;
+
+    memset(config, 0, sizeof(h264_synth_config_t));
+    config->width = 640;
+    config->height = 480;
+    config->gop_length = H264_SYNTH_DEFAULT_GOP_LENGTH;
+    config->pcm_percent = H264_SYNTH_DEFAULT_PCM_PERCENT;
+    config->seed = 1;
+}
+
+bool h264_synth_init(h264_synth_t* synth, const h264_synth_config_t* config) {
+    if (!synth) return false;
+
+    memset(synth, 0, sizeof(h264_synth_t));
+
+    if (!config) {
+        snprintf(synth->error_message, sizeof(synth->error_message), "Invalid parameters");
+        return false;
+    }
+
+    if (config->width < 2 || config->height < 2 || (config->width & 1) || (config->height & 1) ||
+        config->width > H264_SYNTH_MAX_DIMENSION || config->height > H264_SYNTH_MAX_DIMENSION) {
+        snprintf(synth->error_message, sizeof(synth->error_message),
+                "Invalid dimensions %dx%d: must be even and at most %d",
+                config->width, config->height, H264_SYNTH_MAX_DIMENSION);
+        return false;
+    }
+
+    if (config->gop_length < 1 || config->pcm_percent < 0 || config->pcm_percent > 100) {
+        snprintf(synth->error_message, sizeof(synth->error_message),
+                "GOP length must be positive and PCM percentage 0-100");
+        return false;
+    }
+
+    synth->config = *config;
+    synth->width_in_mbs = (config->width + 15) / 16;
+    synth->height_in_mbs = (config->height + 15) / 16;
+
+    int frame_mbs = synth->width_in_mbs * synth->height_in_mbs;
+    synth->level_idc = levels[sizeof(levels) / sizeof(levels[0]) - 1].level_idc;
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        if (frame_mbs <= levels[i].max_frame_mbs) {
+            synth->level_idc = levels[i].level_idc;
+            break;
+        }
+    }
+
+    size_t recon_size = (size_t)frame_mbs * 256 * 3 / 2;
+    synth->rbsp_capacity = NAL_HEADER_BYTES + (size_t)frame_mbs * (PCM_MB_BYTES + 8);
+    synth->output_capacity = 3 * NAL_HEADER_BYTES + synth->rbsp_capacity * 3 / 2;
+
+    synth->recon = calloc(recon_size, 1);
+    synth->expected = malloc((size_t)config->width * config->height * 3 / 2);
+    synth->rbsp = malloc(synth->rbsp_capacity);
+    synth->output = malloc(synth->output_capacity);
+    synth->pcm_map = calloc((size_t)frame_mbs, sizeof(bool));
+    if (!synth->recon || !synth->expected || !synth->rbsp || !synth->output || !synth->pcm_map) {
+        h264_synth_cleanup(synth);
+        snprintf(synth->error_message, sizeof(synth->error_message),
+                "Failed to allocate generator buffers");
+        return false;
+    }
+
+    return true;
+}
+
+void h264_synth_cleanup(h264_synth_t* synth) {
+    if (!synth) return;
+
+    free(synth->recon);
+    free(synth->expected);
+    free(synth->rbsp);
+    free(synth->output);
+    free(synth->pcm_map);
+
+    char message[sizeof(synth->error_message)];
+    memcpy(message, synth->error_message, sizeof(message));
+    memset(synth, 0, sizeof(h264_synth_t));
+    memcpy(synth->error_message, message, sizeof(message));
+}
+
+static void fill_expected(h264_synth_t* synth, yuv420_frame_t* frame) {
+    int width = synth->config.width;
+    int height = synth->config.height;
+    int luma_stride = synth->width_in_mbs * 16;
+    int chroma_stride = synth->width_in_mbs * 8;
+    const uint8_t* y_plane = synth->recon;
+    const uint8_t* u_plane = y_plane + (size_t)luma_stride * synth->height_in_mbs * 16;
+    const uint8_t* v_plane = u_plane + (size_t)chroma_stride * synth->height_in_mbs * 8;
+
+    memset(frame, 0, sizeof(yuv420_frame_t));
+    frame->width = width;
+    frame->height = height;
+    frame->y_size = width * height;
+    frame->uv_size = frame->y_size / 4;
+    frame->y_plane = synth->expected;
+    frame->u_plane = frame->y_plane + frame->y_size;
+    frame->v_plane = frame->u_plane + frame->uv_size;
+
+    for (int row = 0; row < height; row++) {
+        memcpy(frame->y_plane + (size_t)row * width, y_plane + (size_t)row * luma_stride, width);
+    }
+    for (int row = 0; row < height / 2; row++) {
+        memcpy(frame->u_plane + (size_t)row * (width / 2), u_plane + (size_t)row * chroma_stride, width / 2);
+        memcpy(frame->v_plane + (size_t)row * (width / 2), v_plane + (size_t)row * chroma_stride, width / 2);
+    }
+}
+
+bool h264_synth_next_frame(h264_synth_t* synth,
+                           const uint8_t** h264_data,
+                           size_t* h264_size,
+                           yuv420_frame_t* expected) {
+    if (!synth || !h264_data || !h264_size) {
+        if (synth) {
+            snprintf(synth->error_message, sizeof(synth->error_message), "Invalid parameters");
+        }
+        return false;
+    }
+
+    if (!synth->output) {
+        snprintf(synth->error_message, sizeof(synth->error_message), "Generator not initialized");
+        return false;
+    }
+
+    int frame_num = (int)(synth->frame_count % (uint32_t)synth->config.gop_length);
+    size_t length = 0;
+    bit_writer_t writer;
+
+    if (frame_num == 0) {
+        memset(&writer, 0, sizeof(writer));
+        writer.data = synth->rbsp;
+        write_sps(synth, &writer);
+        length += append_nal(synth->output + length, 0x67, &writer);
+
+        memset(&writer, 0, sizeof(writer));
+        writer.data = synth->rbsp;
+        write_pps(&writer);
+        length += append_nal(synth->output + length, 0x68, &writer);
+
+        memset(&writer, 0, sizeof(writer));
+        writer.data = synth->rbsp;
+        write_idr_slice(synth, &writer);
+        length += append_nal(synth->output + length, 0x65, &writer);
+        synth->idr_pic_id = (synth->idr_pic_id + 1) & 0xFFFF;
+    } else {
+        memset(&writer, 0, sizeof(writer));
+        writer.data = synth->rbsp;
+        write_p_slice(synth, &writer, frame_num & ((1 << LOG2_MAX_FRAME_NUM) - 1));
+        length += append_nal(synth->output + length, 0x41, &writer);
+    }
+
+    synth->frame_count++;
+    *h264_data = synth->output;
+    *h264_size = length;
+
+    if (expected) {
+        fill_expected(synth, expected);
+    }
+    return true;
+}
+
+const char* h264_synth_get_error(const h264_synth_t* synth) {
+    if (!synth) return "Invalid generator context";
+    return synth->error_message;
+}
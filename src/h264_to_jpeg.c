@@ -1,14 +1,22 @@
+#define _GNU_SOURCE
 #include "h264_to_jpeg.h"
 #include "h264_hw_decoder.h"
 #include "mjpeg_hw_encoder.h"
+#include "jpeg_sw_encoder.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include "pipeline_time.h"
+#include "pipeline_stats.h"
+#include "pipeline_trace.h"
+#include "pipeline_probes.h"
 
 static char g_error_message[256] = {0};
 static bool g_debug_enabled = false;
+static h264_parameter_sets_t g_parameter_sets = {0};
+static int g_timeout_ms = H264_HW_DECODER_DEFAULT_TIMEOUT_MS + MJPEG_HW_ENCODER_DEFAULT_TIMEOUT_MS;
 
 static void debug_printf(const char* format, ...) {
     if (!g_debug_enabled) return;
@@ -19,26 +27,301 @@ static void debug_printf(const char* format, ...) {
     va_end(args);
 }
 
-bool h264_to_jpeg(const uint8_t* h264_data, 
-                  size_t h264_size, 
-                  uint8_t** jpeg_data, 
-                  size_t* jpeg_size,
-                  int quality) {
-    if (!h264_data || h264_size == 0 || !jpeg_data || !jpeg_size) {
+static bool resolve_crop(const h264_to_jpeg_options_t* options, const yuv420_frame_t* yuv_frame, yuv_rect_t* crop) {
+    crop->x = 0;
+    crop->y = 0;
+    crop->width = yuv_frame->width;
+    crop->height = yuv_frame->height;
+    if (options->crop.width <= 0 || options->crop.height <= 0) {
+        return true;
+    }
+    
+    *crop = options->crop;
+    if (!yuv_rect_align(crop, yuv_frame->width, yuv_frame->height, H264_TO_JPEG_CROP_ALIGNMENT)) {
+        snprintf(g_error_message, sizeof(g_error_message), 
+                "Crop %dx%d+%d+%d lies outside the %dx%d frame", 
+                options->crop.width, options->crop.height, options->crop.x, options->crop.y,
+                yuv_frame->width, yuv_frame->height);
+        return false;
+    }
+    return true;
+}
+
+static void target_size(const h264_to_jpeg_options_t* options, int* width, int* height) {
+    bool transposed = options->rotation == YUV_ROTATE_90 || options->rotation == YUV_ROTATE_270;
+    *width = transposed ? options->height : options->width;
+    *height = transposed ? options->width : options->height;
+}
+
+static void order_renditions(const yuv420_frame_t* yuv_frame,
+                             const h264_to_jpeg_options_t* options,
+                             int count,
+                             int* order) {
+    int64_t pixels[H264_TO_JPEG_MAX_RENDITIONS];
+    
+    for (int i = 0; i < count; i++) {
+        yuv_rect_t crop;
+        yuv_rect_t source;
+        int target_width;
+        int target_height;
+        int width = 0;
+        int height = 0;
+        target_size(&options[i], &target_width, &target_height);
+        if (resolve_crop(&options[i], yuv_frame, &crop)) {
+            yuv_scale_plan(crop.width, crop.height, target_width, target_height, options[i].aspect,
+                           &source, &width, &height);
+        }
+        pixels[i] = (int64_t)width * height;
+        
+        int j = i;
+        while (j > 0 && pixels[order[j - 1]] < pixels[i]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+}
+
+static bool reset_orientation(mjpeg_hw_encoder_t* encoder) {
+    if (!mjpeg_hw_encoder_set_orientation(encoder, YUV_ROTATE_0, YUV_FLIP_NONE)) {
+        snprintf(g_error_message, sizeof(g_error_message), 
+                "Hardware MJPEG encoder orientation change failed: %s", 
+                mjpeg_hw_encoder_get_error(encoder));
+        return false;
+    }
+    return true;
+}
+
+static bool orient_image(yuv_rotator_t* rotator,
+                         mjpeg_hw_encoder_t* encoder,
+                         const h264_to_jpeg_options_t* options,
+                         yuv_image_t* image,
+                         bool* rotated_by_encoder,
+                         uint32_t frame_id) {
+    *rotated_by_encoder = false;
+    if (options->rotation == YUV_ROTATE_0 && options->flip == YUV_FLIP_NONE) {
+        return reset_orientation(encoder);
+    }
+    
+    // The encoder's mirror/rotation order is unspecified, so it only takes one of the two at a time
+    if (options->rotation == YUV_ROTATE_0 || options->flip == YUV_FLIP_NONE) {
+        if (mjpeg_hw_encoder_set_orientation(encoder, options->rotation, options->flip)) {
+            *rotated_by_encoder = true;
+            return true;
+        }
+        debug_printf("Encoder cannot orient the image, rotating in software: %s\n", 
+                    mjpeg_hw_encoder_get_error(encoder));
+    }
+    
+    if (!reset_orientation(encoder)) {
+        return false;
+    }
+    
+    const yuv420_frame_t* rotated;
+    PIPELINE_TRACE_BEGIN("rotate", frame_id);
+    bool done = yuv_rotator_rotate_image(rotator, image, options->rotation, options->flip, &rotated);
+    PIPELINE_TRACE_END("rotate", frame_id);
+    
+    if (!done) {
+        snprintf(g_error_message, sizeof(g_error_message), 
+                "Rotation failed: %s", 
+                yuv_rotator_get_error(rotator));
+        return false;
+    }
+    yuv_image_from_frame(image, rotated);
+    return true;
+}
+
+static bool encode_rendition(yuv_scaler_t* scaler,
+                             yuv_rotator_t* rotator,
+                             mjpeg_hw_encoder_t* encoder,
+                             const yuv420_frame_t* yuv_frame,
+                             const h264_to_jpeg_options_t* options,
+                             h264_to_jpeg_rendition_t* rendition,
+                             uint64_t deadline_us,
+                             uint32_t frame_id) {
+    yuv_rect_t crop;
+    if (!resolve_crop(options, yuv_frame, &crop)) {
+        return false;
+    }
+    
+    int target_width;
+    int target_height;
+    target_size(options, &target_width, &target_height);
+    
+    yuv_image_t image;
+    if (target_width > 0 || target_height > 0) {
+        PIPELINE_TRACE_BEGIN("scale", frame_id);
+        bool scaled = yuv_scaler_scale_region(scaler, yuv_frame, &crop, target_width, target_height,
+                                              options->aspect, &yuv_frame);
+        PIPELINE_TRACE_END("scale", frame_id);
+        
+        if (!scaled) {
+            snprintf(g_error_message, sizeof(g_error_message), 
+                    "Scaling failed: %s", 
+                    yuv_scaler_get_error(scaler));
+            return false;
+        }
+        yuv_image_from_frame(&image, yuv_frame);
+    } else {
+        // The crop is encoded straight out of the decoded planes
+        yuv_image_from_frame(&image, yuv_frame);
+        yuv_image_crop(&image, crop.x, crop.y, crop.width, crop.height);
+    }
+    
+    bool rotated_by_encoder;
+    if (!orient_image(rotator, encoder, options, &image, &rotated_by_encoder, frame_id)) {
+        return false;
+    }
+    
+    if (!mjpeg_hw_encoder_set_quality(encoder, options->quality)) {
+        snprintf(g_error_message, sizeof(g_error_message), 
+                "Hardware MJPEG encoder quality change failed: %s", 
+                mjpeg_hw_encoder_get_error(encoder));
+        return false;
+    }
+    
+    uint64_t now_us = pipeline_time_now_us();
+    if (now_us >= deadline_us) {
+        snprintf(g_error_message, sizeof(g_error_message), 
+                "Timeout: no time left for JPEG encoding");
+        return false;
+    }
+    
+    mjpeg_hw_encoder_set_timeout(encoder, (int)((deadline_us - now_us + 999) / 1000));
+    
+    PIPELINE_TRACE_BEGIN("encode", frame_id);
+    bool encoded = mjpeg_hw_encoder_encode_image(encoder, &image, &rendition->jpeg_data, &rendition->jpeg_size);
+    PIPELINE_TRACE_END("encode", frame_id);
+    
+    if (!encoded) {
+        snprintf(g_error_message, sizeof(g_error_message), 
+                "Hardware MJPEG encoding failed: %s", 
+                mjpeg_hw_encoder_get_error(encoder));
+        return false;
+    }
+    
+    bool transposed = rotated_by_encoder &&
+                      (options->rotation == YUV_ROTATE_90 || options->rotation == YUV_ROTATE_270);
+    rendition->width = transposed ? image.height : image.width;
+    rendition->height = transposed ? image.width : image.height;
+    debug_printf("Encoded %dx%d rendition at quality %d (size: %zu bytes)\n", 
+                rendition->width, rendition->height, options->quality, rendition->jpeg_size);
+    return true;
+}
+
+static bool encode_renditions(const yuv420_frame_t* yuv_frame,
+                              const h264_to_jpeg_options_t* options,
+                              h264_to_jpeg_rendition_t* renditions,
+                              int count,
+                              uint64_t deadline_us,
+                              pipeline_latency_record_t* record,
+                              uint32_t frame_id) {
+    if (!mjpeg_hw_encoder_available()) {
+        snprintf(g_error_message, sizeof(g_error_message), 
+                "Hardware MJPEG encoder not available on this system");
+        return false;
+    }
+    
+    debug_printf("Using hardware MJPEG encoder\n");
+    pipeline_latency_mark(record, PIPELINE_STAGE_ENCODE_SUBMITTED);
+    
+    mjpeg_hw_encoder_t encoder;
+    if (!mjpeg_hw_encoder_init(&encoder, options[0].quality)) {
+        snprintf(g_error_message, sizeof(g_error_message), 
+                "Hardware MJPEG encoder initialization failed: %s", 
+                mjpeg_hw_encoder_get_error(&encoder));
+        return false;
+    }
+    
+    // Check if hardware is actually available after initialization
+    if (!encoder.hw_available) {
+        snprintf(g_error_message, sizeof(g_error_message), 
+                "Hardware MJPEG encoder not available: %s", 
+                mjpeg_hw_encoder_get_error(&encoder));
+        mjpeg_hw_encoder_cleanup(&encoder);
+        return false;
+    }
+    mjpeg_hw_encoder_set_frame_id(&encoder, frame_id);
+    
+    bool scaling = false;
+    for (int i = 0; i < count; i++) {
+        scaling = scaling || options[i].width > 0 || options[i].height > 0;
+    }
+    
+    yuv_scaler_t scaler;
+    yuv_scaler_init(&scaler, scaling);
+    
+    yuv_rotator_t rotator;
+    yuv_rotator_init(&rotator);
+    
+    // Largest first: the scaler's frame is sized once and each scaled frame is encoded while still cached
+    int order[H264_TO_JPEG_MAX_RENDITIONS];
+    order_renditions(yuv_frame, options, count, order);
+    
+    bool encoded = true;
+    for (int n = 0; n < count && encoded; n++) {
+        int i = order[n];
+        encoded = encode_rendition(&scaler, &rotator, &encoder, yuv_frame, &options[i], &renditions[i],
+                                   deadline_us, frame_id);
+    }
+    
+    if (encoded) {
+        pipeline_latency_mark(record, PIPELINE_STAGE_ENCODED);
+    }
+    
+    mjpeg_hw_encoder_cleanup(&encoder);
+    yuv_scaler_cleanup(&scaler);
+    yuv_rotator_cleanup(&rotator);
+    
+    return encoded;
+}
+
+static bool decode_and_encode(int dmabuf_fd,
+                              const uint8_t* h264_data, 
+                              size_t h264_size, 
+                              const h264_to_jpeg_options_t* options,
+                              h264_to_jpeg_rendition_t* renditions,
+                              int count,
+                              pipeline_latency_record_t* record,
+                              uint32_t frame_id) {
+    if (!h264_data || h264_size == 0 || !renditions) {
         snprintf(g_error_message, sizeof(g_error_message), 
                 "Invalid parameters");
         return false;
     }
     
-    if (quality < 1 || quality > 100) {
-        quality = 85;
+    uint64_t deadline_us = pipeline_time_now_us() + (uint64_t)g_timeout_ms * 1000;
+    pipeline_latency_mark(record, PIPELINE_STAGE_DECODE_SUBMITTED);
+    
+    debug_printf("Starting H.264 to JPEG conversion (size: %zu, renditions: %d, timeout: %d ms)\n", 
+                h264_size, count, g_timeout_ms);
+    
+    size_t validate_size = h264_size;
+    if (dmabuf_fd >= 0 && h264_size > H264_HW_DECODER_DMABUF_INSPECT_SIZE &&
+        h264_bitstream_detect_format(h264_data, h264_size, g_parameter_sets.nal_length_size) ==
+        H264_FORMAT_ANNEXB) {
+        validate_size = H264_HW_DECODER_DMABUF_INSPECT_SIZE;
+    }
+    
+    h264_validation_limits_t limits;
+    h264_bitstream_default_limits(&limits);
+    limits.require_idr = true;
+    
+    h264_validation_result_t validation;
+    if (!h264_bitstream_validate(h264_data, validate_size, H264_FORMAT_UNKNOWN,
+                                 &g_parameter_sets, &limits, &validation)) {
+        snprintf(g_error_message, sizeof(g_error_message), 
+                "Invalid H.264 access unit: %s", validation.reason);
+        return false;
     }
     
-    debug_printf("Starting H.264 to JPEG conversion (size: %zu, quality: %d)\n", 
-                h264_size, quality);
+    debug_printf("Access unit validated: %d NAL units, %dx%d\n", 
+                validation.nal_count, validation.width, validation.height);
     
     const yuv420_frame_t* yuv_frame = NULL;
     bool decode_success = false;
+    bool encoded = false;
     
     if (!h264_hw_decoder_available()) {
         snprintf(g_error_message, sizeof(g_error_message), 
@@ -59,12 +342,31 @@ bool h264_to_jpeg(const uint8_t* h264_data,
             return false;
         }
         
-        if (h264_hw_decoder_process(&hw_decoder, h264_data, h264_size)) {
+        hw_decoder.parameter_sets = g_parameter_sets;
+        h264_hw_decoder_set_frame_id(&hw_decoder, frame_id);
+        h264_hw_decoder_set_validation(&hw_decoder, h264_data, validate_size, &validation);
+        
+        bool processed;
+        PIPELINE_TRACE_BEGIN("decode", frame_id);
+        if (dmabuf_fd >= 0) {
+            processed = h264_hw_decoder_process_dmabuf(&hw_decoder, dmabuf_fd, h264_data, h264_size, 
+                                                       g_timeout_ms);
+        } else {
+            processed = h264_hw_decoder_process_timeout(&hw_decoder, h264_data, h264_size, 
+                                                        g_timeout_ms);
+        }
+        PIPELINE_TRACE_END("decode", frame_id);
+        g_parameter_sets = hw_decoder.parameter_sets;
+        
+        if (processed) {
+            pipeline_latency_mark(record, PIPELINE_STAGE_DECODED);
             yuv_frame = h264_hw_decoder_get_frame(&hw_decoder);
             if (yuv_frame) {
                 decode_success = true;
                 debug_printf("Hardware decoding successful: %dx%d\n", 
                             yuv_frame->width, yuv_frame->height);
+                encoded = encode_renditions(yuv_frame, options, renditions, count, deadline_us, record,
+                                            frame_id);
             }
         } else {
             snprintf(g_error_message, sizeof(g_error_message), 
@@ -86,46 +388,301 @@ bool h264_to_jpeg(const uint8_t* h264_data,
         return false;
     }
     
-    if (!mjpeg_hw_encoder_available()) {
+    return encoded;
+}
+
+static bool validate_options(const h264_to_jpeg_options_t* options) {
+    if (options->width < 0 || options->height < 0 || (unsigned)options->aspect > YUV_SCALE_FILL ||
+        options->crop.x < 0 || options->crop.y < 0 || options->crop.width < 0 || options->crop.height < 0 ||
+        !yuv_orientation_valid(options->rotation, options->flip)) {
         snprintf(g_error_message, sizeof(g_error_message), 
-                "Hardware MJPEG encoder not available on this system");
+                "Invalid output size, crop, aspect policy or orientation");
         return false;
     }
     
-    debug_printf("Using hardware MJPEG encoder\n");
+    return true;
+}
+
+static bool convert(int dmabuf_fd,
+                    const uint8_t* h264_data, 
+                    size_t h264_size, 
+                    const h264_to_jpeg_options_t* options,
+                    h264_to_jpeg_rendition_t* renditions,
+                    int count,
+                    pipeline_latency_record_t* record,
+                    uint32_t frame_id) {
+    h264_to_jpeg_options_t resolved[H264_TO_JPEG_MAX_RENDITIONS];
+    for (int i = 0; i < count; i++) {
+        resolved[i] = options[i];
+        if (resolved[i].quality < 1 || resolved[i].quality > 100) {
+            resolved[i].quality = 85;
+        }
+    }
     
-    mjpeg_hw_encoder_t encoder;
-    if (!mjpeg_hw_encoder_init(&encoder, quality)) {
+    if (renditions) {
+        memset(renditions, 0, sizeof(h264_to_jpeg_rendition_t) * (size_t)count);
+    }
+    
+    uint64_t start_us = pipeline_time_now_us();
+    pipeline_stats_add(PIPELINE_COUNTER_FRAMES_IN, 1);
+    pipeline_stats_add(PIPELINE_COUNTER_BYTES_IN, h264_data ? h264_size : 0);
+    
+    PIPELINE_TRACE_BEGIN("convert", frame_id);
+    PIPELINE_PROBE3(convert_begin, frame_id, h264_size, start_us);
+    bool converted = decode_and_encode(dmabuf_fd, h264_data, h264_size, resolved, renditions, count,
+                                       record, frame_id);
+    size_t jpeg_bytes = 0;
+    for (int i = 0; converted && i < count; i++) {
+        jpeg_bytes += renditions[i].jpeg_size;
+    }
+    PIPELINE_TRACE_END("convert", frame_id);
+    PIPELINE_PROBE3(convert_end, frame_id, jpeg_bytes, pipeline_time_now_us());
+    
+    if (!converted) {
+        if (renditions) {
+            h264_to_jpeg_free_renditions(renditions, count);
+        }
+        pipeline_stats_add(PIPELINE_COUNTER_ERRORS, 1);
+        return false;
+    }
+    
+    pipeline_stats_add(PIPELINE_COUNTER_FRAMES_OUT, 1);
+    pipeline_stats_add(PIPELINE_COUNTER_BYTES_OUT, jpeg_bytes);
+    pipeline_stats_record(PIPELINE_METRIC_TOTAL, pipeline_time_now_us() - start_us);
+    return true;
+}
+
+static bool convert_one(int dmabuf_fd,
+                        const uint8_t* h264_data, 
+                        size_t h264_size, 
+                        const h264_to_jpeg_options_t* options,
+                        uint8_t** jpeg_data, 
+                        size_t* jpeg_size,
+                        pipeline_latency_record_t* record,
+                        uint32_t frame_id) {
+    h264_to_jpeg_rendition_t rendition;
+    if (!convert(dmabuf_fd, h264_data, h264_size, options, jpeg_data && jpeg_size ? &rendition : NULL, 1,
+                 record, frame_id)) {
+        return false;
+    }
+    
+    *jpeg_data = rendition.jpeg_data;
+    *jpeg_size = rendition.jpeg_size;
+    return true;
+}
+
+static h264_to_jpeg_options_t options_for(int quality) {
+    h264_to_jpeg_options_t options;
+    h264_to_jpeg_default_options(&options);
+    options.quality = quality;
+    return options;
+}
+
+void h264_to_jpeg_default_options(h264_to_jpeg_options_t* options) {
+    if (!options) return;
+    
+    memset(options, 0, sizeof(h264_to_jpeg_options_t));
+    options->quality = 85;
+    options->aspect = YUV_SCALE_FIT;
+}
+
+bool h264_to_jpeg(const uint8_t* h264_data, 
+                  size_t h264_size, 
+                  uint8_t** jpeg_data, 
+                  size_t* jpeg_size,
+                  int quality) {
+    h264_to_jpeg_options_t options = options_for(quality);
+    return convert_one(-1, h264_data, h264_size, &options, jpeg_data, jpeg_size, NULL, 0);
+}
+
+bool h264_to_jpeg_with_options(const uint8_t* h264_data, 
+                               size_t h264_size, 
+                               const h264_to_jpeg_options_t* options,
+                               uint8_t** jpeg_data, 
+                               size_t* jpeg_size) {
+    h264_to_jpeg_options_t defaults;
+    if (!options) {
+        h264_to_jpeg_default_options(&defaults);
+        options = &defaults;
+    }
+    
+    if (!validate_options(options)) {
+        return false;
+    }
+    
+    return convert_one(-1, h264_data, h264_size, options, jpeg_data, jpeg_size, NULL, 0);
+}
+
+bool h264_to_jpeg_renditions(const uint8_t* h264_data, 
+                             size_t h264_size, 
+                             const h264_to_jpeg_options_t* options,
+                             h264_to_jpeg_rendition_t* renditions,
+                             int count) {
+    if (!options || !renditions || count < 1 || count > H264_TO_JPEG_MAX_RENDITIONS) {
         snprintf(g_error_message, sizeof(g_error_message), 
-                "Hardware MJPEG encoder initialization failed: %s", 
-                mjpeg_hw_encoder_get_error(&encoder));
+                "Invalid parameters: %d renditions (1-%d supported)", count, H264_TO_JPEG_MAX_RENDITIONS);
         return false;
     }
     
-    // Check if hardware is actually available after initialization
-    if (!encoder.hw_available) {
+    for (int i = 0; i < count; i++) {
+        if (!validate_options(&options[i])) {
+            return false;
+        }
+    }
+    
+    return convert(-1, h264_data, h264_size, options, renditions, count, NULL, 0);
+}
+
+void h264_to_jpeg_free_renditions(h264_to_jpeg_rendition_t* renditions, int count) {
+    if (!renditions) return;
+    
+    for (int i = 0; i < count; i++) {
+        h264_to_jpeg_free(renditions[i].jpeg_data);
+        renditions[i].jpeg_data = NULL;
+        renditions[i].jpeg_size = 0;
+    }
+}
+
+bool h264_to_jpeg_dmabuf(int dmabuf_fd,
+                         const uint8_t* h264_data, 
+                         size_t h264_size, 
+                         uint8_t** jpeg_data, 
+                         size_t* jpeg_size,
+                         int quality) {
+    if (dmabuf_fd < 0) {
         snprintf(g_error_message, sizeof(g_error_message), 
-                "Hardware MJPEG encoder not available: %s", 
-                mjpeg_hw_encoder_get_error(&encoder));
-        mjpeg_hw_encoder_cleanup(&encoder);
+                "Invalid DMABUF file descriptor");
         return false;
     }
     
-    if (!mjpeg_hw_encoder_encode(&encoder, yuv_frame, jpeg_data, jpeg_size)) {
+    h264_to_jpeg_options_t options = options_for(quality);
+    return convert_one(dmabuf_fd, h264_data, h264_size, &options, jpeg_data, jpeg_size, NULL, 0);
+}
+
+bool h264_to_jpeg_frame(const v4l2_capture_frame_t* frame,
+                        uint8_t** jpeg_data, 
+                        size_t* jpeg_size,
+                        int quality,
+                        pipeline_latency_record_t* record) {
+    if (!frame) {
         snprintf(g_error_message, sizeof(g_error_message), 
-                "Hardware MJPEG encoding failed: %s", 
-                mjpeg_hw_encoder_get_error(&encoder));
-        mjpeg_hw_encoder_cleanup(&encoder);
+                "Invalid parameters");
         return false;
     }
     
-    debug_printf("Hardware MJPEG encoding successful (size: %zu bytes)\n", *jpeg_size);
+    h264_to_jpeg_options_t options = options_for(quality);
+    return convert_one(frame->dmabuf_fd, frame->data, frame->size, &options, jpeg_data, jpeg_size, record,
+                       frame->sequence);
+}
+
+static bool encode_image(const yuv_image_t* image, uint8_t** jpeg_data, size_t* jpeg_size, int quality) {
+    if (mjpeg_hw_encoder_available()) {
+        mjpeg_hw_encoder_t hw_encoder;
+        if (mjpeg_hw_encoder_init(&hw_encoder, quality) && hw_encoder.hw_available) {
+            debug_printf("Using hardware MJPEG encoder\n");
+            mjpeg_hw_encoder_set_timeout(&hw_encoder, g_timeout_ms);
+            bool encoded = mjpeg_hw_encoder_encode_image(&hw_encoder, image, jpeg_data, jpeg_size);
+            if (!encoded) {
+                snprintf(g_error_message, sizeof(g_error_message), 
+                        "Hardware MJPEG encoding failed: %s", 
+                        mjpeg_hw_encoder_get_error(&hw_encoder));
+            }
+            mjpeg_hw_encoder_cleanup(&hw_encoder);
+            return encoded;
+        }
+        mjpeg_hw_encoder_cleanup(&hw_encoder);
+    }
+    
+    debug_printf("Using software JPEG encoder\n");
     
-    mjpeg_hw_encoder_cleanup(&encoder);
+    jpeg_sw_encoder_t sw_encoder;
+    if (!jpeg_sw_encoder_init(&sw_encoder, quality)) {
+        snprintf(g_error_message, sizeof(g_error_message), 
+                "Software JPEG encoder initialization failed: %s", 
+                jpeg_sw_encoder_get_error(&sw_encoder));
+        return false;
+    }
+    
+    bool encoded = jpeg_sw_encoder_encode_image(&sw_encoder, image, jpeg_data, jpeg_size);
+    if (!encoded) {
+        snprintf(g_error_message, sizeof(g_error_message), 
+                "Software JPEG encoding failed: %s", 
+                jpeg_sw_encoder_get_error(&sw_encoder));
+    }
+    jpeg_sw_encoder_cleanup(&sw_encoder);
+    return encoded;
+}
+
+static size_t image_size(const yuv_image_t* image) {
+    size_t pixels = (size_t)image->width * image->height;
+    return image->format == YUV_FORMAT_YUYV ? pixels * 2 : pixels * 3 / 2;
+}
+
+bool yuv_to_jpeg(const yuv_image_t* image,
+                 uint8_t** jpeg_data,
+                 size_t* jpeg_size,
+                 int quality) {
+    if (!image || !jpeg_data || !jpeg_size) {
+        snprintf(g_error_message, sizeof(g_error_message), 
+                "Invalid parameters");
+        return false;
+    }
+    
+    if (!yuv_image_validate(image)) {
+        snprintf(g_error_message, sizeof(g_error_message), 
+                "Invalid YUV image layout");
+        return false;
+    }
+    
+    if (quality < 1 || quality > 100) {
+        quality = 85;
+    }
+    
+    uint64_t start_us = pipeline_time_now_us();
+    pipeline_stats_add(PIPELINE_COUNTER_FRAMES_IN, 1);
+    pipeline_stats_add(PIPELINE_COUNTER_BYTES_IN, image_size(image));
+    
+    debug_printf("Starting YUV to JPEG conversion (%dx%d, format: %d, quality: %d)\n", 
+                image->width, image->height, (int)image->format, quality);
     
+    PIPELINE_TRACE_BEGIN("encode", 0);
+    PIPELINE_PROBE3(convert_begin, 0, image_size(image), start_us);
+    bool encoded = encode_image(image, jpeg_data, jpeg_size, quality);
+    PIPELINE_TRACE_END("encode", 0);
+    PIPELINE_PROBE3(convert_end, 0, encoded ? *jpeg_size : 0, pipeline_time_now_us());
+    
+    if (!encoded) {
+        pipeline_stats_add(PIPELINE_COUNTER_ERRORS, 1);
+        return false;
+    }
+    
+    debug_printf("JPEG encoding successful (size: %zu bytes)\n", *jpeg_size);
+    pipeline_stats_add(PIPELINE_COUNTER_FRAMES_OUT, 1);
+    pipeline_stats_add(PIPELINE_COUNTER_BYTES_OUT, *jpeg_size);
+    pipeline_stats_record(PIPELINE_METRIC_TOTAL, pipeline_time_now_us() - start_us);
     return true;
 }
 
+bool h264_to_jpeg_set_avcc(const uint8_t* avcc_data, size_t avcc_size) {
+    if (!avcc_data || avcc_size == 0) {
+        memset(&g_parameter_sets, 0, sizeof(g_parameter_sets));
+        return true;
+    }
+    
+    if (!h264_bitstream_parse_avcc(avcc_data, avcc_size, &g_parameter_sets)) {
+        snprintf(g_error_message, sizeof(g_error_message), 
+                "Invalid avcC decoder configuration record");
+        return false;
+    }
+    
+    return true;
+}
+
+void h264_to_jpeg_set_timeout(int timeout_ms) {
+    g_timeout_ms = timeout_ms > 0 ? timeout_ms : 
+                   H264_HW_DECODER_DEFAULT_TIMEOUT_MS + MJPEG_HW_ENCODER_DEFAULT_TIMEOUT_MS;
+}
+
 void h264_to_jpeg_free(uint8_t* jpeg_data) {
     if (jpeg_data) {
         free(jpeg_data);
@@ -0,0 +1,475 @@
+#include "jpeg_sw_decoder.h"
+#include "jpeg_sw_internal.h"
+#include "pipeline_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    int32_t max_code[18];
+    int32_t value_offset[17];
+    uint8_t values[256];
+    bool defined;
+} huffman_table_t;
+
+typedef struct {
+    uint8_t id;
+    uint8_t sampling;
+    uint8_t quant_table;
+    uint8_t dc_table;
+    uint8_t ac_table;
+    int last_dc;
+} component_t;
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t position;
+    uint32_t bits;
+    int bit_count;
+    int padded;
+} bit_reader_t;
+
+typedef struct {
+    jpeg_sw_decoder_t* decoder;
+    uint16_t quant[4][64];
+    bool quant_defined[4];
+    huffman_table_t dc_tables[4];
+    huffman_table_t ac_tables[4];
+    component_t components[3];
+    int width;
+    int height;
+    int restart_interval;
+    bool have_frame;
+} jpeg_state_t;
+
+static bool fail(jpeg_state_t* state, const char* message) {
+    snprintf(state->decoder->error_message, sizeof(state->decoder->error_message), "%s", message);
+    return false;
+}
+
+static uint16_t read_word(const uint8_t* data) {
+    return (uint16_t)((data[0] << 8) | data[1]);
+}
+
+static bool parse_quant(jpeg_state_t* state, const uint8_t* data, size_t length) {
+    size_t offset = 0;
+    while (offset < length) {
+        int precision = data[offset] >> 4;
+        int id = data[offset] & 0x0F;
+        size_t table_size = precision ? 128 : 64;
+        if (id > 3 || offset + 1 + table_size > length) {
+            return fail(state, "Invalid quantization table");
+        }
+
+        for (int k = 0; k < 64; k++) {
+            state->quant[id][k] = precision ? read_word(&data[offset + 1 + 2 * k]) : data[offset + 1 + k];
+        }
+        state->quant_defined[id] = true;
+        offset += 1 + table_size;
+    }
+    return true;
+}
+
+static bool parse_huffman(jpeg_state_t* state, const uint8_t* data, size_t length) {
+    size_t offset = 0;
+    while (offset < length) {
+        int table_class = data[offset] >> 4;
+        int id = data[offset] & 0x0F;
+        if (table_class > 1 || id > 3 || offset + 17 > length) {
+            return fail(state, "Invalid Huffman table");
+        }
+
+        const uint8_t* bits = &data[offset + 1];
+        int count = 0;
+        for (int i = 0; i < 16; i++) {
+            count += bits[i];
+        }
+        if (count > 256 || offset + 17 + (size_t)count > length) {
+            return fail(state, "Invalid Huffman table");
+        }
+
+        huffman_table_t* table = table_class ? &state->ac_tables[id] : &state->dc_tables[id];
+        memcpy(table->values, &data[offset + 17], (size_t)count);
+
+        int32_t code = 0;
+        int k = 0;
+        for (int size = 1; size <= 16; size++) {
+            table->value_offset[size] = k - code;
+            code += bits[size - 1];
+            k += bits[size - 1];
+            table->max_code[size] = bits[size - 1] ? code - 1 : -1;
+            code <<= 1;
+        }
+        table->max_code[17] = 0x7FFFFFFF;
+        table->defined = true;
+        offset += 17 + (size_t)count;
+    }
+    return true;
+}
+
+static bool parse_frame(jpeg_state_t* state, const uint8_t* data, size_t length) {
+    if (length < 6 || data[0] != 8) {
+        return fail(state, "Only 8-bit JPEG is supported");
+    }
+
+    state->height = read_word(&data[1]);
+    state->width = read_word(&data[3]);
+    if (state->width < 2 || state->height < 2) {
+        return fail(state, "Invalid JPEG dimensions");
+    }
+
+    if (data[5] != 3 || length < 6 + 3 * 3) {
+        return fail(state, "Only three-component JPEG is supported");
+    }
+
+    for (int i = 0; i < 3; i++) {
+        state->components[i].id = data[6 + 3 * i];
+        state->components[i].sampling = data[7 + 3 * i];
+        state->components[i].quant_table = data[8 + 3 * i] & 0x03;
+    }
+
+    if (state->components[0].sampling != 0x22 || state->components[1].sampling != 0x11 ||
+        state->components[2].sampling != 0x11) {
+        return fail(state, "Only 4:2:0 sampling is supported");
+    }
+
+    state->have_frame = true;
+    return true;
+}
+
+static void refill(bit_reader_t* reader) {
+    while (reader->bit_count <= 24) {
+        uint8_t byte = 0;
+        if (reader->position < reader->size) {
+            byte = reader->data[reader->position];
+            if (byte == 0xFF) {
+                uint8_t next = reader->position + 1 < reader->size ? reader->data[reader->position + 1] : 0xD9;
+                if (next == 0x00) {
+                    reader->position += 2;
+                } else {
+                    byte = 0;
+                    reader->padded++;
+                }
+            } else {
+                reader->position++;
+            }
+        } else {
+            reader->padded++;
+        }
+        reader->bits |= (uint32_t)byte << (24 - reader->bit_count);
+        reader->bit_count += 8;
+    }
+}
+
+static uint32_t get_bits(bit_reader_t* reader, int count) {
+    if (count == 0) {
+        return 0;
+    }
+    refill(reader);
+    uint32_t value = reader->bits >> (32 - count);
+    reader->bits <<= count;
+    reader->bit_count -= count;
+    return value;
+}
+
+static int decode_symbol(bit_reader_t* reader, const huffman_table_t* table) {
+    refill(reader);
+    int32_t code = 0;
+    for (int size = 1; size <= 16; size++) {
+        code = (code << 1) | (int32_t)(reader->bits >> 31);
+        reader->bits <<= 1;
+        reader->bit_count--;
+        if (code <= table->max_code[size]) {
+            int index = table->value_offset[size] + code;
+            return index >= 0 && index < 256 ? table->values[index] : -1;
+        }
+    }
+    return -1;
+}
+
+static int extend(uint32_t value, int size) {
+    if (size == 0) {
+        return 0;
+    }
+    return value < (1u << (size - 1)) ? (int)value - (1 << size) + 1 : (int)value;
+}
+
+static bool decode_block(jpeg_state_t* state, bit_reader_t* reader, component_t* component,
+                         float coefficients[64]) {
+    const uint16_t* quant = state->quant[component->quant_table];
+    const huffman_table_t* dc = &state->dc_tables[component->dc_table];
+    const huffman_table_t* ac = &state->ac_tables[component->ac_table];
+
+    memset(coefficients, 0, 64 * sizeof(float));
+
+    int size = decode_symbol(reader, dc);
+    if (size < 0 || size > 11) {
+        return fail(state, "Corrupt JPEG data");
+    }
+    component->last_dc += extend(get_bits(reader, size), size);
+    coefficients[0] = (float)(component->last_dc * quant[0]);
+
+    for (int k = 1; k < 64;) {
+        int symbol = decode_symbol(reader, ac);
+        if (symbol < 0) {
+            return fail(state, "Corrupt JPEG data");
+        }
+
+        int run = symbol >> 4;
+        size = symbol & 0x0F;
+        if (size == 0) {
+            if (run != 15) {
+                break;
+            }
+            k += 16;
+            continue;
+        }
+
+        k += run;
+        if (k > 63) {
+            return fail(state, "Corrupt JPEG data");
+        }
+        coefficients[jpeg_sw_zigzag[k]] = (float)(extend(get_bits(reader, size), size) * quant[k]);
+        k++;
+    }
+    return true;
+}
+
+static void inverse_dct(const float coefficients[64], uint8_t* plane, int stride, int width, int height,
+                        int x, int y) {
+    float columns[64];
+
+    for (int u = 0; u < 8; u++) {
+        for (int row = 0; row < 8; row++) {
+            float sum = 0.0f;
+            for (int v = 0; v < 8; v++) {
+                sum += jpeg_sw_dct_matrix[v * 8 + row] * coefficients[v * 8 + u];
+            }
+            columns[row * 8 + u] = sum;
+        }
+    }
+
+    for (int row = 0; row < 8 && y + row < height; row++) {
+        uint8_t* out = plane + (size_t)(y + row) * stride + x;
+        for (int col = 0; col < 8 && x + col < width; col++) {
+            float sum = 128.0f;
+            for (int u = 0; u < 8; u++) {
+                sum += jpeg_sw_dct_matrix[u * 8 + col] * columns[row * 8 + u];
+            }
+            int value = (int)(sum + 0.5f);
+            out[col] = (uint8_t)(value < 0 ? 0 : value > 255 ? 255 : value);
+        }
+    }
+}
+
+static bool prepare_frame(jpeg_state_t* state, yuv420_frame_t* frame) {
+    jpeg_sw_decoder_t* decoder = state->decoder;
+    size_t y_size = (size_t)state->width * state->height;
+    size_t uv_size = (size_t)(state->width / 2) * (state->height / 2);
+    size_t needed = y_size + 2 * uv_size;
+
+    if (needed > decoder->capacity) {
+        uint8_t* buffer = realloc(decoder->buffer, needed);
+        pipeline_stats_add(PIPELINE_COUNTER_ALLOCATIONS, 1);
+        if (!buffer) {
+            return fail(state, "Failed to allocate frame buffer");
+        }
+        decoder->buffer = buffer;
+        decoder->capacity = needed;
+    }
+
+    frame->width = state->width;
+    frame->height = state->height;
+    frame->y_size = (int)y_size;
+    frame->uv_size = (int)uv_size;
+    frame->y_plane = decoder->buffer;
+    frame->u_plane = decoder->buffer + y_size;
+    frame->v_plane = frame->u_plane + uv_size;
+    return true;
+}
+
+static bool decode_scan(jpeg_state_t* state, const uint8_t* header, size_t header_length,
+                        const uint8_t* data, size_t size, size_t* consumed, yuv420_frame_t* frame) {
+    if (!state->have_frame) {
+        return fail(state, "Scan before frame header");
+    }
+    if (header_length < 1 + 3 * 2 + 3 || header[0] != 3) {
+        return fail(state, "Only interleaved three-component scans are supported");
+    }
+
+    for (int i = 0; i < 3; i++) {
+        uint8_t id = header[1 + 2 * i];
+        uint8_t tables = header[2 + 2 * i];
+        if (id != state->components[i].id) {
+            return fail(state, "Scan components out of order");
+        }
+        state->components[i].dc_table = (tables >> 4) & 0x03;
+        state->components[i].ac_table = tables & 0x03;
+        state->components[i].last_dc = 0;
+        if (!state->dc_tables[tables >> 4 & 0x03].defined || !state->ac_tables[tables & 0x03].defined ||
+            !state->quant_defined[state->components[i].quant_table]) {
+            return fail(state, "Missing table");
+        }
+    }
+
+    if (!prepare_frame(state, frame)) {
+        return false;
+    }
+
+    bit_reader_t reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.data = data;
+    reader.size = size;
+
+    int chroma_width = state->width / 2;
+    int chroma_height = state->height / 2;
+    int mcus_per_row = (state->width + 15) / 16;
+    int mcu_rows = (state->height + 15) / 16;
+    int remaining = state->restart_interval;
+    float coefficients[64];
+
+    for (int mcu_y = 0; mcu_y < mcu_rows; mcu_y++) {
+        for (int mcu_x = 0; mcu_x < mcus_per_row; mcu_x++) {
+            if (state->restart_interval && remaining == 0) {
+                reader.bits = 0;
+                reader.bit_count = 0;
+                reader.padded = 0;
+                if (reader.position + 1 < size && data[reader.position] == 0xFF &&
+                    data[reader.position + 1] >= 0xD0 && data[reader.position + 1] <= 0xD7) {
+                    reader.position += 2;
+                }
+                for (int i = 0; i < 3; i++) {
+                    state->components[i].last_dc = 0;
+                }
+                remaining = state->restart_interval;
+            }
+
+            int x = mcu_x * 16;
+            int y = mcu_y * 16;
+            for (int block = 0; block < 4; block++) {
+                if (!decode_block(state, &reader, &state->components[0], coefficients)) {
+                    return false;
+                }
+                inverse_dct(coefficients, frame->y_plane, state->width, state->width, state->height,
+                            x + (block & 1) * 8, y + (block >> 1) * 8);
+            }
+            if (!decode_block(state, &reader, &state->components[1], coefficients)) {
+                return false;
+            }
+            inverse_dct(coefficients, frame->u_plane, chroma_width, chroma_width, chroma_height, x / 2, y / 2);
+            if (!decode_block(state, &reader, &state->components[2], coefficients)) {
+                return false;
+            }
+            inverse_dct(coefficients, frame->v_plane, chroma_width, chroma_width, chroma_height, x / 2, y / 2);
+            if (reader.padded * 8 > reader.bit_count) {
+                return fail(state, "Truncated JPEG data");
+            }
+            remaining--;
+        }
+    }
+
+    *consumed = reader.position;
+    return true;
+}
+
+bool jpeg_sw_decoder_init(jpeg_sw_decoder_t* decoder) {
+    if (!decoder) return false;
+
+    memset(decoder, 0, sizeof(jpeg_sw_decoder_t));
+    return true;
+}
+
+void jpeg_sw_decoder_cleanup(jpeg_sw_decoder_t* decoder) {
+    if (!decoder) return;
+
+    free(decoder->buffer);
+
+    char message[sizeof(decoder->error_message)];
+    memcpy(message, decoder->error_message, sizeof(message));
+    memset(decoder, 0, sizeof(jpeg_sw_decoder_t));
+    memcpy(decoder->error_message, message, sizeof(message));
+}
+
+bool jpeg_sw_decoder_decode(jpeg_sw_decoder_t* decoder,
+                            const uint8_t* jpeg_data,
+                            size_t jpeg_size,
+                            yuv420_frame_t* yuv_frame) {
+    if (!decoder || !jpeg_data || !yuv_frame) {
+        if (decoder) {
+            snprintf(decoder->error_message, sizeof(decoder->error_message),
+                    "Invalid parameters");
+        }
+        return false;
+    }
+
+    jpeg_state_t state;
+    memset(&state, 0, sizeof(state));
+    state.decoder = decoder;
+
+    if (jpeg_size < 4 || jpeg_data[0] != 0xFF || jpeg_data[1] != 0xD8) {
+        return fail(&state, "Missing JPEG start of image");
+    }
+
+    size_t offset = 2;
+    bool decoded = false;
+    while (offset + 4 <= jpeg_size) {
+        if (jpeg_data[offset] != 0xFF) {
+            offset++;
+            continue;
+        }
+
+        uint8_t marker = jpeg_data[offset + 1];
+        if (marker == 0xFF || marker == 0x00 || (marker >= 0xD0 && marker <= 0xD7)) {
+            offset++;
+            continue;
+        }
+        if (marker == 0xD9) {
+            break;
+        }
+
+        size_t length = read_word(&jpeg_data[offset + 2]);
+        if (length < 2 || offset + 2 + length > jpeg_size) {
+            return fail(&state, "Truncated JPEG segment");
+        }
+        const uint8_t* segment = &jpeg_data[offset + 4];
+        size_t segment_length = length - 2;
+        offset += 2 + length;
+
+        bool ok = true;
+        if (marker == 0xDB) {
+            ok = parse_quant(&state, segment, segment_length);
+        } else if (marker == 0xC4) {
+            ok = parse_huffman(&state, segment, segment_length);
+        } else if (marker == 0xC0 || marker == 0xC1) {
+            ok = parse_frame(&state, segment, segment_length);
+        } else if ((marker >= 0xC2 && marker <= 0xCF) && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            ok = fail(&state, "Only baseline Huffman JPEG is supported");
+        } else if (marker == 0xDD) {
+            state.restart_interval = segment_length >= 2 ? read_word(segment) : 0;
+        } else if (marker == 0xDA) {
+            size_t consumed = 0;
+            ok = decode_scan(&state, segment, segment_length, &jpeg_data[offset], jpeg_size - offset,
+                             &consumed, yuv_frame);
+            offset += consumed;
+            decoded = ok;
+        }
+
+        if (!ok) {
+            return false;
+        }
+        if (decoded) {
+            break;
+        }
+    }
+
+    if (!decoded) {
+        return fail(&state, "No image data in JPEG");
+    }
+    return true;
+}
+
+const char* jpeg_sw_decoder_get_error(const jpeg_sw_decoder_t* decoder) {
+    if (!decoder) return "Invalid decoder context";
+    return decoder->error_message;
+}
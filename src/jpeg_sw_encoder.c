@@ -0,0 +1,831 @@
+#define _GNU_SOURCE
+#include "jpeg_sw_encoder.h"
+#include "jpeg_sw_internal.h"
+#include "pipeline_stats.h"
+#include "pipeline_time.h"
+#include "pipeline_kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MCU_BLOCKS 6
+#define MCU_BYTES (MCU_BLOCKS * JPEG_SW_BLOCK_BYTES)
+#define HEADER_BYTES 1024
+
+typedef struct {
+    const uint8_t* bits;
+    const uint8_t* values;
+} huffman_spec_t;
+
+const uint8_t jpeg_sw_zigzag[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10,
+    17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63
+};
+
+static const uint8_t base_luma_quant[64] = {
+    16, 11, 10, 16, 24, 40, 51, 61,
+    12, 12, 14, 19, 26, 58, 60, 55,
+    14, 13, 16, 24, 40, 57, 69, 56,
+    14, 17, 22, 29, 51, 87, 80, 62,
+    18, 22, 37, 56, 68, 109, 103, 77,
+    24, 35, 55, 64, 81, 104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103, 99
+};
+
+static const uint8_t base_chroma_quant[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99,
+    18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99,
+    47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99
+};
+
+const float jpeg_sw_dct_matrix[64] = {
+    0.353553391f, 0.353553391f, 0.353553391f, 0.353553391f, 0.353553391f, 0.353553391f, 0.353553391f, 0.353553391f,
+    0.490392640f, 0.415734806f, 0.277785117f, 0.097545161f, -0.097545161f, -0.277785117f, -0.415734806f, -0.490392640f,
+    0.461939766f, 0.191341716f, -0.191341716f, -0.461939766f, -0.461939766f, -0.191341716f, 0.191341716f, 0.461939766f,
+    0.415734806f, -0.097545161f, -0.490392640f, -0.277785117f, 0.277785117f, 0.490392640f, 0.097545161f, -0.415734806f,
+    0.353553391f, -0.353553391f, -0.353553391f, 0.353553391f, 0.353553391f, -0.353553391f, -0.353553391f, 0.353553391f,
+    0.277785117f, -0.490392640f, 0.097545161f, 0.415734806f, -0.415734806f, -0.097545161f, 0.490392640f, -0.277785117f,
+    0.191341716f, -0.461939766f, 0.461939766f, -0.191341716f, -0.191341716f, 0.461939766f, -0.461939766f, 0.191341716f,
+    0.097545161f, -0.277785117f, 0.415734806f, -0.490392640f, 0.490392640f, -0.415734806f, 0.277785117f, -0.097545161f
+};
+
+static const uint8_t dc_luma_bits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+static const uint8_t dc_chroma_bits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+static const uint8_t dc_values[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+static const uint8_t ac_luma_bits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+static const uint8_t ac_luma_values[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+static const uint8_t ac_chroma_bits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+static const uint8_t ac_chroma_values[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+static void build_huffman(jpeg_sw_huffman_t* table, const uint8_t bits[16], const uint8_t* values) {
+    memset(table, 0, sizeof(jpeg_sw_huffman_t));
+
+    uint16_t code = 0;
+    int k = 0;
+    for (int length = 1; length <= 16; length++) {
+        for (int i = 0; i < bits[length - 1]; i++) {
+            table->code[values[k]] = code++;
+            table->size[values[k]] = (uint8_t)length;
+            k++;
+        }
+        code <<= 1;
+    }
+}
+
+static void scale_quant(uint8_t quant[64], float scale[64], const uint8_t base[64], int quality) {
+    int factor = quality < 50 ? 5000 / quality : 200 - 2 * quality;
+
+    for (int i = 0; i < 64; i++) {
+        int value = (base[i] * factor + 50) / 100;
+        if (value < 1) value = 1;
+        if (value > 255) value = 255;
+        quant[i] = (uint8_t)value;
+        scale[i] = 1.0f / (float)value;
+    }
+}
+
+bool jpeg_sw_encoder_init(jpeg_sw_encoder_t* encoder, int quality) {
+    if (!encoder) return false;
+
+    memset(encoder, 0, sizeof(jpeg_sw_encoder_t));
+
+    build_huffman(&encoder->dc_luma, dc_luma_bits, dc_values);
+    build_huffman(&encoder->ac_luma, ac_luma_bits, ac_luma_values);
+    build_huffman(&encoder->dc_chroma, dc_chroma_bits, dc_values);
+    build_huffman(&encoder->ac_chroma, ac_chroma_bits, ac_chroma_values);
+
+    return jpeg_sw_encoder_set_quality(encoder, quality);
+}
+
+void jpeg_sw_encoder_cleanup(jpeg_sw_encoder_t* encoder) {
+    if (!encoder) return;
+
+    free(encoder->strip);
+
+    char message[sizeof(encoder->error_message)];
+    memcpy(message, encoder->error_message, sizeof(message));
+    memset(encoder, 0, sizeof(jpeg_sw_encoder_t));
+    memcpy(encoder->error_message, message, sizeof(message));
+}
+
+void jpeg_sw_encoder_set_optimize_huffman(jpeg_sw_encoder_t* encoder, bool enabled) {
+    if (!encoder) return;
+
+    encoder->optimize_huffman = enabled;
+}
+
+bool jpeg_sw_encoder_set_quality(jpeg_sw_encoder_t* encoder, int quality) {
+    if (!encoder) return false;
+
+    if (quality < 1 || quality > 100) {
+        snprintf(encoder->error_message, sizeof(encoder->error_message),
+                "Quality must be between 1 and 100");
+        return false;
+    }
+
+    scale_quant(encoder->luma_quant, encoder->luma_scale, base_luma_quant, quality);
+    scale_quant(encoder->chroma_quant, encoder->chroma_scale, base_chroma_quant, quality);
+    encoder->quality = quality;
+    return true;
+}
+
+void jpeg_sw_forward_dct(const uint8_t* pixels, int stride, const float scale[64], int16_t coefficients[64]) {
+    float rows[64];
+    float result[64];
+
+    for (int y = 0; y < 8; y++) {
+        const uint8_t* row = pixels + (size_t)y * stride;
+        float shifted[8];
+        for (int x = 0; x < 8; x++) {
+            shifted[x] = (float)row[x] - 128.0f;
+        }
+        for (int u = 0; u < 8; u++) {
+            const float* basis = &jpeg_sw_dct_matrix[u * 8];
+            float sum = 0.0f;
+            for (int x = 0; x < 8; x++) {
+                sum += basis[x] * shifted[x];
+            }
+            rows[y * 8 + u] = sum;
+        }
+    }
+
+    for (int u = 0; u < 8; u++) {
+        for (int v = 0; v < 8; v++) {
+            const float* basis = &jpeg_sw_dct_matrix[v * 8];
+            float sum = 0.0f;
+            for (int y = 0; y < 8; y++) {
+                sum += basis[y] * rows[y * 8 + u];
+            }
+            result[v * 8 + u] = sum;
+        }
+    }
+
+    int16_t quantized[64];
+    pipeline_kernels()->quantize_block(result, scale, quantized);
+    for (int k = 0; k < 64; k++) {
+        coefficients[k] = quantized[jpeg_sw_zigzag[k]];
+    }
+}
+
+bool jpeg_sw_writer_reserve(jpeg_sw_writer_t* writer, size_t bytes) {
+    if (writer->length + bytes <= writer->capacity) {
+        return true;
+    }
+
+    size_t capacity = writer->capacity * 2;
+    if (capacity < writer->length + bytes) {
+        capacity = writer->length + bytes;
+    }
+
+    uint8_t* grown = realloc(writer->data, capacity);
+    pipeline_stats_add(PIPELINE_COUNTER_ALLOCATIONS, 1);
+    if (!grown) {
+        return false;
+    }
+
+    writer->data = grown;
+    writer->capacity = capacity;
+    return true;
+}
+
+static void put_bits(jpeg_sw_writer_t* writer, uint32_t code, int size) {
+    writer->bits = (writer->bits << size) | code;
+    writer->bit_count += size;
+
+    while (writer->bit_count >= 8) {
+        uint8_t byte = (uint8_t)(writer->bits >> (writer->bit_count - 8));
+        writer->data[writer->length++] = byte;
+        if (byte == 0xFF) {
+            writer->data[writer->length++] = 0x00;
+        }
+        writer->bit_count -= 8;
+    }
+}
+
+static int magnitude_bits(int value) {
+    unsigned magnitude = (unsigned)(value < 0 ? -value : value);
+    return magnitude ? 32 - __builtin_clz(magnitude) : 0;
+}
+
+static void put_value(jpeg_sw_writer_t* writer, int value, int size) {
+    if (value < 0) {
+        value -= 1;
+    }
+    put_bits(writer, (uint32_t)value & ((1u << size) - 1), size);
+}
+
+void jpeg_sw_encode_block(jpeg_sw_writer_t* writer, const int16_t coefficients[64], int* last_dc,
+                          const jpeg_sw_huffman_t* dc, const jpeg_sw_huffman_t* ac) {
+    int diff = coefficients[0] - *last_dc;
+    *last_dc = coefficients[0];
+
+    int size = magnitude_bits(diff);
+    put_bits(writer, dc->code[size], dc->size[size]);
+    if (size) {
+        put_value(writer, diff, size);
+    }
+
+    int run = 0;
+    for (int k = 1; k < 64; k++) {
+        int value = coefficients[k];
+        if (value == 0) {
+            run++;
+            continue;
+        }
+
+        while (run > 15) {
+            put_bits(writer, ac->code[0xF0], ac->size[0xF0]);
+            run -= 16;
+        }
+
+        size = magnitude_bits(value);
+        int symbol = (run << 4) | size;
+        put_bits(writer, ac->code[symbol], ac->size[symbol]);
+        put_value(writer, value, size);
+        run = 0;
+    }
+
+    if (run > 0) {
+        put_bits(writer, ac->code[0x00], ac->size[0x00]);
+    }
+}
+
+void jpeg_sw_count_block(const int16_t coefficients[64], int* last_dc, uint32_t dc_counts[257],
+                         uint32_t ac_counts[257]) {
+    int diff = coefficients[0] - *last_dc;
+    *last_dc = coefficients[0];
+    dc_counts[magnitude_bits(diff)]++;
+
+    int run = 0;
+    for (int k = 1; k < 64; k++) {
+        int value = coefficients[k];
+        if (value == 0) {
+            run++;
+            continue;
+        }
+
+        while (run > 15) {
+            ac_counts[0xF0]++;
+            run -= 16;
+        }
+
+        ac_counts[(run << 4) | magnitude_bits(value)]++;
+        run = 0;
+    }
+
+    if (run > 0) {
+        ac_counts[0x00]++;
+    }
+}
+
+void jpeg_sw_build_optimal_table(const uint32_t counts[257], uint8_t bits[16], uint8_t values[256]) {
+    uint32_t frequency[257];
+    int code_size[257];
+    int others[257];
+    int length_count[33];
+
+    memcpy(frequency, counts, sizeof(frequency));
+    frequency[256] = 1;
+    memset(code_size, 0, sizeof(code_size));
+    memset(length_count, 0, sizeof(length_count));
+    for (int i = 0; i < 257; i++) {
+        others[i] = -1;
+    }
+
+    for (;;) {
+        int c1 = -1;
+        int c2 = -1;
+        for (int i = 0; i < 257; i++) {
+            if (frequency[i] && (c1 < 0 || frequency[i] <= frequency[c1])) {
+                c1 = i;
+            }
+        }
+        for (int i = 0; i < 257; i++) {
+            if (frequency[i] && i != c1 && (c2 < 0 || frequency[i] <= frequency[c2])) {
+                c2 = i;
+            }
+        }
+        if (c2 < 0) {
+            break;
+        }
+
+        frequency[c1] += frequency[c2];
+        frequency[c2] = 0;
+
+        code_size[c1]++;
+        while (others[c1] >= 0) {
+            c1 = others[c1];
+            code_size[c1]++;
+        }
+        others[c1] = c2;
+
+        code_size[c2]++;
+        while (others[c2] >= 0) {
+            c2 = others[c2];
+            code_size[c2]++;
+        }
+    }
+
+    for (int i = 0; i < 257; i++) {
+        if (code_size[i]) {
+            length_count[code_size[i] > 32 ? 32 : code_size[i]]++;
+        }
+    }
+
+    for (int i = 32; i > 16; i--) {
+        while (length_count[i] > 0) {
+            int j = i - 2;
+            while (length_count[j] == 0) {
+                j--;
+            }
+            length_count[i] -= 2;
+            length_count[i - 1]++;
+            length_count[j + 1] += 2;
+            length_count[j]--;
+        }
+    }
+
+    int longest = 16;
+    while (longest > 0 && length_count[longest] == 0) {
+        longest--;
+    }
+    length_count[longest]--;
+
+    for (int i = 0; i < 16; i++) {
+        bits[i] = (uint8_t)length_count[i + 1];
+    }
+
+    int k = 0;
+    for (int length = 1; length <= 32; length++) {
+        for (int symbol = 0; symbol < 256; symbol++) {
+            int size = code_size[symbol] > 32 ? 32 : code_size[symbol];
+            if (size == length) {
+                values[k++] = (uint8_t)symbol;
+            }
+        }
+    }
+}
+
+void jpeg_sw_writer_flush(jpeg_sw_writer_t* writer) {
+    if (writer->bit_count > 0) {
+        int pad = 8 - writer->bit_count;
+        put_bits(writer, (1u << pad) - 1, pad);
+    }
+    writer->bits = 0;
+}
+
+static void put_byte(jpeg_sw_writer_t* writer, uint8_t value) {
+    writer->data[writer->length++] = value;
+}
+
+static void put_word(jpeg_sw_writer_t* writer, uint16_t value) {
+    put_byte(writer, (uint8_t)(value >> 8));
+    put_byte(writer, (uint8_t)(value & 0xFF));
+}
+
+static void put_huffman_table(jpeg_sw_writer_t* writer, uint8_t id, const uint8_t bits[16],
+                              const uint8_t* values) {
+    int count = 0;
+    put_byte(writer, id);
+    for (int i = 0; i < 16; i++) {
+        put_byte(writer, bits[i]);
+        count += bits[i];
+    }
+    for (int i = 0; i < count; i++) {
+        put_byte(writer, values[i]);
+    }
+}
+
+static int huffman_table_length(const uint8_t bits[16]) {
+    int length = 17;
+    for (int i = 0; i < 16; i++) {
+        length += bits[i];
+    }
+    return length;
+}
+
+static void write_headers(jpeg_sw_writer_t* writer, const jpeg_sw_encoder_t* encoder, int width, int height,
+                          const huffman_spec_t specs[4]) {
+    static const uint8_t jfif[14] = {'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0};
+    static const uint8_t table_ids[4] = {0x00, 0x10, 0x01, 0x11};
+
+    put_word(writer, 0xFFD8);
+
+    put_word(writer, 0xFFE0);
+    put_word(writer, 16);
+    for (int i = 0; i < 14; i++) {
+        put_byte(writer, jfif[i]);
+    }
+
+    put_word(writer, 0xFFDB);
+    put_word(writer, 2 + 2 * 65);
+    put_byte(writer, 0);
+    for (int k = 0; k < 64; k++) {
+        put_byte(writer, encoder->luma_quant[jpeg_sw_zigzag[k]]);
+    }
+    put_byte(writer, 1);
+    for (int k = 0; k < 64; k++) {
+        put_byte(writer, encoder->chroma_quant[jpeg_sw_zigzag[k]]);
+    }
+
+    put_word(writer, 0xFFC0);
+    put_word(writer, 17);
+    put_byte(writer, 8);
+    put_word(writer, (uint16_t)height);
+    put_word(writer, (uint16_t)width);
+    put_byte(writer, 3);
+    put_byte(writer, 1);
+    put_byte(writer, 0x22);
+    put_byte(writer, 0);
+    put_byte(writer, 2);
+    put_byte(writer, 0x11);
+    put_byte(writer, 1);
+    put_byte(writer, 3);
+    put_byte(writer, 0x11);
+    put_byte(writer, 1);
+
+    int length = 2;
+    for (int i = 0; i < 4; i++) {
+        length += huffman_table_length(specs[i].bits);
+    }
+    put_word(writer, 0xFFC4);
+    put_word(writer, (uint16_t)length);
+    for (int i = 0; i < 4; i++) {
+        put_huffman_table(writer, table_ids[i], specs[i].bits, specs[i].values);
+    }
+
+    put_word(writer, 0xFFDA);
+    put_word(writer, 12);
+    put_byte(writer, 3);
+    put_byte(writer, 1);
+    put_byte(writer, 0x00);
+    put_byte(writer, 2);
+    put_byte(writer, 0x11);
+    put_byte(writer, 3);
+    put_byte(writer, 0x11);
+    put_byte(writer, 0);
+    put_byte(writer, 63);
+    put_byte(writer, 0);
+}
+
+static const uint8_t* block_pixels(const uint8_t* plane, int stride, int width, int height,
+                                   int x, int y, uint8_t scratch[64], int* block_stride) {
+    if (x + 8 <= width && y + 8 <= height) {
+        *block_stride = stride;
+        return plane + (size_t)y * stride + x;
+    }
+
+    for (int row = 0; row < 8; row++) {
+        int source_y = y + row < height ? y + row : height - 1;
+        const uint8_t* source = plane + (size_t)source_y * stride;
+        for (int col = 0; col < 8; col++) {
+            int source_x = x + col < width ? x + col : width - 1;
+            scratch[row * 8 + col] = source[source_x];
+        }
+    }
+
+    *block_stride = 8;
+    return scratch;
+}
+
+static void transform_block(const uint8_t* plane, int stride, int width, int height,
+                            int x, int y, const float scale[64], int16_t coefficients[64]) {
+    uint8_t scratch[64];
+    int block_stride;
+
+    const uint8_t* pixels = block_pixels(plane, stride, width, height, x, y, scratch, &block_stride);
+    jpeg_sw_forward_dct(pixels, block_stride, scale, coefficients);
+}
+
+typedef struct {
+    const uint8_t* planes[3];
+    int strides[3];
+    int width;
+    int height;
+} mcu_rows_t;
+
+static bool reserve_strip(jpeg_sw_encoder_t* encoder, size_t bytes) {
+    if (bytes <= encoder->strip_capacity) {
+        return true;
+    }
+
+    uint8_t* grown = realloc(encoder->strip, bytes);
+    pipeline_stats_add(PIPELINE_COUNTER_ALLOCATIONS, 1);
+    if (!grown) {
+        return false;
+    }
+
+    encoder->strip = grown;
+    encoder->strip_capacity = bytes;
+    return true;
+}
+
+static bool prepare_strip(jpeg_sw_encoder_t* encoder, const yuv_image_t* image) {
+    int width = image->width;
+    switch (image->format) {
+        case YUV_FORMAT_NV12:
+            return reserve_strip(encoder, (size_t)width * 8);
+        case YUV_FORMAT_YUYV:
+            return reserve_strip(encoder, (size_t)width * 24);
+        default:
+            return true;
+    }
+}
+
+static void load_mcu_rows(const jpeg_sw_encoder_t* encoder, const yuv_image_t* image, int y, mcu_rows_t* rows) {
+    int width = image->width;
+    int chroma_width = width / 2;
+    int luma_rows = image->height - y < 16 ? image->height - y : 16;
+    int chroma_rows = luma_rows / 2;
+
+    rows->width = width;
+    rows->height = luma_rows;
+    rows->planes[0] = image->planes[0] + (size_t)y * image->strides[0];
+    rows->strides[0] = image->strides[0];
+    rows->strides[1] = chroma_width;
+    rows->strides[2] = chroma_width;
+
+    switch (image->format) {
+        case YUV_FORMAT_I420:
+            for (int plane = 1; plane < 3; plane++) {
+                rows->planes[plane] = image->planes[plane] + (size_t)(y / 2) * image->strides[plane];
+                rows->strides[plane] = image->strides[plane];
+            }
+            break;
+        case YUV_FORMAT_NV12: {
+            uint8_t* u = encoder->strip;
+            uint8_t* v = u + (size_t)chroma_width * 8;
+            yuv_deinterleave_chroma(u, chroma_width, v, chroma_width,
+                                    image->planes[1] + (size_t)(y / 2) * image->strides[1], image->strides[1],
+                                    chroma_width, chroma_rows);
+            rows->planes[1] = u;
+            rows->planes[2] = v;
+            break;
+        }
+        case YUV_FORMAT_YUYV: {
+            uint8_t* luma = encoder->strip;
+            uint8_t* u = luma + (size_t)width * 16;
+            uint8_t* v = u + (size_t)chroma_width * 8;
+            yuv_yuyv_to_i420(luma, width, u, chroma_width, v, chroma_width,
+                             rows->planes[0], image->strides[0], width, luma_rows);
+            rows->planes[0] = luma;
+            rows->planes[1] = u;
+            rows->planes[2] = v;
+            rows->strides[0] = width;
+            break;
+        }
+    }
+}
+
+static void transform_mcu(const jpeg_sw_encoder_t* encoder, const mcu_rows_t* rows,
+                          int x, int16_t blocks[MCU_BLOCKS][64]) {
+    int width = rows->width;
+    int height = rows->height;
+
+    for (int block = 0; block < 4; block++) {
+        transform_block(rows->planes[0], rows->strides[0], width, height, x + (block & 1) * 8, (block >> 1) * 8,
+                        encoder->luma_scale, blocks[block]);
+    }
+    transform_block(rows->planes[1], rows->strides[1], width / 2, height / 2, x / 2, 0,
+                    encoder->chroma_scale, blocks[4]);
+    transform_block(rows->planes[2], rows->strides[2], width / 2, height / 2, x / 2, 0,
+                    encoder->chroma_scale, blocks[5]);
+}
+
+static void encode_mcu(jpeg_sw_writer_t* writer, int16_t blocks[MCU_BLOCKS][64], int last_dc[3],
+                       const jpeg_sw_huffman_t* tables[4]) {
+    for (int block = 0; block < MCU_BLOCKS; block++) {
+        int component = block < 4 ? 0 : block - 3;
+        int table = component ? 2 : 0;
+        jpeg_sw_encode_block(writer, blocks[block], &last_dc[component], tables[table], tables[table + 1]);
+    }
+}
+
+static bool encode_scan(jpeg_sw_encoder_t* encoder, const yuv_image_t* image, jpeg_sw_writer_t* writer,
+                        const huffman_spec_t specs[4], const jpeg_sw_huffman_t* tables[4],
+                        int16_t (*stored)[MCU_BLOCKS][64]) {
+    write_headers(writer, encoder, image->width, image->height, specs);
+
+    int last_dc[3] = {0, 0, 0};
+    size_t mcu = 0;
+    int16_t blocks[MCU_BLOCKS][64];
+    mcu_rows_t rows;
+    for (int y = 0; y < image->height; y += 16) {
+        if (!stored) {
+            load_mcu_rows(encoder, image, y, &rows);
+        }
+        for (int x = 0; x < image->width; x += 16) {
+            if (!jpeg_sw_writer_reserve(writer, MCU_BYTES)) {
+                return false;
+            }
+
+            if (stored) {
+                encode_mcu(writer, stored[mcu++], last_dc, tables);
+            } else {
+                transform_mcu(encoder, &rows, x, blocks);
+                encode_mcu(writer, blocks, last_dc, tables);
+            }
+        }
+    }
+
+    if (!jpeg_sw_writer_reserve(writer, 4)) {
+        return false;
+    }
+    jpeg_sw_writer_flush(writer);
+    put_word(writer, 0xFFD9);
+    return true;
+}
+
+static bool encode_optimized(jpeg_sw_encoder_t* encoder, const yuv_image_t* image, jpeg_sw_writer_t* writer) {
+    size_t mcu_count = (size_t)((image->width + 15) / 16) * (size_t)((image->height + 15) / 16);
+    int16_t (*stored)[MCU_BLOCKS][64] = malloc(mcu_count * sizeof(*stored));
+    pipeline_stats_add(PIPELINE_COUNTER_ALLOCATIONS, 1);
+    if (!stored) {
+        return false;
+    }
+
+    uint32_t counts[4][257];
+    memset(counts, 0, sizeof(counts));
+    int last_dc[3] = {0, 0, 0};
+    size_t mcu = 0;
+    mcu_rows_t rows;
+    for (int y = 0; y < image->height; y += 16) {
+        load_mcu_rows(encoder, image, y, &rows);
+        for (int x = 0; x < image->width; x += 16) {
+            transform_mcu(encoder, &rows, x, stored[mcu]);
+            for (int block = 0; block < MCU_BLOCKS; block++) {
+                int component = block < 4 ? 0 : block - 3;
+                int table = component ? 2 : 0;
+                jpeg_sw_count_block(stored[mcu][block], &last_dc[component], counts[table], counts[table + 1]);
+            }
+            mcu++;
+        }
+    }
+
+    uint8_t bits[4][16];
+    uint8_t values[4][256];
+    jpeg_sw_huffman_t optimal[4];
+    huffman_spec_t specs[4];
+    const jpeg_sw_huffman_t* tables[4];
+    for (int i = 0; i < 4; i++) {
+        jpeg_sw_build_optimal_table(counts[i], bits[i], values[i]);
+        build_huffman(&optimal[i], bits[i], values[i]);
+        specs[i].bits = bits[i];
+        specs[i].values = values[i];
+        tables[i] = &optimal[i];
+    }
+
+    bool result = encode_scan(encoder, image, writer, specs, tables, stored);
+    free(stored);
+    return result;
+}
+
+bool jpeg_sw_encoder_encode(jpeg_sw_encoder_t* encoder,
+                            const yuv420_frame_t* yuv_frame,
+                            uint8_t** jpeg_data,
+                            size_t* jpeg_size) {
+    if (!encoder || !yuv_frame || !jpeg_data || !jpeg_size) {
+        if (encoder) {
+            snprintf(encoder->error_message, sizeof(encoder->error_message),
+                    "Invalid parameters");
+        }
+        return false;
+    }
+
+    if (!yuv_frame->y_plane || !yuv_frame->u_plane || !yuv_frame->v_plane) {
+        snprintf(encoder->error_message, sizeof(encoder->error_message),
+                "Invalid YUV frame data");
+        return false;
+    }
+
+    yuv_image_t image;
+    yuv_image_from_frame(&image, yuv_frame);
+    return jpeg_sw_encoder_encode_image(encoder, &image, jpeg_data, jpeg_size);
+}
+
+bool jpeg_sw_encoder_encode_image(jpeg_sw_encoder_t* encoder,
+                                  const yuv_image_t* image,
+                                  uint8_t** jpeg_data,
+                                  size_t* jpeg_size) {
+    if (!encoder || !image || !jpeg_data || !jpeg_size) {
+        if (encoder) {
+            snprintf(encoder->error_message, sizeof(encoder->error_message),
+                    "Invalid parameters");
+        }
+        return false;
+    }
+
+    int width = image->width;
+    int height = image->height;
+    if (width < 2 || height < 2 || width > 65535 || height > 65535) {
+        snprintf(encoder->error_message, sizeof(encoder->error_message),
+                "Invalid frame dimensions: %dx%d", width, height);
+        return false;
+    }
+
+    if (!yuv_image_validate(image)) {
+        snprintf(encoder->error_message, sizeof(encoder->error_message),
+                "Invalid YUV image layout");
+        return false;
+    }
+
+    if (encoder->quality == 0) {
+        snprintf(encoder->error_message, sizeof(encoder->error_message),
+                "Encoder not initialized");
+        return false;
+    }
+
+    if (!prepare_strip(encoder, image)) {
+        snprintf(encoder->error_message, sizeof(encoder->error_message),
+                "Failed to allocate conversion buffer");
+        return false;
+    }
+
+    uint64_t start_us = pipeline_time_now_us();
+
+    jpeg_sw_writer_t writer;
+    memset(&writer, 0, sizeof(writer));
+    if (!jpeg_sw_writer_reserve(&writer, HEADER_BYTES + (size_t)width * height / 4)) {
+        snprintf(encoder->error_message, sizeof(encoder->error_message),
+                "Failed to allocate JPEG output buffer");
+        return false;
+    }
+
+    bool encoded;
+    if (encoder->optimize_huffman) {
+        encoded = encode_optimized(encoder, image, &writer);
+    } else {
+        static const huffman_spec_t standard[4] = {
+            {dc_luma_bits, dc_values},
+            {ac_luma_bits, ac_luma_values},
+            {dc_chroma_bits, dc_values},
+            {ac_chroma_bits, ac_chroma_values}
+        };
+        const jpeg_sw_huffman_t* tables[4] = {
+            &encoder->dc_luma, &encoder->ac_luma, &encoder->dc_chroma, &encoder->ac_chroma
+        };
+        encoded = encode_scan(encoder, image, &writer, standard, tables, NULL);
+    }
+
+    if (!encoded) {
+        free(writer.data);
+        snprintf(encoder->error_message, sizeof(encoder->error_message),
+                "Failed to grow JPEG output buffer");
+        return false;
+    }
+
+    *jpeg_data = writer.data;
+    *jpeg_size = writer.length;
+
+    pipeline_stats_record(PIPELINE_METRIC_ENCODE, pipeline_time_now_us() - start_us);
+    return true;
+}
+
+void jpeg_sw_encoder_free(uint8_t* jpeg_data) {
+    if (jpeg_data) {
+        free(jpeg_data);
+    }
+}
+
+const char* jpeg_sw_encoder_get_error(const jpeg_sw_encoder_t* encoder) {
+    if (!encoder) return "Invalid encoder context";
+    return encoder->error_message;
+}
@@ -0,0 +1,28 @@
+#ifndef JPEG_SW_INTERNAL_H
+#define JPEG_SW_INTERNAL_H
+
+#include "jpeg_sw_encoder.h"
+
+#define JPEG_SW_BLOCK_BYTES 512
+
+extern const uint8_t jpeg_sw_zigzag[64];
+extern const float jpeg_sw_dct_matrix[64];
+
+typedef struct {
+    uint8_t* data;
+    size_t length;
+    size_t capacity;
+    uint32_t bits;
+    int bit_count;
+} jpeg_sw_writer_t;
+
+void jpeg_sw_forward_dct(const uint8_t* pixels, int stride, const float scale[64], int16_t coefficients[64]);
+bool jpeg_sw_writer_reserve(jpeg_sw_writer_t* writer, size_t bytes);
+void jpeg_sw_encode_block(jpeg_sw_writer_t* writer, const int16_t coefficients[64], int* last_dc,
+                          const jpeg_sw_huffman_t* dc, const jpeg_sw_huffman_t* ac);
+void jpeg_sw_count_block(const int16_t coefficients[64], int* last_dc, uint32_t dc_counts[257],
+                         uint32_t ac_counts[257]);
+void jpeg_sw_build_optimal_table(const uint32_t counts[257], uint8_t bits[16], uint8_t values[256]);
+void jpeg_sw_writer_flush(jpeg_sw_writer_t* writer);
+
+#endif // JPEG_SW_INTERNAL_H
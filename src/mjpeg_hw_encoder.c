@@ -1,4 +1,7 @@
 #include "mjpeg_hw_encoder.h"
+#include "pipeline_stats.h"
+#include "pipeline_probes.h"
+#include "yuv_convert.h"
 #include "h264_hw_decoder.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,36 +13,216 @@
 static void output_callback(MMAL_PORT_T* port, MMAL_BUFFER_HEADER_T* buffer) {
     mjpeg_hw_encoder_t* encoder = (mjpeg_hw_encoder_t*)port->userdata;
     
-    if (encoder && buffer->length > 0) {
-        encoder->current_buffer = buffer;
-        encoder->frame_ready = true;
-        vcos_semaphore_post(&encoder->output_semaphore);
+    if (!encoder || buffer->cmd != 0) {
+        mmal_buffer_header_release(buffer);
+        return;
     }
     
-    mmal_buffer_header_release(buffer);
+    mmal_queue_put(encoder->output_queue, buffer);
+    vcos_semaphore_post(&encoder->output_semaphore);
 }
 
 static void input_callback(MMAL_PORT_T* port, MMAL_BUFFER_HEADER_T* buffer) {
     mmal_buffer_header_release(buffer);
 }
 
-static bool convert_yuv420_to_mmal(const yuv420_frame_t* yuv, MMAL_BUFFER_HEADER_T* buffer) {
-    if (!yuv || !buffer || !buffer->data) {
+static bool send_output_buffers(mjpeg_hw_encoder_t* encoder) {
+    MMAL_BUFFER_HEADER_T* buffer;
+    
+    while ((buffer = mmal_queue_get(encoder->output_pool->queue)) != NULL) {
+        MMAL_STATUS_T status = mmal_port_send_buffer(encoder->output_port, buffer);
+        if (status != MMAL_SUCCESS) {
+            mmal_buffer_header_release(buffer);
+            snprintf(encoder->error_message, sizeof(encoder->error_message), 
+                    "Failed to send output buffer: %s", mmal_status_to_string(status));
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+static void drain_output(mjpeg_hw_encoder_t* encoder) {
+    MMAL_BUFFER_HEADER_T* buffer;
+    
+    while ((buffer = mmal_queue_get(encoder->output_queue)) != NULL) {
+        mmal_buffer_header_release(buffer);
+    }
+    
+    while (vcos_semaphore_trywait(&encoder->output_semaphore) == VCOS_SUCCESS) {
+    }
+    
+    encoder->current_buffer = NULL;
+}
+
+static uint32_t input_encoding_for(yuv_format_t format) {
+    switch (format) {
+        case YUV_FORMAT_NV12: return MMAL_ENCODING_NV12;
+        case YUV_FORMAT_YUYV: return MMAL_ENCODING_YUYV;
+        default: return MMAL_ENCODING_I420;
+    }
+}
+
+static bool configure_input(mjpeg_hw_encoder_t* encoder, int width, int height, uint32_t encoding) {
+    if (encoder->input_pool && encoder->input_width == width && encoder->input_height == height &&
+        encoder->input_encoding == encoding) {
+        return true;
+    }
+    
+    if (encoder->input_port->is_enabled) {
+        mmal_port_disable(encoder->input_port);
+    }
+    
+    if (encoder->input_pool) {
+        mmal_port_pool_destroy(encoder->input_port, encoder->input_pool);
+        encoder->input_pool = NULL;
+    }
+    
+    MMAL_ES_FORMAT_T* format = encoder->input_port->format;
+    format->encoding = encoding;
+    format->es->video.width = VCOS_ALIGN_UP(width, 32);
+    format->es->video.height = VCOS_ALIGN_UP(height, 16);
+    format->es->video.crop.x = 0;
+    format->es->video.crop.y = 0;
+    format->es->video.crop.width = width;
+    format->es->video.crop.height = height;
+    
+    MMAL_STATUS_T status = mmal_port_format_commit(encoder->input_port);
+    if (status != MMAL_SUCCESS) {
+        snprintf(encoder->error_message, sizeof(encoder->error_message), 
+                "Failed to commit input format: %s", mmal_status_to_string(status));
         return false;
     }
     
-    int width = yuv->width;
-    int height = yuv->height;
-    int y_size = width * height;
-    int uv_size = y_size / 4;
+    encoder->input_port->buffer_num = encoder->input_port->buffer_num_recommended;
+    encoder->input_port->buffer_size = encoder->input_port->buffer_size_recommended;
     
-    memcpy(buffer->data, yuv->y_plane, y_size);
+    encoder->input_pool = mmal_port_pool_create(encoder->input_port,
+                                                encoder->input_port->buffer_num,
+                                                encoder->input_port->buffer_size);
+    if (!encoder->input_pool) {
+        snprintf(encoder->error_message, sizeof(encoder->error_message), 
+                "Failed to create input pool");
+        return false;
+    }
     
-    for (int i = 0; i < uv_size; i++) {
-        buffer->data[y_size + i * 2] = yuv->u_plane[i];
-        buffer->data[y_size + i * 2 + 1] = yuv->v_plane[i];
+    status = mmal_port_enable(encoder->input_port, input_callback);
+    if (status != MMAL_SUCCESS) {
+        snprintf(encoder->error_message, sizeof(encoder->error_message), 
+                "Failed to enable input port: %s", mmal_status_to_string(status));
+        return false;
     }
     
+    encoder->input_width = width;
+    encoder->input_height = height;
+    encoder->input_encoding = encoding;
+    
+    return true;
+}
+
+static MMAL_BUFFER_HEADER_T* wait_for_output(mjpeg_hw_encoder_t* encoder, uint64_t deadline_us) {
+    for (;;) {
+        uint64_t now_us = vcos_getmicrosecs64();
+        if (now_us >= deadline_us) {
+            pipeline_stats_add(PIPELINE_COUNTER_TIMEOUTS, 1);
+            PIPELINE_PROBE2(encode_timeout, encoder->frame_id, deadline_us);
+            snprintf(encoder->error_message, sizeof(encoder->error_message), 
+                    "Timeout waiting for encoded frame");
+            return NULL;
+        }
+    
+        VCOS_STATUS_T wait_status = vcos_semaphore_wait_timeout(&encoder->output_semaphore,
+                                                                (VCOS_UNSIGNED)((deadline_us - now_us + 999) / 1000));
+    
+        if (__atomic_load_n(&encoder->cancel_requested, __ATOMIC_ACQUIRE)) {
+            snprintf(encoder->error_message, sizeof(encoder->error_message), 
+                    "Encode cancelled");
+            return NULL;
+        }
+    
+        if (wait_status != VCOS_SUCCESS) {
+            continue;
+        }
+    
+        MMAL_BUFFER_HEADER_T* buffer = mmal_queue_get(encoder->output_queue);
+        if (buffer) {
+            return buffer;
+        }
+    }
+}
+
+static MMAL_BUFFER_HEADER_T* wait_for_input(mjpeg_hw_encoder_t* encoder, uint64_t deadline_us) {
+    uint64_t now_us = vcos_getmicrosecs64();
+    MMAL_BUFFER_HEADER_T* buffer = NULL;
+    
+    if (now_us < deadline_us) {
+        buffer = mmal_queue_timedwait(encoder->input_pool->queue,
+                                      (VCOS_UNSIGNED)((deadline_us - now_us + 999) / 1000));
+    }
+    
+    if (!buffer) {
+        pipeline_stats_add(PIPELINE_COUNTER_TIMEOUTS, 1);
+        snprintf(encoder->error_message, sizeof(encoder->error_message), 
+                "Timeout waiting for input buffer");
+    }
+    
+    return buffer;
+}
+
+static bool copy_image_to_mmal(const mjpeg_hw_encoder_t* encoder,
+                               const yuv_image_t* image,
+                               MMAL_BUFFER_HEADER_T* buffer) {
+    if (!image || !buffer || !buffer->data) {
+        return false;
+    }
+    
+    int width = image->width;
+    int height = image->height;
+    int aligned_width = encoder->input_port->format->es->video.width;
+    int slice_height = encoder->input_port->format->es->video.height;
+    size_t length;
+    
+    switch (image->format) {
+        case YUV_FORMAT_NV12:
+            length = (size_t)aligned_width * slice_height * 3 / 2;
+            break;
+        case YUV_FORMAT_YUYV:
+            length = (size_t)aligned_width * 2 * slice_height;
+            break;
+        default:
+            length = (size_t)aligned_width * slice_height * 3 / 2;
+            break;
+    }
+    
+    if (length > buffer->alloc_size) {
+        return false;
+    }
+    
+    uint64_t copy_start_us = vcos_getmicrosecs64();
+    uint8_t* luma = buffer->data;
+    uint8_t* chroma = luma + (size_t)aligned_width * slice_height;
+    
+    switch (image->format) {
+        case YUV_FORMAT_NV12:
+            yuv_copy_plane(luma, aligned_width, image->planes[0], image->strides[0], width, height);
+            yuv_copy_plane(chroma, aligned_width, image->planes[1], image->strides[1], width, height / 2);
+            break;
+        case YUV_FORMAT_YUYV:
+            yuv_copy_plane(luma, aligned_width * 2, image->planes[0], image->strides[0], width * 2, height);
+            break;
+        default: {
+            int chroma_stride = aligned_width / 2;
+            uint8_t* v_dst = chroma + (size_t)chroma_stride * (slice_height / 2);
+            yuv_copy_plane(luma, aligned_width, image->planes[0], image->strides[0], width, height);
+            yuv_copy_plane(chroma, chroma_stride, image->planes[1], image->strides[1], width / 2, height / 2);
+            yuv_copy_plane(v_dst, chroma_stride, image->planes[2], image->strides[2], width / 2, height / 2);
+            break;
+        }
+    }
+    
+    buffer->length = length;
+    pipeline_stats_record(PIPELINE_METRIC_COPY, vcos_getmicrosecs64() - copy_start_us);
+    
     return true;
 }
 #endif
@@ -50,6 +233,7 @@ bool mjpeg_hw_encoder_init(mjpeg_hw_encoder_t* encoder, int quality) {
     
     memset(encoder, 0, sizeof(mjpeg_hw_encoder_t));
     encoder->hw_available = false;
+    encoder->timeout_ms = MJPEG_HW_ENCODER_DEFAULT_TIMEOUT_MS;
     
     if (quality < 1 || quality > 100) {
         snprintf(encoder->error_message, sizeof(encoder->error_message), 
@@ -69,6 +253,13 @@ bool mjpeg_hw_encoder_init(mjpeg_hw_encoder_t* encoder, int quality) {
         return false;
     }
     
+    encoder->output_queue = mmal_queue_create();
+    if (!encoder->output_queue) {
+        snprintf(encoder->error_message, sizeof(encoder->error_message), 
+                "Failed to create output queue");
+        return false;
+    }
+    
     MMAL_STATUS_T status = mmal_component_create(MMAL_COMPONENT_DEFAULT_IMAGE_ENCODER, &encoder->encoder);
     if (status != MMAL_SUCCESS) {
         snprintf(encoder->error_message, sizeof(encoder->error_message), 
@@ -91,13 +282,6 @@ bool mjpeg_hw_encoder_init(mjpeg_hw_encoder_t* encoder, int quality) {
     output_format->es->video.width = 0;
     output_format->es->video.height = 0;
     
-    status = mmal_port_format_commit(encoder->input_port);
-    if (status != MMAL_SUCCESS) {
-        snprintf(encoder->error_message, sizeof(encoder->error_message), 
-                "Failed to commit input format: %s", mmal_status_to_string(status));
-        return false;
-    }
-    
     status = mmal_port_format_commit(encoder->output_port);
     if (status != MMAL_SUCCESS) {
         snprintf(encoder->error_message, sizeof(encoder->error_message), 
@@ -105,36 +289,39 @@ bool mjpeg_hw_encoder_init(mjpeg_hw_encoder_t* encoder, int quality) {
         return false;
     }
     
-    encoder->output_port->userdata = (struct MMAL_PORT_USERDATA_T*)encoder;
-    status = mmal_port_enable(encoder->output_port, output_callback);
+    status = mmal_port_parameter_set_uint32(encoder->output_port, MMAL_PARAMETER_JPEG_Q_FACTOR,
+                                            (uint32_t)quality);
     if (status != MMAL_SUCCESS) {
         snprintf(encoder->error_message, sizeof(encoder->error_message), 
-                "Failed to enable output port: %s", mmal_status_to_string(status));
+                "Failed to set JPEG quality: %s", mmal_status_to_string(status));
         return false;
     }
     
-    encoder->input_port->userdata = (struct MMAL_PORT_USERDATA_T*)encoder;
-    status = mmal_port_enable(encoder->input_port, input_callback);
-    if (status != MMAL_SUCCESS) {
-        snprintf(encoder->error_message, sizeof(encoder->error_message), 
-                "Failed to enable input port: %s", mmal_status_to_string(status));
-        return false;
+    encoder->output_port->buffer_num = encoder->output_port->buffer_num_recommended;
+    encoder->output_port->buffer_size = encoder->output_port->buffer_size_recommended;
+    if (encoder->output_port->buffer_size < MJPEG_HW_ENCODER_OUTPUT_BUFFER_SIZE) {
+        encoder->output_port->buffer_size = MJPEG_HW_ENCODER_OUTPUT_BUFFER_SIZE;
     }
     
-    encoder->input_pool = mmal_port_pool_create(encoder->input_port, 1, 0);
-    if (!encoder->input_pool) {
+    encoder->output_pool = mmal_port_pool_create(encoder->output_port,
+                                                 encoder->output_port->buffer_num,
+                                                 encoder->output_port->buffer_size);
+    if (!encoder->output_pool) {
         snprintf(encoder->error_message, sizeof(encoder->error_message), 
-                "Failed to create input pool");
+                "Failed to create output pool");
         return false;
     }
     
-    encoder->output_pool = mmal_port_pool_create(encoder->output_port, 1, 0);
-    if (!encoder->output_pool) {
+    encoder->output_port->userdata = (struct MMAL_PORT_USERDATA_T*)encoder;
+    status = mmal_port_enable(encoder->output_port, output_callback);
+    if (status != MMAL_SUCCESS) {
         snprintf(encoder->error_message, sizeof(encoder->error_message), 
-                "Failed to create output pool");
+                "Failed to enable output port: %s", mmal_status_to_string(status));
         return false;
     }
     
+    encoder->input_port->userdata = (struct MMAL_PORT_USERDATA_T*)encoder;
+    
     status = mmal_component_enable(encoder->encoder);
     if (status != MMAL_SUCCESS) {
         snprintf(encoder->error_message, sizeof(encoder->error_message), 
@@ -144,6 +331,10 @@ bool mjpeg_hw_encoder_init(mjpeg_hw_encoder_t* encoder, int quality) {
     
     encoder->component_ready = true;
     encoder->hw_available = true;
+    
+    if (!send_output_buffers(encoder)) {
+        return false;
+    }
 #else
     encoder->hw_available = false;
     snprintf(encoder->error_message, sizeof(encoder->error_message), 
@@ -163,17 +354,20 @@ void mjpeg_hw_encoder_cleanup(mjpeg_hw_encoder_t* encoder) {
     
 #ifdef RASPBERRY_PI
 #ifndef NO_HARDWARE
-    if (encoder->hw_available && encoder->component_ready) {
-        if (encoder->input_port) {
-            mmal_port_disable(encoder->input_port);
-        }
-        if (encoder->output_port) {
-            mmal_port_disable(encoder->output_port);
-        }
+    if (encoder->input_port && encoder->input_port->is_enabled) {
+        mmal_port_disable(encoder->input_port);
+    }
+    if (encoder->output_port && encoder->output_port->is_enabled) {
+        mmal_port_disable(encoder->output_port);
+    }
         
-        if (encoder->encoder) {
-            mmal_component_disable(encoder->encoder);
-        }
+    if (encoder->encoder && encoder->component_ready) {
+        mmal_component_disable(encoder->encoder);
+    }
+    
+    if (encoder->output_queue) {
+        drain_output(encoder);
+        mmal_queue_destroy(encoder->output_queue);
     }
     
     if (encoder->input_pool) {
@@ -194,24 +388,112 @@ void mjpeg_hw_encoder_cleanup(mjpeg_hw_encoder_t* encoder) {
     memset(encoder, 0, sizeof(mjpeg_hw_encoder_t));
 }
 
-bool mjpeg_hw_encoder_encode(mjpeg_hw_encoder_t* encoder,
-                            const yuv420_frame_t* yuv_frame,
-                            uint8_t** jpeg_data,
-                            size_t* jpeg_size) {
-    if (!encoder || !yuv_frame || !jpeg_data || !jpeg_size) {
-        if (encoder) {
+bool mjpeg_hw_encoder_set_quality(mjpeg_hw_encoder_t* encoder, int quality) {
+    if (!encoder) return false;
+    
+    if (quality < 1 || quality > 100) {
+        snprintf(encoder->error_message, sizeof(encoder->error_message), 
+                "Invalid quality value: %d (must be 1-100)", quality);
+        return false;
+    }
+
+#ifdef RASPBERRY_PI
+#ifndef NO_HARDWARE
+    if (encoder->hw_available && encoder->quality != quality) {
+        MMAL_STATUS_T status = mmal_port_parameter_set_uint32(encoder->output_port, MMAL_PARAMETER_JPEG_Q_FACTOR,
+                                                              (uint32_t)quality);
+        if (status != MMAL_SUCCESS) {
             snprintf(encoder->error_message, sizeof(encoder->error_message), 
-                    "Invalid parameters");
+                    "Failed to set JPEG quality: %s", mmal_status_to_string(status));
+            return false;
         }
-        return false;
     }
+#endif
+#endif
     
-    if (!yuv_frame->y_plane || !yuv_frame->u_plane || !yuv_frame->v_plane) {
+    encoder->quality = quality;
+    return true;
+}
+
+bool mjpeg_hw_encoder_set_orientation(mjpeg_hw_encoder_t* encoder, yuv_rotation_t rotation, yuv_flip_t flip) {
+    if (!encoder) return false;
+    
+    if (!yuv_orientation_valid(rotation, flip)) {
         snprintf(encoder->error_message, sizeof(encoder->error_message), 
-                "Invalid YUV frame data");
+                "Invalid orientation: rotation %d, flip %d", (int)rotation, (int)flip);
         return false;
     }
     
+    if (encoder->rotation == rotation && encoder->flip == flip) {
+        return true;
+    }
+
+#ifdef RASPBERRY_PI
+#ifndef NO_HARDWARE
+    if (encoder->hw_available) {
+        MMAL_STATUS_T status = MMAL_SUCCESS;
+        if (encoder->rotation != rotation) {
+            status = mmal_port_parameter_set_int32(encoder->output_port, MMAL_PARAMETER_ROTATION, (int32_t)rotation);
+            if (status == MMAL_SUCCESS) {
+                encoder->rotation = rotation;
+            }
+        }
+    
+        if (status == MMAL_SUCCESS && encoder->flip != flip) {
+            static const MMAL_PARAM_MIRROR_T mirrors[] = {
+                MMAL_PARAM_MIRROR_NONE, MMAL_PARAM_MIRROR_HORIZONTAL,
+                MMAL_PARAM_MIRROR_VERTICAL, MMAL_PARAM_MIRROR_BOTH
+            };
+            MMAL_PARAMETER_MIRROR_T mirror = {{MMAL_PARAMETER_MIRROR, sizeof(mirror)}, mirrors[flip]};
+            status = mmal_port_parameter_set(encoder->output_port, &mirror.hdr);
+            if (status == MMAL_SUCCESS) {
+                encoder->flip = flip;
+            }
+        }
+    
+        if (status != MMAL_SUCCESS) {
+            snprintf(encoder->error_message, sizeof(encoder->error_message), 
+                    "Failed to set JPEG orientation: %s", mmal_status_to_string(status));
+            return false;
+        }
+        return true;
+    }
+#endif
+#endif
+    
+    snprintf(encoder->error_message, sizeof(encoder->error_message), 
+            "Hardware encoder cannot rotate on this system");
+    return false;
+}
+
+void mjpeg_hw_encoder_set_timeout(mjpeg_hw_encoder_t* encoder, int timeout_ms) {
+    if (!encoder) return;
+    
+    encoder->timeout_ms = timeout_ms > 0 ? timeout_ms : MJPEG_HW_ENCODER_DEFAULT_TIMEOUT_MS;
+}
+
+void mjpeg_hw_encoder_set_frame_id(mjpeg_hw_encoder_t* encoder, uint32_t frame_id) {
+    if (!encoder) return;
+    
+    encoder->frame_id = frame_id;
+}
+
+bool mjpeg_hw_encoder_encode(mjpeg_hw_encoder_t* encoder,
+                            const yuv420_frame_t* yuv_frame,
+                            uint8_t** jpeg_data,
+                            size_t* jpeg_size) {
+    return mjpeg_hw_encoder_encode_timeout(encoder, yuv_frame, jpeg_data, jpeg_size, 0);
+}
+
+static bool encode_image(mjpeg_hw_encoder_t* encoder,
+                         const yuv_image_t* image,
+                         uint8_t** jpeg_data,
+                         size_t* jpeg_size,
+                         int timeout_ms) {
+    if (timeout_ms <= 0) {
+        timeout_ms = encoder->timeout_ms;
+    }
+
 #ifdef RASPBERRY_PI
 #ifndef NO_HARDWARE
     if (!encoder->component_ready) {
@@ -220,23 +502,40 @@ bool mjpeg_hw_encoder_encode(mjpeg_hw_encoder_t* encoder,
         return false;
     }
     
+    uint64_t start_us = vcos_getmicrosecs64();
+    uint64_t deadline_us = start_us + (uint64_t)timeout_ms * 1000;
+    
+    if (encoder->needs_recovery && !mjpeg_hw_encoder_recover(encoder)) {
+        return false;
+    }
+    
+    __atomic_store_n(&encoder->cancel_requested, 0, __ATOMIC_RELEASE);
     encoder->frame_ready = false;
     
-    MMAL_BUFFER_HEADER_T* buffer = mmal_queue_get(encoder->input_pool->queue);
+    drain_output(encoder);
+    if (!send_output_buffers(encoder)) {
+        encoder->needs_recovery = true;
+        return false;
+    }
+    
+    if (!configure_input(encoder, image->width, image->height, input_encoding_for(image->format))) {
+        encoder->needs_recovery = true;
+        return false;
+    }
+    
+    MMAL_BUFFER_HEADER_T* buffer = wait_for_input(encoder, deadline_us);
     if (!buffer) {
-        snprintf(encoder->error_message, sizeof(encoder->error_message), 
-                "No input buffer available");
+        encoder->needs_recovery = true;
         return false;
     }
     
-    if (!convert_yuv420_to_mmal(yuv_frame, buffer)) {
+    if (!copy_image_to_mmal(encoder, image, buffer)) {
         mmal_buffer_header_release(buffer);
         snprintf(encoder->error_message, sizeof(encoder->error_message), 
-                "Failed to convert YUV420 to MMAL format");
+                "Failed to copy YUV image to MMAL buffer");
         return false;
     }
     
-    buffer->length = yuv_frame->y_size + 2 * yuv_frame->uv_size;
     buffer->offset = 0;
     buffer->flags = MMAL_BUFFER_HEADER_FLAG_FRAME_END;
     
@@ -248,34 +547,186 @@ bool mjpeg_hw_encoder_encode(mjpeg_hw_encoder_t* encoder,
         return false;
     }
     
-    if (vcos_semaphore_wait_timeout(&encoder->output_semaphore, 1000) != VCOS_SUCCESS) {
+    PIPELINE_PROBE3(encode_submit, encoder->frame_id, buffer->length, vcos_getmicrosecs64());
+    
+    uint8_t* output = NULL;
+    size_t output_size = 0;
+    bool frame_end = false;
+    
+    while (!frame_end) {
+        encoder->current_buffer = wait_for_output(encoder, deadline_us);
+        if (!encoder->current_buffer) {
+            encoder->needs_recovery = true;
+            free(output);
+            return false;
+        }
+    
+        MMAL_BUFFER_HEADER_T* out = encoder->current_buffer;
+        frame_end = (out->flags & (MMAL_BUFFER_HEADER_FLAG_FRAME_END | MMAL_BUFFER_HEADER_FLAG_EOS)) != 0;
+    
+        if (out->length > 0) {
+            uint8_t* grown = realloc(output, output_size + out->length);
+            pipeline_stats_add(PIPELINE_COUNTER_ALLOCATIONS, 1);
+            PIPELINE_PROBE2(alloc, "jpeg_output", output_size + out->length);
+            if (!grown) {
+                mmal_buffer_header_release(out);
+                encoder->current_buffer = NULL;
+                encoder->needs_recovery = true;
+                free(output);
+                snprintf(encoder->error_message, sizeof(encoder->error_message), 
+                        "Failed to allocate memory for JPEG data");
+                return false;
+            }
+    
+            memcpy(grown + output_size, out->data + out->offset, out->length);
+            output = grown;
+            output_size += out->length;
+        }
+    
+        mmal_buffer_header_release(out);
+        encoder->current_buffer = NULL;
+        send_output_buffers(encoder);
+    }
+    
+    if (output_size == 0) {
+        free(output);
         snprintf(encoder->error_message, sizeof(encoder->error_message), 
-                "Timeout waiting for encoded frame");
+                "No frame encoded");
         return false;
     }
     
-    if (!encoder->frame_ready || !encoder->current_buffer) {
+    *jpeg_data = output;
+    *jpeg_size = output_size;
+    encoder->frame_ready = true;
+    pipeline_stats_record(PIPELINE_METRIC_ENCODE, vcos_getmicrosecs64() - start_us);
+    PIPELINE_PROBE3(encode_done, encoder->frame_id, output_size, vcos_getmicrosecs64());
+    
+    return true;
+#else
+    (void)image;
+    (void)jpeg_data;
+    (void)jpeg_size;
+    snprintf(encoder->error_message, sizeof(encoder->error_message), 
+            "Hardware encoder not available on this system");
+    return false;
+#endif
+#else
+    (void)image;
+    (void)jpeg_data;
+    (void)jpeg_size;
+    snprintf(encoder->error_message, sizeof(encoder->error_message), 
+            "Hardware encoder not available on this system");
+    return false;
+#endif
+}
+
+bool mjpeg_hw_encoder_encode_timeout(mjpeg_hw_encoder_t* encoder,
+                                    const yuv420_frame_t* yuv_frame,
+                                    uint8_t** jpeg_data,
+                                    size_t* jpeg_size,
+                                    int timeout_ms) {
+    if (!encoder || !yuv_frame || !jpeg_data || !jpeg_size) {
+        if (encoder) {
+            snprintf(encoder->error_message, sizeof(encoder->error_message), 
+                    "Invalid parameters");
+        }
+        return false;
+    }
+    
+    if (!yuv_frame->y_plane || !yuv_frame->u_plane || !yuv_frame->v_plane) {
         snprintf(encoder->error_message, sizeof(encoder->error_message), 
-                "No frame encoded");
+                "Invalid YUV frame data");
         return false;
     }
     
-    *jpeg_size = encoder->current_buffer->length;
-    *jpeg_data = malloc(*jpeg_size);
-    if (!*jpeg_data) {
+    yuv_image_t image;
+    yuv_image_from_frame(&image, yuv_frame);
+    return encode_image(encoder, &image, jpeg_data, jpeg_size, timeout_ms);
+}
+
+bool mjpeg_hw_encoder_encode_image(mjpeg_hw_encoder_t* encoder,
+                                   const yuv_image_t* image,
+                                   uint8_t** jpeg_data,
+                                   size_t* jpeg_size) {
+    if (!encoder || !image || !jpeg_data || !jpeg_size) {
+        if (encoder) {
+            snprintf(encoder->error_message, sizeof(encoder->error_message), 
+                    "Invalid parameters");
+        }
+        return false;
+    }
+    
+    if (!yuv_image_validate(image)) {
         snprintf(encoder->error_message, sizeof(encoder->error_message), 
-                "Failed to allocate memory for JPEG data");
+                "Invalid YUV image layout");
         return false;
     }
     
-    memcpy(*jpeg_data, encoder->current_buffer->data, *jpeg_size);
+    return encode_image(encoder, image, jpeg_data, jpeg_size, 0);
+}
+
+void mjpeg_hw_encoder_cancel(mjpeg_hw_encoder_t* encoder) {
+    if (!encoder) return;
     
+    __atomic_store_n(&encoder->cancel_requested, 1, __ATOMIC_RELEASE);
+
+#ifdef RASPBERRY_PI
+#ifndef NO_HARDWARE
+    if (encoder->component_ready) {
+        vcos_semaphore_post(&encoder->output_semaphore);
+    }
+#endif
+#endif
+}
+
+bool mjpeg_hw_encoder_recover(mjpeg_hw_encoder_t* encoder) {
+    if (!encoder) return false;
+
+#ifdef RASPBERRY_PI
+#ifndef NO_HARDWARE
+    if (!encoder->component_ready) {
+        snprintf(encoder->error_message, sizeof(encoder->error_message), 
+                "Hardware encoder not ready");
+        return false;
+    }
+    
+    MMAL_STATUS_T status = MMAL_SUCCESS;
+    if (encoder->input_port->is_enabled) {
+        status = mmal_port_flush(encoder->input_port);
+    }
+    if (status == MMAL_SUCCESS) {
+        status = mmal_port_flush(encoder->output_port);
+    }
+    
+    if (status != MMAL_SUCCESS) {
+        mmal_component_disable(encoder->encoder);
+        status = mmal_component_enable(encoder->encoder);
+        if (status != MMAL_SUCCESS) {
+            snprintf(encoder->error_message, sizeof(encoder->error_message), 
+                    "Failed to reset encoder: %s", mmal_status_to_string(status));
+            return false;
+        }
+    }
+    
+    drain_output(encoder);
+    __atomic_store_n(&encoder->cancel_requested, 0, __ATOMIC_RELEASE);
+    encoder->frame_ready = false;
+    
+    if (!send_output_buffers(encoder)) {
+        return false;
+    }
+    
+    encoder->needs_recovery = false;
     return true;
 #else
     snprintf(encoder->error_message, sizeof(encoder->error_message), 
             "Hardware encoder not available on this system");
     return false;
 #endif
+#else
+    snprintf(encoder->error_message, sizeof(encoder->error_message), 
+            "Hardware encoder not available on this system");
+    return false;
 #endif
 }
 
@@ -0,0 +1,176 @@
+#include "pipeline_cpu.h"
+#include "pipeline_kernels.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__arm__) || defined(__aarch64__)
+#include <sys/auxv.h>
+#endif
+
+#define ARM_HWCAP_NEON (1UL << 12)
+#define AARCH64_HWCAP_ASIMD (1UL << 1)
+
+static const char* level_names[PIPELINE_CPU_LEVEL_COUNT] = {
+    "scalar", "armv6", "neon", "sse2", "avx2"
+};
+
+static const pipeline_kernels_t scalar_kernels = {
+    pipeline_scalar_interleave_row,
+    pipeline_scalar_deinterleave_row,
+    pipeline_scalar_quantize_block,
+    pipeline_scalar_find_start_code,
+    pipeline_scalar_yuyv_to_i420_rows,
+    pipeline_scalar_filter_rows,
+    pipeline_scalar_transpose_8x8,
+    pipeline_scalar_reverse_row
+};
+
+#ifdef PIPELINE_KERNELS_ARMV6
+static const pipeline_kernels_t armv6_kernels = {
+    pipeline_armv6_interleave_row,
+    pipeline_armv6_deinterleave_row,
+    pipeline_scalar_quantize_block,
+    pipeline_armv6_find_start_code,
+    pipeline_armv6_yuyv_to_i420_rows,
+    pipeline_scalar_filter_rows,
+    pipeline_scalar_transpose_8x8,
+    pipeline_scalar_reverse_row
+};
+#endif
+
+#ifdef PIPELINE_KERNELS_NEON
+static const pipeline_kernels_t neon_kernels = {
+    pipeline_neon_interleave_row,
+    pipeline_neon_deinterleave_row,
+    pipeline_neon_quantize_block,
+    pipeline_neon_find_start_code,
+    pipeline_neon_yuyv_to_i420_rows,
+    pipeline_neon_filter_rows,
+    pipeline_neon_transpose_8x8,
+    pipeline_neon_reverse_row
+};
+#endif
+
+#ifdef PIPELINE_KERNELS_X86
+static const pipeline_kernels_t sse2_kernels = {
+    pipeline_sse2_interleave_row,
+    pipeline_sse2_deinterleave_row,
+    pipeline_sse2_quantize_block,
+    pipeline_sse2_find_start_code,
+    pipeline_sse2_yuyv_to_i420_rows,
+    pipeline_sse2_filter_rows,
+    pipeline_sse2_transpose_8x8,
+    pipeline_sse2_reverse_row
+};
+
+static const pipeline_kernels_t avx2_kernels = {
+    pipeline_avx2_interleave_row,
+    pipeline_avx2_deinterleave_row,
+    pipeline_avx2_quantize_block,
+    pipeline_avx2_find_start_code,
+    pipeline_avx2_yuyv_to_i420_rows,
+    pipeline_avx2_filter_rows,
+    pipeline_sse2_transpose_8x8,
+    pipeline_avx2_reverse_row
+};
+#endif
+
+static const pipeline_kernels_t* active_kernels;
+static int active_level = -1;
+
+static const pipeline_kernels_t* kernels_for(pipeline_cpu_level_t level) {
+    switch (level) {
+#ifdef PIPELINE_KERNELS_ARMV6
+        case PIPELINE_CPU_ARMV6: return &armv6_kernels;
+#endif
+#ifdef PIPELINE_KERNELS_NEON
+        case PIPELINE_CPU_NEON: return &neon_kernels;
+#endif
+#ifdef PIPELINE_KERNELS_X86
+        case PIPELINE_CPU_SSE2: return &sse2_kernels;
+        case PIPELINE_CPU_AVX2: return &avx2_kernels;
+#endif
+        case PIPELINE_CPU_SCALAR: return &scalar_kernels;
+        default: return NULL;
+    }
+}
+
+pipeline_cpu_level_t pipeline_cpu_detect(void) {
+#if defined(PIPELINE_KERNELS_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return PIPELINE_CPU_AVX2;
+    if (__builtin_cpu_supports("sse2")) return PIPELINE_CPU_SSE2;
+#elif defined(__aarch64__)
+    if (getauxval(AT_HWCAP) & AARCH64_HWCAP_ASIMD) return PIPELINE_CPU_NEON;
+#elif defined(__arm__)
+#ifdef PIPELINE_KERNELS_NEON
+    if (getauxval(AT_HWCAP) & ARM_HWCAP_NEON) return PIPELINE_CPU_NEON;
+#endif
+#ifdef PIPELINE_KERNELS_ARMV6
+    return PIPELINE_CPU_ARMV6;
+#endif
+#endif
+    return PIPELINE_CPU_SCALAR;
+}
+
+bool pipeline_cpu_supported(pipeline_cpu_level_t level) {
+    if (level == PIPELINE_CPU_SCALAR) return true;
+    if (!kernels_for(level)) return false;
+
+    pipeline_cpu_level_t detected = pipeline_cpu_detect();
+    if (level == PIPELINE_CPU_ARMV6) {
+        return detected == PIPELINE_CPU_ARMV6 || detected == PIPELINE_CPU_NEON;
+    }
+    return level <= detected;
+}
+
+static void activate(pipeline_cpu_level_t level) {
+    __atomic_store_n(&active_level, (int)level, __ATOMIC_RELAXED);
+    __atomic_store_n(&active_kernels, kernels_for(level), __ATOMIC_RELEASE);
+}
+
+static const pipeline_kernels_t* resolve(void) {
+    pipeline_cpu_level_t level = pipeline_cpu_detect();
+    pipeline_cpu_level_t requested;
+    const char* override = getenv(PIPELINE_CPU_ENV);
+    if (override && pipeline_cpu_parse_level(override, &requested) && pipeline_cpu_supported(requested)) {
+        level = requested;
+    }
+    activate(level);
+    return kernels_for(level);
+}
+
+const pipeline_kernels_t* pipeline_kernels(void) {
+    const pipeline_kernels_t* kernels = __atomic_load_n(&active_kernels, __ATOMIC_ACQUIRE);
+    return kernels ? kernels : resolve();
+}
+
+pipeline_cpu_level_t pipeline_cpu_get_level(void) {
+    pipeline_kernels();
+    return (pipeline_cpu_level_t)__atomic_load_n(&active_level, __ATOMIC_RELAXED);
+}
+
+bool pipeline_cpu_set_level(pipeline_cpu_level_t level) {
+    if ((unsigned)level >= PIPELINE_CPU_LEVEL_COUNT || !pipeline_cpu_supported(level)) {
+        return false;
+    }
+    activate(level);
+    return true;
+}
+
+const char* pipeline_cpu_level_name(pipeline_cpu_level_t level) {
+    if ((unsigned)level >= PIPELINE_CPU_LEVEL_COUNT) return "unknown";
+    return level_names[level];
+}
+
+bool pipeline_cpu_parse_level(const char* name, pipeline_cpu_level_t* level) {
+    if (!name || !level) return false;
+
+    for (int i = 0; i < PIPELINE_CPU_LEVEL_COUNT; i++) {
+        if (strcmp(name, level_names[i]) == 0) {
+            *level = (pipeline_cpu_level_t)i;
+            return true;
+        }
+    }
+    return false;
+}
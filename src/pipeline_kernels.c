@@ -0,0 +1,87 @@
+#include "pipeline_kernels.h"
+
+void pipeline_scalar_interleave_row(uint8_t* uv, const uint8_t* u, const uint8_t* v, int width) {
+    for (int x = 0; x < width; x++) {
+        uv[2 * x] = u[x];
+        uv[2 * x + 1] = v[x];
+    }
+}
+
+void pipeline_scalar_deinterleave_row(uint8_t* u, uint8_t* v, const uint8_t* uv, int width) {
+    for (int x = 0; x < width; x++) {
+        u[x] = uv[2 * x];
+        v[x] = uv[2 * x + 1];
+    }
+}
+
+void pipeline_scalar_quantize_block(const float values[64], const float scale[64], int16_t coefficients[64]) {
+    for (int i = 0; i < 64; i++) {
+        float value = values[i] * scale[i];
+        int quantized = (int)(value + (value >= 0.0f ? 0.5f : -0.5f));
+        if (quantized > 1023) quantized = 1023;
+        if (quantized < -1023) quantized = -1023;
+        coefficients[i] = (int16_t)quantized;
+    }
+}
+
+size_t pipeline_scalar_find_start_code(const uint8_t* data, size_t size, size_t from) {
+    size_t i = from;
+
+    while (i + 2 < size) {
+        if (data[i + 2] > 1) {
+            i += 3;
+        } else if (data[i + 1] != 0) {
+            i += 2;
+        } else if (data[i] != 0 || data[i + 2] != 1) {
+            i++;
+        } else {
+            return i;
+        }
+    }
+
+    return size;
+}
+
+void pipeline_scalar_yuyv_to_i420_rows(uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                                       const uint8_t* src0, const uint8_t* src1, int width) {
+    for (int x = 0; x + 1 < width; x += 2) {
+        const uint8_t* top = src0 + 2 * x;
+        const uint8_t* bottom = src1 + 2 * x;
+        y0[x] = top[0];
+        y0[x + 1] = top[2];
+        y1[x] = bottom[0];
+        y1[x + 1] = bottom[2];
+        u[x / 2] = (uint8_t)((top[1] + bottom[1] + 1) >> 1);
+        v[x / 2] = (uint8_t)((top[3] + bottom[3] + 1) >> 1);
+    }
+}
+
+void pipeline_scalar_filter_columns(uint8_t* dst, const uint8_t* const* rows, const int16_t* weights,
+                                    int count, int from, int to) {
+    for (int x = from; x < to; x++) {
+        int32_t sum = 1 << (PIPELINE_FILTER_BITS - 1);
+        for (int k = 0; k < count; k++) {
+            sum += weights[k] * rows[k][x];
+        }
+        dst[x] = (uint8_t)(sum >> PIPELINE_FILTER_BITS);
+    }
+}
+
+void pipeline_scalar_filter_rows(uint8_t* dst, const uint8_t* const* rows, const int16_t* weights,
+                                 int count, int width) {
+    pipeline_scalar_filter_columns(dst, rows, weights, count, 0, width);
+}
+
+void pipeline_scalar_transpose_8x8(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride) {
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            dst[x * dst_stride + y] = src[y * src_stride + x];
+        }
+    }
+}
+
+void pipeline_scalar_reverse_row(uint8_t* dst, const uint8_t* src, int width) {
+    for (int x = 0; x < width; x++) {
+        dst[x] = src[width - 1 - x];
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef PIPELINE_KERNELS_H
+#define PIPELINE_KERNELS_H
+
+#include "pipeline_cpu.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PIPELINE_KERNELS_X86
+#endif
+#if defined(__arm__) && defined(__ARM_FEATURE_SIMD32)
+#define PIPELINE_KERNELS_ARMV6
+#endif
+#if defined(__aarch64__) || (defined(__arm__) && !defined(__SOFTFP__))
+#define PIPELINE_KERNELS_NEON
+#endif
+
+#define PIPELINE_FILTER_BITS 14
+
+typedef struct {
+    void (*interleave_row)(uint8_t* uv, const uint8_t* u, const uint8_t* v, int width);
+    void (*deinterleave_row)(uint8_t* u, uint8_t* v, const uint8_t* uv, int width);
+    void (*quantize_block)(const float values[64], const float scale[64], int16_t coefficients[64]);
+    size_t (*find_start_code)(const uint8_t* data, size_t size, size_t from);
+    void (*yuyv_to_i420_rows)(uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                              const uint8_t* src0, const uint8_t* src1, int width);
+    void (*filter_rows)(uint8_t* dst, const uint8_t* const* rows, const int16_t* weights, int count, int width);
+    void (*transpose_8x8)(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride);
+    void (*reverse_row)(uint8_t* dst, const uint8_t* src, int width);
+} pipeline_kernels_t;
+
+const pipeline_kernels_t* pipeline_kernels(void);
+
+void pipeline_scalar_interleave_row(uint8_t* uv, const uint8_t* u, const uint8_t* v, int width);
+void pipeline_scalar_deinterleave_row(uint8_t* u, uint8_t* v, const uint8_t* uv, int width);
+void pipeline_scalar_quantize_block(const float values[64], const float scale[64], int16_t coefficients[64]);
+size_t pipeline_scalar_find_start_code(const uint8_t* data, size_t size, size_t from);
+void pipeline_scalar_yuyv_to_i420_rows(uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                                       const uint8_t* src0, const uint8_t* src1, int width);
+void pipeline_scalar_filter_rows(uint8_t* dst, const uint8_t* const* rows, const int16_t* weights,
+                                 int count, int width);
+void pipeline_scalar_filter_columns(uint8_t* dst, const uint8_t* const* rows, const int16_t* weights,
+                                    int count, int from, int to);
+void pipeline_scalar_transpose_8x8(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride);
+void pipeline_scalar_reverse_row(uint8_t* dst, const uint8_t* src, int width);
+
+#ifdef PIPELINE_KERNELS_ARMV6
+void pipeline_armv6_interleave_row(uint8_t* uv, const uint8_t* u, const uint8_t* v, int width);
+void pipeline_armv6_deinterleave_row(uint8_t* u, uint8_t* v, const uint8_t* uv, int width);
+size_t pipeline_armv6_find_start_code(const uint8_t* data, size_t size, size_t from);
+void pipeline_armv6_yuyv_to_i420_rows(uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                                      const uint8_t* src0, const uint8_t* src1, int width);
+#endif
+
+#ifdef PIPELINE_KERNELS_NEON
+void pipeline_neon_interleave_row(uint8_t* uv, const uint8_t* u, const uint8_t* v, int width);
+void pipeline_neon_deinterleave_row(uint8_t* u, uint8_t* v, const uint8_t* uv, int width);
+void pipeline_neon_quantize_block(const float values[64], const float scale[64], int16_t coefficients[64]);
+size_t pipeline_neon_find_start_code(const uint8_t* data, size_t size, size_t from);
+void pipeline_neon_yuyv_to_i420_rows(uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                                     const uint8_t* src0, const uint8_t* src1, int width);
+void pipeline_neon_filter_rows(uint8_t* dst, const uint8_t* const* rows, const int16_t* weights,
+                               int count, int width);
+void pipeline_neon_transpose_8x8(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride);
+void pipeline_neon_reverse_row(uint8_t* dst, const uint8_t* src, int width);
+#endif
+
+#ifdef PIPELINE_KERNELS_X86
+void pipeline_sse2_interleave_row(uint8_t* uv, const uint8_t* u, const uint8_t* v, int width);
+void pipeline_sse2_deinterleave_row(uint8_t* u, uint8_t* v, const uint8_t* uv, int width);
+void pipeline_sse2_quantize_block(const float values[64], const float scale[64], int16_t coefficients[64]);
+size_t pipeline_sse2_find_start_code(const uint8_t* data, size_t size, size_t from);
+void pipeline_sse2_yuyv_to_i420_rows(uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                                     const uint8_t* src0, const uint8_t* src1, int width);
+void pipeline_sse2_filter_rows(uint8_t* dst, const uint8_t* const* rows, const int16_t* weights,
+                               int count, int width);
+void pipeline_sse2_transpose_8x8(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride);
+void pipeline_sse2_reverse_row(uint8_t* dst, const uint8_t* src, int width);
+void pipeline_avx2_interleave_row(uint8_t* uv, const uint8_t* u, const uint8_t* v, int width);
+void pipeline_avx2_deinterleave_row(uint8_t* u, uint8_t* v, const uint8_t* uv, int width);
+void pipeline_avx2_quantize_block(const float values[64], const float scale[64], int16_t coefficients[64]);
+size_t pipeline_avx2_find_start_code(const uint8_t* data, size_t size, size_t from);
+void pipeline_avx2_yuyv_to_i420_rows(uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                                     const uint8_t* src0, const uint8_t* src1, int width);
+void pipeline_avx2_filter_rows(uint8_t* dst, const uint8_t* const* rows, const int16_t* weights,
+                               int count, int width);
+void pipeline_avx2_reverse_row(uint8_t* dst, const uint8_t* src, int width);
+#endif
+
+#endif // PIPELINE_KERNELS_H
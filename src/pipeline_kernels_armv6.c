@@ -0,0 +1,94 @@
+#include "pipeline_kernels.h"
+
+#ifdef PIPELINE_KERNELS_ARMV6
+
+#include <string.h>
+
+static uint32_t load_word(const uint8_t* data) {
+    uint32_t word;
+    memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+static void store_word(uint8_t* data, uint32_t word) {
+    memcpy(data, &word, sizeof(word));
+}
+
+void pipeline_armv6_interleave_row(uint8_t* uv, const uint8_t* u, const uint8_t* v, int width) {
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        uint32_t u_word = load_word(u + x);
+        uint32_t v_word = load_word(v + x);
+        uint32_t even = (u_word & 0x00FF00FF) | ((v_word & 0x00FF00FF) << 8);
+        uint32_t odd = ((u_word >> 8) & 0x00FF00FF) | (v_word & 0xFF00FF00);
+        store_word(uv + 2 * x, (even & 0xFFFF) | (odd << 16));
+        store_word(uv + 2 * x + 4, (odd & 0xFFFF0000) | (even >> 16));
+    }
+    pipeline_scalar_interleave_row(uv + 2 * x, u + x, v + x, width - x);
+}
+
+static uint32_t pack_low_bytes(uint32_t first, uint32_t second) {
+    first &= 0x00FF00FF;
+    second &= 0x00FF00FF;
+    first = (first | (first >> 8)) & 0xFFFF;
+    second = (second | (second >> 8)) & 0xFFFF;
+    return first | (second << 16);
+}
+
+void pipeline_armv6_deinterleave_row(uint8_t* u, uint8_t* v, const uint8_t* uv, int width) {
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        uint32_t first = load_word(uv + 2 * x);
+        uint32_t second = load_word(uv + 2 * x + 4);
+        store_word(u + x, pack_low_bytes(first, second));
+        store_word(v + x, pack_low_bytes(first >> 8, second >> 8));
+    }
+    pipeline_scalar_deinterleave_row(u + x, v + x, uv + 2 * x, width - x);
+}
+
+size_t pipeline_armv6_find_start_code(const uint8_t* data, size_t size, size_t from) {
+    size_t i = from;
+    while (i + 6 <= size) {
+        uint32_t word = load_word(data + i);
+        if (((word - 0x01010101) & ~word & 0x80808080) == 0) {
+            i += 4;
+            continue;
+        }
+        for (size_t end = i + 4; i < end; i++) {
+            if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+                return i;
+            }
+        }
+    }
+    return pipeline_scalar_find_start_code(data, size, i);
+}
+
+static uint32_t average_bytes(uint32_t a, uint32_t b) {
+    return (a | b) - (((a ^ b) >> 1) & 0x7F7F7F7F);
+}
+
+void pipeline_armv6_yuyv_to_i420_rows(uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                                      const uint8_t* src0, const uint8_t* src1, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        uint32_t top[4], bottom[4];
+        for (int i = 0; i < 4; i++) {
+            top[i] = load_word(src0 + 2 * x + 4 * i);
+            bottom[i] = load_word(src1 + 2 * x + 4 * i);
+        }
+        store_word(y0 + x, pack_low_bytes(top[0], top[1]));
+        store_word(y0 + x + 4, pack_low_bytes(top[2], top[3]));
+        store_word(y1 + x, pack_low_bytes(bottom[0], bottom[1]));
+        store_word(y1 + x + 4, pack_low_bytes(bottom[2], bottom[3]));
+
+        uint32_t first = average_bytes(pack_low_bytes(top[0] >> 8, top[1] >> 8),
+                                       pack_low_bytes(bottom[0] >> 8, bottom[1] >> 8));
+        uint32_t second = average_bytes(pack_low_bytes(top[2] >> 8, top[3] >> 8),
+                                        pack_low_bytes(bottom[2] >> 8, bottom[3] >> 8));
+        store_word(u + x / 2, pack_low_bytes(first, second));
+        store_word(v + x / 2, pack_low_bytes(first >> 8, second >> 8));
+    }
+    pipeline_scalar_yuyv_to_i420_rows(y0 + x, y1 + x, u + x / 2, v + x / 2, src0 + 2 * x, src1 + 2 * x, width - x);
+}
+
+#endif
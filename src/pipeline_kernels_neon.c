@@ -0,0 +1,144 @@
+#include "pipeline_kernels.h"
+
+#ifdef PIPELINE_KERNELS_NEON
+
+#if defined(__arm__) && !defined(__ARM_NEON)
+#pragma GCC target("arch=armv7-a", "fpu=neon")
+#endif
+#include <arm_neon.h>
+
+void pipeline_neon_interleave_row(uint8_t* uv, const uint8_t* u, const uint8_t* v, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x2_t pair;
+        pair.val[0] = vld1q_u8(u + x);
+        pair.val[1] = vld1q_u8(v + x);
+        vst2q_u8(uv + 2 * x, pair);
+    }
+    pipeline_scalar_interleave_row(uv + 2 * x, u + x, v + x, width - x);
+}
+
+void pipeline_neon_deinterleave_row(uint8_t* u, uint8_t* v, const uint8_t* uv, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x2_t pair = vld2q_u8(uv + 2 * x);
+        vst1q_u8(u + x, pair.val[0]);
+        vst1q_u8(v + x, pair.val[1]);
+    }
+    pipeline_scalar_deinterleave_row(u + x, v + x, uv + 2 * x, width - x);
+}
+
+static int16x4_t quantize4(const float* values, const float* scale) {
+    float32x4_t value = vmulq_f32(vld1q_f32(values), vld1q_f32(scale));
+    uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(value), vdupq_n_u32(0x80000000));
+    float32x4_t half = vreinterpretq_f32_u32(vorrq_u32(sign, vreinterpretq_u32_f32(vdupq_n_f32(0.5f))));
+    return vqmovn_s32(vcvtq_s32_f32(vaddq_f32(value, half)));
+}
+
+void pipeline_neon_quantize_block(const float values[64], const float scale[64], int16_t coefficients[64]) {
+    const int16x8_t limit = vdupq_n_s16(1023);
+    const int16x8_t negative_limit = vdupq_n_s16(-1023);
+    for (int i = 0; i < 64; i += 8) {
+        int16x8_t packed = vcombine_s16(quantize4(values + i, scale + i), quantize4(values + i + 4, scale + i + 4));
+        vst1q_s16(coefficients + i, vmaxq_s16(vminq_s16(packed, limit), negative_limit));
+    }
+}
+
+static bool any_set(uint8x16_t mask) {
+#ifdef __aarch64__
+    return vmaxvq_u8(mask) != 0;
+#else
+    uint8x8_t folded = vorr_u8(vget_low_u8(mask), vget_high_u8(mask));
+    return vget_lane_u32(vreinterpret_u32_u8(vpmax_u8(folded, folded)), 0) != 0;
+#endif
+}
+
+size_t pipeline_neon_find_start_code(const uint8_t* data, size_t size, size_t from) {
+    size_t i = from;
+    while (i + 18 <= size) {
+        uint8x16_t first = vceqq_u8(vld1q_u8(data + i), vdupq_n_u8(0));
+        uint8x16_t second = vceqq_u8(vld1q_u8(data + i + 1), vdupq_n_u8(0));
+        if (any_set(vandq_u8(first, second))) {
+            for (size_t end = i + 16; i < end; i++) {
+                if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+                    return i;
+                }
+            }
+        } else {
+            i += 16;
+        }
+    }
+    return pipeline_scalar_find_start_code(data, size, i);
+}
+
+void pipeline_neon_yuyv_to_i420_rows(uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                                     const uint8_t* src0, const uint8_t* src1, int width) {
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        uint8x16x4_t top = vld4q_u8(src0 + 2 * x);
+        uint8x16x4_t bottom = vld4q_u8(src1 + 2 * x);
+        uint8x16x2_t luma;
+        luma.val[0] = top.val[0];
+        luma.val[1] = top.val[2];
+        vst2q_u8(y0 + x, luma);
+        luma.val[0] = bottom.val[0];
+        luma.val[1] = bottom.val[2];
+        vst2q_u8(y1 + x, luma);
+        vst1q_u8(u + x / 2, vrhaddq_u8(top.val[1], bottom.val[1]));
+        vst1q_u8(v + x / 2, vrhaddq_u8(top.val[3], bottom.val[3]));
+    }
+    pipeline_scalar_yuyv_to_i420_rows(y0 + x, y1 + x, u + x / 2, v + x / 2, src0 + 2 * x, src1 + 2 * x, width - x);
+}
+
+void pipeline_neon_filter_rows(uint8_t* dst, const uint8_t* const* rows, const int16_t* weights,
+                               int count, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        int32x4_t low = vdupq_n_s32(0);
+        int32x4_t high = vdupq_n_s32(0);
+        for (int k = 0; k < count; k++) {
+            int16x8_t pixels = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(rows[k] + x)));
+            low = vmlal_n_s16(low, vget_low_s16(pixels), weights[k]);
+            high = vmlal_n_s16(high, vget_high_s16(pixels), weights[k]);
+        }
+        int16x8_t packed = vcombine_s16(vrshrn_n_s32(low, PIPELINE_FILTER_BITS),
+                                        vrshrn_n_s32(high, PIPELINE_FILTER_BITS));
+        vst1_u8(dst + x, vqmovun_s16(packed));
+    }
+    pipeline_scalar_filter_columns(dst, rows, weights, count, x, width);
+}
+
+void pipeline_neon_transpose_8x8(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride) {
+    uint8x8_t rows[8];
+    for (int i = 0; i < 8; i++) {
+        rows[i] = vld1_u8(src + i * src_stride);
+    }
+    uint8x8x2_t bytes[4];
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = vtrn_u8(rows[2 * i], rows[2 * i + 1]);
+    }
+    uint16x4x2_t halves[4];
+    for (int i = 0; i < 2; i++) {
+        halves[2 * i] = vtrn_u16(vreinterpret_u16_u8(bytes[2 * i].val[0]), vreinterpret_u16_u8(bytes[2 * i + 1].val[0]));
+        halves[2 * i + 1] = vtrn_u16(vreinterpret_u16_u8(bytes[2 * i].val[1]), vreinterpret_u16_u8(bytes[2 * i + 1].val[1]));
+    }
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 2; j++) {
+            uint32x2x2_t words = vtrn_u32(vreinterpret_u32_u16(halves[i].val[j]),
+                                          vreinterpret_u32_u16(halves[2 + i].val[j]));
+            vst1_u8(dst + (2 * j + i) * dst_stride, vreinterpret_u8_u32(words.val[0]));
+            vst1_u8(dst + (2 * j + i + 4) * dst_stride, vreinterpret_u8_u32(words.val[1]));
+        }
+    }
+}
+
+void pipeline_neon_reverse_row(uint8_t* dst, const uint8_t* src, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t bytes = vrev64q_u8(vld1q_u8(src + width - 16 - x));
+        vst1q_u8(dst + x, vcombine_u8(vget_high_u8(bytes), vget_low_u8(bytes)));
+    }
+    pipeline_scalar_reverse_row(dst + x, src, width - x);
+}
+
+#endif
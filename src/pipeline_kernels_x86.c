@@ -0,0 +1,301 @@
+#include "pipeline_kernels.h"
+
+#ifdef PIPELINE_KERNELS_X86
+
+#include <immintrin.h>
+
+#define SSE2 __attribute__((target("sse2")))
+#define AVX2 __attribute__((target("avx2")))
+
+SSE2 void pipeline_sse2_interleave_row(uint8_t* uv, const uint8_t* u, const uint8_t* v, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i u_bytes = _mm_loadu_si128((const __m128i*)(u + x));
+        __m128i v_bytes = _mm_loadu_si128((const __m128i*)(v + x));
+        _mm_storeu_si128((__m128i*)(uv + 2 * x), _mm_unpacklo_epi8(u_bytes, v_bytes));
+        _mm_storeu_si128((__m128i*)(uv + 2 * x + 16), _mm_unpackhi_epi8(u_bytes, v_bytes));
+    }
+    pipeline_scalar_interleave_row(uv + 2 * x, u + x, v + x, width - x);
+}
+
+SSE2 void pipeline_sse2_deinterleave_row(uint8_t* u, uint8_t* v, const uint8_t* uv, int width) {
+    const __m128i low_bytes = _mm_set1_epi16(0x00FF);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i first = _mm_loadu_si128((const __m128i*)(uv + 2 * x));
+        __m128i second = _mm_loadu_si128((const __m128i*)(uv + 2 * x + 16));
+        _mm_storeu_si128((__m128i*)(u + x),
+                         _mm_packus_epi16(_mm_and_si128(first, low_bytes), _mm_and_si128(second, low_bytes)));
+        _mm_storeu_si128((__m128i*)(v + x),
+                         _mm_packus_epi16(_mm_srli_epi16(first, 8), _mm_srli_epi16(second, 8)));
+    }
+    pipeline_scalar_deinterleave_row(u + x, v + x, uv + 2 * x, width - x);
+}
+
+SSE2 static __m128i sse2_quantize4(const float* values, const float* scale) {
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 value = _mm_mul_ps(_mm_loadu_ps(values), _mm_loadu_ps(scale));
+    __m128 half = _mm_or_ps(_mm_and_ps(value, sign), _mm_set1_ps(0.5f));
+    return _mm_cvttps_epi32(_mm_add_ps(value, half));
+}
+
+SSE2 void pipeline_sse2_quantize_block(const float values[64], const float scale[64], int16_t coefficients[64]) {
+    const __m128i limit = _mm_set1_epi16(1023);
+    const __m128i negative_limit = _mm_set1_epi16(-1023);
+    for (int i = 0; i < 64; i += 8) {
+        __m128i packed = _mm_packs_epi32(sse2_quantize4(values + i, scale + i),
+                                         sse2_quantize4(values + i + 4, scale + i + 4));
+        packed = _mm_max_epi16(_mm_min_epi16(packed, limit), negative_limit);
+        _mm_storeu_si128((__m128i*)(coefficients + i), packed);
+    }
+}
+
+static size_t check_candidates(const uint8_t* data, size_t base, uint32_t mask) {
+    while (mask) {
+        int bit = __builtin_ctz(mask);
+        if (data[base + (size_t)bit + 2] == 1) {
+            return base + (size_t)bit;
+        }
+        mask &= mask - 1;
+    }
+    return SIZE_MAX;
+}
+
+SSE2 size_t pipeline_sse2_find_start_code(const uint8_t* data, size_t size, size_t from) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = from;
+    while (i + 18 <= size) {
+        __m128i first = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i)), zero);
+        __m128i second = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i + 1)), zero);
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(first, second));
+        if (mask) {
+            size_t found = check_candidates(data, i, mask);
+            if (found != SIZE_MAX) {
+                return found;
+            }
+        }
+        i += 16;
+    }
+    return pipeline_scalar_find_start_code(data, size, i);
+}
+
+SSE2 void pipeline_sse2_yuyv_to_i420_rows(uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                                          const uint8_t* src0, const uint8_t* src1, int width) {
+    const __m128i low_bytes = _mm_set1_epi16(0x00FF);
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i top_first = _mm_loadu_si128((const __m128i*)(src0 + 2 * x));
+        __m128i top_second = _mm_loadu_si128((const __m128i*)(src0 + 2 * x + 16));
+        __m128i bottom_first = _mm_loadu_si128((const __m128i*)(src1 + 2 * x));
+        __m128i bottom_second = _mm_loadu_si128((const __m128i*)(src1 + 2 * x + 16));
+        _mm_storeu_si128((__m128i*)(y0 + x), _mm_packus_epi16(_mm_and_si128(top_first, low_bytes),
+                                                              _mm_and_si128(top_second, low_bytes)));
+        _mm_storeu_si128((__m128i*)(y1 + x), _mm_packus_epi16(_mm_and_si128(bottom_first, low_bytes),
+                                                              _mm_and_si128(bottom_second, low_bytes)));
+
+        __m128i chroma = _mm_avg_epu8(
+            _mm_packus_epi16(_mm_srli_epi16(top_first, 8), _mm_srli_epi16(top_second, 8)),
+            _mm_packus_epi16(_mm_srli_epi16(bottom_first, 8), _mm_srli_epi16(bottom_second, 8)));
+        _mm_storel_epi64((__m128i*)(u + x / 2), _mm_packus_epi16(_mm_and_si128(chroma, low_bytes), zero));
+        _mm_storel_epi64((__m128i*)(v + x / 2), _mm_packus_epi16(_mm_srli_epi16(chroma, 8), zero));
+    }
+    pipeline_scalar_yuyv_to_i420_rows(y0 + x, y1 + x, u + x / 2, v + x / 2, src0 + 2 * x, src1 + 2 * x, width - x);
+}
+
+SSE2 void pipeline_sse2_filter_rows(uint8_t* dst, const uint8_t* const* rows, const int16_t* weights,
+                                    int count, int width) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (PIPELINE_FILTER_BITS - 1));
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i low = round;
+        __m128i high = round;
+        for (int k = 0; k < count; k += 2) {
+            bool pair = k + 1 < count;
+            __m128i first = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(rows[k] + x)), zero);
+            __m128i second = pair ? _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(rows[k + 1] + x)), zero)
+                                  : zero;
+            __m128i weight = _mm_set1_epi32((int)(((uint32_t)(pair ? weights[k + 1] : 0) << 16) |
+                                                  (uint16_t)weights[k]));
+            low = _mm_add_epi32(low, _mm_madd_epi16(_mm_unpacklo_epi16(first, second), weight));
+            high = _mm_add_epi32(high, _mm_madd_epi16(_mm_unpackhi_epi16(first, second), weight));
+        }
+        __m128i packed = _mm_packs_epi32(_mm_srai_epi32(low, PIPELINE_FILTER_BITS),
+                                         _mm_srai_epi32(high, PIPELINE_FILTER_BITS));
+        _mm_storel_epi64((__m128i*)(dst + x), _mm_packus_epi16(packed, packed));
+    }
+    pipeline_scalar_filter_columns(dst, rows, weights, count, x, width);
+}
+
+SSE2 void pipeline_sse2_transpose_8x8(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride) {
+    __m128i rows[8];
+    for (int i = 0; i < 8; i++) {
+        rows[i] = _mm_loadl_epi64((const __m128i*)(src + i * src_stride));
+    }
+    __m128i pairs[4];
+    for (int i = 0; i < 4; i++) {
+        pairs[i] = _mm_unpacklo_epi8(rows[2 * i], rows[2 * i + 1]);
+    }
+    __m128i top_low = _mm_unpacklo_epi16(pairs[0], pairs[1]);
+    __m128i top_high = _mm_unpackhi_epi16(pairs[0], pairs[1]);
+    __m128i bottom_low = _mm_unpacklo_epi16(pairs[2], pairs[3]);
+    __m128i bottom_high = _mm_unpackhi_epi16(pairs[2], pairs[3]);
+    __m128i columns[4] = {
+        _mm_unpacklo_epi32(top_low, bottom_low), _mm_unpackhi_epi32(top_low, bottom_low),
+        _mm_unpacklo_epi32(top_high, bottom_high), _mm_unpackhi_epi32(top_high, bottom_high)
+    };
+    for (int i = 0; i < 4; i++) {
+        _mm_storel_epi64((__m128i*)(dst + 2 * i * dst_stride), columns[i]);
+        _mm_storel_epi64((__m128i*)(dst + (2 * i + 1) * dst_stride), _mm_unpackhi_epi64(columns[i], columns[i]));
+    }
+}
+
+SSE2 void pipeline_sse2_reverse_row(uint8_t* dst, const uint8_t* src, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(src + width - 16 - x));
+        bytes = _mm_shuffle_epi32(bytes, _MM_SHUFFLE(0, 1, 2, 3));
+        bytes = _mm_shufflehi_epi16(_mm_shufflelo_epi16(bytes, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+        bytes = _mm_or_si128(_mm_slli_epi16(bytes, 8), _mm_srli_epi16(bytes, 8));
+        _mm_storeu_si128((__m128i*)(dst + x), bytes);
+    }
+    pipeline_scalar_reverse_row(dst + x, src, width - x);
+}
+
+AVX2 void pipeline_avx2_interleave_row(uint8_t* uv, const uint8_t* u, const uint8_t* v, int width) {
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i u_bytes = _mm256_loadu_si256((const __m256i*)(u + x));
+        __m256i v_bytes = _mm256_loadu_si256((const __m256i*)(v + x));
+        __m256i low = _mm256_unpacklo_epi8(u_bytes, v_bytes);
+        __m256i high = _mm256_unpackhi_epi8(u_bytes, v_bytes);
+        _mm256_storeu_si256((__m256i*)(uv + 2 * x), _mm256_permute2x128_si256(low, high, 0x20));
+        _mm256_storeu_si256((__m256i*)(uv + 2 * x + 32), _mm256_permute2x128_si256(low, high, 0x31));
+    }
+    pipeline_sse2_interleave_row(uv + 2 * x, u + x, v + x, width - x);
+}
+
+AVX2 void pipeline_avx2_deinterleave_row(uint8_t* u, uint8_t* v, const uint8_t* uv, int width) {
+    const __m256i low_bytes = _mm256_set1_epi16(0x00FF);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i first = _mm256_loadu_si256((const __m256i*)(uv + 2 * x));
+        __m256i second = _mm256_loadu_si256((const __m256i*)(uv + 2 * x + 32));
+        __m256i u_bytes = _mm256_packus_epi16(_mm256_and_si256(first, low_bytes),
+                                              _mm256_and_si256(second, low_bytes));
+        __m256i v_bytes = _mm256_packus_epi16(_mm256_srli_epi16(first, 8), _mm256_srli_epi16(second, 8));
+        _mm256_storeu_si256((__m256i*)(u + x), _mm256_permute4x64_epi64(u_bytes, 0xD8));
+        _mm256_storeu_si256((__m256i*)(v + x), _mm256_permute4x64_epi64(v_bytes, 0xD8));
+    }
+    pipeline_sse2_deinterleave_row(u + x, v + x, uv + 2 * x, width - x);
+}
+
+AVX2 static __m256i avx2_quantize8(const float* values, const float* scale) {
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 value = _mm256_mul_ps(_mm256_loadu_ps(values), _mm256_loadu_ps(scale));
+    __m256 half = _mm256_or_ps(_mm256_and_ps(value, sign), _mm256_set1_ps(0.5f));
+    return _mm256_cvttps_epi32(_mm256_add_ps(value, half));
+}
+
+AVX2 void pipeline_avx2_quantize_block(const float values[64], const float scale[64], int16_t coefficients[64]) {
+    const __m256i limit = _mm256_set1_epi16(1023);
+    const __m256i negative_limit = _mm256_set1_epi16(-1023);
+    for (int i = 0; i < 64; i += 16) {
+        __m256i packed = _mm256_packs_epi32(avx2_quantize8(values + i, scale + i),
+                                            avx2_quantize8(values + i + 8, scale + i + 8));
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        packed = _mm256_max_epi16(_mm256_min_epi16(packed, limit), negative_limit);
+        _mm256_storeu_si256((__m256i*)(coefficients + i), packed);
+    }
+}
+
+AVX2 size_t pipeline_avx2_find_start_code(const uint8_t* data, size_t size, size_t from) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = from;
+    while (i + 34 <= size) {
+        __m256i first = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + i)), zero);
+        __m256i second = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + i + 1)), zero);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(first, second));
+        if (mask) {
+            size_t found = check_candidates(data, i, mask);
+            if (found != SIZE_MAX) {
+                return found;
+            }
+        }
+        i += 32;
+    }
+    return pipeline_sse2_find_start_code(data, size, i);
+}
+
+AVX2 static __m256i avx2_pack_luma(const uint8_t* src) {
+    const __m256i low_bytes = _mm256_set1_epi16(0x00FF);
+    __m256i first = _mm256_loadu_si256((const __m256i*)src);
+    __m256i second = _mm256_loadu_si256((const __m256i*)(src + 32));
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(_mm256_and_si256(first, low_bytes),
+                                                        _mm256_and_si256(second, low_bytes)), 0xD8);
+}
+
+AVX2 static __m256i avx2_pack_chroma(const uint8_t* src) {
+    __m256i first = _mm256_loadu_si256((const __m256i*)src);
+    __m256i second = _mm256_loadu_si256((const __m256i*)(src + 32));
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(_mm256_srli_epi16(first, 8),
+                                                        _mm256_srli_epi16(second, 8)), 0xD8);
+}
+
+AVX2 void pipeline_avx2_yuyv_to_i420_rows(uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                                          const uint8_t* src0, const uint8_t* src1, int width) {
+    const __m256i low_bytes = _mm256_set1_epi16(0x00FF);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        _mm256_storeu_si256((__m256i*)(y0 + x), avx2_pack_luma(src0 + 2 * x));
+        _mm256_storeu_si256((__m256i*)(y1 + x), avx2_pack_luma(src1 + 2 * x));
+
+        __m256i chroma = _mm256_avg_epu8(avx2_pack_chroma(src0 + 2 * x), avx2_pack_chroma(src1 + 2 * x));
+        __m256i planar = _mm256_permute4x64_epi64(
+            _mm256_packus_epi16(_mm256_and_si256(chroma, low_bytes), _mm256_srli_epi16(chroma, 8)), 0xD8);
+        _mm_storeu_si128((__m128i*)(u + x / 2), _mm256_castsi256_si128(planar));
+        _mm_storeu_si128((__m128i*)(v + x / 2), _mm256_extracti128_si256(planar, 1));
+    }
+    pipeline_sse2_yuyv_to_i420_rows(y0 + x, y1 + x, u + x / 2, v + x / 2, src0 + 2 * x, src1 + 2 * x, width - x);
+}
+
+AVX2 void pipeline_avx2_filter_rows(uint8_t* dst, const uint8_t* const* rows, const int16_t* weights,
+                                    int count, int width) {
+    const __m256i round = _mm256_set1_epi32(1 << (PIPELINE_FILTER_BITS - 1));
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i low = round;
+        __m256i high = round;
+        for (int k = 0; k < count; k += 2) {
+            bool pair = k + 1 < count;
+            __m256i first = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(rows[k] + x)));
+            __m256i second = pair ? _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(rows[k + 1] + x)))
+                                  : _mm256_setzero_si256();
+            __m256i weight = _mm256_set1_epi32((int)(((uint32_t)(pair ? weights[k + 1] : 0) << 16) |
+                                                     (uint16_t)weights[k]));
+            low = _mm256_add_epi32(low, _mm256_madd_epi16(_mm256_unpacklo_epi16(first, second), weight));
+            high = _mm256_add_epi32(high, _mm256_madd_epi16(_mm256_unpackhi_epi16(first, second), weight));
+        }
+        __m256i packed = _mm256_packs_epi32(_mm256_srai_epi32(low, PIPELINE_FILTER_BITS),
+                                            _mm256_srai_epi32(high, PIPELINE_FILTER_BITS));
+        packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(packed, packed), 0x08);
+        _mm_storeu_si128((__m128i*)(dst + x), _mm256_castsi256_si128(packed));
+    }
+    pipeline_scalar_filter_columns(dst, rows, weights, count, x, width);
+}
+
+
+AVX2 void pipeline_avx2_reverse_row(uint8_t* dst, const uint8_t* src, int width) {
+    const __m256i order = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                           15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)(src + width - 32 - x));
+        bytes = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(bytes, order), 0x4E);
+        _mm256_storeu_si256((__m256i*)(dst + x), bytes);
+    }
+    pipeline_sse2_reverse_row(dst + x, src, width - x);
+}
+
+#endif
@@ -0,0 +1,92 @@
+#define _GNU_SOURCE
+#include "pipeline_latency.h"
+#include "pipeline_time.h"
+#include "videodev2.h"
+#include <string.h>
+
+static const char* stage_names[PIPELINE_STAGE_COUNT] = {
+    "captured",
+    "dequeued",
+    "decode_submitted",
+    "decoded",
+    "encode_submitted",
+    "encoded",
+    "delivered"
+};
+
+void pipeline_latency_reset(pipeline_latency_t* latency) {
+    if (!latency) return;
+
+    memset(latency, 0, sizeof(pipeline_latency_t));
+}
+
+void pipeline_latency_begin(pipeline_latency_record_t* record, const v4l2_capture_frame_t* frame) {
+    if (!record) return;
+
+    memset(record, 0, sizeof(pipeline_latency_record_t));
+    if (!frame) {
+        record->timestamps_us[PIPELINE_STAGE_DEQUEUED] = pipeline_time_now_us();
+        return;
+    }
+
+    if ((frame->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+        record->timestamps_us[PIPELINE_STAGE_CAPTURED] = frame->timestamp_us;
+    }
+    record->timestamps_us[PIPELINE_STAGE_DEQUEUED] =
+        frame->dequeue_us > 0 ? frame->dequeue_us : pipeline_time_now_us();
+}
+
+void pipeline_latency_mark(pipeline_latency_record_t* record, pipeline_stage_t stage) {
+    if (!record || (unsigned)stage >= PIPELINE_STAGE_COUNT) return;
+
+    record->timestamps_us[stage] = pipeline_time_now_us();
+}
+
+void pipeline_latency_add(pipeline_latency_t* latency, const pipeline_latency_record_t* record) {
+    if (!latency || !record) return;
+
+    const uint64_t* stamps = record->timestamps_us;
+    int first = -1;
+    int previous = -1;
+
+    for (int stage = 0; stage < PIPELINE_STAGE_COUNT; stage++) {
+        if (stamps[stage] == 0) {
+            continue;
+        }
+        if (previous >= 0 && stamps[stage] >= stamps[previous]) {
+            pipeline_histogram_add(&latency->stages[stage], stamps[stage] - stamps[previous]);
+        }
+        if (first < 0) {
+            first = stage;
+        }
+        previous = stage;
+    }
+
+    if (first < 0 || stamps[PIPELINE_STAGE_DELIVERED] == 0 ||
+        stamps[PIPELINE_STAGE_DELIVERED] < stamps[first]) {
+        latency->incomplete++;
+        return;
+    }
+
+    pipeline_histogram_add(&latency->total, stamps[PIPELINE_STAGE_DELIVERED] - stamps[first]);
+    latency->frames++;
+}
+
+uint64_t pipeline_latency_stage_percentile(const pipeline_latency_t* latency,
+                                           pipeline_stage_t stage,
+                                           double percentile) {
+    if (!latency || (unsigned)stage >= PIPELINE_STAGE_COUNT) return 0;
+
+    return pipeline_histogram_percentile(&latency->stages[stage], percentile);
+}
+
+uint64_t pipeline_latency_total_percentile(const pipeline_latency_t* latency, double percentile) {
+    if (!latency) return 0;
+
+    return pipeline_histogram_percentile(&latency->total, percentile);
+}
+
+const char* pipeline_latency_stage_name(pipeline_stage_t stage) {
+    if ((unsigned)stage >= PIPELINE_STAGE_COUNT) return "unknown";
+    return stage_names[stage];
+}
@@ -0,0 +1,359 @@
+#define _GNU_SOURCE
+#include "pipeline_metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define PREFIX "h264_jpeg_"
+#define REQUEST_TIMEOUT_MS 250
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t length;
+} writer_t;
+
+static const char* counter_help[PIPELINE_COUNTER_COUNT] = {
+    "H.264 access units submitted for conversion",
+    "JPEG images produced",
+    "H.264 bytes submitted for conversion",
+    "JPEG bytes produced",
+    "Hardware decoder and encoder output timeouts",
+    "Frames dropped or replaced by frame queues",
+    "Heap allocations on the frame path",
+    "Failed conversions",
+    "Frame bytes copied between buffers"
+};
+
+static const uint64_t bucket_bounds_us[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+};
+
+static void append(writer_t* writer, const char* format, ...) {
+    char* target = writer->length < writer->size ? writer->data + writer->length : NULL;
+    size_t space = writer->length < writer->size ? writer->size - writer->length : 0;
+
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(target, space, format, args);
+    va_end(args);
+
+    if (written > 0) {
+        writer->length += (size_t)written;
+    }
+}
+
+static void append_seconds(writer_t* writer, uint64_t value_us) {
+    append(writer, "%llu.%06llu", (unsigned long long)(value_us / 1000000),
+           (unsigned long long)(value_us % 1000000));
+}
+
+static void render_histogram(writer_t* writer, const char* stage, const pipeline_histogram_t* histogram) {
+    const int bound_count = (int)(sizeof(bucket_bounds_us) / sizeof(bucket_bounds_us[0]));
+    uint64_t cumulative = 0;
+    int bucket = 0;
+
+    for (int i = 0; i < bound_count; i++) {
+        while (bucket < PIPELINE_HISTOGRAM_BUCKETS &&
+               pipeline_histogram_bucket_upper(bucket) <= bucket_bounds_us[i]) {
+            cumulative += histogram->buckets[bucket];
+            bucket++;
+        }
+        append(writer, PREFIX "latency_seconds_bucket{stage=\"%s\",le=\"", stage);
+        append_seconds(writer, bucket_bounds_us[i]);
+        append(writer, "\"} %llu\n", (unsigned long long)cumulative);
+    }
+
+    append(writer, PREFIX "latency_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %llu\n",
+           stage, (unsigned long long)histogram->count);
+    append(writer, PREFIX "latency_seconds_count{stage=\"%s\"} %llu\n",
+           stage, (unsigned long long)histogram->count);
+    append(writer, PREFIX "latency_seconds_sum{stage=\"%s\"} ", stage);
+    append_seconds(writer, histogram->sum_us);
+    append(writer, "\n");
+}
+
+size_t pipeline_metrics_render(const pipeline_stats_snapshot_t* snapshot, char* buffer, size_t size) {
+    pipeline_stats_snapshot_t current;
+    if (!snapshot) {
+        pipeline_stats_snapshot(&current);
+        snapshot = &current;
+    }
+
+    writer_t writer;
+    writer.data = buffer;
+    writer.size = buffer ? size : 0;
+    writer.length = 0;
+    if (writer.size > 0) {
+        buffer[0] = '\0';
+    }
+
+    for (int counter = 0; counter < PIPELINE_COUNTER_COUNT; counter++) {
+        const char* name = pipeline_stats_counter_name((pipeline_counter_t)counter);
+        append(&writer, "# TYPE " PREFIX "%s counter\n", name);
+        append(&writer, "# HELP " PREFIX "%s %s.\n", name, counter_help[counter]);
+        append(&writer, PREFIX "%s_total %llu\n", name, (unsigned long long)snapshot->counters[counter]);
+    }
+
+    append(&writer, "# TYPE " PREFIX "latency_seconds histogram\n");
+    append(&writer, "# HELP " PREFIX "latency_seconds Pipeline stage latency.\n");
+    for (int metric = 0; metric < PIPELINE_METRIC_COUNT; metric++) {
+        render_histogram(&writer, pipeline_stats_metric_name((pipeline_metric_t)metric),
+                         &snapshot->histograms[metric]);
+    }
+
+    append(&writer, "# TYPE " PREFIX "recording_threads gauge\n");
+    append(&writer, "# HELP " PREFIX "recording_threads Threads that have recorded statistics.\n");
+    append(&writer, PREFIX "recording_threads %u\n", snapshot->threads);
+    append(&writer, "# EOF\n");
+
+    return writer.length;
+}
+
+static bool listen_unix(pipeline_metrics_server_t* server, const char* path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (path[0] == '\0' || strlen(path) >= sizeof(addr.sun_path)) {
+        snprintf(server->error_message, sizeof(server->error_message),
+                "Invalid Unix socket path");
+        return false;
+    }
+    strcpy(addr.sun_path, path);
+
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server->listen_fd < 0) {
+        snprintf(server->error_message, sizeof(server->error_message),
+                "Failed to create socket: %s", strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            snprintf(server->error_message, sizeof(server->error_message),
+                    "Failed to bind %s: %s", path, strerror(EADDRINUSE));
+            return false;
+        }
+        unlink(path);
+    }
+
+    if (bind(server->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        snprintf(server->error_message, sizeof(server->error_message),
+                "Failed to bind %s: %s", path, strerror(errno));
+        return false;
+    }
+
+    strcpy(server->path, path);
+    server->is_unix = true;
+    return true;
+}
+
+static bool listen_tcp(pipeline_metrics_server_t* server, const char* port_text) {
+    char* end = NULL;
+    long port = strtol(port_text, &end, 10);
+    if (end == port_text || *end != '\0' || port < 0 || port > 65535) {
+        snprintf(server->error_message, sizeof(server->error_message),
+                "Invalid TCP port: %s", port_text);
+        return false;
+    }
+
+    server->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server->listen_fd < 0) {
+        snprintf(server->error_message, sizeof(server->error_message),
+                "Failed to create socket: %s", strerror(errno));
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)port);
+
+    if (bind(server->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        snprintf(server->error_message, sizeof(server->error_message),
+                "Failed to bind 127.0.0.1:%ld: %s", port, strerror(errno));
+        return false;
+    }
+
+    socklen_t length = sizeof(addr);
+    if (getsockname(server->listen_fd, (struct sockaddr*)&addr, &length) == 0) {
+        server->port = ntohs(addr.sin_port);
+    }
+    return true;
+}
+
+bool pipeline_metrics_server_init(pipeline_metrics_server_t* server, const char* address) {
+    if (!server) return false;
+
+    memset(server, 0, sizeof(pipeline_metrics_server_t));
+    server->listen_fd = -1;
+
+    bool bound;
+    if (!address) {
+        char port_text[16];
+        snprintf(port_text, sizeof(port_text), "%d", PIPELINE_METRICS_DEFAULT_PORT);
+        bound = listen_tcp(server, port_text);
+    } else if (strncmp(address, "unix:", 5) == 0) {
+        bound = listen_unix(server, address + 5);
+    } else if (strncmp(address, "tcp:", 4) == 0) {
+        bound = listen_tcp(server, address + 4);
+    } else {
+        snprintf(server->error_message, sizeof(server->error_message),
+                "Address must be unix:<path> or tcp:<port>");
+        bound = false;
+    }
+
+    if (bound && listen(server->listen_fd, 4) < 0) {
+        snprintf(server->error_message, sizeof(server->error_message),
+                "Failed to listen: %s", strerror(errno));
+        bound = false;
+    }
+
+    if (!bound) {
+        pipeline_metrics_server_cleanup(server);
+        return false;
+    }
+
+    return true;
+}
+
+void pipeline_metrics_server_cleanup(pipeline_metrics_server_t* server) {
+    if (!server) return;
+
+    char message[sizeof(server->error_message)];
+    memcpy(message, server->error_message, sizeof(message));
+
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+        if (server->is_unix) {
+            unlink(server->path);
+        }
+    }
+
+    memset(server, 0, sizeof(pipeline_metrics_server_t));
+    server->listen_fd = -1;
+    memcpy(server->error_message, message, sizeof(message));
+}
+
+int pipeline_metrics_server_get_fd(const pipeline_metrics_server_t* server) {
+    if (!server) return -1;
+    return server->listen_fd;
+}
+
+static bool wait_readable(int fd, int timeout_ms) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int result;
+    do {
+        result = poll(&pfd, 1, timeout_ms);
+    } while (result == -1 && errno == EINTR);
+
+    return result > 0;
+}
+
+static void read_request(int fd) {
+    char request[1024];
+    size_t length = 0;
+
+    while (length < sizeof(request) - 1 && wait_readable(fd, REQUEST_TIMEOUT_MS)) {
+        ssize_t received = recv(fd, request + length, sizeof(request) - 1 - length, 0);
+        if (received <= 0) {
+            return;
+        }
+        length += (size_t)received;
+        request[length] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) {
+            return;
+        }
+    }
+}
+
+static bool send_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= (size_t)sent;
+    }
+    return true;
+}
+
+int pipeline_metrics_server_serve(pipeline_metrics_server_t* server, int timeout_ms) {
+    if (!server || server->listen_fd < 0) {
+        if (server) {
+            snprintf(server->error_message, sizeof(server->error_message),
+                    "Metrics server not initialized");
+        }
+        return -1;
+    }
+
+    if (!wait_readable(server->listen_fd, timeout_ms)) {
+        return 0;
+    }
+
+    int client = accept4(server->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (client < 0) {
+        if (errno == EAGAIN || errno == EINTR || errno == ECONNABORTED) {
+            return 0;
+        }
+        snprintf(server->error_message, sizeof(server->error_message),
+                "Failed to accept: %s", strerror(errno));
+        return -1;
+    }
+
+    read_request(client);
+
+    size_t length = pipeline_metrics_render(NULL, server->body, sizeof(server->body));
+    char header[256];
+    int header_length;
+    if (length >= sizeof(server->body)) {
+        snprintf(server->error_message, sizeof(server->error_message),
+                "Metrics exceed %d byte buffer", PIPELINE_METRICS_BUFFER_SIZE);
+        length = 0;
+        header_length = snprintf(header, sizeof(header),
+                                 "HTTP/1.0 500 Internal Server Error\r\n"
+                                 "Content-Length: 0\r\nConnection: close\r\n\r\n");
+    } else {
+        header_length = snprintf(header, sizeof(header),
+                                 "HTTP/1.0 200 OK\r\nContent-Type: %s\r\n"
+                                 "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                                 PIPELINE_METRICS_CONTENT_TYPE, length);
+    }
+
+    bool sent = send_all(client, header, (size_t)header_length) && send_all(client, server->body, length);
+    close(client);
+
+    if (sent) {
+        server->requests++;
+    }
+    return 1;
+}
+
+const char* pipeline_metrics_server_get_error(const pipeline_metrics_server_t* server) {
+    if (!server) return "Invalid metrics server context";
+    return server->error_message;
+}
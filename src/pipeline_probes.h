@@ -0,0 +1,21 @@
+#ifndef PIPELINE_PROBES_H
+#define PIPELINE_PROBES_H
+
+#if !defined(NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define PIPELINE_HAVE_USDT 1
+#endif
+#endif
+
+#ifdef PIPELINE_HAVE_USDT
+#define PIPELINE_PROBE1(name, a) DTRACE_PROBE1(h264_jpeg, name, a)
+#define PIPELINE_PROBE2(name, a, b) DTRACE_PROBE2(h264_jpeg, name, a, b)
+#define PIPELINE_PROBE3(name, a, b, c) DTRACE_PROBE3(h264_jpeg, name, a, b, c)
+#else
+#define PIPELINE_PROBE1(name, a) do { } while (0)
+#define PIPELINE_PROBE2(name, a, b) do { } while (0)
+#define PIPELINE_PROBE3(name, a, b, c) do { } while (0)
+#endif
+
+#endif // PIPELINE_PROBES_H
@@ -0,0 +1,248 @@
+#include "pipeline_stats.h"
+#include <string.h>
+
+#define LINEAR_BUCKETS (1 << PIPELINE_HISTOGRAM_SUB_BITS)
+#define SUB_MASK (LINEAR_BUCKETS - 1)
+
+typedef struct {
+    uint32_t seq;
+    pipeline_histogram_t histograms[PIPELINE_METRIC_COUNT];
+    uint64_t counters[PIPELINE_COUNTER_COUNT];
+} __attribute__((aligned(64))) stats_block_t;
+
+static const char* metric_names[PIPELINE_METRIC_COUNT] = {
+    "decode",
+    "encode",
+    "copy",
+    "scale",
+    "rotate",
+    "total"
+};
+
+static const char* counter_names[PIPELINE_COUNTER_COUNT] = {
+    "frames_in",
+    "frames_out",
+    "bytes_in",
+    "bytes_out",
+    "timeouts",
+    "drops",
+    "allocations",
+    "errors",
+    "bytes_copied"
+};
+
+static stats_block_t g_blocks[PIPELINE_STATS_MAX_THREADS];
+static stats_block_t g_shared;
+static int g_shared_lock = 0;
+static uint32_t g_claimed = 0;
+static __thread stats_block_t* t_block = NULL;
+
+static stats_block_t* thread_block(void) {
+    if (!t_block) {
+        uint32_t index = __atomic_fetch_add(&g_claimed, 1, __ATOMIC_RELAXED);
+        t_block = index < PIPELINE_STATS_MAX_THREADS ? &g_blocks[index] : &g_shared;
+    }
+    return t_block;
+}
+
+static uint32_t begin_write(stats_block_t* block) {
+    if (block == &g_shared) {
+        while (__atomic_exchange_n(&g_shared_lock, 1, __ATOMIC_ACQUIRE)) {
+        }
+    }
+
+    uint32_t seq = block->seq;
+    __atomic_store_n(&block->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return seq + 2;
+}
+
+static void end_write(stats_block_t* block, uint32_t seq) {
+    __atomic_store_n(&block->seq, seq, __ATOMIC_RELEASE);
+
+    if (block == &g_shared) {
+        __atomic_store_n(&g_shared_lock, 0, __ATOMIC_RELEASE);
+    }
+}
+
+static void read_block(const stats_block_t* block, stats_block_t* copy) {
+    for (;;) {
+        uint32_t before = __atomic_load_n(&block->seq, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            continue;
+        }
+
+        memcpy(copy, block, sizeof(stats_block_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&block->seq, __ATOMIC_RELAXED) == before) {
+            return;
+        }
+    }
+}
+
+static void merge_block(pipeline_stats_snapshot_t* snapshot, const stats_block_t* block) {
+    for (int metric = 0; metric < PIPELINE_METRIC_COUNT; metric++) {
+        pipeline_histogram_merge(&snapshot->histograms[metric], &block->histograms[metric]);
+    }
+    for (int counter = 0; counter < PIPELINE_COUNTER_COUNT; counter++) {
+        snapshot->counters[counter] += block->counters[counter];
+    }
+}
+
+static int bucket_index(uint64_t value_us) {
+    uint32_t value = value_us > UINT32_MAX ? UINT32_MAX : (uint32_t)value_us;
+    if (value < LINEAR_BUCKETS) {
+        return (int)value;
+    }
+
+    int shift = 31 - __builtin_clz(value) - PIPELINE_HISTOGRAM_SUB_BITS;
+    return LINEAR_BUCKETS + shift * LINEAR_BUCKETS + (int)((value >> shift) & SUB_MASK);
+}
+
+void pipeline_stats_record(pipeline_metric_t metric, uint64_t value_us) {
+    if ((unsigned)metric >= PIPELINE_METRIC_COUNT) return;
+
+    stats_block_t* block = thread_block();
+    uint32_t seq = begin_write(block);
+    pipeline_histogram_add(&block->histograms[metric], value_us);
+    end_write(block, seq);
+}
+
+void pipeline_stats_add(pipeline_counter_t counter, uint64_t amount) {
+    if ((unsigned)counter >= PIPELINE_COUNTER_COUNT) return;
+
+    stats_block_t* block = thread_block();
+    uint32_t seq = begin_write(block);
+    block->counters[counter] += amount;
+    end_write(block, seq);
+}
+
+void pipeline_stats_snapshot(pipeline_stats_snapshot_t* snapshot) {
+    if (!snapshot) return;
+
+    memset(snapshot, 0, sizeof(pipeline_stats_snapshot_t));
+
+    uint32_t claimed = __atomic_load_n(&g_claimed, __ATOMIC_ACQUIRE);
+    uint32_t owned = claimed < PIPELINE_STATS_MAX_THREADS ? claimed : PIPELINE_STATS_MAX_THREADS;
+    stats_block_t copy;
+
+    for (uint32_t i = 0; i < owned; i++) {
+        read_block(&g_blocks[i], &copy);
+        merge_block(snapshot, &copy);
+    }
+    if (claimed > PIPELINE_STATS_MAX_THREADS) {
+        read_block(&g_shared, &copy);
+        merge_block(snapshot, &copy);
+    }
+
+    snapshot->threads = claimed;
+}
+
+void pipeline_stats_merge(pipeline_stats_snapshot_t* dst, const pipeline_stats_snapshot_t* src) {
+    if (!dst || !src) return;
+
+    for (int metric = 0; metric < PIPELINE_METRIC_COUNT; metric++) {
+        pipeline_histogram_merge(&dst->histograms[metric], &src->histograms[metric]);
+    }
+    for (int counter = 0; counter < PIPELINE_COUNTER_COUNT; counter++) {
+        dst->counters[counter] += src->counters[counter];
+    }
+    dst->threads += src->threads;
+}
+
+void pipeline_stats_reset(void) {
+    for (int i = 0; i < PIPELINE_STATS_MAX_THREADS + 1; i++) {
+        stats_block_t* block = i < PIPELINE_STATS_MAX_THREADS ? &g_blocks[i] : &g_shared;
+        uint32_t seq = begin_write(block);
+        memset(block->histograms, 0, sizeof(block->histograms));
+        memset(block->counters, 0, sizeof(block->counters));
+        end_write(block, seq);
+    }
+}
+
+uint64_t pipeline_stats_metric_percentile(const pipeline_stats_snapshot_t* snapshot,
+                                          pipeline_metric_t metric,
+                                          double percentile) {
+    if (!snapshot || (unsigned)metric >= PIPELINE_METRIC_COUNT) return 0;
+
+    return pipeline_histogram_percentile(&snapshot->histograms[metric], percentile);
+}
+
+const char* pipeline_stats_metric_name(pipeline_metric_t metric) {
+    if ((unsigned)metric >= PIPELINE_METRIC_COUNT) return "unknown";
+    return metric_names[metric];
+}
+
+const char* pipeline_stats_counter_name(pipeline_counter_t counter) {
+    if ((unsigned)counter >= PIPELINE_COUNTER_COUNT) return "unknown";
+    return counter_names[counter];
+}
+
+void pipeline_histogram_reset(pipeline_histogram_t* histogram) {
+    if (!histogram) return;
+
+    memset(histogram, 0, sizeof(pipeline_histogram_t));
+}
+
+void pipeline_histogram_add(pipeline_histogram_t* histogram, uint64_t value_us) {
+    if (!histogram) return;
+
+    histogram->buckets[bucket_index(value_us)]++;
+    if (histogram->count == 0 || value_us < histogram->min_us) {
+        histogram->min_us = value_us;
+    }
+    if (value_us > histogram->max_us) {
+        histogram->max_us = value_us;
+    }
+    histogram->count++;
+    histogram->sum_us += value_us;
+}
+
+void pipeline_histogram_merge(pipeline_histogram_t* dst, const pipeline_histogram_t* src) {
+    if (!dst || !src || src->count == 0) return;
+
+    for (int bucket = 0; bucket < PIPELINE_HISTOGRAM_BUCKETS; bucket++) {
+        dst->buckets[bucket] += src->buckets[bucket];
+    }
+    if (dst->count == 0 || src->min_us < dst->min_us) {
+        dst->min_us = src->min_us;
+    }
+    if (src->max_us > dst->max_us) {
+        dst->max_us = src->max_us;
+    }
+    dst->count += src->count;
+    dst->sum_us += src->sum_us;
+}
+
+uint64_t pipeline_histogram_percentile(const pipeline_histogram_t* histogram, double percentile) {
+    if (!histogram || histogram->count == 0) return 0;
+
+    uint64_t rank = (uint64_t)(percentile / 100.0 * histogram->count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < PIPELINE_HISTOGRAM_BUCKETS; bucket++) {
+        seen += histogram->buckets[bucket];
+        if (seen >= rank) {
+            uint64_t upper = pipeline_histogram_bucket_upper(bucket);
+            if (upper > histogram->max_us) {
+                return histogram->max_us;
+            }
+            return upper < histogram->min_us ? histogram->min_us : upper;
+        }
+    }
+
+    return histogram->max_us;
+}
+
+uint64_t pipeline_histogram_bucket_upper(int bucket) {
+    if (bucket < 0) return 0;
+    if (bucket < LINEAR_BUCKETS) return (uint64_t)bucket;
+    if (bucket >= PIPELINE_HISTOGRAM_BUCKETS) return UINT32_MAX;
+
+    int shift = (bucket - LINEAR_BUCKETS) / LINEAR_BUCKETS;
+    uint64_t lower = (uint64_t)(LINEAR_BUCKETS + (bucket & SUB_MASK)) << shift;
+    return lower + (1ULL << shift) - 1;
+}
@@ -0,0 +1,13 @@
+#ifndef PIPELINE_TIME_H
+#define PIPELINE_TIME_H
+
+#include <stdint.h>
+#include <time.h>
+
+static inline uint64_t pipeline_time_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+#endif // PIPELINE_TIME_H
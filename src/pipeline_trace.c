@@ -0,0 +1,237 @@
+#define _GNU_SOURCE
+#include "pipeline_trace.h"
+#include "pipeline_time.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+typedef struct {
+    uint64_t timestamp_us;
+    const char* name;
+    uint32_t frame_id;
+    char phase;
+} trace_event_t;
+
+typedef struct {
+    uint32_t head;
+    int tid;
+    char name[32];
+} __attribute__((aligned(64))) trace_thread_t;
+
+int pipeline_trace_enabled = 0;
+
+static char g_error_message[256] = {0};
+static trace_thread_t g_threads[PIPELINE_TRACE_MAX_THREADS];
+static trace_event_t* g_events = NULL;
+static uint32_t g_capacity = 0;
+static uint32_t g_dropped = 0;
+static __thread int t_index = -1;
+
+static bool thread_exited(int tid) {
+    return syscall(SYS_tgkill, getpid(), tid, 0) == -1 && errno == ESRCH;
+}
+
+static bool claim_thread(int index, int tid, bool reuse) {
+    trace_thread_t* thread = &g_threads[index];
+    int owner = __atomic_load_n(&thread->tid, __ATOMIC_ACQUIRE);
+
+    if ((owner != 0 && (!reuse || !thread_exited(owner))) ||
+        !__atomic_compare_exchange_n(&thread->tid, &owner, tid, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+
+    thread->name[0] = '\0';
+    __atomic_store_n(&thread->head, 0, __ATOMIC_RELEASE);
+    return true;
+}
+
+static int thread_index(void) {
+    if (t_index < 0) {
+        int tid = (int)syscall(SYS_gettid);
+        for (int pass = 0; pass < 2 && t_index < 0; pass++) {
+            for (int i = 0; i < PIPELINE_TRACE_MAX_THREADS; i++) {
+                if (claim_thread(i, tid, pass == 1)) {
+                    t_index = i;
+                    break;
+                }
+            }
+        }
+    }
+    return t_index;
+}
+
+bool pipeline_trace_enable(int events_per_thread) {
+    if (events_per_thread <= 0) {
+        events_per_thread = PIPELINE_TRACE_DEFAULT_EVENTS;
+    }
+    if (events_per_thread > PIPELINE_TRACE_MAX_EVENTS) {
+        snprintf(g_error_message, sizeof(g_error_message),
+                "At most %d events per thread", PIPELINE_TRACE_MAX_EVENTS);
+        return false;
+    }
+
+    uint32_t capacity = 1;
+    while (capacity < (uint32_t)events_per_thread) {
+        capacity <<= 1;
+    }
+
+    if (g_events && capacity != g_capacity) {
+        snprintf(g_error_message, sizeof(g_error_message),
+                "Trace rings already allocated with %u events per thread", g_capacity);
+        return false;
+    }
+
+    if (!g_events) {
+        trace_event_t* events = calloc((size_t)capacity * PIPELINE_TRACE_MAX_THREADS, sizeof(trace_event_t));
+        if (!events) {
+            snprintf(g_error_message, sizeof(g_error_message),
+                    "Failed to allocate trace rings");
+            return false;
+        }
+        g_events = events;
+        g_capacity = capacity;
+    }
+
+    for (int i = 0; i < PIPELINE_TRACE_MAX_THREADS; i++) {
+        __atomic_store_n(&g_threads[i].head, 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&g_dropped, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pipeline_trace_enabled, 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void pipeline_trace_disable(void) {
+    __atomic_store_n(&pipeline_trace_enabled, 0, __ATOMIC_RELEASE);
+}
+
+void pipeline_trace_cleanup(void) {
+    pipeline_trace_disable();
+    free(g_events);
+    g_events = NULL;
+    g_capacity = 0;
+}
+
+void pipeline_trace_record(pipeline_trace_phase_t phase, const char* name, uint32_t frame_id) {
+    if (!__atomic_load_n(&pipeline_trace_enabled, __ATOMIC_ACQUIRE) || !name) return;
+
+    int index = thread_index();
+    if (index < 0) {
+        __atomic_fetch_add(&g_dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    trace_thread_t* thread = &g_threads[index];
+    uint32_t head = thread->head;
+    trace_event_t* event = &g_events[(size_t)index * g_capacity + (head & (g_capacity - 1))];
+    event->timestamp_us = pipeline_time_now_us();
+    event->name = name;
+    event->frame_id = frame_id;
+    event->phase = (char)phase;
+    __atomic_store_n(&thread->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void pipeline_trace_set_thread_name(const char* name) {
+    if (!name) return;
+
+    int index = thread_index();
+    if (index < 0) return;
+
+    snprintf(g_threads[index].name, sizeof(g_threads[index].name), "%s", name);
+}
+
+static void write_string(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(file, "\\%c", *c);
+        } else if ((unsigned char)*c < 0x20) {
+            fprintf(file, "\\u%04x", (unsigned char)*c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+static void write_separator(FILE* file, bool* first) {
+    fputs(*first ? "\n" : ",\n", file);
+    *first = false;
+}
+
+bool pipeline_trace_dump(const char* path) {
+    if (!path) {
+        snprintf(g_error_message, sizeof(g_error_message), "Invalid parameters");
+        return false;
+    }
+
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        snprintf(g_error_message, sizeof(g_error_message),
+                "Failed to open %s: %s", path, strerror(errno));
+        return false;
+    }
+
+    int pid = (int)getpid();
+    bool first = true;
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+
+    for (int i = 0; i < PIPELINE_TRACE_MAX_THREADS; i++) {
+        trace_thread_t* thread = &g_threads[i];
+        if (__atomic_load_n(&thread->tid, __ATOMIC_ACQUIRE) == 0) {
+            continue;
+        }
+
+        if (thread->name[0] != '\0') {
+            write_separator(file, &first);
+            fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+                    pid, thread->tid);
+            write_string(file, thread->name);
+            fputs("}}", file);
+        }
+
+        if (!g_events) {
+            continue;
+        }
+
+        uint32_t head = __atomic_load_n(&thread->head, __ATOMIC_ACQUIRE);
+        uint32_t start = head >= g_capacity ? head - g_capacity + 1 : 0;
+        for (uint32_t n = start; n != head; n++) {
+            trace_event_t event = g_events[(size_t)i * g_capacity + (n & (g_capacity - 1))];
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&thread->head, __ATOMIC_RELAXED) - n >= g_capacity) {
+                continue;
+            }
+
+            write_separator(file, &first);
+            fputs("{\"name\":", file);
+            write_string(file, event.name);
+            fprintf(file, ",\"cat\":\"pipeline\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":%d,\"tid\":%d,",
+                    event.phase, (unsigned long long)event.timestamp_us, pid, thread->tid);
+            if (event.phase == PIPELINE_TRACE_PHASE_INSTANT) {
+                fputs("\"s\":\"t\",", file);
+            }
+            fprintf(file, "\"args\":{\"frame\":%u}}", event.frame_id);
+        }
+    }
+
+    fputs("\n]}\n", file);
+
+    if (fclose(file) != 0) {
+        snprintf(g_error_message, sizeof(g_error_message),
+                "Failed to write %s: %s", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+uint32_t pipeline_trace_get_dropped(void) {
+    return __atomic_load_n(&g_dropped, __ATOMIC_RELAXED);
+}
+
+const char* pipeline_trace_get_error(void) {
+    return g_error_message;
+}
@@ -0,0 +1,977 @@
+#define _GNU_SOURCE
+#include "v4l2_capture.h"
+#include "v4l2_record.h"
+#include "videodev2.h"
+#include "pipeline_time.h"
+#include "pipeline_stats.h"
+#include "pipeline_trace.h"
+#include "pipeline_probes.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+static int xioctl(int fd, unsigned long request, void* arg) {
+    int result;
+
+    do {
+        result = ioctl(fd, request, arg);
+    } while (result == -1 && errno == EINTR);
+
+    return result;
+}
+
+static bool queue_buffer(v4l2_capture_t* capture, uint32_t index) {
+    struct v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+
+    if (xioctl(capture->fd, VIDIOC_QBUF, &buf) == -1) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Failed to queue buffer %u: %s", index, strerror(errno));
+        return false;
+    }
+
+    __atomic_store_n(&capture->buffers[index].queued, true, __ATOMIC_RELEASE);
+    return true;
+}
+
+static void export_buffers(v4l2_capture_t* capture) {
+    for (int i = 0; i < capture->buffer_count; i++) {
+        struct v4l2_exportbuffer expbuf;
+        memset(&expbuf, 0, sizeof(expbuf));
+        expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        expbuf.index = i;
+        expbuf.flags = O_RDONLY | O_CLOEXEC;
+
+        if (xioctl(capture->fd, VIDIOC_EXPBUF, &expbuf) == -1) {
+            return;
+        }
+
+        capture->buffers[i].dmabuf_fd = expbuf.fd;
+    }
+}
+
+static bool map_buffers(v4l2_capture_t* capture) {
+    for (int i = 0; i < capture->buffer_count; i++) {
+        struct v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+
+        if (xioctl(capture->fd, VIDIOC_QUERYBUF, &buf) == -1) {
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Failed to query buffer %d: %s", i, strerror(errno));
+            return false;
+        }
+
+        void* start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED,
+                           capture->fd, buf.m.offset);
+        if (start == MAP_FAILED) {
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Failed to map buffer %d: %s", i, strerror(errno));
+            return false;
+        }
+
+        capture->buffers[i].start = start;
+        capture->buffers[i].length = buf.length;
+        __atomic_store_n(&capture->buffers[i].queued, false, __ATOMIC_RELEASE);
+    }
+
+    return true;
+}
+
+static void unmap_buffers(v4l2_capture_t* capture) {
+    for (int i = 0; i < V4L2_CAPTURE_MAX_BUFFERS; i++) {
+        if (capture->buffers[i].start && capture->replay.file) {
+            free(capture->buffers[i].start);
+            capture->buffers[i].start = NULL;
+            capture->buffers[i].length = 0;
+        } else if (capture->buffers[i].start) {
+            munmap(capture->buffers[i].start, capture->buffers[i].length);
+            capture->buffers[i].start = NULL;
+            capture->buffers[i].length = 0;
+        }
+        if (capture->buffers[i].dmabuf_fd >= 0) {
+            close(capture->buffers[i].dmabuf_fd);
+        }
+        capture->buffers[i].dmabuf_fd = -1;
+    }
+}
+
+static void drain_wake(v4l2_capture_t* capture) {
+    uint64_t value;
+    while (read(capture->wake_fd, &value, sizeof(value)) == (ssize_t)sizeof(value)) {
+    }
+}
+
+static void drain_timer(v4l2_capture_t* capture) {
+    uint64_t expirations;
+    ssize_t result = read(capture->replay.timer_fd, &expirations, sizeof(expirations));
+    (void)result;
+}
+
+static bool setup_events(v4l2_capture_t* capture) {
+    capture->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (capture->epoll_fd == -1) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Failed to create epoll instance: %s", strerror(errno));
+        return false;
+    }
+
+    capture->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (capture->wake_fd == -1) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Failed to create wake eventfd: %s", strerror(errno));
+        return false;
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = capture->fd;
+    if (capture->fd >= 0 && epoll_ctl(capture->epoll_fd, EPOLL_CTL_ADD, capture->fd, &event) == -1) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Failed to watch capture device: %s", strerror(errno));
+        return false;
+    }
+
+    event.events = EPOLLIN;
+    event.data.fd = capture->replay.timer_fd;
+    if (capture->replay.timer_fd >= 0 &&
+        epoll_ctl(capture->epoll_fd, EPOLL_CTL_ADD, capture->replay.timer_fd, &event) == -1) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Failed to watch replay timer: %s", strerror(errno));
+        return false;
+    }
+
+    event.events = EPOLLIN;
+    event.data.fd = capture->wake_fd;
+    if (epoll_ctl(capture->epoll_fd, EPOLL_CTL_ADD, capture->wake_fd, &event) == -1) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Failed to watch wake eventfd: %s", strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+static bool open_replay(v4l2_capture_t* capture, const v4l2_capture_config_t* config, int buffer_count) {
+    if (config->replay_speed < 0.0) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Invalid replay speed: %g", config->replay_speed);
+        return false;
+    }
+
+    capture->replay.file = fopen(config->replay_path, "rb");
+    if (!capture->replay.file) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Failed to open %s: %s", config->replay_path, strerror(errno));
+        return false;
+    }
+
+    if (!v4l2_record_read_header(capture->replay.file, &capture->width, &capture->height,
+                                 &capture->pixelformat)) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Not a capture recording: %s", config->replay_path);
+        return false;
+    }
+
+    capture->replay.data_offset = ftell(capture->replay.file);
+    capture->replay.speed = config->replay_speed;
+    capture->replay.loop = config->replay_loop;
+    capture->replay.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (capture->replay.timer_fd == -1) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Failed to create replay timer: %s", strerror(errno));
+        return false;
+    }
+
+    capture->buffer_count = buffer_count;
+    return setup_events(capture);
+}
+
+void v4l2_capture_default_config(v4l2_capture_config_t* config) {
+    if (!config) return;
+
+    memset(config, 0, sizeof(v4l2_capture_config_t));
+    config->device = "/dev/video0";
+    config->width = 1280;
+    config->height = 720;
+    config->pixelformat = V4L2_PIX_FMT_H264;
+    config->buffer_count = V4L2_CAPTURE_DEFAULT_BUFFER_COUNT;
+    config->replay_speed = 1.0;
+}
+
+bool v4l2_capture_init(v4l2_capture_t* capture, const v4l2_capture_config_t* config) {
+    if (!capture) return false;
+
+    memset(capture, 0, sizeof(v4l2_capture_t));
+    capture->fd = -1;
+    capture->epoll_fd = -1;
+    capture->wake_fd = -1;
+    capture->replay.timer_fd = -1;
+    for (int i = 0; i < V4L2_CAPTURE_MAX_BUFFERS; i++) {
+        capture->buffers[i].dmabuf_fd = -1;
+    }
+
+    if (!config || (!config->replay_path &&
+                    (!config->device || config->width <= 0 || config->height <= 0))) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Invalid parameters");
+        return false;
+    }
+
+    int buffer_count = config->buffer_count;
+    if (buffer_count < V4L2_CAPTURE_MIN_BUFFERS) {
+        buffer_count = V4L2_CAPTURE_MIN_BUFFERS;
+    }
+    if (buffer_count > V4L2_CAPTURE_MAX_BUFFERS) {
+        buffer_count = V4L2_CAPTURE_MAX_BUFFERS;
+    }
+
+    if (config->replay_path) {
+        if (!open_replay(capture, config, buffer_count)) {
+            v4l2_capture_cleanup(capture);
+            return false;
+        }
+        return true;
+    }
+
+    capture->fd = open(config->device, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (capture->fd == -1) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Failed to open %s: %s", config->device, strerror(errno));
+        return false;
+    }
+
+    struct v4l2_format fmt;
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    fmt.fmt.pix.width = config->width;
+    fmt.fmt.pix.height = config->height;
+    fmt.fmt.pix.pixelformat = config->pixelformat;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+
+    if (xioctl(capture->fd, VIDIOC_S_FMT, &fmt) == -1) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Failed to set format: %s", strerror(errno));
+        v4l2_capture_cleanup(capture);
+        return false;
+    }
+
+    capture->width = fmt.fmt.pix.width;
+    capture->height = fmt.fmt.pix.height;
+    capture->pixelformat = fmt.fmt.pix.pixelformat;
+
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = buffer_count;
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = V4L2_MEMORY_MMAP;
+
+    if (xioctl(capture->fd, VIDIOC_REQBUFS, &req) == -1) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Failed to request buffers: %s", strerror(errno));
+        v4l2_capture_cleanup(capture);
+        return false;
+    }
+
+    if (req.count < V4L2_CAPTURE_MIN_BUFFERS || req.count > V4L2_CAPTURE_MAX_BUFFERS) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Driver allocated unusable buffer count: %u", req.count);
+        v4l2_capture_cleanup(capture);
+        return false;
+    }
+
+    capture->buffer_count = req.count;
+
+    if (!map_buffers(capture) || !setup_events(capture)) {
+        v4l2_capture_cleanup(capture);
+        return false;
+    }
+
+    if (config->export_dmabuf) {
+        export_buffers(capture);
+    }
+
+    return true;
+}
+
+void v4l2_capture_cleanup(v4l2_capture_t* capture) {
+    if (!capture) return;
+
+    if (capture->streaming) {
+        v4l2_capture_stop(capture);
+    }
+
+    unmap_buffers(capture);
+
+    if (capture->fd >= 0 && capture->buffer_count > 0) {
+        struct v4l2_requestbuffers req;
+        memset(&req, 0, sizeof(req));
+        req.count = 0;
+        req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        req.memory = V4L2_MEMORY_MMAP;
+        xioctl(capture->fd, VIDIOC_REQBUFS, &req);
+    }
+
+    if (capture->replay.timer_fd >= 0) {
+        close(capture->replay.timer_fd);
+    }
+    if (capture->replay.file) {
+        fclose(capture->replay.file);
+    }
+    if (capture->wake_fd >= 0) {
+        close(capture->wake_fd);
+    }
+    if (capture->epoll_fd >= 0) {
+        close(capture->epoll_fd);
+    }
+    if (capture->fd >= 0) {
+        close(capture->fd);
+    }
+
+    char message[sizeof(capture->error_message)];
+    memcpy(message, capture->error_message, sizeof(message));
+    memset(capture, 0, sizeof(v4l2_capture_t));
+    capture->fd = -1;
+    capture->epoll_fd = -1;
+    capture->wake_fd = -1;
+    capture->replay.timer_fd = -1;
+    for (int i = 0; i < V4L2_CAPTURE_MAX_BUFFERS; i++) {
+        capture->buffers[i].dmabuf_fd = -1;
+    }
+    memcpy(capture->error_message, message, sizeof(message));
+}
+
+static bool start_replay(v4l2_capture_t* capture) {
+    v4l2_capture_replay_t* replay = &capture->replay;
+
+    if (fseek(replay->file, replay->data_offset, SEEK_SET) != 0) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Failed to rewind recording: %s", strerror(errno));
+        return false;
+    }
+
+    for (int i = 0; i < capture->buffer_count; i++) {
+        bool held = __atomic_load_n(&capture->buffers[i].holds, __ATOMIC_ACQUIRE) > 0;
+        __atomic_store_n(&capture->buffers[i].queued, !held, __ATOMIC_RELEASE);
+    }
+
+    replay->have_pending = false;
+    replay->pass_frames = 0;
+    replay->sequence_offset = 0;
+    replay->offset_us = 0;
+    replay->next_index = 0;
+    replay->starved_us = 0;
+    replay->refilled_us = 0;
+    replay->start_us = pipeline_time_now_us();
+    return true;
+}
+
+bool v4l2_capture_start(v4l2_capture_t* capture) {
+    if (!capture || (capture->fd < 0 && !capture->replay.file)) return false;
+
+    if (capture->streaming) {
+        return true;
+    }
+
+    if (capture->replay.file) {
+        if (!start_replay(capture)) {
+            return false;
+        }
+        drain_wake(capture);
+        __atomic_store_n(&capture->stop_requested, 0, __ATOMIC_RELEASE);
+        v4l2_capture_stats_reset(&capture->stats);
+        capture->streaming = true;
+        return true;
+    }
+
+    for (int i = 0; i < capture->buffer_count; i++) {
+        if (!__atomic_load_n(&capture->buffers[i].queued, __ATOMIC_ACQUIRE) &&
+            __atomic_load_n(&capture->buffers[i].holds, __ATOMIC_ACQUIRE) == 0 &&
+            !queue_buffer(capture, i)) {
+            return false;
+        }
+    }
+
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(capture->fd, VIDIOC_STREAMON, &type) == -1) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Failed to start capture: %s", strerror(errno));
+        return false;
+    }
+
+    drain_wake(capture);
+    __atomic_store_n(&capture->stop_requested, 0, __ATOMIC_RELEASE);
+    v4l2_capture_stats_reset(&capture->stats);
+    capture->streaming = true;
+    return true;
+}
+
+bool v4l2_capture_stop(v4l2_capture_t* capture) {
+    if (!capture || (capture->fd < 0 && !capture->replay.file)) return false;
+
+    if (!capture->streaming) {
+        return true;
+    }
+
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (capture->replay.file) {
+        struct itimerspec disarm;
+        memset(&disarm, 0, sizeof(disarm));
+        timerfd_settime(capture->replay.timer_fd, 0, &disarm, NULL);
+    } else if (xioctl(capture->fd, VIDIOC_STREAMOFF, &type) == -1) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Failed to stop capture: %s", strerror(errno));
+        return false;
+    }
+
+    for (int i = 0; i < capture->buffer_count; i++) {
+        __atomic_store_n(&capture->buffers[i].queued, false, __ATOMIC_RELEASE);
+    }
+
+    capture->streaming = false;
+    return true;
+}
+
+static bool any_buffer_queued(const v4l2_capture_t* capture) {
+    for (int i = 0; i < capture->buffer_count; i++) {
+        if (__atomic_load_n(&capture->buffers[i].queued, __ATOMIC_ACQUIRE)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool complete_dequeue(v4l2_capture_t* capture, v4l2_capture_frame_t* frame) {
+    frame->dequeue_us = pipeline_time_now_us();
+    PIPELINE_TRACE_INSTANT("dequeue", frame->sequence);
+    PIPELINE_PROBE3(capture_dequeue, frame->sequence, frame->size, frame->timestamp_us);
+
+    if (capture->recorder && !v4l2_capture_recorder_write(capture->recorder, frame)) {
+        capture->recorder = NULL;
+    }
+
+    v4l2_capture_stats_update(&capture->stats, frame, frame->dequeue_us);
+    if (!any_buffer_queued(capture)) {
+        capture->stats.starved++;
+    }
+    return true;
+}
+
+static bool replay_next_record(v4l2_capture_t* capture) {
+    v4l2_capture_replay_t* replay = &capture->replay;
+    int result = v4l2_record_read_frame(replay->file, &replay->pending);
+
+    if (result == 0 && replay->loop && replay->pass_frames > 0) {
+        uint64_t span = replay->last_timestamp_us - replay->first_timestamp_us;
+        uint64_t interval = replay->pass_frames > 1 ? span / (replay->pass_frames - 1) : 0;
+        replay->offset_us += span + interval;
+        replay->sequence_offset += replay->last_sequence - replay->first_sequence + 1;
+        replay->pass_frames = 0;
+
+        if (fseek(replay->file, replay->data_offset, SEEK_SET) != 0) {
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Failed to rewind recording: %s", strerror(errno));
+            return false;
+        }
+        result = v4l2_record_read_frame(replay->file, &replay->pending);
+    }
+
+    if (result == 0) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "End of recording");
+        __atomic_store_n(&capture->stop_requested, 1, __ATOMIC_RELEASE);
+        return false;
+    }
+
+    if (result < 0) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Truncated recording");
+        return false;
+    }
+
+    if (replay->pass_frames == 0) {
+        replay->first_sequence = replay->pending.sequence;
+        replay->first_timestamp_us = replay->pending.timestamp_us;
+        replay->last_timestamp_us = replay->pending.timestamp_us;
+    }
+    if (replay->pending.timestamp_us > replay->last_timestamp_us) {
+        replay->last_timestamp_us = replay->pending.timestamp_us;
+    }
+    replay->last_sequence = replay->pending.sequence;
+    replay->pass_frames++;
+    replay->have_pending = true;
+    return true;
+}
+
+static uint64_t replay_due_us(const v4l2_capture_replay_t* replay, uint64_t now_us) {
+    if (replay->speed <= 0.0) {
+        return now_us;
+    }
+
+    uint64_t position_us = replay->offset_us;
+    if (replay->pending.timestamp_us > replay->first_timestamp_us) {
+        position_us += replay->pending.timestamp_us - replay->first_timestamp_us;
+    }
+
+    return replay->start_us + (uint64_t)((double)position_us / replay->speed);
+}
+
+static bool replay_starved_at(const v4l2_capture_replay_t* replay, uint64_t due_us) {
+    if (replay->starved_us == 0 || due_us <= replay->starved_us) {
+        return false;
+    }
+
+    uint64_t refilled_us = __atomic_load_n(&replay->refilled_us, __ATOMIC_ACQUIRE);
+    return refilled_us != 0 && due_us < refilled_us;
+}
+
+static int replay_claim_buffer(v4l2_capture_t* capture) {
+    for (int i = 0; i < capture->buffer_count; i++) {
+        uint32_t index = (capture->replay.next_index + i) % (uint32_t)capture->buffer_count;
+        if (__atomic_load_n(&capture->buffers[index].queued, __ATOMIC_ACQUIRE)) {
+            capture->replay.next_index = (index + 1) % (uint32_t)capture->buffer_count;
+            return (int)index;
+        }
+    }
+    return -1;
+}
+
+static bool replay_fill(v4l2_capture_t* capture, uint32_t index, v4l2_capture_frame_t* frame, uint64_t due_us) {
+    v4l2_capture_replay_t* replay = &capture->replay;
+    v4l2_capture_buffer_t* buffer = &capture->buffers[index];
+    size_t size = replay->pending.size;
+
+    if (size > buffer->length) {
+        void* start = realloc(buffer->start, size);
+        if (!start) {
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Failed to allocate %zu byte replay buffer", size);
+            return false;
+        }
+        pipeline_stats_add(PIPELINE_COUNTER_ALLOCATIONS, 1);
+        buffer->start = start;
+        buffer->length = size;
+    }
+
+    if (size > 0 && fread(buffer->start, 1, size, replay->file) != size) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Truncated recording");
+        return false;
+    }
+
+    replay->have_pending = false;
+    __atomic_store_n(&buffer->queued, false, __ATOMIC_RELEASE);
+    if (!any_buffer_queued(capture)) {
+        __atomic_store_n(&replay->refilled_us, 0, __ATOMIC_RELAXED);
+        replay->starved_us = due_us;
+    }
+
+    frame->data = (const uint8_t*)buffer->start;
+    frame->size = size;
+    frame->dmabuf_fd = -1;
+    frame->index = index;
+    frame->sequence = replay->pending.sequence + replay->sequence_offset;
+    frame->flags = (replay->pending.flags & ~V4L2_BUF_FLAG_TIMESTAMP_MASK) |
+                   V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+    frame->timestamp_us = due_us;
+    return complete_dequeue(capture, frame);
+}
+
+static bool replay_dequeue(v4l2_capture_t* capture, v4l2_capture_frame_t* frame, int timeout_ms) {
+    v4l2_capture_replay_t* replay = &capture->replay;
+
+    for (;;) {
+        if (__atomic_load_n(&capture->stop_requested, __ATOMIC_ACQUIRE)) {
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Capture stopped");
+            return false;
+        }
+
+        if (!replay->have_pending && !replay_next_record(capture)) {
+            return false;
+        }
+
+        uint64_t now_us = pipeline_time_now_us();
+        uint64_t due_us = replay_due_us(replay, now_us);
+        if (due_us <= now_us) {
+            bool starved = replay->speed > 0.0 && replay_starved_at(replay, due_us);
+            int index = starved ? -1 : replay_claim_buffer(capture);
+            if (index >= 0) {
+                return replay_fill(capture, (uint32_t)index, frame, due_us);
+            }
+
+            if (replay->speed > 0.0) {
+                if (fseek(replay->file, (long)replay->pending.size, SEEK_CUR) != 0) {
+                    snprintf(capture->error_message, sizeof(capture->error_message),
+                            "Truncated recording");
+                    return false;
+                }
+                replay->have_pending = false;
+                continue;
+            }
+        } else {
+            struct itimerspec timer;
+            memset(&timer, 0, sizeof(timer));
+            timer.it_value.tv_sec = (time_t)(due_us / 1000000ULL);
+            timer.it_value.tv_nsec = (long)(due_us % 1000000ULL) * 1000L;
+            if (timerfd_settime(replay->timer_fd, TFD_TIMER_ABSTIME, &timer, NULL) == -1) {
+                snprintf(capture->error_message, sizeof(capture->error_message),
+                        "Failed to arm replay timer: %s", strerror(errno));
+                return false;
+            }
+        }
+
+        struct epoll_event events[2];
+        int count = epoll_wait(capture->epoll_fd, events, 2, timeout_ms);
+        if (count == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Failed to wait for frame: %s", strerror(errno));
+            return false;
+        }
+
+        if (count == 0) {
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Timeout waiting for frame");
+            return false;
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.fd == capture->wake_fd) {
+                drain_wake(capture);
+            } else if (events[i].data.fd == replay->timer_fd) {
+                drain_timer(capture);
+            }
+        }
+    }
+}
+
+bool v4l2_capture_dequeue(v4l2_capture_t* capture, v4l2_capture_frame_t* frame, int timeout_ms) {
+    if (!capture || !frame || !capture->streaming) {
+        if (capture) {
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Capture not streaming");
+        }
+        return false;
+    }
+
+    if (capture->replay.file) {
+        return replay_dequeue(capture, frame, timeout_ms);
+    }
+
+    for (;;) {
+        if (__atomic_load_n(&capture->stop_requested, __ATOMIC_ACQUIRE)) {
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Capture stopped");
+            return false;
+        }
+
+        struct v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+
+        if (xioctl(capture->fd, VIDIOC_DQBUF, &buf) == 0) {
+            if (buf.index >= (uint32_t)capture->buffer_count) {
+                snprintf(capture->error_message, sizeof(capture->error_message),
+                        "Driver returned invalid buffer index %u", buf.index);
+                return false;
+            }
+
+            __atomic_store_n(&capture->buffers[buf.index].queued, false, __ATOMIC_RELEASE);
+
+            frame->data = (const uint8_t*)capture->buffers[buf.index].start;
+            frame->size = buf.bytesused;
+            frame->dmabuf_fd = capture->buffers[buf.index].dmabuf_fd;
+            frame->index = buf.index;
+            frame->sequence = buf.sequence;
+            frame->flags = buf.flags;
+            frame->timestamp_us = (uint64_t)buf.timestamp.tv_sec * 1000000ULL +
+                                  (uint64_t)buf.timestamp.tv_usec;
+            return complete_dequeue(capture, frame);
+        }
+
+        if (errno != EAGAIN) {
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Failed to dequeue buffer: %s", strerror(errno));
+            return false;
+        }
+
+        struct epoll_event events[2];
+        int count = epoll_wait(capture->epoll_fd, events, 2, timeout_ms);
+        if (count == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Failed to wait for frame: %s", strerror(errno));
+            return false;
+        }
+
+        if (count == 0) {
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Timeout waiting for frame");
+            return false;
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.fd == capture->wake_fd) {
+                drain_wake(capture);
+            } else if (events[i].events & EPOLLERR) {
+                snprintf(capture->error_message, sizeof(capture->error_message),
+                        "Capture device reported an error");
+                return false;
+            }
+        }
+    }
+}
+
+bool v4l2_capture_requeue(v4l2_capture_t* capture, uint32_t index) {
+    if (!capture || index >= (uint32_t)capture->buffer_count) {
+        if (capture) {
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Invalid buffer index %u", index);
+        }
+        return false;
+    }
+
+    if (__atomic_load_n(&capture->buffers[index].queued, __ATOMIC_ACQUIRE)) {
+        return true;
+    }
+
+    if (capture->replay.file) {
+        if (!any_buffer_queued(capture)) {
+            __atomic_store_n(&capture->replay.refilled_us, pipeline_time_now_us(), __ATOMIC_RELEASE);
+        }
+        __atomic_store_n(&capture->buffers[index].queued, true, __ATOMIC_RELEASE);
+        if (capture->replay.speed <= 0.0 && capture->wake_fd >= 0) {
+            uint64_t value = 1;
+            ssize_t written = write(capture->wake_fd, &value, sizeof(value));
+            (void)written;
+        }
+        return true;
+    }
+
+    return queue_buffer(capture, index);
+}
+
+bool v4l2_capture_hold(v4l2_capture_t* capture, uint32_t index) {
+    if (!capture || index >= (uint32_t)capture->buffer_count) {
+        if (capture) {
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Invalid buffer index %u", index);
+        }
+        return false;
+    }
+
+    __atomic_fetch_add(&capture->buffers[index].holds, 1, __ATOMIC_ACQ_REL);
+    return true;
+}
+
+bool v4l2_capture_release(v4l2_capture_t* capture, uint32_t index) {
+    if (!capture || index >= (uint32_t)capture->buffer_count) {
+        if (capture) {
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Invalid buffer index %u", index);
+        }
+        return false;
+    }
+
+    if (__atomic_sub_fetch(&capture->buffers[index].holds, 1, __ATOMIC_ACQ_REL) > 0) {
+        return true;
+    }
+
+    return v4l2_capture_requeue(capture, index);
+}
+
+bool v4l2_capture_run(v4l2_capture_t* capture, v4l2_capture_callback_t callback, void* userdata) {
+    if (!capture || !callback) {
+        if (capture) {
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Invalid parameters");
+        }
+        return false;
+    }
+
+    if (!v4l2_capture_start(capture)) {
+        return false;
+    }
+
+    for (;;) {
+        v4l2_capture_frame_t frame;
+        if (!v4l2_capture_dequeue(capture, &frame, -1)) {
+            return __atomic_load_n(&capture->stop_requested, __ATOMIC_ACQUIRE) != 0;
+        }
+
+        v4l2_capture_hold(capture, frame.index);
+        bool keep_running = callback(&frame, userdata);
+
+        if (!v4l2_capture_release(capture, frame.index)) {
+            return false;
+        }
+
+        if (!keep_running) {
+            return true;
+        }
+    }
+}
+
+bool v4l2_capture_set_control(v4l2_capture_t* capture, uint32_t id, int32_t value) {
+    if (!capture) return false;
+
+    if (capture->replay.file) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Controls are not available during replay");
+        return false;
+    }
+
+    if (capture->fd < 0) return false;
+
+    struct v4l2_control control;
+    memset(&control, 0, sizeof(control));
+    control.id = id;
+    control.value = value;
+
+    if (xioctl(capture->fd, VIDIOC_S_CTRL, &control) == -1) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Failed to set control 0x%08x: %s", id, strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+bool v4l2_capture_get_control(v4l2_capture_t* capture, uint32_t id, int32_t* value) {
+    if (!capture) return false;
+
+    if (capture->replay.file) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Controls are not available during replay");
+        return false;
+    }
+
+    if (capture->fd < 0 || !value) return false;
+
+    struct v4l2_control control;
+    memset(&control, 0, sizeof(control));
+    control.id = id;
+
+    if (xioctl(capture->fd, VIDIOC_G_CTRL, &control) == -1) {
+        snprintf(capture->error_message, sizeof(capture->error_message),
+                "Failed to get control 0x%08x: %s", id, strerror(errno));
+        return false;
+    }
+
+    *value = control.value;
+    return true;
+}
+
+bool v4l2_capture_force_keyframe(v4l2_capture_t* capture) {
+    return v4l2_capture_set_control(capture, V4L2_CID_MPEG_VIDEO_FORCE_KEY_FRAME, 1);
+}
+
+bool v4l2_capture_set_repeat_sequence_header(v4l2_capture_t* capture, bool enabled) {
+    return v4l2_capture_set_control(capture, V4L2_CID_MPEG_VIDEO_REPEAT_SEQ_HEADER, enabled ? 1 : 0);
+}
+
+bool v4l2_capture_set_i_period(v4l2_capture_t* capture, int period) {
+    if (period < 0) {
+        if (capture) {
+            snprintf(capture->error_message, sizeof(capture->error_message),
+                    "Invalid I-frame period: %d", period);
+        }
+        return false;
+    }
+
+    return v4l2_capture_set_control(capture, V4L2_CID_MPEG_VIDEO_H264_I_PERIOD, period);
+}
+
+void v4l2_capture_request_stop(v4l2_capture_t* capture) {
+    if (!capture) return;
+
+    __atomic_store_n(&capture->stop_requested, 1, __ATOMIC_RELEASE);
+
+    if (capture->wake_fd >= 0) {
+        uint64_t value = 1;
+        ssize_t written = write(capture->wake_fd, &value, sizeof(value));
+        (void)written;
+    }
+}
+
+void v4l2_capture_set_recorder(v4l2_capture_t* capture, v4l2_capture_recorder_t* recorder) {
+    if (!capture) return;
+
+    capture->recorder = recorder;
+}
+
+const char* v4l2_capture_get_error(const v4l2_capture_t* capture) {
+    if (!capture) return "Invalid capture context";
+    return capture->error_message;
+}
+
+void v4l2_capture_stats_reset(v4l2_capture_stats_t* stats) {
+    if (!stats) return;
+
+    memset(stats, 0, sizeof(v4l2_capture_stats_t));
+}
+
+void v4l2_capture_stats_update(v4l2_capture_stats_t* stats,
+                               const v4l2_capture_frame_t* frame,
+                               uint64_t dequeue_us) {
+    if (!stats || !frame) return;
+
+    stats->frames++;
+    if (frame->flags & V4L2_BUF_FLAG_ERROR) {
+        stats->error_frames++;
+    }
+
+    bool monotonic = (frame->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+    if (monotonic && dequeue_us >= frame->timestamp_us) {
+        pipeline_histogram_add(&stats->latency, dequeue_us - frame->timestamp_us);
+    }
+
+    if (stats->have_last) {
+        if (frame->sequence > stats->last_sequence + 1) {
+            stats->sequence_gaps++;
+            stats->frames_lost += frame->sequence - stats->last_sequence - 1;
+        } else if (frame->sequence != stats->last_sequence + 1) {
+            stats->sequence_resets++;
+        }
+
+        if (frame->timestamp_us <= stats->last_timestamp_us) {
+            stats->timestamp_regressions++;
+        } else if (frame->sequence == stats->last_sequence + 1) {
+            uint64_t interval = frame->timestamp_us - stats->last_timestamp_us;
+            pipeline_histogram_add(&stats->interval, interval);
+
+            if (stats->expected_interval_us == 0) {
+                stats->expected_interval_us = interval;
+            } else {
+                uint64_t jitter = interval > stats->expected_interval_us ?
+                    interval - stats->expected_interval_us : stats->expected_interval_us - interval;
+                pipeline_histogram_add(&stats->jitter, jitter);
+                stats->expected_interval_us = (stats->expected_interval_us * 15 + interval) / 16;
+            }
+        }
+    }
+
+    stats->have_last = true;
+    stats->last_sequence = frame->sequence;
+    stats->last_timestamp_us = frame->timestamp_us;
+}
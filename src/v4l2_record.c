@@ -0,0 +1,144 @@
+#include "v4l2_record.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+static void put_u32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+static void put_u64(uint8_t* out, uint64_t value) {
+    put_u32(out, (uint32_t)value);
+    put_u32(out + 4, (uint32_t)(value >> 32));
+}
+
+static uint32_t get_u32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) |
+           ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static uint64_t get_u64(const uint8_t* in) {
+    return (uint64_t)get_u32(in) | ((uint64_t)get_u32(in + 4) << 32);
+}
+
+bool v4l2_record_read_header(FILE* file, int* width, int* height, uint32_t* pixelformat) {
+    uint8_t header[V4L2_RECORD_HEADER_SIZE];
+
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        memcmp(header, V4L2_CAPTURE_RECORD_MAGIC, 8) != 0 ||
+        get_u32(header + 8) != V4L2_CAPTURE_RECORD_VERSION) {
+        return false;
+    }
+
+    uint32_t record_width = get_u32(header + 12);
+    uint32_t record_height = get_u32(header + 16);
+    if (record_width == 0 || record_height == 0 || record_width > 65535 || record_height > 65535) {
+        return false;
+    }
+
+    *width = (int)record_width;
+    *height = (int)record_height;
+    *pixelformat = get_u32(header + 20);
+    return true;
+}
+
+int v4l2_record_read_frame(FILE* file, v4l2_capture_record_t* record) {
+    uint8_t header[V4L2_RECORD_FRAME_HEADER_SIZE];
+
+    size_t count = fread(header, 1, sizeof(header), file);
+    if (count == 0 && feof(file)) {
+        return 0;
+    }
+    if (count != sizeof(header)) {
+        return -1;
+    }
+
+    record->timestamp_us = get_u64(header);
+    record->sequence = get_u32(header + 8);
+    record->flags = get_u32(header + 12);
+    record->size = get_u32(header + 16);
+    return 1;
+}
+
+bool v4l2_capture_recorder_init(v4l2_capture_recorder_t* recorder,
+                                const char* path,
+                                const v4l2_capture_t* capture) {
+    if (!recorder) return false;
+
+    memset(recorder, 0, sizeof(v4l2_capture_recorder_t));
+
+    if (!path || !capture || capture->width <= 0 || capture->height <= 0) {
+        snprintf(recorder->error_message, sizeof(recorder->error_message),
+                "Invalid parameters");
+        return false;
+    }
+
+    recorder->file = fopen(path, "wb");
+    if (!recorder->file) {
+        snprintf(recorder->error_message, sizeof(recorder->error_message),
+                "Failed to create %s: %s", path, strerror(errno));
+        return false;
+    }
+
+    uint8_t header[V4L2_RECORD_HEADER_SIZE];
+    memcpy(header, V4L2_CAPTURE_RECORD_MAGIC, 8);
+    put_u32(header + 8, V4L2_CAPTURE_RECORD_VERSION);
+    put_u32(header + 12, (uint32_t)capture->width);
+    put_u32(header + 16, (uint32_t)capture->height);
+    put_u32(header + 20, capture->pixelformat);
+
+    if (fwrite(header, 1, sizeof(header), recorder->file) != sizeof(header)) {
+        snprintf(recorder->error_message, sizeof(recorder->error_message),
+                "Failed to write %s: %s", path, strerror(errno));
+        v4l2_capture_recorder_cleanup(recorder);
+        return false;
+    }
+
+    recorder->bytes = sizeof(header);
+    return true;
+}
+
+void v4l2_capture_recorder_cleanup(v4l2_capture_recorder_t* recorder) {
+    if (!recorder) return;
+
+    if (recorder->file) {
+        fclose(recorder->file);
+        recorder->file = NULL;
+    }
+}
+
+bool v4l2_capture_recorder_write(v4l2_capture_recorder_t* recorder, const v4l2_capture_frame_t* frame) {
+    if (!recorder || !frame || !recorder->file || frame->size > UINT32_MAX ||
+        (frame->size > 0 && !frame->data)) {
+        if (recorder) {
+            snprintf(recorder->error_message, sizeof(recorder->error_message),
+                    "Invalid parameters");
+        }
+        return false;
+    }
+
+    uint8_t header[V4L2_RECORD_FRAME_HEADER_SIZE];
+    put_u64(header, frame->timestamp_us);
+    put_u32(header + 8, frame->sequence);
+    put_u32(header + 12, frame->flags);
+    put_u32(header + 16, (uint32_t)frame->size);
+
+    if (fwrite(header, 1, sizeof(header), recorder->file) != sizeof(header) ||
+        (frame->size > 0 && fwrite(frame->data, 1, frame->size, recorder->file) != frame->size)) {
+        snprintf(recorder->error_message, sizeof(recorder->error_message),
+                "Failed to write frame %u: %s", frame->sequence, strerror(errno));
+        return false;
+    }
+
+    recorder->frames++;
+    recorder->bytes += sizeof(header) + frame->size;
+    return true;
+}
+
+const char* v4l2_capture_recorder_get_error(const v4l2_capture_recorder_t* recorder) {
+    if (!recorder) return "Invalid recorder context";
+    return recorder->error_message;
+}
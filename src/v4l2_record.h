@@ -0,0 +1,12 @@
+#ifndef V4L2_RECORD_H
+#define V4L2_RECORD_H
+
+#include "v4l2_capture.h"
+
+#define V4L2_RECORD_HEADER_SIZE 24
+#define V4L2_RECORD_FRAME_HEADER_SIZE 20
+
+bool v4l2_record_read_header(FILE* file, int* width, int* height, uint32_t* pixelformat);
+int v4l2_record_read_frame(FILE* file, v4l2_capture_record_t* record);
+
+#endif // V4L2_RECORD_H
@@ -0,0 +1,181 @@
+#include "yuv_convert.h"
+#include "pipeline_stats.h"
+#include "pipeline_kernels.h"
+#include <string.h>
+
+void yuv_copy_plane(uint8_t* dst, int dst_stride,
+                    const uint8_t* src, int src_stride,
+                    int width, int height) {
+    if (!dst || !src || width <= 0 || height <= 0) return;
+
+    if (dst_stride == width && src_stride == width) {
+        memcpy(dst, src, (size_t)width * height);
+    } else {
+        for (int row = 0; row < height; row++) {
+            memcpy(dst + (size_t)row * dst_stride, src + (size_t)row * src_stride, width);
+        }
+    }
+
+    pipeline_stats_add(PIPELINE_COUNTER_BYTES_COPIED, (uint64_t)width * height);
+}
+
+void yuv_interleave_chroma(uint8_t* uv, int uv_stride,
+                           const uint8_t* u, int u_stride,
+                           const uint8_t* v, int v_stride,
+                           int width, int height) {
+    if (!uv || !u || !v || width <= 0 || height <= 0) return;
+
+    const pipeline_kernels_t* kernels = pipeline_kernels();
+    for (int row = 0; row < height; row++) {
+        kernels->interleave_row(uv + (size_t)row * uv_stride, u + (size_t)row * u_stride,
+                                v + (size_t)row * v_stride, width);
+    }
+
+    pipeline_stats_add(PIPELINE_COUNTER_BYTES_COPIED, (uint64_t)width * height * 2);
+}
+
+void yuv_deinterleave_chroma(uint8_t* u, int u_stride,
+                             uint8_t* v, int v_stride,
+                             const uint8_t* uv, int uv_stride,
+                             int width, int height) {
+    if (!u || !v || !uv || width <= 0 || height <= 0) return;
+
+    const pipeline_kernels_t* kernels = pipeline_kernels();
+    for (int row = 0; row < height; row++) {
+        kernels->deinterleave_row(u + (size_t)row * u_stride, v + (size_t)row * v_stride,
+                                  uv + (size_t)row * uv_stride, width);
+    }
+
+    pipeline_stats_add(PIPELINE_COUNTER_BYTES_COPIED, (uint64_t)width * height * 2);
+}
+
+void yuv_yuyv_to_i420(uint8_t* y, int y_stride,
+                      uint8_t* u, int u_stride,
+                      uint8_t* v, int v_stride,
+                      const uint8_t* yuyv, int yuyv_stride,
+                      int width, int height) {
+    if (!y || !u || !v || !yuyv || width <= 0 || height <= 0) return;
+
+    const pipeline_kernels_t* kernels = pipeline_kernels();
+    for (int row = 0; row + 1 < height; row += 2) {
+        const uint8_t* src = yuyv + (size_t)row * yuyv_stride;
+        kernels->yuyv_to_i420_rows(y + (size_t)row * y_stride, y + (size_t)(row + 1) * y_stride,
+                                   u + (size_t)(row / 2) * u_stride, v + (size_t)(row / 2) * v_stride,
+                                   src, src + yuyv_stride, width);
+    }
+
+    pipeline_stats_add(PIPELINE_COUNTER_BYTES_COPIED, (uint64_t)width * height * 2);
+}
+
+static uint32_t fourcc(char a, char b, char c, char d) {
+    return (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+}
+
+bool yuv_image_init(yuv_image_t* image, yuv_format_t format, int width, int height,
+                    const uint8_t* data, int stride) {
+    if (!image || !data) return false;
+
+    memset(image, 0, sizeof(yuv_image_t));
+    image->format = format;
+    image->width = width;
+    image->height = height;
+    image->planes[0] = data;
+
+    switch (format) {
+        case YUV_FORMAT_I420:
+            image->strides[0] = stride > 0 ? stride : width;
+            image->strides[1] = image->strides[0] / 2;
+            image->strides[2] = image->strides[0] / 2;
+            image->planes[1] = data + (size_t)image->strides[0] * height;
+            image->planes[2] = image->planes[1] + (size_t)image->strides[1] * (height / 2);
+            break;
+        case YUV_FORMAT_NV12:
+            image->strides[0] = stride > 0 ? stride : width;
+            image->strides[1] = image->strides[0];
+            image->planes[1] = data + (size_t)image->strides[0] * height;
+            break;
+        case YUV_FORMAT_YUYV:
+            image->strides[0] = stride > 0 ? stride : width * 2;
+            break;
+        default:
+            return false;
+    }
+
+    return yuv_image_validate(image);
+}
+
+void yuv_image_from_frame(yuv_image_t* image, const yuv420_frame_t* frame) {
+    if (!image || !frame) return;
+
+    memset(image, 0, sizeof(yuv_image_t));
+    image->format = YUV_FORMAT_I420;
+    image->width = frame->width;
+    image->height = frame->height;
+    image->planes[0] = frame->y_plane;
+    image->planes[1] = frame->u_plane;
+    image->planes[2] = frame->v_plane;
+    image->strides[0] = frame->width;
+    image->strides[1] = frame->width / 2;
+    image->strides[2] = frame->width / 2;
+}
+
+bool yuv_image_validate(const yuv_image_t* image) {
+    if (!image || !image->planes[0]) return false;
+
+    int width = image->width;
+    int height = image->height;
+    if (width < 2 || height < 2 || (width & 1) || (height & 1)) return false;
+
+    switch (image->format) {
+        case YUV_FORMAT_I420:
+            return image->planes[1] && image->planes[2] && image->strides[0] >= width &&
+                   image->strides[1] >= width / 2 && image->strides[2] >= width / 2;
+        case YUV_FORMAT_NV12:
+            return image->planes[1] && image->strides[0] >= width && image->strides[1] >= width;
+        case YUV_FORMAT_YUYV:
+            return image->strides[0] >= width * 2;
+        default:
+            return false;
+    }
+}
+
+bool yuv_image_crop(yuv_image_t* image, int x, int y, int width, int height) {
+    if (!yuv_image_validate(image) || x < 0 || y < 0 || width < 2 || height < 2 ||
+        ((x | y | width | height) & 1) || width > image->width - x || height > image->height - y) {
+        return false;
+    }
+
+    switch (image->format) {
+        case YUV_FORMAT_I420:
+            image->planes[0] += (size_t)y * image->strides[0] + x;
+            image->planes[1] += (size_t)(y / 2) * image->strides[1] + x / 2;
+            image->planes[2] += (size_t)(y / 2) * image->strides[2] + x / 2;
+            break;
+        case YUV_FORMAT_NV12:
+            image->planes[0] += (size_t)y * image->strides[0] + x;
+            image->planes[1] += (size_t)(y / 2) * image->strides[1] + x;
+            break;
+        default:
+            image->planes[0] += (size_t)y * image->strides[0] + 2 * x;
+            break;
+    }
+
+    image->width = width;
+    image->height = height;
+    return true;
+}
+
+bool yuv_format_from_fourcc(uint32_t code, yuv_format_t* format) {
+    if (!format) return false;
+
+    if (code == fourcc('Y', 'U', '1', '2')) {
+        *format = YUV_FORMAT_I420;
+    } else if (code == fourcc('N', 'V', '1', '2')) {
+        *format = YUV_FORMAT_NV12;
+    } else if (code == fourcc('Y', 'U', 'Y', 'V')) {
+        *format = YUV_FORMAT_YUYV;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,197 @@
+#define _GNU_SOURCE
+#include "yuv_rotate.h"
+#include "pipeline_stats.h"
+#include "pipeline_time.h"
+#include "pipeline_kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TILE 8
+#define BLOCK 64
+
+static void transpose_plane(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride,
+                            int width, int height, const pipeline_kernels_t* kernels) {
+    int tiled_width = width & ~(TILE - 1);
+    int tiled_height = height & ~(TILE - 1);
+
+    for (int by = 0; by < tiled_height; by += BLOCK) {
+        int block_height = tiled_height - by < BLOCK ? tiled_height - by : BLOCK;
+        for (int bx = 0; bx < tiled_width; bx += BLOCK) {
+            int block_width = tiled_width - bx < BLOCK ? tiled_width - bx : BLOCK;
+            for (int y = by; y < by + block_height; y += TILE) {
+                for (int x = bx; x < bx + block_width; x += TILE) {
+                    kernels->transpose_8x8(dst + (ptrdiff_t)x * dst_stride + y, dst_stride,
+                                           src + (ptrdiff_t)y * src_stride + x, src_stride);
+                }
+            }
+        }
+    }
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = src + (ptrdiff_t)y * src_stride;
+        for (int x = y < tiled_height ? tiled_width : 0; x < width; x++) {
+            dst[(ptrdiff_t)x * dst_stride + y] = row[x];
+        }
+    }
+}
+
+bool yuv_orientation_valid(yuv_rotation_t rotation, yuv_flip_t flip) {
+    return (rotation == YUV_ROTATE_0 || rotation == YUV_ROTATE_90 ||
+            rotation == YUV_ROTATE_180 || rotation == YUV_ROTATE_270) &&
+           (unsigned)flip <= YUV_FLIP_BOTH;
+}
+
+bool yuv_orient_plane(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride,
+                      int width, int height, yuv_rotation_t rotation, yuv_flip_t flip) {
+    if (!dst || !src || width <= 0 || height <= 0 || !yuv_orientation_valid(rotation, flip)) {
+        return false;
+    }
+
+    const pipeline_kernels_t* kernels = pipeline_kernels();
+    bool horizontal = (flip & YUV_FLIP_HORIZONTAL) != 0;
+    bool vertical = (flip & YUV_FLIP_VERTICAL) != 0;
+
+    if (rotation == YUV_ROTATE_0 || rotation == YUV_ROTATE_180) {
+        bool reverse_rows = vertical != (rotation == YUV_ROTATE_180);
+        bool reverse_columns = horizontal != (rotation == YUV_ROTATE_180);
+        for (int y = 0; y < height; y++) {
+            const uint8_t* row = src + (size_t)(reverse_rows ? height - 1 - y : y) * src_stride;
+            uint8_t* out = dst + (size_t)y * dst_stride;
+            if (reverse_columns) {
+                kernels->reverse_row(out, row, width);
+            } else {
+                memcpy(out, row, width);
+            }
+        }
+        return true;
+    }
+
+    if (vertical != (rotation == YUV_ROTATE_90)) {
+        src += (size_t)(height - 1) * src_stride;
+        src_stride = -src_stride;
+    }
+    if (horizontal != (rotation == YUV_ROTATE_270)) {
+        dst += (size_t)(width - 1) * dst_stride;
+        dst_stride = -dst_stride;
+    }
+    transpose_plane(dst, dst_stride, src, src_stride, width, height, kernels);
+    return true;
+}
+
+bool yuv_rotator_init(yuv_rotator_t* rotator) {
+    if (!rotator) return false;
+
+    memset(rotator, 0, sizeof(yuv_rotator_t));
+    return true;
+}
+
+void yuv_rotator_cleanup(yuv_rotator_t* rotator) {
+    if (!rotator) return;
+
+    free(rotator->buffer);
+
+    char message[sizeof(rotator->error_message)];
+    memcpy(message, rotator->error_message, sizeof(message));
+    memset(rotator, 0, sizeof(yuv_rotator_t));
+    memcpy(rotator->error_message, message, sizeof(message));
+}
+
+static bool reserve_frame(yuv_rotator_t* rotator, int width, int height) {
+    size_t bytes = (size_t)width * height * 3 / 2;
+    if (bytes > rotator->buffer_capacity) {
+        uint8_t* grown = realloc(rotator->buffer, bytes);
+        pipeline_stats_add(PIPELINE_COUNTER_ALLOCATIONS, 1);
+        if (!grown) {
+            snprintf(rotator->error_message, sizeof(rotator->error_message),
+                    "Failed to allocate rotated frame");
+            return false;
+        }
+        rotator->buffer = grown;
+        rotator->buffer_capacity = bytes;
+    }
+
+    yuv420_frame_t* frame = &rotator->frame;
+    frame->width = width;
+    frame->height = height;
+    frame->y_size = width * height;
+    frame->uv_size = (width / 2) * (height / 2);
+    frame->y_plane = rotator->buffer;
+    frame->u_plane = frame->y_plane + frame->y_size;
+    frame->v_plane = frame->u_plane + frame->uv_size;
+    return true;
+}
+
+bool yuv_rotator_rotate_image(yuv_rotator_t* rotator,
+                              const yuv_image_t* src,
+                              yuv_rotation_t rotation,
+                              yuv_flip_t flip,
+                              const yuv420_frame_t** rotated) {
+    if (!rotator || !src || !rotated) {
+        if (rotator) {
+            snprintf(rotator->error_message, sizeof(rotator->error_message),
+                    "Invalid parameters");
+        }
+        return false;
+    }
+
+    if (!yuv_orientation_valid(rotation, flip)) {
+        snprintf(rotator->error_message, sizeof(rotator->error_message),
+                "Invalid orientation: rotation %d, flip %d", (int)rotation, (int)flip);
+        return false;
+    }
+
+    if (src->format != YUV_FORMAT_I420 || !yuv_image_validate(src)) {
+        snprintf(rotator->error_message, sizeof(rotator->error_message),
+                "Invalid YUV frame data");
+        return false;
+    }
+
+    bool transposed = rotation == YUV_ROTATE_90 || rotation == YUV_ROTATE_270;
+    int width = transposed ? src->height : src->width;
+    int height = transposed ? src->width : src->height;
+    if (!reserve_frame(rotator, width, height)) {
+        return false;
+    }
+
+    uint64_t start_us = pipeline_time_now_us();
+    const yuv420_frame_t* dst = &rotator->frame;
+    yuv_orient_plane(dst->y_plane, dst->width, src->planes[0], src->strides[0],
+                     src->width, src->height, rotation, flip);
+    yuv_orient_plane(dst->u_plane, dst->width / 2, src->planes[1], src->strides[1],
+                     src->width / 2, src->height / 2, rotation, flip);
+    yuv_orient_plane(dst->v_plane, dst->width / 2, src->planes[2], src->strides[2],
+                     src->width / 2, src->height / 2, rotation, flip);
+
+    pipeline_stats_record(PIPELINE_METRIC_ROTATE, pipeline_time_now_us() - start_us);
+    *rotated = dst;
+    return true;
+}
+
+bool yuv_rotator_rotate(yuv_rotator_t* rotator,
+                        const yuv420_frame_t* src,
+                        yuv_rotation_t rotation,
+                        yuv_flip_t flip,
+                        const yuv420_frame_t** rotated) {
+    if (!rotator || !src || !rotated) {
+        if (rotator) {
+            snprintf(rotator->error_message, sizeof(rotator->error_message),
+                    "Invalid parameters");
+        }
+        return false;
+    }
+
+    if (rotation == YUV_ROTATE_0 && flip == YUV_FLIP_NONE) {
+        *rotated = src;
+        return true;
+    }
+
+    yuv_image_t image;
+    yuv_image_from_frame(&image, src);
+    return yuv_rotator_rotate_image(rotator, &image, rotation, flip, rotated);
+}
+
+const char* yuv_rotator_get_error(const yuv_rotator_t* rotator) {
+    if (!rotator) return "Invalid rotator context";
+    return rotator->error_message;
+}
@@ -0,0 +1,706 @@
+#define _GNU_SOURCE
+#include "yuv_scale.h"
+#include "yuv_convert.h"
+#include "pipeline_stats.h"
+#include "pipeline_time.h"
+#include "pipeline_kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FILTER_ONE (1 << PIPELINE_FILTER_BITS)
+
+typedef struct {
+    int* starts;
+    int* counts;
+    int16_t* weights;
+    int taps;
+} filter_t;
+
+static int filter_taps(int src, int dst) {
+    return src > dst ? (src + dst - 1) / dst + 1 : 2;
+}
+
+static void normalize_weights(int16_t* weights, int count) {
+    int sum = 0;
+    int largest = 0;
+    for (int k = 0; k < count; k++) {
+        sum += weights[k];
+        if (weights[k] > weights[largest]) {
+            largest = k;
+        }
+    }
+    weights[largest] = (int16_t)(weights[largest] + FILTER_ONE - sum);
+}
+
+static void build_filter(filter_t* filter, int src, int dst) {
+    for (int i = 0; i < dst; i++) {
+        int16_t* weights = filter->weights + (size_t)i * filter->taps;
+        int start;
+        int count;
+
+        if (src >= dst) {
+            int64_t begin = (int64_t)i * src;
+            int64_t end = begin + src;
+            start = (int)(begin / dst);
+            count = (int)((end - 1) / dst) - start + 1;
+            for (int k = 0; k < count; k++) {
+                int64_t low = (int64_t)(start + k) * dst;
+                int64_t high = low + dst;
+                int64_t overlap = (high < end ? high : end) - (low > begin ? low : begin);
+                weights[k] = (int16_t)(overlap * FILTER_ONE / src);
+            }
+        } else {
+            int64_t center = (int64_t)(2 * i + 1) * src - dst;
+            if (center < 0) {
+                center = 0;
+            }
+            start = (int)(center / (2 * dst));
+            int fraction = (int)(center % (2 * dst) * FILTER_ONE / (2 * dst));
+            count = fraction && start + 1 < src ? 2 : 1;
+            weights[0] = (int16_t)(FILTER_ONE - fraction);
+            weights[1] = (int16_t)fraction;
+        }
+
+        normalize_weights(weights, count);
+        filter->starts[i] = start;
+        filter->counts[i] = count;
+    }
+}
+
+static void filter_columns(uint8_t* dst, const uint8_t* row, const filter_t* filter, int width) {
+    for (int x = 0; x < width; x++) {
+        const uint8_t* pixels = row + filter->starts[x];
+        const int16_t* weights = filter->weights + (size_t)x * filter->taps;
+        int32_t sum = 1 << (PIPELINE_FILTER_BITS - 1);
+        for (int k = 0; k < filter->counts[x]; k++) {
+            sum += weights[k] * pixels[k];
+        }
+        dst[x] = (uint8_t)(sum >> PIPELINE_FILTER_BITS);
+    }
+}
+
+bool yuv_scale_plane(uint8_t* dst, int dst_stride, int dst_width, int dst_height,
+                     const uint8_t* src, int src_stride, int src_width, int src_height) {
+    if (!dst || !src || dst_width <= 0 || dst_height <= 0 || src_width <= 0 || src_height <= 0) {
+        return false;
+    }
+
+    filter_t columns;
+    filter_t rows;
+    columns.taps = filter_taps(src_width, dst_width);
+    rows.taps = filter_taps(src_height, dst_height);
+
+    size_t bytes = (size_t)rows.taps * sizeof(const uint8_t*) +
+                   (size_t)(dst_width + dst_height) * 2 * sizeof(int) +
+                   ((size_t)dst_width * columns.taps + (size_t)dst_height * rows.taps) * sizeof(int16_t) +
+                   (size_t)src_width;
+    uint8_t* scratch = malloc(bytes);
+    pipeline_stats_add(PIPELINE_COUNTER_ALLOCATIONS, 1);
+    if (!scratch) {
+        return false;
+    }
+
+    const uint8_t** lines = (const uint8_t**)scratch;
+    columns.starts = (int*)(lines + rows.taps);
+    columns.counts = columns.starts + dst_width;
+    rows.starts = columns.counts + dst_width;
+    rows.counts = rows.starts + dst_height;
+    columns.weights = (int16_t*)(rows.counts + dst_height);
+    rows.weights = columns.weights + (size_t)dst_width * columns.taps;
+    uint8_t* row_buffer = (uint8_t*)(rows.weights + (size_t)dst_height * rows.taps);
+
+    build_filter(&columns, src_width, dst_width);
+    build_filter(&rows, src_height, dst_height);
+
+    const pipeline_kernels_t* kernels = pipeline_kernels();
+    for (int y = 0; y < dst_height; y++) {
+        for (int k = 0; k < rows.counts[y]; k++) {
+            lines[k] = src + (size_t)(rows.starts[y] + k) * src_stride;
+        }
+
+        uint8_t* out = dst + (size_t)y * dst_stride;
+        const int16_t* weights = rows.weights + (size_t)y * rows.taps;
+        if (dst_width == src_width) {
+            kernels->filter_rows(out, lines, weights, rows.counts[y], src_width);
+        } else {
+            kernels->filter_rows(row_buffer, lines, weights, rows.counts[y], src_width);
+            filter_columns(out, row_buffer, &columns, dst_width);
+        }
+    }
+
+    free(scratch);
+    return true;
+}
+
+static int round_even(int64_t numerator, int64_t denominator) {
+    int64_t value = (numerator + denominator) / (2 * denominator) * 2;
+    return value < 2 ? 2 : (int)value;
+}
+
+bool yuv_scale_plan(int src_width, int src_height, int target_width, int target_height,
+                    yuv_scale_aspect_t aspect, yuv_rect_t* source, int* width, int* height) {
+    if (!source || !width || !height) return false;
+
+    if (src_width < 2 || src_height < 2 || (src_width & 1) || (src_height & 1) ||
+        target_width < 0 || target_height < 0 || target_width > 65535 || target_height > 65535 ||
+        (unsigned)aspect > YUV_SCALE_FILL) {
+        return false;
+    }
+
+    source->x = 0;
+    source->y = 0;
+    source->width = src_width;
+    source->height = src_height;
+
+    if (target_width == 0 && target_height == 0) {
+        *width = src_width;
+        *height = src_height;
+        return true;
+    }
+
+    if (target_width == 0) {
+        target_width = round_even((int64_t)src_width * target_height, src_height);
+    } else if (target_height == 0) {
+        target_height = round_even((int64_t)src_height * target_width, src_width);
+    }
+
+    bool wider = (int64_t)src_width * target_height > (int64_t)src_height * target_width;
+    switch (aspect) {
+        case YUV_SCALE_FIT:
+            if (wider) {
+                target_height = round_even((int64_t)src_height * target_width, src_width);
+            } else {
+                target_width = round_even((int64_t)src_width * target_height, src_height);
+            }
+            break;
+        case YUV_SCALE_FILL:
+            if (wider) {
+                source->width = round_even((int64_t)src_height * target_width, target_height);
+                source->x = (src_width - source->width) / 4 * 2;
+            } else {
+                source->height = round_even((int64_t)src_width * target_height, target_width);
+                source->y = (src_height - source->height) / 4 * 2;
+            }
+            break;
+        default:
+            break;
+    }
+
+    *width = round_even(target_width, 1);
+    *height = round_even(target_height, 1);
+    return *width <= 65535 && *height <= 65535;
+}
+
+bool yuv_rect_align(yuv_rect_t* rect, int width, int height, int alignment) {
+    if (!rect || alignment < 2 || (alignment & (alignment - 1)) || rect->x < 0 || rect->y < 0 ||
+        rect->width <= 0 || rect->height <= 0) {
+        return false;
+    }
+
+    int64_t mask = alignment - 1;
+    int64_t left = rect->x & ~mask;
+    int64_t top = rect->y & ~mask;
+    int64_t right = ((int64_t)rect->x + rect->width + mask) & ~mask;
+    int64_t bottom = ((int64_t)rect->y + rect->height + mask) & ~mask;
+    if (right > width) right = width;
+    if (bottom > height) bottom = height;
+    if (right - left < 2 || bottom - top < 2) return false;
+
+    rect->x = (int)left;
+    rect->y = (int)top;
+    rect->width = (int)(right - left);
+    rect->height = (int)(bottom - top);
+    return true;
+}
+
+static bool reserve_frame(yuv_scaler_t* scaler, int width, int height) {
+    size_t bytes = (size_t)width * height * 3 / 2;
+    if (bytes > scaler->buffer_capacity) {
+        uint8_t* grown = realloc(scaler->buffer, bytes);
+        pipeline_stats_add(PIPELINE_COUNTER_ALLOCATIONS, 1);
+        if (!grown) {
+            snprintf(scaler->error_message, sizeof(scaler->error_message),
+                    "Failed to allocate scaled frame");
+            return false;
+        }
+        scaler->buffer = grown;
+        scaler->buffer_capacity = bytes;
+    }
+
+    yuv420_frame_t* frame = &scaler->frame;
+    frame->width = width;
+    frame->height = height;
+    frame->y_size = width * height;
+    frame->uv_size = (width / 2) * (height / 2);
+    frame->y_plane = scaler->buffer;
+    frame->u_plane = frame->y_plane + frame->y_size;
+    frame->v_plane = frame->u_plane + frame->uv_size;
+    return true;
+}
+
+static bool scale_software(yuv_scaler_t* scaler, const yuv420_frame_t* src, const yuv_rect_t* rect) {
+    const yuv420_frame_t* dst = &scaler->frame;
+    int chroma_stride = src->width / 2;
+    size_t chroma_offset = (size_t)(rect->y / 2) * chroma_stride + rect->x / 2;
+
+    if (!yuv_scale_plane(dst->y_plane, dst->width, dst->width, dst->height,
+                         src->y_plane + (size_t)rect->y * src->width + rect->x, src->width,
+                         rect->width, rect->height) ||
+        !yuv_scale_plane(dst->u_plane, dst->width / 2, dst->width / 2, dst->height / 2,
+                         src->u_plane + chroma_offset, chroma_stride, rect->width / 2, rect->height / 2) ||
+        !yuv_scale_plane(dst->v_plane, dst->width / 2, dst->width / 2, dst->height / 2,
+                         src->v_plane + chroma_offset, chroma_stride, rect->width / 2, rect->height / 2)) {
+        snprintf(scaler->error_message, sizeof(scaler->error_message),
+                "Failed to allocate scaler filter");
+        return false;
+    }
+
+    return true;
+}
+
+#ifdef RASPBERRY_PI
+#ifndef NO_HARDWARE
+static void output_callback(MMAL_PORT_T* port, MMAL_BUFFER_HEADER_T* buffer) {
+    yuv_scaler_t* scaler = (yuv_scaler_t*)port->userdata;
+
+    if (!scaler || buffer->cmd != 0) {
+        mmal_buffer_header_release(buffer);
+        return;
+    }
+
+    mmal_queue_put(scaler->output_queue, buffer);
+    vcos_semaphore_post(&scaler->output_semaphore);
+}
+
+static void input_callback(MMAL_PORT_T* port, MMAL_BUFFER_HEADER_T* buffer) {
+    mmal_buffer_header_release(buffer);
+}
+
+static void drain_output(yuv_scaler_t* scaler) {
+    MMAL_BUFFER_HEADER_T* buffer;
+
+    while ((buffer = mmal_queue_get(scaler->output_queue)) != NULL) {
+        mmal_buffer_header_release(buffer);
+    }
+
+    while (vcos_semaphore_trywait(&scaler->output_semaphore) == VCOS_SUCCESS) {
+    }
+}
+
+static void release_ports(yuv_scaler_t* scaler) {
+    if (scaler->input_port && scaler->input_port->is_enabled) {
+        mmal_port_disable(scaler->input_port);
+    }
+    if (scaler->output_port && scaler->output_port->is_enabled) {
+        mmal_port_disable(scaler->output_port);
+    }
+
+    if (scaler->output_queue) {
+        drain_output(scaler);
+    }
+
+    if (scaler->input_pool) {
+        mmal_port_pool_destroy(scaler->input_port, scaler->input_pool);
+        scaler->input_pool = NULL;
+    }
+    if (scaler->output_pool) {
+        mmal_port_pool_destroy(scaler->output_port, scaler->output_pool);
+        scaler->output_pool = NULL;
+    }
+}
+
+static bool setup_port(yuv_scaler_t* scaler, MMAL_PORT_T* port, int width, int height, const yuv_rect_t* crop,
+                       MMAL_POOL_T** pool, MMAL_PORT_BH_CB_T callback) {
+    MMAL_ES_FORMAT_T* format = port->format;
+    format->type = MMAL_ES_TYPE_VIDEO;
+    format->encoding = MMAL_ENCODING_I420;
+    format->es->video.width = VCOS_ALIGN_UP(width, 32);
+    format->es->video.height = VCOS_ALIGN_UP(height, 16);
+    format->es->video.crop.x = crop->x;
+    format->es->video.crop.y = crop->y;
+    format->es->video.crop.width = crop->width;
+    format->es->video.crop.height = crop->height;
+
+    MMAL_STATUS_T status = mmal_port_format_commit(port);
+    if (status != MMAL_SUCCESS) {
+        snprintf(scaler->error_message, sizeof(scaler->error_message),
+                "Failed to commit resizer format: %s", mmal_status_to_string(status));
+        return false;
+    }
+
+    port->buffer_num = port->buffer_num_recommended;
+    port->buffer_size = port->buffer_size_recommended;
+    *pool = mmal_port_pool_create(port, port->buffer_num, port->buffer_size);
+    if (!*pool) {
+        snprintf(scaler->error_message, sizeof(scaler->error_message),
+                "Failed to create resizer pool");
+        return false;
+    }
+
+    port->userdata = (struct MMAL_PORT_USERDATA_T*)scaler;
+    status = mmal_port_enable(port, callback);
+    if (status != MMAL_SUCCESS) {
+        snprintf(scaler->error_message, sizeof(scaler->error_message),
+                "Failed to enable resizer port: %s", mmal_status_to_string(status));
+        return false;
+    }
+
+    return true;
+}
+
+static bool configure_ports(yuv_scaler_t* scaler, const yuv420_frame_t* src, const yuv_rect_t* rect,
+                            int width, int height) {
+    if (scaler->input_pool && scaler->input_width == src->width && scaler->input_height == src->height &&
+        memcmp(&scaler->input_rect, rect, sizeof(yuv_rect_t)) == 0 &&
+        scaler->output_width == width && scaler->output_height == height) {
+        return true;
+    }
+
+    release_ports(scaler);
+    scaler->input_width = 0;
+
+    yuv_rect_t output_rect = {0, 0, width, height};
+    if (!setup_port(scaler, scaler->input_port, src->width, src->height, rect,
+                    &scaler->input_pool, input_callback) ||
+        !setup_port(scaler, scaler->output_port, width, height, &output_rect,
+                    &scaler->output_pool, output_callback)) {
+        return false;
+    }
+
+    scaler->input_rect = *rect;
+    scaler->input_width = src->width;
+    scaler->input_height = src->height;
+    scaler->output_width = width;
+    scaler->output_height = height;
+    return true;
+}
+
+static MMAL_BUFFER_HEADER_T* wait_for_output(yuv_scaler_t* scaler, uint64_t deadline_us) {
+    for (;;) {
+        uint64_t now_us = vcos_getmicrosecs64();
+        if (now_us >= deadline_us) {
+            pipeline_stats_add(PIPELINE_COUNTER_TIMEOUTS, 1);
+            snprintf(scaler->error_message, sizeof(scaler->error_message),
+                    "Timeout waiting for scaled frame");
+            return NULL;
+        }
+
+        if (vcos_semaphore_wait_timeout(&scaler->output_semaphore,
+                                        (VCOS_UNSIGNED)((deadline_us - now_us + 999) / 1000)) != VCOS_SUCCESS) {
+            continue;
+        }
+
+        MMAL_BUFFER_HEADER_T* buffer = mmal_queue_get(scaler->output_queue);
+        if (buffer) {
+            return buffer;
+        }
+    }
+}
+
+static MMAL_BUFFER_HEADER_T* wait_for_input(yuv_scaler_t* scaler, uint64_t deadline_us) {
+    uint64_t now_us = vcos_getmicrosecs64();
+    MMAL_BUFFER_HEADER_T* buffer = NULL;
+
+    if (now_us < deadline_us) {
+        buffer = mmal_queue_timedwait(scaler->input_pool->queue,
+                                      (VCOS_UNSIGNED)((deadline_us - now_us + 999) / 1000));
+    }
+
+    if (!buffer) {
+        pipeline_stats_add(PIPELINE_COUNTER_TIMEOUTS, 1);
+        snprintf(scaler->error_message, sizeof(scaler->error_message),
+                "Timeout waiting for resizer input buffer");
+    }
+
+    return buffer;
+}
+
+static bool scale_hardware(yuv_scaler_t* scaler, const yuv420_frame_t* src, const yuv_rect_t* rect) {
+    yuv420_frame_t* dst = &scaler->frame;
+    uint64_t deadline_us = vcos_getmicrosecs64() + (uint64_t)scaler->timeout_ms * 1000;
+
+    if (!configure_ports(scaler, src, rect, dst->width, dst->height)) {
+        return false;
+    }
+
+    drain_output(scaler);
+    MMAL_BUFFER_HEADER_T* buffer;
+    while ((buffer = mmal_queue_get(scaler->output_pool->queue)) != NULL) {
+        MMAL_STATUS_T status = mmal_port_send_buffer(scaler->output_port, buffer);
+        if (status != MMAL_SUCCESS) {
+            mmal_buffer_header_release(buffer);
+            snprintf(scaler->error_message, sizeof(scaler->error_message),
+                    "Failed to send resizer output buffer: %s", mmal_status_to_string(status));
+            return false;
+        }
+    }
+
+    buffer = wait_for_input(scaler, deadline_us);
+    if (!buffer) {
+        return false;
+    }
+
+    int stride = scaler->input_port->format->es->video.width;
+    int slice_height = scaler->input_port->format->es->video.height;
+    size_t length = (size_t)stride * slice_height * 3 / 2;
+    if (length > buffer->alloc_size) {
+        mmal_buffer_header_release(buffer);
+        snprintf(scaler->error_message, sizeof(scaler->error_message),
+                "Resizer input buffer too small");
+        return false;
+    }
+
+    uint8_t* u_dst = buffer->data + (size_t)stride * slice_height;
+    uint8_t* v_dst = u_dst + (size_t)(stride / 2) * (slice_height / 2);
+    yuv_copy_plane(buffer->data, stride, src->y_plane, src->width, src->width, src->height);
+    yuv_copy_plane(u_dst, stride / 2, src->u_plane, src->width / 2, src->width / 2, src->height / 2);
+    yuv_copy_plane(v_dst, stride / 2, src->v_plane, src->width / 2, src->width / 2, src->height / 2);
+    buffer->length = length;
+    buffer->offset = 0;
+    buffer->flags = MMAL_BUFFER_HEADER_FLAG_FRAME_END;
+
+    MMAL_STATUS_T status = mmal_port_send_buffer(scaler->input_port, buffer);
+    if (status != MMAL_SUCCESS) {
+        mmal_buffer_header_release(buffer);
+        snprintf(scaler->error_message, sizeof(scaler->error_message),
+                "Failed to send resizer input buffer: %s", mmal_status_to_string(status));
+        return false;
+    }
+
+    MMAL_BUFFER_HEADER_T* out = wait_for_output(scaler, deadline_us);
+    if (!out) {
+        return false;
+    }
+
+    stride = scaler->output_port->format->es->video.width;
+    slice_height = scaler->output_port->format->es->video.height;
+    const uint8_t* y_src = out->data + out->offset;
+    const uint8_t* u_src = y_src + (size_t)stride * slice_height;
+    const uint8_t* v_src = u_src + (size_t)(stride / 2) * (slice_height / 2);
+    yuv_copy_plane(dst->y_plane, dst->width, y_src, stride, dst->width, dst->height);
+    yuv_copy_plane(dst->u_plane, dst->width / 2, u_src, stride / 2, dst->width / 2, dst->height / 2);
+    yuv_copy_plane(dst->v_plane, dst->width / 2, v_src, stride / 2, dst->width / 2, dst->height / 2);
+    mmal_buffer_header_release(out);
+
+    return true;
+}
+
+static bool init_hardware(yuv_scaler_t* scaler) {
+    vcos_init();
+
+    if (vcos_semaphore_create(&scaler->output_semaphore, "scaler_sem", 0) != VCOS_SUCCESS) {
+        snprintf(scaler->error_message, sizeof(scaler->error_message),
+                "Failed to create semaphore");
+        return false;
+    }
+
+    scaler->output_queue = mmal_queue_create();
+    if (!scaler->output_queue) {
+        snprintf(scaler->error_message, sizeof(scaler->error_message),
+                "Failed to create output queue");
+        return false;
+    }
+
+    MMAL_STATUS_T status = mmal_component_create(MMAL_COMPONENT_DEFAULT_RESIZER, &scaler->resizer);
+    if (status != MMAL_SUCCESS) {
+        snprintf(scaler->error_message, sizeof(scaler->error_message),
+                "Failed to create resizer component: %s", mmal_status_to_string(status));
+        return false;
+    }
+
+    scaler->input_port = scaler->resizer->input[0];
+    scaler->output_port = scaler->resizer->output[0];
+
+    status = mmal_component_enable(scaler->resizer);
+    if (status != MMAL_SUCCESS) {
+        snprintf(scaler->error_message, sizeof(scaler->error_message),
+                "Failed to enable resizer: %s", mmal_status_to_string(status));
+        return false;
+    }
+
+    scaler->component_ready = true;
+    return true;
+}
+
+static void release_hardware(yuv_scaler_t* scaler) {
+    release_ports(scaler);
+
+    if (scaler->resizer && scaler->component_ready) {
+        mmal_component_disable(scaler->resizer);
+    }
+    if (scaler->output_queue) {
+        mmal_queue_destroy(scaler->output_queue);
+    }
+    if (scaler->resizer) {
+        mmal_component_destroy(scaler->resizer);
+    }
+
+    vcos_semaphore_delete(&scaler->output_semaphore);
+}
+#endif
+#endif
+
+bool yuv_scaler_init(yuv_scaler_t* scaler, bool use_hardware) {
+    if (!scaler) return false;
+
+    memset(scaler, 0, sizeof(yuv_scaler_t));
+    scaler->timeout_ms = YUV_SCALER_DEFAULT_TIMEOUT_MS;
+
+#ifdef RASPBERRY_PI
+#ifndef NO_HARDWARE
+    if (use_hardware) {
+        if (init_hardware(scaler)) {
+            scaler->hw_available = true;
+        } else {
+            release_hardware(scaler);
+            char message[sizeof(scaler->error_message)];
+            memcpy(message, scaler->error_message, sizeof(message));
+            memset(scaler, 0, sizeof(yuv_scaler_t));
+            memcpy(scaler->error_message, message, sizeof(message));
+            scaler->timeout_ms = YUV_SCALER_DEFAULT_TIMEOUT_MS;
+        }
+    }
+#else
+    (void)use_hardware;
+#endif
+#else
+    (void)use_hardware;
+#endif
+
+    return true;
+}
+
+void yuv_scaler_cleanup(yuv_scaler_t* scaler) {
+    if (!scaler) return;
+
+#ifdef RASPBERRY_PI
+#ifndef NO_HARDWARE
+    if (scaler->hw_available) {
+        release_hardware(scaler);
+    }
+#endif
+#endif
+
+    free(scaler->buffer);
+
+    char message[sizeof(scaler->error_message)];
+    memcpy(message, scaler->error_message, sizeof(message));
+    memset(scaler, 0, sizeof(yuv_scaler_t));
+    memcpy(scaler->error_message, message, sizeof(message));
+}
+
+static void copy_region(yuv_scaler_t* scaler, const yuv420_frame_t* src, const yuv_rect_t* rect) {
+    const yuv420_frame_t* dst = &scaler->frame;
+    int chroma_stride = src->width / 2;
+    size_t chroma_offset = (size_t)(rect->y / 2) * chroma_stride + rect->x / 2;
+
+    yuv_copy_plane(dst->y_plane, dst->width, src->y_plane + (size_t)rect->y * src->width + rect->x, src->width,
+                   dst->width, dst->height);
+    yuv_copy_plane(dst->u_plane, dst->width / 2, src->u_plane + chroma_offset, chroma_stride,
+                   dst->width / 2, dst->height / 2);
+    yuv_copy_plane(dst->v_plane, dst->width / 2, src->v_plane + chroma_offset, chroma_stride,
+                   dst->width / 2, dst->height / 2);
+}
+
+bool yuv_scaler_scale_region(yuv_scaler_t* scaler,
+                             const yuv420_frame_t* src,
+                             const yuv_rect_t* region,
+                             int target_width,
+                             int target_height,
+                             yuv_scale_aspect_t aspect,
+                             const yuv420_frame_t** scaled) {
+    if (!scaler || !src || !scaled) {
+        if (scaler) {
+            snprintf(scaler->error_message, sizeof(scaler->error_message),
+                    "Invalid parameters");
+        }
+        return false;
+    }
+
+    if (!src->y_plane || !src->u_plane || !src->v_plane) {
+        snprintf(scaler->error_message, sizeof(scaler->error_message),
+                "Invalid YUV frame data");
+        return false;
+    }
+
+    yuv_rect_t area = {0, 0, src->width, src->height};
+    if (region) {
+        if (region->x < 0 || region->y < 0 || region->width < 2 || region->height < 2 ||
+            ((region->x | region->y | region->width | region->height) & 1) ||
+            region->width > src->width - region->x || region->height > src->height - region->y) {
+            snprintf(scaler->error_message, sizeof(scaler->error_message),
+                    "Invalid region %dx%d+%d+%d for %dx%d frame", region->width, region->height,
+                    region->x, region->y, src->width, src->height);
+            return false;
+        }
+        area = *region;
+    }
+
+    yuv_rect_t rect;
+    int width;
+    int height;
+    if (!yuv_scale_plan(area.width, area.height, target_width, target_height, aspect, &rect, &width, &height)) {
+        snprintf(scaler->error_message, sizeof(scaler->error_message),
+                "Cannot scale %dx%d to %dx%d", area.width, area.height, target_width, target_height);
+        return false;
+    }
+    rect.x += area.x;
+    rect.y += area.y;
+
+    if (width == src->width && height == src->height && rect.width == src->width && rect.height == src->height) {
+        *scaled = src;
+        return true;
+    }
+
+    if (!reserve_frame(scaler, width, height)) {
+        return false;
+    }
+
+    uint64_t start_us = pipeline_time_now_us();
+    bool done = false;
+    if (rect.width == width && rect.height == height) {
+        copy_region(scaler, src, &rect);
+        done = true;
+    }
+#ifdef RASPBERRY_PI
+#ifndef NO_HARDWARE
+    if (!done && scaler->hw_available) {
+        done = scale_hardware(scaler, src, &rect);
+    }
+#endif
+#endif
+    if (!done && !scale_software(scaler, src, &rect)) {
+        return false;
+    }
+
+    pipeline_stats_record(PIPELINE_METRIC_SCALE, pipeline_time_now_us() - start_us);
+    *scaled = &scaler->frame;
+    return true;
+}
+
+bool yuv_scaler_scale(yuv_scaler_t* scaler,
+                      const yuv420_frame_t* src,
+                      int target_width,
+                      int target_height,
+                      yuv_scale_aspect_t aspect,
+                      const yuv420_frame_t** scaled) {
+    return yuv_scaler_scale_region(scaler, src, NULL, target_width, target_height, aspect, scaled);
+}
+
+const char* yuv_scaler_get_error(const yuv_scaler_t* scaler) {
+    if (!scaler) return "Invalid scaler context";
+    return scaler->error_message;
+}
+
+bool yuv_scaler_hw_available(void) {
+#ifdef RASPBERRY_PI
+#ifndef NO_HARDWARE
+    return true;
+#else
+    return false;
+#endif
+#else
+    return false;
+#endif
+}